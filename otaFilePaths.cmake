@@ -27,6 +27,7 @@ set( OTA_SOURCES
     "${CMAKE_CURRENT_LIST_DIR}/source/include/ota_os_interface.h"
     "${CMAKE_CURRENT_LIST_DIR}/source/include/ota_platform_interface.h"
     "${CMAKE_CURRENT_LIST_DIR}/source/include/ota_private.h"
+    "${CMAKE_CURRENT_LIST_DIR}/source/include/ota_job_doc_key_table.h"
     "${CMAKE_CURRENT_LIST_DIR}/source/include/ota_interface_private.h"
     "${CMAKE_CURRENT_LIST_DIR}/source/include/ota_base64_private.h"
     "${CMAKE_CURRENT_LIST_DIR}/source/ota.c"
@@ -71,6 +72,18 @@ set( OTA_INCLUDE_OS_FREERTOS_DIRS
     "${CMAKE_CURRENT_LIST_DIR}/source/portable/os"
 )
 
+# OTA library POSIX HTTP client source files.
+# Note: this is a reference plain HTTP/1.1 client of the OTA HTTP interface,
+# it does not implement TLS.
+set( OTA_HTTP_POSIX_SOURCES
+    "${CMAKE_CURRENT_LIST_DIR}/source/portable/http/ota_http_posix.c"
+)
+
+# OTA library POSIX HTTP client include directories.
+set( OTA_INCLUDE_HTTP_POSIX_DIRS
+    "${CMAKE_CURRENT_LIST_DIR}/source/portable/http"
+)
+
 # OTA library MQTT backend source files.
 set( OTA_MQTT_SOURCES
     "${CMAKE_CURRENT_LIST_DIR}/source/ota_mqtt.c"
@@ -84,3 +97,16 @@ set( OTA_HTTP_SOURCES
     "${CMAKE_CURRENT_LIST_DIR}/source/ota_http.c"
     "${CMAKE_CURRENT_LIST_DIR}/source/include/ota_http_private.h"
 )
+
+# OTA library CoAP backend source files.
+set( OTA_COAP_SOURCES
+    "${CMAKE_CURRENT_LIST_DIR}/source/ota_coap.c"
+    "${CMAKE_CURRENT_LIST_DIR}/source/include/ota_coap_private.h"
+)
+
+# OTA library MQTT and HTTP hybrid backend source files.
+# Note: requires both the MQTT and HTTP backend source files.
+set( OTA_HYBRID_SOURCES
+    "${CMAKE_CURRENT_LIST_DIR}/source/ota_hybrid.c"
+    "${CMAKE_CURRENT_LIST_DIR}/source/include/ota_hybrid_private.h"
+)
@@ -41,6 +41,7 @@
 #include "ota_os_interface.h"
 #include "ota_mqtt_interface.h"
 #include "ota_http_interface.h"
+#include "ota_coap_interface.h"
 #include "ota_platform_interface.h"
 
 /**
@@ -100,7 +101,9 @@ typedef enum OtaErr
     OtaErrUserAbort,              /*!< User aborted the active OTA. */
     OtaErrFailedToEncodeCbor,     /*!< Failed to encode CBOR object for requesting data block from streaming service. */
     OtaErrFailedToDecodeCbor,     /*!< Failed to decode CBOR object from streaming service response. */
-    OtaErrActivateFailed          /*!< Failed to activate the new image. */
+    OtaErrActivateFailed,         /*!< Failed to activate the new image. */
+    OtaErrUrlExpired,             /*!< The pre-signed url for the file download was rejected. */
+    OtaErrStaleFileBlock          /*!< The file block belongs to a request that is no longer in flight. */
 } OtaErr_t;
 
 /**
@@ -216,7 +219,8 @@ typedef void (* OtaAppCallback_t)( OtaJobEvent_t eEvent,
  * @brief Custom Job callback function typedef.
  *
  * The user may register a callback function when initializing the OTA Agent. This
- * callback will be called when the OTA agent cannot parse a job document.
+ * callback will be called when the OTA agent cannot parse a JSON job document. It is not
+ * called for a CBOR job document, see @ref OtaCustomJobDocCallback_t.
  *
  * @param[in] pcJSON Pointer to the json document received by the OTA agent
  * @param[in] ulMsgLen Length of the json document received by the agent
@@ -224,6 +228,42 @@ typedef void (* OtaAppCallback_t)( OtaJobEvent_t eEvent,
 typedef OtaJobParseErr_t (* OtaCustomJobCallback_t)( const char * pcJSON,
                                                      uint32_t ulMsgLen );
 
+/**
+ * @ingroup ota_datatypes_structs
+ * @brief Read-only view of the values that the OTA agent found in a job document.
+ *
+ * The members are private to the OTA agent, the values are read with
+ * @ref OTA_GetJobDocValue.
+ */
+typedef struct OtaJobDocView
+{
+    const void * pKeyTable; /*!< Hash table of the key paths of the job document model. */
+    const void * pParams;   /*!< Parameters of the job document model, for their keys. */
+    uint16_t numParams;     /*!< Number of parameters of the job document model. */
+    const void * pSpans;    /*!< Values found in the document, in the order of the model. */
+    uint32_t spansFound;    /*!< Bitmap of the parameters with a value in the document. */
+} OtaJobDocView_t;
+
+/**
+ * @ingroup ota_datatypes_functionpointers
+ * @brief Custom Job callback function typedef with the values found in the job document.
+ *
+ * The user may register this callback with @ref OTA_SetCustomJobDocCallback. It is called
+ * instead of the custom job callback when the OTA agent cannot parse a job document. The
+ * values of the keys of the job document model that the agent found in the document are
+ * passed along, so that they can be read with @ref OTA_GetJobDocValue without searching
+ * the document again.
+ *
+ * @param[in] pcJSON Pointer to the job document received by the OTA agent. It is a CBOR
+ * document instead of a JSON document if its first byte is the head of a CBOR map.
+ * @param[in] ulMsgLen Length of the job document received by the agent
+ * @param[in] pDocView The values found in the document, NULL if the document is neither
+ * valid JSON nor valid CBOR. It is only valid during the call.
+ */
+typedef OtaJobParseErr_t (* OtaCustomJobDocCallback_t)( const char * pcJSON,
+                                                        uint32_t ulMsgLen,
+                                                        const OtaJobDocView_t * pDocView );
+
 /*--------------------------- OTA structs ----------------------------*/
 
 
@@ -233,6 +273,15 @@ typedef OtaJobParseErr_t (* OtaCustomJobCallback_t)( const char * pcJSON,
  *
  * Information about the different interfaces used to initialize
  * the OTA agent with references to components.
+ *
+ * @note The structure must be zero-initialized, for example by declaring it
+ * static or with memset, before the interfaces are set. The optional
+ * interfaces, such as mqtt.publishWithProperties, http.requestWithContext,
+ * http.requestWithOffset, os.timer.getTimeMs, pal.saveProbeResult,
+ * pal.loadProbeResult and the coap interface, are only used when they are not
+ * NULL. Members added to these
+ * structures in later versions are optional as well, so an application that
+ * zero-initializes the structure keeps working without setting them.
  */
 typedef struct OtaInterface
 {
@@ -240,6 +289,7 @@ typedef struct OtaInterface
     OtaMqttInterface_t mqtt; /*!< MQTT interface that references the publish subscribe methods and callbacks. */
     OtaHttpInterface_t http; /*!< HTTP interface to request data. */
     OtaPalInterface_t pal;   /*!< OTA PAL callback structure. */
+    OtaCoapInterface_t coap; /*!< CoAP interface to request data with block-wise transfers. */
 } OtaInterfaces_t;
 
 /**
@@ -288,6 +338,7 @@ typedef struct OtaAgentContext
     OtaInterfaces_t * pOtaInterface;                       /*!< Collection of all interfaces used by the agent. */
     OtaAppCallback_t OtaAppCallback;                       /*!< OTA App callback. */
     OtaCustomJobCallback_t customJobCallback;              /*!< Custom job callback. */
+    OtaCustomJobDocCallback_t customJobDocCallback;        /*!< Custom job callback with the values found in the job document. */
 } OtaAgentContext_t;
 
 /*------------------------- OTA Public API --------------------------*/
@@ -300,7 +351,8 @@ typedef struct OtaAgentContext
  * OTA Agent may exist.
  *
  * @param[in] pOtaBuffer Buffers used by the agent to store different params.
- * @param[in] pOtaInterfaces A pointer to the OS context.
+ * @param[in] pOtaInterfaces A pointer to the OS context. It must be zero-initialized before the
+ * interfaces are set, see @ref OtaInterfaces_t.
  * @param[in] pThingName A pointer to a C string holding the Thing name.
  * @param[in] OtaAppCallback Static callback function for when an OTA job is complete. This function will have
  * input of the state of the OTA image after download and during self-test.
@@ -372,6 +424,38 @@ OtaErr_t OTA_SetImageState( OtaImageState_t state );
  */
 OtaImageState_t OTA_GetImageState( void );
 
+/**
+ * @brief Register the custom job callback with the values found in the job document.
+ *
+ * The callback is called when the OTA agent cannot parse a job document, see
+ * OtaCustomJobDocCallback_t. It must be registered after @ref OTA_Init, shutting down the
+ * OTA agent unregisters it.
+ *
+ * @param[in] customJobDocCallback The callback, or NULL to unregister it.
+ */
+void OTA_SetCustomJobDocCallback( OtaCustomJobDocCallback_t customJobDocCallback );
+
+/**
+ * @brief Get the value of a key of the job document model in a job document.
+ *
+ * The key is the full key path of the model, for example "execution.jobId", and is found
+ * with one lookup in the hash table of the model. Keys of the file parameters, for example
+ * "filepath", give the value in the first file of the document. Strings are returned
+ * without their quotes, objects and arrays with their brackets. The values of a CBOR job
+ * document are the encoded CBOR data items. The value is not zero terminated.
+ *
+ * @param[in] pDocView The values found in the job document, passed to the custom job callback.
+ * @param[in] pKey The zero terminated key path.
+ * @param[out] pValue The start of the value in the job document.
+ * @param[out] pValueLength The length of the value.
+ *
+ * @return true if the key is in the model and its value was found in the document.
+ */
+bool OTA_GetJobDocValue( const OtaJobDocView_t * pDocView,
+                         const char * pKey,
+                         const char ** pValue,
+                         size_t * pValueLength );
+
 /**
  * @brief Request for the next available OTA job from the job service.
  *
@@ -83,6 +83,21 @@ typedef enum Base64Status
     Base64InvalidPaddingSymbol
 } Base64Status_t;
 
+/**
+ * @brief State of a Base64 decoding of data received in several parts.
+ *
+ * The sextets of an incomplete group of four symbols and the padding and
+ * whitespace that have been parsed are carried over to the next part.
+ */
+typedef struct Base64DecodeContext
+{
+    uint32_t base64IndexBuffer; /*!< Sextets of the incomplete group of four symbols. */
+    uint32_t numDataInBuffer;   /*!< Number of sextets in base64IndexBuffer. */
+    int64_t numPadding;         /*!< Number of padding symbols parsed. */
+    int64_t numWhitespace;      /*!< Number of whitespace symbols parsed. */
+    size_t encodedLen;          /*!< Number of encoded symbols parsed. */
+} Base64DecodeContext_t;
+
 /**
  * @brief Decode Base64 encoded data.
  *
@@ -105,4 +120,84 @@ Base64Status_t base64Decode( uint8_t * pDest,
                              const uint8_t * pEncodedData,
                              const size_t encodedLen );
 
+/**
+ * @brief Start a Base64 decoding of data received in several parts.
+ *
+ * @param[out] pContext The decoding context to initialize.
+ *
+ * @return     #Base64Success, or #Base64NullPointerInput if pContext is NULL.
+ */
+Base64Status_t base64DecodeInit( Base64DecodeContext_t * pContext );
+
+/**
+ * @brief Decode the next part of Base64 encoded data.
+ *
+ * The groups of four symbols completed by this part are decoded. The symbols
+ * of an incomplete group are kept in the context and decoded with the next
+ * part, or by base64DecodeFinal. The parts may be split at any symbol, so this
+ * writes at most ( ( number of symbols kept + encodedLen ) / 4 ) * 3 bytes.
+ * After an error, the context must be initialized again.
+ *
+ * @param[in,out] pContext The decoding context.
+ * @param[out] pDest Pointer to a buffer for storing the decoded result of this part.
+ * @param[in]  destLen Length of the pDest buffer.
+ * @param[out] pResultLen Pointer to the length of the decoded result of this part.
+ * @param[in]  pEncodedData Pointer to a buffer containing the part of the Base64
+ *             encoded data.
+ * @param[in]  encodedLen Length of the pEncodedData buffer.
+ *
+ * @return     One of the following:
+ *             - #Base64Success if the part was valid and successfully decoded.
+ *             - An error code defined in ota_base64_private.h if the
+ *               encoded data or input parameters are invalid.
+ */
+Base64Status_t base64DecodeUpdate( Base64DecodeContext_t * pContext,
+                                   uint8_t * pDest,
+                                   const size_t destLen,
+                                   size_t * pResultLen,
+                                   const uint8_t * pEncodedData,
+                                   const size_t encodedLen );
+
+/**
+ * @brief Finish a Base64 decoding of data received in several parts.
+ *
+ * The symbols of the last incomplete group, ended by padding or by the end of
+ * the data, are decoded. This writes at most 2 bytes.
+ *
+ * @param[in,out] pContext The decoding context.
+ * @param[out] pDest Pointer to a buffer for storing the last decoded bytes.
+ * @param[in]  destLen Length of the pDest buffer.
+ * @param[out] pResultLen Pointer to the number of the last decoded bytes.
+ *
+ * @return     One of the following:
+ *             - #Base64Success if the Base64 encoded data was valid
+ *               and successfully decoded.
+ *             - An error code defined in ota_base64_private.h if the
+ *               encoded data or input parameters are invalid.
+ */
+Base64Status_t base64DecodeFinal( Base64DecodeContext_t * pContext,
+                                  uint8_t * pDest,
+                                  const size_t destLen,
+                                  size_t * pResultLen );
+
+/**
+ * @brief Encode data with Base64, with padding.
+ *
+ * @param[out] pDest Pointer to a buffer for storing the encoded result.
+ * @param[in]  destLen Length of the pDest buffer.
+ * @param[out] pResultLen Pointer to the length of the encoded result.
+ * @param[in]  pData Pointer to a buffer containing the data to encode.
+ * @param[in]  dataLen Length of the pData buffer.
+ *
+ * @return     One of the following:
+ *             - #Base64Success if the data was successfully encoded.
+ *             - An error code defined in ota_base64_private.h if the
+ *               input parameters are invalid.
+ */
+Base64Status_t base64Encode( uint8_t * pDest,
+                             const size_t destLen,
+                             size_t * pResultLen,
+                             const uint8_t * pData,
+                             const size_t dataLen );
+
 #endif /* ifndef __OTA_BASE64_PRIVATE__H__ */
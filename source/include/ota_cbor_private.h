@@ -41,6 +41,20 @@
 #define OTA_CBOR_BLOCKID_KEY              "i"
 #define OTA_CBOR_BLOCKPAYLOAD_KEY         "p"
 #define OTA_CBOR_NUMBEROFBLOCKS_KEY       "n"
+#define OTA_CBOR_BLOCKS_KEY               "m"
+
+/**
+ * @brief Positions of the fields of a Get Stream Request message that change
+ * between the requests of a file transfer.
+ */
+typedef struct OtaCborGetStreamRequest
+{
+    size_t messageSize;      /*!< Size of the encoded message, 0 if no template is encoded. */
+    size_t blockOffsetIndex; /*!< Index of the block offset, an integer in 5 bytes. */
+    size_t blockBitmapIndex; /*!< Index of the bytes of the block bitmap. */
+    size_t blockBitmapSize;  /*!< Size of the block bitmap. */
+    size_t numOfBlocksIndex; /*!< Index of the number of blocks requested, an integer in 5 bytes. */
+} OtaCborGetStreamRequest_t;
 
 /**
  * @brief Decode a Get Stream response message from AWS IoT OTA.
@@ -53,6 +67,57 @@ bool OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pMessageBuffer,
                                                uint8_t ** pPayload,
                                                size_t * pPayloadSize );
 
+/**
+ * @brief Decode a Get Stream response message from AWS IoT OTA in a single
+ * pass over its map, without copying the payload.
+ *
+ * The payload is returned as a view into the message. It fails for a payload
+ * that is a chunked byte string and for a response with several blocks, which
+ * are decoded by the functions that copy the payload.
+ */
+bool OTA_CBOR_Decode_GetStreamResponseMessageView( const uint8_t * pMessageBuffer,
+                                                   size_t messageSize,
+                                                   int32_t * pFileId,
+                                                   int32_t * pBlockId,
+                                                   int32_t * pBlockSize,
+                                                   const uint8_t ** pPayload,
+                                                   size_t * pPayloadSize );
+
+/**
+ * @brief Decode a Get Stream response message in the layout sent by the
+ * service, without tinycbor.
+ *
+ * The payload is returned as a view into the message. It fails for any other
+ * layout, such as keys in another order, which is decoded by the functions
+ * that use tinycbor.
+ */
+bool OTA_CBOR_Decode_GetStreamResponseMessageFast( const uint8_t * pMessageBuffer,
+                                                   size_t messageSize,
+                                                   int32_t * pFileId,
+                                                   int32_t * pBlockId,
+                                                   int32_t * pBlockSize,
+                                                   const uint8_t ** pPayload,
+                                                   size_t * pPayloadSize );
+
+/**
+ * @brief Decode a block of a Get Stream response message that may carry
+ * several blocks.
+ *
+ * A response with several blocks is an extension of the service protocol.
+ * Its map has the file ID and, instead of the block ID, size and payload, an
+ * array of maps with the block ID, size and payload of each block. A response
+ * in the format of the service carries one block.
+ */
+bool OTA_CBOR_Decode_GetStreamResponseMessageBlock( const uint8_t * pMessageBuffer,
+                                                    size_t messageSize,
+                                                    size_t blockNumber,
+                                                    int32_t * pFileId,
+                                                    int32_t * pBlockId,
+                                                    int32_t * pBlockSize,
+                                                    uint8_t ** pPayload,
+                                                    size_t * pPayloadSize,
+                                                    size_t * pNumBlocks );
+
 /**
  * @brief Create an encoded Get Stream Request message for the AWS IoT OTA
  * service. The service allows block count or block bitmap to be requested,
@@ -65,8 +130,32 @@ bool OTA_CBOR_Encode_GetStreamRequestMessage( uint8_t * pMessageBuffer,
                                               int32_t fileId,
                                               int32_t blockSize,
                                               int32_t blockOffset,
-                                              uint8_t * pBlockBitmap,
+                                              const uint8_t * pBlockBitmap,
                                               size_t blockBitmapSize,
                                               int32_t numOfBlocksRequested );
 
+/**
+ * @brief Encode the template of the Get Stream Request messages of a file
+ * transfer, with the block offset, block bitmap and number of blocks
+ * requested at fixed positions.
+ */
+bool OTA_CBOR_Encode_GetStreamRequestTemplate( uint8_t * pMessageBuffer,
+                                               size_t messageBufferSize,
+                                               OtaCborGetStreamRequest_t * pRequest,
+                                               const char * pClientToken,
+                                               int32_t fileId,
+                                               int32_t blockSize,
+                                               size_t blockBitmapSize );
+
+/**
+ * @brief Write the block offset, block bitmap and number of blocks requested
+ * of a Get Stream Request message into its template.
+ */
+bool OTA_CBOR_Patch_GetStreamRequestMessage( uint8_t * pMessageBuffer,
+                                             const OtaCborGetStreamRequest_t * pRequest,
+                                             int32_t blockOffset,
+                                             const uint8_t * pBlockBitmap,
+                                             size_t blockBitmapSize,
+                                             int32_t numOfBlocksRequested );
+
 #endif /* ifndef __OTACBOR__H__ */
@@ -0,0 +1,125 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#ifndef _OTA_COAP_INTERFACE_H_
+#define _OTA_COAP_INTERFACE_H_
+
+/* Standard library includes. */
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The OTA CoAP interface return status.
+ */
+typedef enum OtaCoapStatus
+{
+    OtaCoapSuccess = 0,       /*!< OTA CoAP interface success. */
+    OtaCoapInitFailed = 0xd0, /*!< Error initializing the CoAP session. */
+    OtaCoapDeinitFailed,      /*!< Error deinitializing the CoAP session. */
+    OtaCoapRequestFailed      /*!< Error sending the CoAP request. */
+} OtaCoapStatus_t;
+
+/**
+ * @brief Block number of a Block2 option value (RFC 7959).
+ */
+#define OTA_COAP_BLOCK2_NUM( option )       ( ( option ) >> 4U )
+
+/**
+ * @brief More flag of a Block2 option value, 1 if blocks follow this one.
+ */
+#define OTA_COAP_BLOCK2_MORE( option )      ( ( ( option ) >> 3U ) & 1U )
+
+/**
+ * @brief Size exponent of a Block2 option value, the block size is 2 ^ ( SZX + 4 ) bytes.
+ */
+#define OTA_COAP_BLOCK2_SZX( option )       ( ( option ) & 7U )
+
+/**
+ * @brief File offset of the payload of a Block2 response.
+ */
+#define OTA_COAP_BLOCK2_OFFSET( option )    ( OTA_COAP_BLOCK2_NUM( option ) << ( OTA_COAP_BLOCK2_SZX( option ) + 4U ) )
+
+/**
+ * @brief Init OTA CoAP interface.
+ *
+ * This function parses the coap:// or coaps:// uri of the update file from
+ * the job document and sets up the session with the server.
+ *
+ * @param[in] pUri         Pointer to the uri for downloading update file.
+ *
+ * @return              OtaCoapSuccess if success , other error code on failure.
+ */
+
+typedef OtaCoapStatus_t ( * ota_CoapInit_t ) ( char * pUri );
+
+/**
+ * @brief Request file blocks over CoAP.
+ *
+ * This function requests numBlocks consecutive blocks of the file with
+ * block-wise transfers (RFC 7959). Each block is a GET request for the uri
+ * with a Block2 option of block number blockNumber, blockNumber + 1, ... and
+ * the size exponent blockSizeExponent. The requests may be sent one after
+ * another as the responses arrive, to stay within the NSTART limit of the
+ * server.
+ *
+ * The payload of every Block2 response must be passed to the OTA agent as an
+ * OtaAgentEventReceivedFileChunk event at the file offset of the block,
+ * see OTA_COAP_BLOCK2_OFFSET. The blocks of a request must be passed in order.
+ *
+ * @param[in] blockNumber         Number of the first block to request.
+ *
+ * @param[in] numBlocks           Number of blocks to request.
+ *
+ * @param[in] blockSizeExponent   SZX of the Block2 option, from 0 to 6.
+ *
+ * @return             OtaCoapSuccess if success , other error code on failure.
+ */
+
+typedef OtaCoapStatus_t ( * ota_CoapRequest_t )  ( uint32_t blockNumber,
+                                                   uint32_t numBlocks,
+                                                   uint8_t blockSizeExponent );
+
+/**
+ * @brief Deinit OTA CoAP interface.
+ *
+ * This function cleanups the CoAP session and other data used for
+ * requesting file blocks.
+ *
+ * @return        OtaCoapSuccess if success , other error code on failure.
+ */
+typedef OtaCoapStatus_t ( * ota_CoapDeinit_t )( void );
+
+/**
+ * @brief OTA CoAP Interface structure.
+ *
+ */
+typedef struct OtaCoapInterface
+{
+    ota_CoapInit_t init;       /*!< Reference to CoAP initialization. */
+    ota_CoapRequest_t request; /*!< Reference to CoAP block-wise data request. */
+    ota_CoapDeinit_t deinit;   /*!< Reference to CoAP deinitialize. */
+} OtaCoapInterface_t;
+
+#endif /* ifndef _OTA_COAP_INTERFACE_H_ */
@@ -0,0 +1,114 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_coap_private.h
+ * @brief Data transfer over CoAP with block-wise transfers.
+ */
+
+#ifndef __OTA_COAP__H__
+#define __OTA_COAP__H__
+
+/* OTA includes. */
+#include "ota.h"
+#include "ota_private.h"
+
+
+/**
+ * @brief Initialize file transfer over CoAP.
+ *
+ * This function initializes the file transfer after the OTA job is parsed and accepted
+ * by initializing the coap component with the uri from the job document.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+OtaErr_t initFileTransfer_Coap( OtaAgentContext_t * pAgentCtx );
+
+
+/**
+ * @brief Request File blocks over CoAP.
+ *
+ * This function requests up to otaconfigCOAP_MAX_NUM_BLOCKS_REQUEST file blocks with
+ * Block2 transfers. The request starts at the first block missing in the receive block
+ * bitmap and covers the contiguous missing blocks after it, so retries only request the
+ * blocks still missing. Blocks are requested in CoAP blocks of the file block size, or
+ * of 1024 bytes if the file block is larger than the largest Block2 size.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+OtaErr_t requestFileBlock_Coap( OtaAgentContext_t * pAgentCtx );
+
+
+/**
+ * @brief Stub for decoding the file block.
+ *
+ * The payload of the Block2 responses is passed to the OTA agent as file chunks at the
+ * offset of the block, so that file blocks larger than a CoAP block can be assembled
+ * without a buffer. File block events are not expected over CoAP and are rejected.
+ *
+ * @param[in] pMessageBuffer The message to be decoded.
+ * @param[in] messageSize     The size of the message in bytes.
+ * @param[out] pFileId        The server file ID.
+ * @param[out] pBlockId       The file block ID.
+ * @param[out] pBlockSize     The file block size.
+ * @param[out] pPayload     The payload.
+ * @param[out] pPayloadSize   The payload size.
+ *
+ * @return OtaErrInvalidArg as file blocks are received as file chunks.
+ */
+OtaErr_t decodeFileBlock_Coap( const uint8_t * pMessageBuffer,
+                               size_t messageSize,
+                               int32_t * pFileId,
+                               int32_t * pBlockId,
+                               int32_t * pBlockSize,
+                               uint8_t ** pPayload,
+                               size_t * pPayloadSize );
+
+/**
+ * @brief Cleanup related to OTA data plane over CoAP.
+ *
+ * This function deinits the coap component.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+
+OtaErr_t cleanupData_Coap( const OtaAgentContext_t * pAgentCtx );
+
+/**
+ * @brief Status to string conversion for OTA CoAP interface status.
+ *
+ * @param[in] status The status to convert to a string.
+ *
+ * @return The string representation of the status.
+ */
+const char * OTA_COAP_strerror( OtaCoapStatus_t status );
+
+#endif /* ifndef __OTA_COAP__H__ */
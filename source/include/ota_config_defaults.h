@@ -111,6 +111,88 @@
     #define otaconfigMAX_NUM_BLOCKS_REQUEST    1U
 #endif
 
+/**
+ * @brief The maximum number of data blocks in one MQTT stream response.
+ *
+ * @note The stream responses of the service carry one block. A stream server
+ * that implements the multi-block extension packs several blocks into one
+ * response, an array of block ID and payload entries, which the OTA agent
+ * ingests in one event. This saves the broker, TLS and queue overhead of a
+ * message for every block. The event buffers grow to hold a response of this
+ * many blocks, so keep it at or below otaconfigMAX_NUM_BLOCKS_REQUEST. Responses
+ * with more blocks are rejected.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer value greater than 0. <br>
+ * <b>Default value:</b> '1'
+ */
+#ifndef otaconfigMQTT_MAX_BLOCKS_PER_RESPONSE
+    #define otaconfigMQTT_MAX_BLOCKS_PER_RESPONSE    1U
+#endif
+
+/**
+ * @brief The maximum number of data blocks requested in one HTTP range request.
+ *
+ * @note Every HTTP request costs a round trip to the server. Requesting several
+ * blocks per range lowers this overhead for large files. For example if block
+ * size is set as 4 KB then a value of 64 requests 256 KB per range. The blocks
+ * of a range are ingested one by one, and if the range is not received
+ * completely, only its missing blocks are requested again.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer value greater than 0. <br>
+ * <b>Default value:</b> '1'
+ */
+#ifndef otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST
+    #define otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST    1U
+#endif
+
+/**
+ * @brief The maximum number of HTTP range requests in flight at the same time.
+ *
+ * @note This is only used if the HTTP interface provides requestWithContext.
+ * Each request is identified by its own context id, and the application can
+ * serve each on its own connection. A new range is requested as soon as one
+ * in flight is complete. Several requests in flight help fill links with a
+ * large bandwidth-delay product. Every request asks for up to
+ * otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST blocks.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer value from 1 to 256. <br>
+ * <b>Default value:</b> '1'
+ */
+#ifndef otaconfigHTTP_MAX_PARALLEL_REQUESTS
+    #define otaconfigHTTP_MAX_PARALLEL_REQUESTS    1U
+#endif
+
+/**
+ * @brief The maximum size of the file data of a file chunk event.
+ *
+ * @note The buffers of OtaAgentEventReceivedFileChunk events are sized by this
+ * value instead of the file block size, so that the memory needed to receive a
+ * response body in chunks does not grow with the block size. Larger chunks must
+ * be split by the application.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer value greater than 0. <br>
+ * <b>Default value:</b> '1024'
+ */
+#ifndef otaconfigFILE_CHUNK_SIZE
+    #define otaconfigFILE_CHUNK_SIZE    1024U
+#endif
+
+/**
+ * @brief The maximum number of data blocks requested at once over CoAP.
+ *
+ * @note The blocks are fetched with block-wise transfers, one Block2 request
+ * per CoAP block of up to 1 KB. A file block larger than that takes several
+ * Block2 requests. Requesting more file blocks at once lets the application
+ * send the next Block2 request as soon as a response arrives, without waiting
+ * for the agent to ingest the file block first.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer value greater than 0. <br>
+ * <b>Default value:</b> '1'
+ */
+#ifndef otaconfigCOAP_MAX_NUM_BLOCKS_REQUEST
+    #define otaconfigCOAP_MAX_NUM_BLOCKS_REQUEST    1U
+#endif
+
 /**
  * @brief The maximum number of requests allowed to send without a response
  * before we abort.
@@ -126,12 +208,30 @@
     #define otaconfigMAX_NUM_REQUEST_MOMENTUM    32U
 #endif
 
+/**
+ * @brief The maximum number of times the pre-signed url is refreshed without
+ * receiving a file block in between.
+ *
+ * @note When the HTTP server rejects the pre-signed url of the file, for example
+ * because it expired, the agent requests the job document of the active job again
+ * and continues the download with the fresh url. The blocks received so far are
+ * kept. Once this limit is reached, url rejections count as failed requests like
+ * any other.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer. <br>
+ * <b>Default value:</b> '3'
+ */
+#ifndef otaconfigMAX_NUM_URL_REFRESH
+    #define otaconfigMAX_NUM_URL_REFRESH    3U
+#endif
+
 /**
  * @brief How frequently the device will report its OTA progress to the cloud.
  *
- * @note Device will update the job status with the number of blocks it has received every certain
- * number of blocks it receives. For example, 64 means device will update job status every 64 blocks
- * it receives.
+ * @note Deprecated. Progress updates are now rate limited by
+ * otaconfigOTA_STATUS_MIN_INTERVAL_MS and otaconfigOTA_STATUS_MIN_PROGRESS_PERCENT.
+ * This value is no longer used by the agent and is only kept so that existing
+ * configurations still build.
  *
  * <b>Possible values:</b> Any unsigned 32 integer. <br>
  * <b>Default value:</b> '64'
@@ -140,6 +240,37 @@
     #define otaconfigOTA_UPDATE_STATUS_FREQUENCY    64U
 #endif
 
+/**
+ * @brief Minimum time in milliseconds between two progress updates sent to the
+ * cloud while receiving a file.
+ *
+ * @note The job status is updated with the number of blocks received out of the
+ * total number of blocks of the file. An update is sent once this interval has
+ * elapsed since the previous update and the download has progressed by at least
+ * otaconfigOTA_STATUS_MIN_PROGRESS_PERCENT. Set to '0' to only rate limit the
+ * updates by download progress.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer. <br>
+ * <b>Default value:</b> '10000'
+ */
+#ifndef otaconfigOTA_STATUS_MIN_INTERVAL_MS
+    #define otaconfigOTA_STATUS_MIN_INTERVAL_MS    10000U
+#endif
+
+/**
+ * @brief Minimum download progress in percent between two progress updates
+ * sent to the cloud while receiving a file.
+ *
+ * @note See otaconfigOTA_STATUS_MIN_INTERVAL_MS. Set to '0' to only rate limit
+ * the updates by time.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer from 0 to 100. <br>
+ * <b>Default value:</b> '1'
+ */
+#ifndef otaconfigOTA_STATUS_MIN_PROGRESS_PERCENT
+    #define otaconfigOTA_STATUS_MIN_PROGRESS_PERCENT    1U
+#endif
+
 /**
  * @brief The number of data buffers reserved by the OTA agent.
  *
@@ -169,6 +300,100 @@
     #define otaconfigAllowDowngrade    0U
 #endif
 
+/**
+ * @brief Flag to enable passive listening on a shared MQTT data stream.
+ *
+ * @note When devices of a fleet download the same stream, the blocks sent in
+ * response to one device's request are also useful to every other device
+ * subscribed to the same data topic. Set this configuration parameter to '1'
+ * to let the agent ingest any valid block of its file arriving on the data
+ * topic, regardless of which device requested it. Blocks of other files in the
+ * same stream are ignored. Instead of requesting the next blocks as soon as the
+ * previous request is served, the agent waits for the stream to be idle for
+ * a jittered hold-off time so that fleet members share the same transmissions.
+ * This only affects downloads over MQTT.
+ *
+ * <b>Possible values:</b> 0 or 1. <br>
+ * <b>Default value:</b> '0'
+ */
+#ifndef otaconfigENABLE_PASSIVE_STREAM_LISTEN
+    #define otaconfigENABLE_PASSIVE_STREAM_LISTEN    0U
+#endif
+
+/**
+ * @brief Milliseconds the data stream must be idle before a passive listener
+ * requests file blocks itself.
+ *
+ * @note Only used when otaconfigENABLE_PASSIVE_STREAM_LISTEN is set to '1'.
+ * The hold-off timer is restarted whenever a block arrives on the data topic.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer. <br>
+ * <b>Default value:</b> '2000'
+ */
+#ifndef otaconfigPASSIVE_REQUEST_HOLDOFF_MS
+    #define otaconfigPASSIVE_REQUEST_HOLDOFF_MS    2000U
+#endif
+
+/**
+ * @brief Maximum random jitter in milliseconds added to the passive listener
+ * hold-off time.
+ *
+ * @note Only used when otaconfigENABLE_PASSIVE_STREAM_LISTEN is set to '1'.
+ * The jitter is derived from the thing name and the download progress so that
+ * devices of a fleet do not all send their requests at the same time.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer. <br>
+ * <b>Default value:</b> '1000'
+ */
+#ifndef otaconfigPASSIVE_REQUEST_JITTER_MS
+    #define otaconfigPASSIVE_REQUEST_JITTER_MS    1000U
+#endif
+
+/**
+ * @brief Receive MQTT stream data as JSON instead of CBOR.
+ *
+ * @note When enabled, file blocks are requested on the `get/json` topic of
+ * the stream and received on its `data/json` topic. The payload of JSON
+ * stream messages is Base64 encoded, which makes them about a third larger
+ * than CBOR ones. Only enable this when the MQTT path cannot carry CBOR.
+ *
+ * <b>Possible values:</b> Enabled(1) or Disabled(0) <br>
+ * <b>Default value:</b> '0'
+ */
+#ifndef otaconfigENABLE_MQTT_JSON_STREAM
+    #define otaconfigENABLE_MQTT_JSON_STREAM    0U
+#endif
+
+/**
+ * @brief MQTT 5 topic alias used for the stream request topic.
+ *
+ * @note Only used when the MQTT interface provides publishWithProperties. The
+ * stream request topic `$aws/things/<thing>/streams/<stream>/get/cbor` is sent
+ * with every block request, and is often larger than the request itself. Set
+ * this to a topic alias between 1 and the Topic Alias Maximum of the broker to
+ * let the MQTT client replace the topic with the alias. Set to '0' to disable.
+ *
+ * <b>Possible values:</b> Any unsigned 16 integer. <br>
+ * <b>Default value:</b> '0'
+ */
+#ifndef otaconfigMQTT_TOPIC_ALIAS_GET_STREAM
+    #define otaconfigMQTT_TOPIC_ALIAS_GET_STREAM    0U
+#endif
+
+/**
+ * @brief MQTT 5 topic alias used for the job status update topic.
+ *
+ * @note Only used when the MQTT interface provides publishWithProperties. Must
+ * be different from otaconfigMQTT_TOPIC_ALIAS_GET_STREAM. Set to '0' to
+ * disable.
+ *
+ * <b>Possible values:</b> Any unsigned 16 integer. <br>
+ * <b>Default value:</b> '0'
+ */
+#ifndef otaconfigMQTT_TOPIC_ALIAS_JOB_STATUS
+    #define otaconfigMQTT_TOPIC_ALIAS_JOB_STATUS    0U
+#endif
+
 /**
  * @brief The protocol selected for OTA control operations.
  *
@@ -193,6 +418,7 @@
  * Enable data over MQTT - ( OTA_DATA_OVER_MQTT ) <br>
  * Enable data over HTTP - ( OTA_DATA_OVER_HTTP ) <br>
  * Enable data over both MQTT & HTTP - ( OTA_DATA_OVER_MQTT | OTA_DATA_OVER_HTTP ) <br>
+ * Enable data over CoAP, alone or with the others - ( OTA_DATA_OVER_COAP ) <br>
  * <b>Default value:</b> 'OTA_DATA_OVER_MQTT'
  */
 #ifndef configENABLED_DATA_PROTOCOLS
@@ -208,12 +434,62 @@
  * <b>Possible values:</b><br>
  * Data over MQTT - ( OTA_DATA_OVER_MQTT ) <br>
  * Data over HTTP - ( OTA_DATA_OVER_HTTP ) <br>
+ * Data over CoAP - ( OTA_DATA_OVER_COAP ) <br>
  * <b>Default value:</b>  'OTA_DATA_OVER_MQTT'
  */
 #ifndef configOTA_PRIMARY_DATA_PROTOCOL
     #define configOTA_PRIMARY_DATA_PROTOCOL    ( OTA_DATA_OVER_MQTT )
 #endif
 
+/**
+ * @brief Download a file over MQTT and HTTP at the same time.
+ *
+ * @note Only used when both MQTT & HTTP are enabled data protocols and the
+ * OTA job offers both. The primary data protocol downloads the file from the
+ * start while the other protocol downloads it from the end. The blocks left
+ * are split between the two protocols by the throughput each of them has
+ * delivered. HTTP is only used if the HTTP interface implements
+ * requestWithContext. Requires ota_hybrid.c to be built with the library.
+ *
+ * <b>Possible values:</b> Enabled(1) or Disabled(0) <br>
+ * <b>Default value:</b> '0'
+ */
+#ifndef otaconfigENABLE_HYBRID_DATA_TRANSFER
+    #define otaconfigENABLE_HYBRID_DATA_TRANSFER    0U
+#endif
+
+/**
+ * @brief Measure the data protocols offered by a job and use the fastest.
+ *
+ * @note Only used when the OTA job offers more than one enabled data protocol
+ * and the OS interface provides getTimeMs. The first file blocks are fetched
+ * over each protocol in turn, and the rest of the file over the protocol with
+ * the highest throughput, or the lowest latency if they are equal. The blocks
+ * fetched while measuring are part of the download. The agent keeps the result
+ * for the following jobs that offer the protocol, and stores it with the
+ * optional saveProbeResult of the PAL to keep it across reboots. A download
+ * over MQTT and HTTP at the same time is not measured.
+ *
+ * <b>Possible values:</b> 0 or 1 <br>
+ * <b>Default value:</b> '0'
+ */
+#ifndef otaconfigENABLE_DATA_PROTOCOL_PROBE
+    #define otaconfigENABLE_DATA_PROTOCOL_PROBE    0U
+#endif
+
+/**
+ * @brief The number of file blocks fetched over each data protocol to measure it.
+ *
+ * @note The measurement of a protocol ends with the first request whose blocks
+ * are all received once this many blocks were received over the protocol.
+ *
+ * <b>Possible values:</b> Any unsigned 32 integer value greater than 0. <br>
+ * <b>Default value:</b> '4'
+ */
+#ifndef otaconfigDATA_PROTOCOL_PROBE_NUM_BLOCKS
+    #define otaconfigDATA_PROTOCOL_PROBE_NUM_BLOCKS    4U
+#endif
+
 /**
  * @brief Macro that is called in the OTA library for logging "Error" level
  * messages.
@@ -38,9 +38,20 @@ typedef enum OtaHttpStatus
     OtaHttpSuccess = 0,       /*!< OTA HTTP interface success. */
     OtaHttpInitFailed = 0xc0, /*!< Error initializing the HTTP connection. */
     OtaHttpDeinitFailed,      /*!< Error deinitializing the HTTP connection. */
-    OtaHttpRequestFailed      /*!< Error sending the HTTP request. */
+    OtaHttpRequestFailed,     /*!< Error sending the HTTP request. */
+    OtaHttpUrlExpired         /*!< The server rejected the pre-signed url, for example because it expired. */
 } OtaHttpStatus_t;
 
+/**
+ * @brief Size of the context id that precedes every file block of a request with context.
+ */
+#define OTA_HTTP_CONTEXT_ID_SIZE    4U
+
+/**
+ * @brief Size of the file offset that precedes every file block of a request with offset.
+ */
+#define OTA_HTTP_FILE_OFFSET_SIZE    4U
+
 /**
  * @brief Init OTA Http interface.
  *
@@ -57,6 +68,16 @@ typedef OtaHttpStatus_t ( * ota_HttpInit_t ) ( char * pUrl );
  * @brief Request file block over Http.
  *
  * This function requests file block over Http from the rangeStart and rangeEnd.
+ * The range may span several file blocks. The response body must be passed to the
+ * OTA agent in order, in OtaAgentEventReceivedFileBlock events of any number of whole
+ * file blocks that fit in the event buffer. The agent splits each event into blocks.
+ * Alternatively the body can be passed as it arrives, in chunks of up to
+ * otaconfigFILE_CHUNK_SIZE bytes with OtaAgentEventReceivedFileChunk events, so that
+ * no block needs to be buffered.
+ *
+ * Once the server rejected the pre-signed url, for example with 403 Forbidden after
+ * the url expired, the request returns OtaHttpUrlExpired. The OTA agent then requests
+ * the job document again for a fresh url and continues the download with it.
  *
  * @param[in] rangeStart  Starting index of the file data to be requested.
  *
@@ -68,6 +89,53 @@ typedef OtaHttpStatus_t ( * ota_HttpInit_t ) ( char * pUrl );
 typedef OtaHttpStatus_t ( * ota_HttpRequest_t )  ( uint32_t rangeStart,
                                                    uint32_t rangeEnd );
 
+/**
+ * @brief Request file block over Http, with the file offset in front of the response.
+ *
+ * This function requests file data from the rangeStart to the rangeEnd like
+ * ota_HttpRequest_t, but every OtaAgentEventReceivedFileBlock event of the response
+ * starts with the file offset of its data as a OTA_HTTP_FILE_OFFSET_SIZE byte
+ * big-endian integer, taken from the Content-Range header of the response. The agent
+ * stores the blocks at that offset, so that late data of a previous request is not
+ * taken for data of this one.
+ *
+ * @param[in] rangeStart  Starting index of the file data to be requested.
+ *
+ * @param[in] rangeEnd    End index of the file data to be requested.
+ *
+ * @return             OtaHttpSuccess if success , other error code on failure.
+ */
+
+typedef OtaHttpStatus_t ( * ota_HttpRequestWithOffset_t )  ( uint32_t rangeStart,
+                                                             uint32_t rangeEnd );
+
+/**
+ * @brief Request file block over Http on one of several connections.
+ *
+ * This function requests file data from the rangeStart to the rangeEnd like
+ * ota_HttpRequest_t, but several requests may be in flight at the same time,
+ * for example on separate connections. Every request gets a new contextId.
+ * Blocks of a request that timed out may still be passed to the agent, which
+ * ignores them once the blocks were requested again.
+ *
+ * Every OtaAgentEventReceivedFileBlock event of the response starts with the
+ * contextId as a OTA_HTTP_CONTEXT_ID_SIZE byte big-endian integer, followed by
+ * whole file blocks of the response. The blocks of one response must be passed
+ * in order, but responses to different requests may be interleaved.
+ *
+ * @param[in] contextId   Identifier of the request chosen by the agent, passed back unchanged in front of every file block.
+ *
+ * @param[in] rangeStart  Starting index of the file data to be requested.
+ *
+ * @param[in] rangeEnd    End index of the file data to be requested.
+ *
+ * @return             OtaHttpSuccess if success , other error code on failure.
+ */
+
+typedef OtaHttpStatus_t ( * ota_HttpRequestWithContext_t )  ( uint32_t contextId,
+                                                              uint32_t rangeStart,
+                                                              uint32_t rangeEnd );
+
 /**
  * @brief Deinit OTA Http interface.
  *
@@ -84,9 +152,11 @@ typedef OtaHttpStatus_t ( * ota_HttpDeinit )( void );
  */
 typedef struct OtaHttpInterface
 {
-    ota_HttpInit_t init;       /*!< Reference to HTTP initialization. */
-    ota_HttpRequest_t request; /*!< Reference to HTTP data request. */
-    ota_HttpDeinit deinit;     /*!< Reference to HTTP deinitialize. */
+    ota_HttpInit_t init;                             /*!< Reference to HTTP initialization. */
+    ota_HttpRequest_t request;                       /*!< Reference to HTTP data request. */
+    ota_HttpDeinit deinit;                           /*!< Reference to HTTP deinitialize. */
+    ota_HttpRequestWithContext_t requestWithContext; /*!< Optional reference to HTTP data request with a context id, NULL to request one range at a time. */
+    ota_HttpRequestWithOffset_t requestWithOffset;   /*!< Optional reference to HTTP data request with the file offset in front of every file block, NULL to use request. */
 } OtaHttpInterface_t;
 
 #endif /* ifndef _OTA_HTTP_INTERFACE_H_ */
@@ -30,6 +30,28 @@
 #include "ota.h"
 #include "ota_private.h"
 
+/**
+ * @brief First byte of the context id of every request the agent makes with a context id.
+ *
+ * A stream response over MQTT starts with a CBOR map or a JSON object, never with this
+ * byte, so file blocks received with a context id are told apart from it by the first byte.
+ */
+#define OTA_HTTP_CONTEXT_ID_TAG                 0xFFU
+
+/**
+ * @brief Bits of the context id that hold the index of the range request.
+ */
+#define OTA_HTTP_CONTEXT_ID_SLOT_MASK           0xFFU
+
+/**
+ * @brief Position of the generation of the range request in the context id.
+ */
+#define OTA_HTTP_CONTEXT_ID_GENERATION_SHIFT    8U
+
+/**
+ * @brief Bits of the generation of the range request, before the shift.
+ */
+#define OTA_HTTP_CONTEXT_ID_GENERATION_MASK     0xFFFFU
 
 /**
  * @brief Initialize file transfer over HTTP.
@@ -47,8 +69,12 @@ OtaErr_t initFileTransfer_Http( OtaAgentContext_t * pAgentCtx );
 /**
  * @brief Request File block over HTTP.
  *
- * This function is used for requesting a file block over HTTP using the
- * file context.
+ * This function is used for requesting a range of up to otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST
+ * file blocks over HTTP using the file context. The range starts at the first block missing in
+ * the receive block bitmap and covers the contiguous missing blocks after it, so retries and
+ * resumed downloads only request the blocks still missing. If the HTTP interface
+ * supports requests with a context id, up to otaconfigHTTP_MAX_PARALLEL_REQUESTS ranges are
+ * kept in flight.
  *
  * @param[in] pAgentCtx The OTA agent context.
  *
@@ -57,12 +83,44 @@ OtaErr_t initFileTransfer_Http( OtaAgentContext_t * pAgentCtx );
  */
 OtaErr_t requestDataBlock_Http( OtaAgentContext_t * pAgentCtx );
 
+/**
+ * @brief Request a range of file blocks over HTTP with a context id.
+ *
+ * This function is used for requesting the file blocks from firstBlock up to endBlock
+ * with the request with context interface, which must be available. The range replaces
+ * any range requested before, so the blocks of the previous response are not accepted
+ * anymore.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @param[in] firstBlock Index of the first block to request.
+ *
+ * @param[in] endBlock Index after the last block to request.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+OtaErr_t requestDataBlockRange_Http( OtaAgentContext_t * pAgentCtx,
+                                     uint32_t firstBlock,
+                                     uint32_t endBlock );
+
+/**
+ * @brief Check if a file block was received with a context id.
+ *
+ * @param[in] pMessageBuffer The message received.
+ * @param[in] messageSize     The size of the message in bytes.
+ *
+ * @return true if the message starts with a context id of the agent, followed by file data.
+ */
+bool isContextBlock_Http( const uint8_t * pMessageBuffer,
+                          size_t messageSize );
+
 
 /**
  * @brief Stub for decoding the file block.
  *
  * File block received over HTTP does not require decoding, only increment the number
- * of blocks received.
+ * of blocks received. The message must hold one block, see decodeFileBlockAt_Http
+ * for messages with several blocks.
  *
  * @param[in] pMessageBuffer The message to be decoded.
  * @param[in] messageSize     The size of the message in bytes.
@@ -83,6 +141,39 @@ OtaErr_t decodeFileBlock_Http( const uint8_t * pMessageBuffer,
                                uint8_t ** pPayload,
                                size_t * pPayloadSize );
 
+/**
+ * @brief Decode a file block of a part of a response body that may hold several blocks.
+ *
+ * The body of a multi-block range may be passed in messages of any number of
+ * whole blocks, so the agent splits each message into blocks of
+ * OTA_FILE_BLOCK_SIZE bytes. Only the last block of the file may be shorter.
+ * For requests with a context id, each message starts with the context id of
+ * its request. For requests with offset, each message starts with the file offset
+ * of its data, see ota_HttpRequestWithOffset_t. Otherwise the messages hold the
+ * consecutive blocks of the range requested last.
+ *
+ * @param[in] pMessageBuffer The message to be decoded.
+ * @param[in] messageSize     The size of the message in bytes.
+ * @param[in] blockNumber     Position of the block in the message, from 0.
+ * @param[out] pFileId        The server file ID.
+ * @param[out] pBlockId       The file block ID.
+ * @param[out] pBlockSize     The file block size.
+ * @param[out] pPayload     The payload.
+ * @param[out] pPayloadSize   The payload size.
+ * @param[out] pNumBlocks     The number of blocks in the message.
+ *
+ * @return OtaErrNone if the block was decoded, otherwise OtaErrInvalidArg.
+ */
+OtaErr_t decodeFileBlockAt_Http( const uint8_t * pMessageBuffer,
+                                 size_t messageSize,
+                                 uint32_t blockNumber,
+                                 int32_t * pFileId,
+                                 int32_t * pBlockId,
+                                 int32_t * pBlockSize,
+                                 uint8_t ** pPayload,
+                                 size_t * pPayloadSize,
+                                 uint32_t * pNumBlocks );
+
 /**
  * @brief Cleanup related to OTA data plane over HTTP.
  *
@@ -0,0 +1,136 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_hybrid_private.h
+ * @brief Data transfer over MQTT and HTTP at the same time.
+ */
+
+#ifndef __OTA_HYBRID__H__
+#define __OTA_HYBRID__H__
+
+/* OTA includes. */
+#include "ota.h"
+#include "ota_private.h"
+
+
+/**
+ * @brief Initialize file transfer over MQTT and HTTP.
+ *
+ * This function subscribes to the data stream and initializes the http
+ * component with the pre-signed url. HTTP is only used if the HTTP interface
+ * supports requests with a context id, otherwise the file is downloaded over
+ * MQTT only.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+OtaErr_t initFileTransfer_Hybrid( OtaAgentContext_t * pAgentCtx );
+
+
+/**
+ * @brief Request file blocks over MQTT and HTTP.
+ *
+ * The blocks still needed are split into two disjoint parts. The primary
+ * data protocol requests blocks from the start of the file and the other
+ * protocol from the end. The split follows the throughput in bytes per second
+ * each protocol had while its requests were in flight, measured with the
+ * clock of the OS interface, or the number of blocks delivered if there is no
+ * clock. HTTP requests ranges of up to otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST
+ * blocks. A protocol is only sent a new request once it has delivered the
+ * blocks of its previous request, or when the request timed out.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+OtaErr_t requestFileBlock_Hybrid( OtaAgentContext_t * pAgentCtx );
+
+
+/**
+ * @brief Decode a file block received over MQTT or HTTP.
+ *
+ * File blocks over HTTP start with a context id, see isContextBlock_Http. Any
+ * other message is decoded as a stream response over MQTT.
+ *
+ * @param[in] pMessageBuffer The message to be decoded.
+ * @param[in] messageSize     The size of the message in bytes.
+ * @param[out] pFileId        The server file ID.
+ * @param[out] pBlockId       The file block ID.
+ * @param[out] pBlockSize     The file block size.
+ * @param[out] pPayload       The payload.
+ * @param[out] pPayloadSize   The payload size.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+OtaErr_t decodeFileBlock_Hybrid( const uint8_t * pMessageBuffer,
+                                 size_t messageSize,
+                                 int32_t * pFileId,
+                                 int32_t * pBlockId,
+                                 int32_t * pBlockSize,
+                                 uint8_t ** pPayload,
+                                 size_t * pPayloadSize );
+
+/**
+ * @brief Decode a block of a message received over MQTT or HTTP that may carry several blocks.
+ *
+ * See decodeFileBlockAt_Http and decodeFileBlockAt_Mqtt.
+ *
+ * @param[in] pMessageBuffer The message to be decoded.
+ * @param[in] messageSize     The size of the message in bytes.
+ * @param[in] blockNumber     Position of the block in the message, from 0.
+ * @param[out] pFileId        The server file ID.
+ * @param[out] pBlockId       The file block ID.
+ * @param[out] pBlockSize     The file block size.
+ * @param[out] pPayload       The payload.
+ * @param[out] pPayloadSize   The payload size.
+ * @param[out] pNumBlocks     The number of blocks in the message.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+OtaErr_t decodeFileBlockAt_Hybrid( const uint8_t * pMessageBuffer,
+                                   size_t messageSize,
+                                   uint32_t blockNumber,
+                                   int32_t * pFileId,
+                                   int32_t * pBlockId,
+                                   int32_t * pBlockSize,
+                                   uint8_t ** pPayload,
+                                   size_t * pPayloadSize,
+                                   uint32_t * pNumBlocks );
+
+/**
+ * @brief Cleanup related to OTA data plane over MQTT and HTTP.
+ *
+ * This function unsubscribes from the data stream and deinit the http
+ * component.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+OtaErr_t cleanupData_Hybrid( const OtaAgentContext_t * pAgentCtx );
+
+#endif /* ifndef __OTA_HYBRID__H__ */
@@ -38,7 +38,8 @@
 /* OTA data protocol constants. */
 #define OTA_DATA_OVER_MQTT        0x00000001
 #define OTA_DATA_OVER_HTTP        0x00000002
-#define OTA_DATA_NUM_PROTOCOLS    ( 2U )
+#define OTA_DATA_OVER_COAP        0x00000004
+#define OTA_DATA_NUM_PROTOCOLS    ( 3U )
 
 
 /**
@@ -74,6 +75,15 @@ typedef struct
                                     int32_t * pBlockSize,
                                     uint8_t ** pPayload,
                                     size_t * pPayloadSize );       /*!< Decode a cbor encoded fileblock. */
+    OtaErr_t ( * decodeFileBlockAt )( const uint8_t * pMessageBuffer,
+                                      size_t messageSize,
+                                      uint32_t blockNumber,
+                                      int32_t * pFileId,
+                                      int32_t * pBlockId,
+                                      int32_t * pBlockSize,
+                                      uint8_t ** pPayload,
+                                      size_t * pPayloadSize,
+                                      uint32_t * pNumBlocks );     /*!< Decode a block of a message with several blocks, NULL if messages carry one block. */
     OtaErr_t ( * cleanup )( const OtaAgentContext_t * pAgentCtx ); /*!< Cleanup related to OTA data plane. */
 } OtaDataInterface_t;
 
@@ -103,4 +113,35 @@ void setControlInterface( OtaControlInterface_t * pControlInterface );
 OtaErr_t setDataInterface( OtaDataInterface_t * pDataInterface,
                            const uint8_t * pProtocol );
 
+/**
+ * @brief Set data interface of one data protocol.
+ *
+ * @param[out] pDataInterface OTA data interface.
+ *
+ * @param[in] protocol One of the OTA_DATA_OVER_ values.
+ *
+ * @return OtaErrNone, or OtaErrInvalidDataProtocol if the protocol is not enabled.
+ */
+OtaErr_t setDataInterfaceForProtocol( OtaDataInterface_t * pDataInterface,
+                                      uint32_t protocol );
+
+/**
+ * @brief Get the data protocols that the data protocol probe can measure.
+ *
+ * @param[in] pProtocol Protocols used for the download.
+ *
+ * @return The OTA_DATA_OVER_ values of the enabled protocols in pProtocol, or 0
+ * if the download uses MQTT and HTTP at the same time.
+ */
+uint32_t getProbeDataProtocols( const uint8_t * pProtocol );
+
+/**
+ * @brief Get the data protocol to measure next, following the protocol priority.
+ *
+ * @param[in] protocols The OTA_DATA_OVER_ values of the protocols left to measure.
+ *
+ * @return The primary data protocol if it is in protocols, otherwise the first of them.
+ */
+uint32_t nextProbeDataProtocol( uint32_t protocols );
+
 #endif /* ifndef __AWS_IOT_OTA_INTERFACE__H__ */
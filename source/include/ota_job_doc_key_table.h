@@ -0,0 +1,103 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_job_doc_key_table.h
+ * @brief Parameter indices and hash table of the key paths of the OTA job document model.
+ *
+ * Generated by tools/json_key_table.py from otaJobDocModelParamStructure in ota.c.
+ * Do not edit, run the script again after changing the model.
+ *
+ * The table is defined static and only ota.c includes this header, so there is one
+ * copy of it.
+ */
+
+#ifndef OTA_JOB_DOC_KEY_TABLE_H
+#define OTA_JOB_DOC_KEY_TABLE_H
+
+/* Indices of the parameters in otaJobDocModelParamStructure. */
+#define OTA_JOB_DOC_PARAM_CLIENT_TOKEN     0U
+#define OTA_JOB_DOC_PARAM_TIMESTAMP        1U
+#define OTA_JOB_DOC_PARAM_EXECUTION        2U
+#define OTA_JOB_DOC_PARAM_JOB_ID           3U
+#define OTA_JOB_DOC_PARAM_STATUS_DETAILS   4U
+#define OTA_JOB_DOC_PARAM_SELF_TEST        5U
+#define OTA_JOB_DOC_PARAM_UPDATED_BY       6U
+#define OTA_JOB_DOC_PARAM_JOB_DOC          7U
+#define OTA_JOB_DOC_PARAM_OTA_UNIT         8U
+#define OTA_JOB_DOC_PARAM_STREAM_NAME      9U
+#define OTA_JOB_DOC_PARAM_PROTOCOLS        10U
+#define OTA_JOB_DOC_PARAM_FILE_GROUP       11U
+#define OTA_JOB_DOC_PARAM_FILE_PATH        12U
+#define OTA_JOB_DOC_PARAM_FILE_SIZE        13U
+#define OTA_JOB_DOC_PARAM_FILE_ID          14U
+#define OTA_JOB_DOC_PARAM_FILE_CERT_NAME   15U
+#define OTA_JOB_DOC_PARAM_UPDATE_DATA_URL  16U
+#define OTA_JOB_DOC_PARAM_AUTH_SCHEME      17U
+#define OTA_JOB_DOC_PARAM_FILE_SIGNATURE   18U
+#define OTA_JOB_DOC_PARAM_FILE_ATTRIBUTE   19U
+#define OTA_JOB_DOC_PARAM_FILETYPE         20U
+
+/* Number of parameters of otaJobDocModelParamStructure. */
+#define OTA_JOB_DOC_NUM_PARAMS             21U
+
+/* *INDENT-OFF* */
+static const JsonKeyTable_t otaJobDocKeyTable =
+{
+    0x9E3779C1U, /* Multiplier. */
+    0x00040000U, /* Parameters with a key only known at run time. */
+    20U,         /* Number of key paths. */
+    {
+        { 0x103E816BU, 0x00000001U, 0x00000000U,  0U, 11U,  0U }, /* clientToken */
+        { 0xB283D523U, 0x00000002U, 0x00000000U,  0U,  9U,  1U }, /* timestamp */
+        { 0x6CF1DF55U, 0x00000004U, 0x00000FF8U,  0U,  9U,  2U }, /* execution */
+        { 0x97EB55F5U, 0x00000008U, 0x00000000U, 10U,  5U,  3U }, /* execution.jobId */
+        { 0xED44CE13U, 0x00000010U, 0x00000060U, 10U, 13U,  4U }, /* execution.statusDetails */
+        { 0x47DE6C22U, 0x00000020U, 0x00000000U, 24U,  9U,  5U }, /* execution.statusDetails.self_test */
+        { 0xC166F27FU, 0x00000040U, 0x00000000U, 24U,  9U,  6U }, /* execution.statusDetails.updatedBy */
+        { 0x29088AA1U, 0x00000080U, 0x00000F00U, 10U, 11U,  7U }, /* execution.jobDocument */
+        { 0x529A9249U, 0x00000100U, 0x00000E00U, 22U,  7U,  8U }, /* execution.jobDocument.afr_ota */
+        { 0x05E9EBE6U, 0x00000200U, 0x00000000U, 30U, 10U,  9U }, /* execution.jobDocument.afr_ota.streamname */
+        { 0x04A4DD92U, 0x00000400U, 0x00000000U, 30U,  9U, 10U }, /* execution.jobDocument.afr_ota.protocols */
+        { 0xAB91AD70U, 0x00000800U, 0x00000000U, 30U,  5U, 11U }, /* execution.jobDocument.afr_ota.files */
+        { 0x75000BE4U, 0x00001000U, 0x00000000U,  0U,  8U, 12U }, /* filepath */
+        { 0x13B669C2U, 0x00002000U, 0x00000000U,  0U,  8U, 13U }, /* filesize */
+        { 0x0DFC550EU, 0x00004000U, 0x00000000U,  0U,  6U, 14U }, /* fileid */
+        { 0x121D5B7DU, 0x00008000U, 0x00000000U,  0U,  8U, 15U }, /* certfile */
+        { 0x742A5843U, 0x00010000U, 0x00000000U,  0U, 15U, 16U }, /* update_data_url */
+        { 0x6EC94E97U, 0x00020000U, 0x00000000U,  0U, 11U, 17U }, /* auth_scheme */
+        { 0x10A838B2U, 0x00080000U, 0x00000000U,  0U,  4U, 19U }, /* attr */
+        { 0x1123AE9BU, 0x00100000U, 0x00000000U,  0U,  8U, 20U }  /* fileType */
+    },
+    {
+         0U,  0U,  0U,  0U,  0U,  0U, 19U,  8U, 11U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,
+         0U,  0U,  2U,  0U,  0U, 16U,  0U,  0U,  0U,  5U,  0U,  0U,  4U,  0U,  0U,  0U,
+        13U,  6U, 14U,  0U,  0U, 12U,  0U,  0U,  1U,  0U, 10U,  0U,  0U,  0U, 15U,  0U,
+        18U,  0U,  0U,  0U,  9U,  0U,  0U,  0U,  0U,  3U, 17U,  0U,  7U, 20U,  0U,  0U
+    }
+};
+/* *INDENT-ON* */
+
+#endif /* ifndef OTA_JOB_DOC_KEY_TABLE_H */
@@ -103,14 +103,57 @@ typedef OtaMqttStatus_t ( * OtaMqttPublish_t )( const char * const pacTopic,
                                                 uint32_t ulMsgSize,
                                                 uint8_t ucQos );
 
+/**
+ * @brief MQTT 5 properties of a message published by the OTA agent.
+ *
+ * Topic aliases are bound per connection. The agent always passes the full
+ * topic along with the alias, and the MQTT client is expected to send an empty
+ * topic once the alias has been bound to that same topic on the current
+ * connection.
+ */
+typedef struct OtaMqttPublishProperties
+{
+    uint16_t topicAlias;          /*!< Topic alias for the topic, 0 if no alias is used. */
+    const char * pResponseTopic;  /*!< Topic the response should be sent to, NULL if none. */
+    uint16_t responseTopicLength; /*!< Length of the response topic. */
+} OtaMqttPublishProperties_t;
+
+/**
+ * @brief Publish message to a topic with MQTT 5 properties.
+ *
+ * This function publishes a message to a given topic & QoS, with the topic
+ * alias and response topic properties set.
+ *
+ * @param[pacTopic]             Mqtt topic filter.
+ *
+ * @param[usTopicLen]           Length of the topic filter.
+ *
+ * @param[pcMsg]                Message to publish.
+ *
+ * @param[ulMsgSize]            Message size.
+ *
+ * @param[ucQoS]                Quality of Service
+ *
+ * @param[pProperties]          MQTT 5 properties of the message.
+ *
+ * @return                      OtaMqttSuccess if success , other error code on failure.
+ */
+typedef OtaMqttStatus_t ( * OtaMqttPublishWithProperties_t )( const char * const pacTopic,
+                                                              uint16_t usTopicLen,
+                                                              const char * pcMsg,
+                                                              uint32_t ulMsgSize,
+                                                              uint8_t ucQos,
+                                                              const OtaMqttPublishProperties_t * pProperties );
+
 /**
  *  OTA Event Interface structure.
  */
 typedef struct OtaMqttInterface
 {
-    OtaMqttSubscribe_t subscribe;     /*!< Interface for subscribing to Mqtt topics. */
-    OtaMqttUnsubscribe_t unsubscribe; /*!< interface for unsubscribing to MQTT topics. */
-    OtaMqttPublish_t publish;         /*!< Interface for publishing MQTT messages. */
+    OtaMqttSubscribe_t subscribe;                         /*!< Interface for subscribing to Mqtt topics. */
+    OtaMqttUnsubscribe_t unsubscribe;                     /*!< interface for unsubscribing to MQTT topics. */
+    OtaMqttPublish_t publish;                             /*!< Interface for publishing MQTT messages. */
+    OtaMqttPublishWithProperties_t publishWithProperties; /*!< Optional interface for publishing MQTT 5 messages, NULL if not supported. */
 } OtaMqttInterface_t;
 
 #endif /* ifndef _OTA_MQTT_INTERFACE_H_ */
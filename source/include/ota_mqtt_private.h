@@ -70,6 +70,79 @@ OtaErr_t initFileTransfer_Mqtt( OtaAgentContext_t * pAgentCtx );
 
 OtaErr_t requestFileBlock_Mqtt( OtaAgentContext_t * pAgentCtx );
 
+/**
+ * @brief Request the file blocks set in a bitmap over MQTT.
+ *
+ * This function is used for requesting file blocks over MQTT when only a
+ * part of the blocks still needed should be requested. The bitmap has the
+ * same layout as the receive block bitmap of the file context.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @param[in] pBitmap Bitmap of the blocks to request.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+OtaErr_t requestFileBlockBitmap_Mqtt( OtaAgentContext_t * pAgentCtx,
+                                      const uint8_t * pBitmap );
+
+/**
+ * @brief Encode a JSON stream request message.
+ *
+ * This function builds the message published on the `get/json` topic of
+ * a stream to request file blocks. The block bitmap is Base64 encoded.
+ *
+ * @param[out] pMessageBuffer Buffer to store the message in.
+ * @param[in] messageBufferSize Size of the message buffer.
+ * @param[out] pEncodedMessageSize Length of the message, not including the terminator.
+ * @param[in] pClientToken Client token of the request.
+ * @param[in] fileId File ID of the requested blocks.
+ * @param[in] blockSize Size of the requested blocks.
+ * @param[in] blockOffset Index of the first block of the bitmap.
+ * @param[in] pBlockBitmap Bitmap of the requested blocks.
+ * @param[in] blockBitmapSize Size of the bitmap in bytes.
+ * @param[in] numOfBlocksRequested Maximum number of blocks to send.
+ *
+ * @return true if the message was encoded, false otherwise.
+ */
+bool encodeStreamRequestJson_Mqtt( char * pMessageBuffer,
+                                   size_t messageBufferSize,
+                                   size_t * pEncodedMessageSize,
+                                   const char * pClientToken,
+                                   int32_t fileId,
+                                   int32_t blockSize,
+                                   int32_t blockOffset,
+                                   const uint8_t * pBlockBitmap,
+                                   size_t blockBitmapSize,
+                                   int32_t numOfBlocksRequested );
+
+/**
+ * @brief Decode a JSON stream response message.
+ *
+ * This function decodes a message received on the `data/json` topic of a
+ * stream. The message is checked and its fields are decoded in a single walk
+ * over the members of its object, then the Base64 encoded payload is decoded
+ * straight into the payload buffer. The outputs are only written if the whole
+ * message was decoded.
+ *
+ * @param[in] pMessageBuffer The message to be decoded.
+ * @param[in] messageSize     The size of the message in bytes.
+ * @param[out] pFileId        The server file ID.
+ * @param[out] pBlockId       The file block ID.
+ * @param[out] pBlockSize     The file block size.
+ * @param[in,out] pPayload    The buffer to decode the payload into.
+ * @param[in,out] pPayloadSize The size of the payload buffer, then the payload size.
+ *
+ * @return true if the message was decoded, false otherwise.
+ */
+bool decodeStreamResponseJson_Mqtt( const uint8_t * pMessageBuffer,
+                                    size_t messageSize,
+                                    int32_t * pFileId,
+                                    int32_t * pBlockId,
+                                    int32_t * pBlockSize,
+                                    uint8_t ** pPayload,
+                                    size_t * pPayloadSize );
+
 /**
  * @brief Decode a cbor encoded fileblock.
  *
@@ -95,6 +168,35 @@ OtaErr_t decodeFileBlock_Mqtt( const uint8_t * pMessageBuffer,
                                uint8_t ** pPayload,
                                size_t * pPayloadSize );
 
+/**
+ * @brief Decode a block of a cbor encoded stream response that may carry several blocks.
+ *
+ * A stream response of the multi-block extension carries up to
+ * otaconfigMQTT_MAX_BLOCKS_PER_RESPONSE blocks, so that they are ingested in one
+ * event. Responses of the service, and JSON stream responses, carry one block.
+ *
+ * @param[in] pMessageBuffer The message to be decoded.
+ * @param[in] messageSize     The size of the message in bytes.
+ * @param[in] blockNumber     Position of the block in the message, from 0.
+ * @param[out] pFileId        The server file ID.
+ * @param[out] pBlockId       The file block ID.
+ * @param[out] pBlockSize     The file block size.
+ * @param[out] pPayload     The payload.
+ * @param[out] pPayloadSize   The payload size.
+ * @param[out] pNumBlocks     The number of blocks in the message.
+ *
+ * @return OtaErrNone if the block was decoded, otherwise OtaErrFailedToDecodeCbor.
+ */
+OtaErr_t decodeFileBlockAt_Mqtt( const uint8_t * pMessageBuffer,
+                                 size_t messageSize,
+                                 uint32_t blockNumber,
+                                 int32_t * pFileId,
+                                 int32_t * pBlockId,
+                                 int32_t * pBlockSize,
+                                 uint8_t ** pPayload,
+                                 size_t * pPayloadSize,
+                                 uint32_t * pNumBlocks );
+
 /**
  * @brief Cleanup related to OTA control plane over MQTT.
  *
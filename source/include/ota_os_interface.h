@@ -36,6 +36,7 @@ typedef enum
 {
     OtaRequestTimer = 0,
     OtaSelfTestTimer,
+    OtaProgressTimer,
     OtaNumOfTimers
 } OtaTimerId_t;
 
@@ -174,6 +175,18 @@ typedef OtaOsStatus_t ( * OtaStopTimer_t ) ( OtaTimerId_t otaTimerId );
 
 typedef OtaOsStatus_t ( * OtaDeleteTimer_t ) ( OtaTimerId_t otaTimerId );
 
+/**
+ * @brief Get the time.
+ *
+ * This function returns a monotonic time in milliseconds, for example the
+ * time since boot. Only differences of two times are used, so the time may
+ * wrap around.
+ *
+ * @return                  The time in milliseconds.
+ */
+
+typedef uint32_t ( * OtaGetTimeMs_t ) ( void );
+
 /**
  * @brief Allocate memory.
  *
@@ -218,9 +231,10 @@ typedef struct OtaEventInterface
  */
 typedef struct OtaTimerInterface
 {
-    OtaStartTimer_t start;   /*!< Timer start state. */
-    OtaStopTimer_t stop;     /*!< Timer stop state. */
-    OtaDeleteTimer_t delete; /*!< Delete timer. */
+    OtaStartTimer_t start;    /*!< Timer start state. */
+    OtaStopTimer_t stop;      /*!< Timer stop state. */
+    OtaDeleteTimer_t delete;  /*!< Delete timer. */
+    OtaGetTimeMs_t getTimeMs; /*!< Optional monotonic time in milliseconds, NULL if not available. */
 } OtaTimerInterface_t;
 
 /**
@@ -255,6 +255,39 @@ typedef OtaPalStatus_t ( * OtaPalSetPlatformImageState_t )( OtaFileContext_t * c
  */
 typedef OtaPalImageState_t ( * OtaPalGetPlatformImageState_t ) ( OtaFileContext_t * const pFileContext );
 
+/**
+ * @brief The data protocol measured fastest by the data protocol probe.
+ */
+typedef struct OtaDataProbeResult
+{
+    uint32_t protocol;       /*!< The data protocol, one of the OTA_DATA_OVER_ values, 0 if none was measured. */
+    uint32_t bytesPerSecond; /*!< Throughput measured over the data protocol. */
+    uint32_t latencyMs;      /*!< Time from the start of the transfer to the first file block. */
+} OtaDataProbeResult_t;
+
+/**
+ * @brief Store the result of the data protocol probe in non-volatile memory.
+ *
+ * The OTA agent keeps the data protocol measured fastest for the following
+ * jobs. Storing it lets the agent skip the probe after a reboot as well.
+ *
+ * @param[in] pResult The data protocol measured fastest.
+ *
+ * @return The OTA PAL layer error code combined with the MCU specific error code. See OTA Agent
+ * error codes information in ota.h.
+ */
+typedef OtaPalStatus_t ( * OtaPalSaveProbeResult_t )( const OtaDataProbeResult_t * pResult );
+
+/**
+ * @brief Load the result of the data protocol probe stored with OtaPalSaveProbeResult_t.
+ *
+ * @param[out] pResult The data protocol measured fastest.
+ *
+ * @return The OTA PAL layer error code combined with the MCU specific error code. See OTA Agent
+ * error codes information in ota.h. Any error means that no result is stored.
+ */
+typedef OtaPalStatus_t ( * OtaPalLoadProbeResult_t )( OtaDataProbeResult_t * pResult );
+
 /**
  *  OTA pal Interface structure.
  */
@@ -272,6 +305,8 @@ typedef struct OtaPalInterface
     OtaPalResetDevice_t reset;                           /*!< Reset the device. */
     OtaPalSetPlatformImageState_t setPlatformImageState; /*!< Set the state of the OTA update image. */
     OtaPalGetPlatformImageState_t getPlatformImageState; /*!< Get the state of the OTA update image. */
+    OtaPalSaveProbeResult_t saveProbeResult;             /*!< Optional, store the result of the data protocol probe. */
+    OtaPalLoadProbeResult_t loadProbeResult;             /*!< Optional, load the result of the data protocol probe. */
 } OtaPalInterface_t;
 
 #endif /* ifndef _OTA_PLATFORM_INTERFACE_ */
@@ -68,11 +68,21 @@
 #define OTA_MAX_JSON_TOKENS         64U                                                                         /*!< Number of JSON tokens supported in a single parser call. */
 #define OTA_MAX_JSON_STR_LEN        256U                                                                        /*!< Limit our JSON string compares to something small to avoid going into the weeds. */
 #define OTA_DOC_MODEL_MAX_PARAMS    32U                                                                         /*!< The parameter list is backed by a 32 bit longword bitmap by design. */
+#define OTA_MAX_JSON_DEPTH          8U                                                                          /*!< Number of nested objects and arrays of a document that are searched for model parameters. */
+#define OTA_JSON_KEY_TABLE_BITS     6U                                                                          /*!< Log base 2 of the number of slots of the hash table of the model key paths. */
+#define OTA_JSON_KEY_TABLE_SIZE     ( 1U << OTA_JSON_KEY_TABLE_BITS )                                           /*!< Number of slots of the hash table of the model key paths. */
+#define OTA_JSON_MAX_KEY_PATHS      ( OTA_JSON_KEY_TABLE_SIZE / 2U )                                            /*!< Number of distinct key paths and key path prefixes of a document model. */
 #define OTA_JOB_PARAM_REQUIRED      true                                                                        /*!< Used to denote a required document model parameter. */
 #define OTA_JOB_PARAM_OPTIONAL      false                                                                       /*!< Used to denote an optional document model parameter. */
 #define OTA_DONT_STORE_PARAM        0xffff                                                                      /*!< If destOffset in the model is 0xffffffff, do not store the value. */
 #define OTA_STORE_NESTED_JSON       0x1fffU                                                                     /*!< Store the reference to a nested JSON in a separate pointer */
-#define OTA_DATA_BLOCK_SIZE         ( ( 1U << otaconfigLOG2_FILE_BLOCK_SIZE ) + OTA_REQUEST_URL_MAX_SIZE + 30 ) /*!< Header is 19 bytes.*/
+#define OTA_STREAM_BLOCK_OVERHEAD   24U                                                                         /*!< Size of the map, block ID and size of each further block of a multi-block stream response. */
+#define OTA_STREAM_BLOCKS_SIZE      ( ( otaconfigMQTT_MAX_BLOCKS_PER_RESPONSE << otaconfigLOG2_FILE_BLOCK_SIZE ) + \
+                                      ( ( otaconfigMQTT_MAX_BLOCKS_PER_RESPONSE - 1U ) * OTA_STREAM_BLOCK_OVERHEAD ) ) /*!< Size of the blocks of the largest stream response. */
+#define OTA_DATA_BLOCK_SIZE         ( OTA_STREAM_BLOCKS_SIZE + OTA_REQUEST_URL_MAX_SIZE + 30 )                  /*!< Header is 19 bytes.*/
+#define OTA_FILE_CHUNK_OFFSET_SIZE  4U                                                                          /*!< Size of the file offset that precedes the data of a file chunk event. */
+#define OTA_FILE_CHUNK_WRITTEN_SIZE ( 2U * OTA_FILE_CHUNK_OFFSET_SIZE )                                         /*!< Size of the file offset and length of a written file chunk event. */
+#define OTA_FILE_CHUNK_EVENT_SIZE   ( OTA_FILE_CHUNK_OFFSET_SIZE + otaconfigFILE_CHUNK_SIZE )                   /*!< Size of the buffer of a file chunk event, independent of the block size. */
 
 
 /* OTA Agent task event flags. */
@@ -156,7 +166,9 @@ typedef enum
     IngestResultNoDecodeMemory = -11,    /*!< Memory could not be allocated for decoding . */
     IngestResultUninitialized = -127,    /*!< Software BUG: We forgot to set the result code. */
     IngestResultAccepted_Continue = 0,   /*!< The block was accepted and we're expecting more. */
-    IngestResultDuplicate_Continue = 1   /*!< The block was a duplicate but that's OK. Continue. */
+    IngestResultDuplicate_Continue = 1,  /*!< The block was a duplicate but that's OK. Continue. */
+    IngestResultOtherFile_Continue = 2,  /*!< The block belongs to another file of a shared stream. Continue. */
+    IngestResultStale_Continue = 3       /*!< The block belongs to a request that is no longer in flight. Continue. */
 } IngestResult_t;
 
 /**
@@ -182,7 +194,8 @@ typedef enum
     DocParseErrTooManyParams,         /*!< The document model has more parameters than we can handle. */
     DocParseErrParamKeyNotInModel,    /*!< The document model does not include the specified parameter key. */
     DocParseErrInvalidModelParamType, /*!< The document model specified an invalid parameter type. */
-    DocParseErrInvalidToken           /*!< The Jasmine token was invalid, producing a NULL pointer. */
+    DocParseErrInvalidToken,          /*!< The Jasmine token was invalid, producing a NULL pointer. */
+    DocParseErrInvalidCborBuffer      /*!< When the CBOR is malformed and not parsed correctly. */
 } DocParseErr_t;
 
 /**
@@ -248,6 +261,53 @@ typedef struct
     const ModelParamType_t modelParamType; /*!< We extract the value, if found, based on this type. */
 } JsonDocParam_t;
 
+/**
+ * @ingroup ota_private_datatypes_structs
+ * @brief Value of a document model parameter found in the JSON document.
+ *
+ * Strings are recorded without their quotes, like coreJSON returns them. The values of a
+ * CBOR document are the encoded CBOR data items.
+ */
+typedef struct
+{
+    const char * pValue; /*!< Start of the value in the JSON document. */
+    size_t valueLength;  /*!< Length of the value. */
+} JsonDocSpan_t;
+
+/**
+ * @ingroup ota_private_datatypes_structs
+ * @brief Key path, or key path prefix, of the parameters of a document model.
+ *
+ * The last key of the path is compared with the key found in the document to rule out
+ * hash collisions with keys that are not in the model.
+ */
+typedef struct
+{
+    uint32_t hash;       /*!< FNV-1a hash of the key path. */
+    uint32_t matches;    /*!< Parameters with this key path. */
+    uint32_t children;   /*!< Parameters with a key path that continues after this one. */
+    uint16_t keyOffset;  /*!< Offset of the last key in the key path. */
+    uint16_t keyLength;  /*!< Length of the last key of the key path. */
+    uint16_t paramIndex; /*!< Parameter whose key path holds this key path. */
+} JsonKeyPath_t;
+
+/**
+ * @ingroup ota_private_datatypes_structs
+ * @brief Hash table of the key paths of a document model.
+ *
+ * The table is generated from the model by tools/json_key_table.py, which searches a
+ * multiplier of the hash that maps every key path to its own slot, so a key path is found
+ * with one probe. Keys that are only known at run time are matched outside the table.
+ */
+typedef struct
+{
+    uint32_t multiplier;                              /*!< Multiplier of the hash that maps a key path to its slot. */
+    uint32_t dynamicParams;                           /*!< Parameters with a key that is only known at run time. */
+    uint16_t numKeyPaths;                             /*!< Number of key paths in the table. */
+    JsonKeyPath_t keyPaths[ OTA_JSON_MAX_KEY_PATHS ]; /*!< Key paths of the document model. */
+    uint8_t slots[ OTA_JSON_KEY_TABLE_SIZE ];         /*!< Index of the key path of each slot plus one, 0 if empty. */
+} JsonKeyTable_t;
+
 /**
  * @ingroup ota_private_datatypes_structs
  * @brief JSON document model to store the details of parameters expected in the job document.
@@ -263,12 +323,15 @@ typedef struct
  */
 typedef struct
 {
-    void * contextBase;              /*!< The base address of the destination OTA context structure. */
-    uint32_t contextSize;            /*!< The size, in bytes, of the destination context structure. */
-    const JsonDocParam_t * pBodyDef; /*!< Pointer to the document model body definition. */
-    uint16_t numModelParams;         /*!< The number of entries in the document model (limited to 32). */
-    uint32_t paramsReceivedBitmap;   /*!< Bitmap of the parameters received based on the model. */
-    uint32_t paramsRequiredBitmap;   /*!< Bitmap of the parameters required from the model. */
+    void * contextBase;                                   /*!< The base address of the destination OTA context structure. */
+    uint32_t contextSize;                                 /*!< The size, in bytes, of the destination context structure. */
+    const JsonDocParam_t * pBodyDef;                      /*!< Pointer to the document model body definition. */
+    uint16_t numModelParams;                              /*!< The number of entries in the document model (limited to 32). */
+    uint32_t paramsReceivedBitmap;                        /*!< Bitmap of the parameters received based on the model. */
+    uint32_t paramsRequiredBitmap;                        /*!< Bitmap of the parameters required from the model. */
+    const JsonKeyTable_t * pKeyTable;                     /*!< Hash table of the key paths of the model. */
+    bool isCborDoc;                                       /*!< True if the values are the data items of a CBOR document. */
+    JsonDocSpan_t valueSpans[ OTA_DOC_MODEL_MAX_PARAMS ]; /*!< Values of the parameters received, in the order of the model. */
 } JsonDocModel_t;
 
 /**
@@ -344,6 +407,43 @@ typedef enum OtaEvent
     OtaAgentEventResume,
     OtaAgentEventUserAbort,
     OtaAgentEventShutdown,
+
+    /**
+     * @brief A chunk of file data of any size was received.
+     *
+     * The event data is an OtaFileChunkEventData_t. It starts with the file offset of the chunk
+     * as a OTA_FILE_CHUNK_OFFSET_SIZE byte big-endian integer, followed by at most
+     * otaconfigFILE_CHUNK_SIZE bytes of data. The chunks of a block must be received in order,
+     * but chunks of different blocks may be interleaved.
+     */
+    OtaAgentEventReceivedFileChunk,
+
+    /**
+     * @brief A chunk of file data was written to the file by the data plane.
+     *
+     * The event data is the file offset and the length of the chunk, each as a
+     * OTA_FILE_CHUNK_OFFSET_SIZE byte big-endian integer. The data is not passed to the
+     * agent, which only marks the blocks received. It is used by data planes that move the
+     * data into the file that the PAL created without copying it, the same ordering rules as
+     * for OtaAgentEventReceivedFileChunk apply.
+     */
+    OtaAgentEventFileChunkWritten,
+
+    /**
+     * @brief A download progress update may be due.
+     *
+     * Signaled by the progress timer and by the file block ingest, so that the job status is
+     * updated by the agent task instead of while the file block is processed.
+     */
+    OtaAgentEventReportProgress,
+
+    /**
+     * @brief Continue the active transfer after the job document was requested again.
+     *
+     * Signaled by the agent when the job document that answers the request is identical to
+     * the job document of the active job. The file blocks received so far are kept.
+     */
+    OtaAgentEventContinueTransfer,
     OtaAgentEventMax
 } OtaEvent_t;
 
@@ -413,6 +513,20 @@ typedef struct OtaEventData
     bool bufferUsed;                     /*!< Flag set when buffer is used otherwise cleared. */
 } OtaEventData_t;
 
+/**
+ * @ingroup ota_private_datatypes_structs
+ * @brief  The data of an OtaAgentEventReceivedFileChunk event.
+ *
+ * It is passed as the event data of the event message and handed back to the application
+ * with the OtaJobEventProcessed callback like any other event buffer.
+ */
+typedef struct OtaFileChunkEventData
+{
+    uint8_t data[ OTA_FILE_CHUNK_EVENT_SIZE ]; /*!< File offset and data of the chunk. */
+    uint32_t dataLength;                       /*!< Size of the file offset and data. */
+    bool bufferUsed;                           /*!< Flag set when buffer is used otherwise cleared. */
+} OtaFileChunkEventData_t;
+
 /**
  * @ingroup ota_private_datatypes_structs
  * @brief Stores information about the event message.
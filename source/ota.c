@@ -54,21 +54,47 @@
 /* Internal header file for shared OTA definitions. */
 #include "ota_private.h"
 
+/* Hash table of the key paths of the job document model, generated from the model. The table
+ * is a static definition, so no other source file includes this header. */
+#include "ota_job_doc_key_table.h"
+
 /* OTA interface includes. */
 #include "ota_interface_private.h"
 
+/* OTA MQTT data plane includes. */
+#if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_MQTT )
+    #include "ota_mqtt_private.h"
+#endif
+
 /* OTA OS interface. */
 #include "ota_os_interface.h"
 
 /* Core JSON include */
 #include "core_json.h"
 
+/* tinycbor include */
+#include "cbor.h"
+
 /* Include firmware version struct definition. */
 #include "ota_appversion32.h"
 
 /* Offset helper. */
 #define U16_OFFSET( type, member )    ( ( uint16_t ) offsetof( type, member ) )
 
+/* FNV-1a hash constants. */
+#define OTA_FNV_OFFSET_BASIS          2166136261U
+#define OTA_FNV_PRIME                 16777619U
+
+/* Slot of a key path hash in the hash table of the key paths. */
+#define OTA_JSON_KEY_SLOT( hash, multiplier )    ( ( uint32_t ) ( ( hash ) * ( multiplier ) ) >> ( 32U - OTA_JSON_KEY_TABLE_BITS ) )
+
+/* A CBOR job document is a map, major type 5, which no JSON document starts with. */
+#define OTA_CBOR_MAJOR_TYPE_MASK      0xe0U
+#define OTA_CBOR_MAP_MAJOR_TYPE       0xa0U
+
+/* Longest JSON text of an array of strings of a CBOR job document, like ["MQTT","HTTP"]. */
+#define OTA_CBOR_TEXT_ARRAY_MAX_LENGTH    64U
+
 /* OTA event handler definition. */
 
 typedef OtaErr_t ( * OtaEventHandler_t )( const OtaEventData_t * pEventMsg );
@@ -86,6 +112,33 @@ typedef struct OtaStateTableEntry
     OtaState_t nextState;      /**< New state to be triggered*/
 } OtaStateTableEntry_t;
 
+/**
+ * @brief Object or array of a JSON document being tokenized.
+ */
+typedef struct JsonDocLevel
+{
+    const char * pValue;  /**< Start of the object or array in the document. */
+    uint32_t valueParams; /**< Parameters whose value is the object or array. */
+    uint32_t candidates;  /**< Parameters that may be in the object, or in the first element of the array. */
+    size_t pathLength;    /**< Length of the key path of the object, with the separator. */
+    uint32_t pathHash;    /**< FNV-1a hash of the key path of the object, with the separator. */
+    bool isObject;        /**< True for an object, false for an array. */
+    bool inFileParams;    /**< True in the first element of the file group. */
+} JsonDocLevel_t;
+
+/**
+ * @brief Model parameters matched by a key of an object, or by an element of an array.
+ */
+typedef struct JsonDocMatch
+{
+    uint32_t matches;         /**< Parameters whose value is the value of the key. */
+    uint32_t children;        /**< Parameters that may be in the value, if it is an object. */
+    uint32_t fileGroupParams; /**< Parameters that may be in the first element of the value, if it is the file group. */
+    size_t pathLength;        /**< Length of the key path of the value, with the separator. */
+    uint32_t pathHash;        /**< FNV-1a hash of the key path of the value, with the separator. */
+    bool inFileParams;        /**< True in the first element of the file group. */
+} JsonDocMatch_t;
+
 /* OTA control interface. */
 
 static OtaControlInterface_t otaControlInterface;
@@ -101,7 +154,26 @@ static OtaDataInterface_t otaDataInterface;
 static IngestResult_t ingestDataBlock( OtaFileContext_t * pFileContext,
                                        const uint8_t * pRawMsg,
                                        uint32_t messageSize,
-                                       OtaPalStatus_t * pCloseResult );
+                                       OtaPalStatus_t * pCloseResult,
+                                       uint32_t * pBlocksReceived );
+
+/* Called when the OTA agent receives a chunk of file data at a file offset. */
+
+static IngestResult_t ingestDataChunk( OtaFileContext_t * pFileContext,
+                                       const uint8_t * pRawMsg,
+                                       uint32_t messageSize,
+                                       bool dataWritten,
+                                       OtaPalStatus_t * pCloseResult,
+                                       uint32_t * pBlocksCompleted );
+
+/* Write the part of a chunk that falls into one block and mark the block received once complete. */
+
+static IngestResult_t processDataChunkSpan( OtaFileContext_t * pFileContext,
+                                            uint32_t blockIndex,
+                                            uint32_t blockOffset,
+                                            const uint8_t * pData,
+                                            uint32_t spanSize,
+                                            uint32_t * pBlocksCompleted );
 
 /* Validate the incoming data block and store it in the file context. */
 
@@ -133,11 +205,122 @@ static DocParseErr_t extractParameter( JsonDocParam_t docParam,
                                        const char * pValueInJson,
                                        size_t valueLength );
 
-/* Parse a JSON document using the specified document model. */
+/* Store the values of the model parameters found in a tokenized JSON document. */
 
-static DocParseErr_t parseJSONbyModel( const char * pJson,
-                                       uint32_t messageLength,
-                                       JsonDocModel_t * pDocModel );
+static DocParseErr_t extractJSONbyModel( JsonDocModel_t * pDocModel );
+
+/* Walk a validated JSON document once and record the values of the model parameters. */
+
+static void tokenizeJSONbyModel( const char * pJson,
+                                 uint32_t messageLength,
+                                 JsonDocModel_t * pDocModel );
+
+/* Match a key of an object against the model parameters that may be in the object. */
+
+static uint32_t matchJsonKey( const JsonDocModel_t * pDocModel,
+                              uint32_t candidates,
+                              size_t pathLength,
+                              uint32_t keyPathHash,
+                              const char * pKey,
+                              size_t keyLength,
+                              uint32_t * pChildren );
+
+/* Continue the FNV-1a hash of a key path with the characters of a key. */
+
+static uint32_t hashJsonKey( uint32_t hash,
+                             const char * pKey,
+                             size_t keyLength );
+
+/* Match a key against the model parameters with a key that is only known at run time. */
+
+static uint32_t matchDynamicJsonKey( const JsonKeyTable_t * pKeyTable,
+                                     const JsonDocParam_t * pBodyDef,
+                                     uint16_t numModelParams,
+                                     uint32_t candidates,
+                                     const char * pKey,
+                                     size_t keyLength );
+
+/* Record the value of model parameters found in the JSON document. */
+
+static void recordJsonValue( JsonDocModel_t * pDocModel,
+                             uint32_t valueParams,
+                             const char * pValue,
+                             size_t valueLength );
+
+/* Get the bitmap of all the parameters of a document model. */
+
+static uint32_t allModelParams( uint16_t numModelParams );
+
+/* Match a key of an object, or an element of an array, against the model parameters. */
+
+static void matchJsonDocValue( const JsonDocModel_t * pDocModel,
+                               JsonDocLevel_t * pLevel,
+                               const char * pKey,
+                               size_t keyLength,
+                               uint32_t searched,
+                               uint32_t * pFoundInFile,
+                               JsonDocMatch_t * pMatch );
+
+/* Start the level of an object or array walked into. */
+
+static void enterJsonDocLevel( JsonDocLevel_t * pValueLevel,
+                               const JsonDocMatch_t * pMatch,
+                               const char * pValue,
+                               bool isObject );
+
+/* Check if a job document is encoded in CBOR. */
+
+static bool isCborJobDoc( const char * pDoc,
+                          uint32_t messageLength );
+
+/* Walk a CBOR job document once and record the values of the model parameters. */
+
+static DocParseErr_t tokenizeCBORbyModel( const uint8_t * pCbor,
+                                          size_t length,
+                                          JsonDocModel_t * pDocModel );
+
+/* Validate a JSON or CBOR job document and record the values of the model parameters. */
+
+static DocParseErr_t tokenizeJobDoc( const char * pDoc,
+                                     uint32_t messageLength,
+                                     JsonDocModel_t * pDocModel );
+
+/* Store the parameter from a CBOR data item to the offset specified by the document model. */
+
+static DocParseErr_t extractCborParameter( JsonDocParam_t docParam,
+                                           void * pContextBase,
+                                           const char * pValueInCbor,
+                                           size_t valueLength );
+
+/* Write an array of CBOR text strings as the text of a JSON array. */
+
+static DocParseErr_t writeCborTextArray( const CborValue * pArray,
+                                         char * pText,
+                                         size_t textSize,
+                                         size_t * pTextLength );
+
+/* Store a raw signature from a CBOR byte string. */
+
+static DocParseErr_t storeCborSignature( const CborValue * pValue,
+                                         void * pParamAdd );
+
+/* Skip the whitespace of a validated JSON document. */
+
+static size_t skipJsonSpace( const char * pJson,
+                             size_t index,
+                             size_t length );
+
+/* Skip a string of a validated JSON document, starting at its opening quote. */
+
+static size_t skipJsonString( const char * pJson,
+                              size_t index,
+                              size_t length );
+
+/* Skip a value of a validated JSON document. */
+
+static size_t skipJsonValue( const char * pJson,
+                             size_t index,
+                             size_t length );
 
 /* Decode the signature key from the job document and store it.*/
 
@@ -162,10 +345,16 @@ static DocParseErr_t verifyRequiredParamsExtracted( const JsonDocParam_t * pMode
 
 static OtaErr_t validateUpdateVersion( const OtaFileContext_t * pFileContext );
 
+/* Set a read-only view of the values found in a tokenized job document. */
+
+static void initJobDocView( const JsonDocModel_t * pDocModel,
+                            OtaJobDocView_t * pDocView );
+
 /* Check if the JSON can be parsed through a custom callback if initial parsing fails. */
 
 static OtaJobParseErr_t parseJobDocFromCustomCallback( const char * pJson,
                                                        uint32_t messageLength,
+                                                       const JsonDocModel_t * pDocModel,
                                                        OtaFileContext_t * pFileContext,
                                                        OtaFileContext_t ** pFinalFile );
 
@@ -187,6 +376,17 @@ static OtaFileContext_t * parseJobDoc( const char * pJson,
                                        uint32_t messageLength,
                                        bool * pUpdateJob );
 
+/* Validate and tokenize the OTA job document and hash the fields that identify the update. */
+
+static DocParseErr_t fingerprintJobDoc( const char * pJson,
+                                        uint32_t messageLength,
+                                        JsonDocModel_t * pDocModel,
+                                        uint32_t * pFingerprint );
+
+/* Check if a job document fingerprint is the one of the active job. */
+
+static bool isActiveJobDoc( uint32_t fingerprint );
+
 /* Validate block index and block size of the data block. */
 
 static bool validateDataBlock( const OtaFileContext_t * pFileContext,
@@ -198,9 +398,11 @@ static bool validateDataBlock( const OtaFileContext_t * pFileContext,
 static IngestResult_t decodeAndStoreDataBlock( OtaFileContext_t * pFileContext,
                                                const uint8_t * pRawMsg,
                                                uint32_t messageSize,
+                                               uint32_t messageBlock,
                                                uint8_t ** pPayload,
                                                uint32_t * uBlockSize,
-                                               uint32_t * uBlockIndex );
+                                               uint32_t * uBlockIndex,
+                                               uint32_t * pNumBlocks );
 
 /* Close an open OTA file context and free it. */
 
@@ -220,6 +422,13 @@ static void agentShutdownCleanup( void );
 
 static void dataHandlerCleanup( IngestResult_t result );
 
+/* Update the job status and request more blocks after file data is ingested. */
+
+static OtaErr_t handleIngestResult( IngestResult_t result,
+                                    OtaPalStatus_t closeResult,
+                                    uint32_t blocksReceived,
+                                    const OtaEventData_t * pEventData );
+
 /*
  * Prepare the document model for use by sanity checking the initialization parameters
  * and detecting all required parameters.
@@ -227,6 +436,7 @@ static void dataHandlerCleanup( IngestResult_t result );
 
 static DocParseErr_t initDocModel( JsonDocModel_t * pDocModel,
                                    const JsonDocParam_t * pBodyDef,
+                                   const JsonKeyTable_t * pKeyTable,
                                    void * contextBaseAddr,
                                    uint32_t contextSize,
                                    uint16_t numJobParams );
@@ -239,6 +449,18 @@ static bool inSelftest( void );
 
 static void handleUnexpectedEvents( const OtaEventMsg_t * pEventMsg );
 
+/* Check if an event is a job document of the active job received during the transfer. */
+
+static bool ignoreActiveJobDoc( const OtaEventMsg_t * pEventMsg );
+
+/* Check if the job document of an event has the bytes of the job document of the active job. */
+
+static bool isActiveJobDocCopy( const OtaEventData_t * pEventData );
+
+/* Store the pre-signed url of a job document of the active job in the file context. */
+
+static DocParseErr_t updateActiveJobUrl( const JsonDocModel_t * pDocModel );
+
 /* Free or clear multiple buffers used in the file context. */
 static void freeFileContextMem( OtaFileContext_t * const pFileContext );
 
@@ -250,6 +472,9 @@ static OtaErr_t processJobHandler( const OtaEventData_t * pEventData );
 static OtaErr_t inSelfTestHandler( const OtaEventData_t * pEventData );
 static OtaErr_t initFileHandler( const OtaEventData_t * pEventData );
 static OtaErr_t processDataHandler( const OtaEventData_t * pEventData );
+static OtaErr_t processChunkHandler( const OtaEventData_t * pEventData );
+static OtaErr_t processWrittenChunkHandler( const OtaEventData_t * pEventData );
+static OtaErr_t reportProgressHandler( const OtaEventData_t * pEventData );
 static OtaErr_t requestDataHandler( const OtaEventData_t * pEventData );
 static OtaErr_t shutdownHandler( const OtaEventData_t * pEventData );
 static OtaErr_t closeFileHandler( const OtaEventData_t * pEventData );
@@ -257,9 +482,97 @@ static OtaErr_t userAbortHandler( const OtaEventData_t * pEventData );
 static OtaErr_t suspendHandler( const OtaEventData_t * pEventData );
 static OtaErr_t resumeHandler( const OtaEventData_t * pEventData );
 static OtaErr_t jobNotificationHandler( const OtaEventData_t * pEventData );
+static OtaErr_t continueTransferHandler( const OtaEventData_t * pEventData );
 static void executeHandler( uint32_t index,
                             const OtaEventMsg_t * const pEventMsg );
 
+/**
+ * @brief Check if the agent passively listens to a shared data stream.
+ *
+ * @return true if passive listening is enabled and the file is downloaded over MQTT.
+ */
+static bool passiveListenActive( void );
+
+/**
+ * @brief Get the jittered hold-off time before a passive listener requests file blocks.
+ *
+ * @return The hold-off time in milliseconds.
+ */
+static uint32_t passiveRequestHoldoff( void );
+
+/**
+ * @brief Reset the progress reporting state at the start of a file transfer.
+ */
+static void resetReceiveProgress( void );
+
+/**
+ * @brief Request the job document again to refresh the rejected pre-signed url.
+ *
+ * @return OtaErrNone if the job document request was signaled, otherwise OtaErrSignalEventFailed.
+ */
+static OtaErr_t refreshUpdateUrl( void );
+
+/**
+ * @brief Check if a job status update with the download progress is due.
+ *
+ * A progress update is due once otaconfigOTA_STATUS_MIN_INTERVAL_MS has elapsed since the
+ * previous update and the download has progressed by otaconfigOTA_STATUS_MIN_PROGRESS_PERCENT.
+ *
+ * @return true if the download progress should be reported.
+ */
+static bool receiveProgressDue( void );
+
+/**
+ * @brief Get the download progress of the file.
+ *
+ * @return The percentage of the file blocks received.
+ */
+static uint32_t receiveProgress( void );
+
+/**
+ * @brief Signal the agent to report the download progress if an update is due.
+ *
+ * Only signals OtaAgentEventReportProgress, the job status is updated by reportProgressHandler
+ * so that publishing does not hold up the file block ingest.
+ */
+static void reportReceiveProgress( void );
+
+/**
+ * @brief Set the data interface of the job, measuring the offered data protocols if needed.
+ *
+ * Uses the data protocol measured fastest if the job offers it. Otherwise, if the job offers
+ * more than one data protocol and otaconfigENABLE_DATA_PROTOCOL_PROBE is enabled, starts the
+ * download over the first protocol to measure.
+ *
+ * @return OtaErrNone if the data interface is set, otherwise an error from setDataInterface.
+ */
+static OtaErr_t selectDataInterface( void );
+
+/**
+ * @brief Count the file blocks received over the data protocol being measured.
+ *
+ * @param[in] blocksReceived Number of file blocks completed by the event.
+ */
+static void recordProbeBlocks( uint32_t blocksReceived );
+
+/**
+ * @brief Update the fastest data protocol with the measurement of the current one.
+ */
+static void measureDataProtocol( void );
+
+/**
+ * @brief Keep the fastest data protocol for the following jobs and stop measuring.
+ */
+static void finishDataProbe( void );
+
+/**
+ * @brief Move on to the next data protocol to measure once the current one is measured.
+ *
+ * Called when all blocks of a request are received, so that no blocks are in flight over
+ * the data protocol that is replaced.
+ */
+static void switchDataProtocol( void );
+
 /* This is THE OTA agent context and initialization state. */
 
 static OtaAgentContext_t otaAgent =
@@ -278,31 +591,36 @@ static OtaAgentContext_t otaAgent =
     0,                    /* requestMomentum */
     NULL,                 /* pOtaInterface */
     NULL,                 /* OtaAppCallback */
-    NULL                  /* customJobCallback */
+    NULL,                 /* customJobCallback */
+    NULL                  /* customJobDocCallback */
 };
 
 static OtaStateTableEntry_t otaTransitionTable[] =
 {
-    /*STATE ,                              EVENT ,                               ACTION ,               NEXT STATE                         */
-    { OtaAgentStateReady,               OtaAgentEventStart,               startHandler,           OtaAgentStateRequestingJob       },
-    { OtaAgentStateRequestingJob,       OtaAgentEventRequestJobDocument,  requestJobHandler,      OtaAgentStateWaitingForJob       },
-    { OtaAgentStateRequestingJob,       OtaAgentEventRequestTimer,        requestJobHandler,      OtaAgentStateWaitingForJob       },
-    { OtaAgentStateWaitingForJob,       OtaAgentEventReceivedJobDocument, processJobHandler,      OtaAgentStateCreatingFile        },
-    { OtaAgentStateCreatingFile,        OtaAgentEventStartSelfTest,       inSelfTestHandler,      OtaAgentStateWaitingForJob       },
-    { OtaAgentStateCreatingFile,        OtaAgentEventCreateFile,          initFileHandler,        OtaAgentStateRequestingFileBlock },
-    { OtaAgentStateCreatingFile,        OtaAgentEventRequestTimer,        initFileHandler,        OtaAgentStateRequestingFileBlock },
-    { OtaAgentStateRequestingFileBlock, OtaAgentEventRequestFileBlock,    requestDataHandler,     OtaAgentStateWaitingForFileBlock },
-    { OtaAgentStateRequestingFileBlock, OtaAgentEventRequestTimer,        requestDataHandler,     OtaAgentStateWaitingForFileBlock },
-    { OtaAgentStateWaitingForFileBlock, OtaAgentEventReceivedFileBlock,   processDataHandler,     OtaAgentStateWaitingForFileBlock },
-    { OtaAgentStateWaitingForFileBlock, OtaAgentEventRequestTimer,        requestDataHandler,     OtaAgentStateWaitingForFileBlock },
-    { OtaAgentStateWaitingForFileBlock, OtaAgentEventRequestFileBlock,    requestDataHandler,     OtaAgentStateWaitingForFileBlock },
-    { OtaAgentStateWaitingForFileBlock, OtaAgentEventRequestJobDocument,  requestJobHandler,      OtaAgentStateWaitingForJob       },
-    { OtaAgentStateWaitingForFileBlock, OtaAgentEventReceivedJobDocument, jobNotificationHandler, OtaAgentStateRequestingJob       },
-    { OtaAgentStateWaitingForFileBlock, OtaAgentEventCloseFile,           closeFileHandler,       OtaAgentStateWaitingForJob       },
-    { OtaAgentStateSuspended,           OtaAgentEventResume,              resumeHandler,          OtaAgentStateRequestingJob       },
-    { OtaAgentStateAll,                 OtaAgentEventSuspend,             suspendHandler,         OtaAgentStateSuspended           },
-    { OtaAgentStateAll,                 OtaAgentEventUserAbort,           userAbortHandler,       OtaAgentStateWaitingForJob       },
-    { OtaAgentStateAll,                 OtaAgentEventShutdown,            shutdownHandler,        OtaAgentStateStopped             },
+    /*STATE ,                              EVENT ,                               ACTION ,                  NEXT STATE                         */
+    { OtaAgentStateReady,               OtaAgentEventStart,               startHandler,               OtaAgentStateRequestingJob       },
+    { OtaAgentStateRequestingJob,       OtaAgentEventRequestJobDocument,  requestJobHandler,          OtaAgentStateWaitingForJob       },
+    { OtaAgentStateRequestingJob,       OtaAgentEventRequestTimer,        requestJobHandler,          OtaAgentStateWaitingForJob       },
+    { OtaAgentStateWaitingForJob,       OtaAgentEventReceivedJobDocument, processJobHandler,          OtaAgentStateCreatingFile        },
+    { OtaAgentStateWaitingForJob,       OtaAgentEventContinueTransfer,    continueTransferHandler,    OtaAgentStateRequestingFileBlock },
+    { OtaAgentStateCreatingFile,        OtaAgentEventStartSelfTest,       inSelfTestHandler,          OtaAgentStateWaitingForJob       },
+    { OtaAgentStateCreatingFile,        OtaAgentEventCreateFile,          initFileHandler,            OtaAgentStateRequestingFileBlock },
+    { OtaAgentStateCreatingFile,        OtaAgentEventRequestTimer,        initFileHandler,            OtaAgentStateRequestingFileBlock },
+    { OtaAgentStateRequestingFileBlock, OtaAgentEventRequestFileBlock,    requestDataHandler,         OtaAgentStateWaitingForFileBlock },
+    { OtaAgentStateRequestingFileBlock, OtaAgentEventRequestTimer,        requestDataHandler,         OtaAgentStateWaitingForFileBlock },
+    { OtaAgentStateWaitingForFileBlock, OtaAgentEventReceivedFileBlock,   processDataHandler,         OtaAgentStateWaitingForFileBlock },
+    { OtaAgentStateWaitingForFileBlock, OtaAgentEventReceivedFileChunk,   processChunkHandler,        OtaAgentStateWaitingForFileBlock },
+    { OtaAgentStateWaitingForFileBlock, OtaAgentEventFileChunkWritten,    processWrittenChunkHandler, OtaAgentStateWaitingForFileBlock },
+    { OtaAgentStateWaitingForFileBlock, OtaAgentEventReportProgress,      reportProgressHandler,      OtaAgentStateWaitingForFileBlock },
+    { OtaAgentStateWaitingForFileBlock, OtaAgentEventRequestTimer,        requestDataHandler,         OtaAgentStateWaitingForFileBlock },
+    { OtaAgentStateWaitingForFileBlock, OtaAgentEventRequestFileBlock,    requestDataHandler,         OtaAgentStateWaitingForFileBlock },
+    { OtaAgentStateWaitingForFileBlock, OtaAgentEventRequestJobDocument,  requestJobHandler,          OtaAgentStateWaitingForJob       },
+    { OtaAgentStateWaitingForFileBlock, OtaAgentEventReceivedJobDocument, jobNotificationHandler,     OtaAgentStateRequestingJob       },
+    { OtaAgentStateWaitingForFileBlock, OtaAgentEventCloseFile,           closeFileHandler,           OtaAgentStateWaitingForJob       },
+    { OtaAgentStateSuspended,           OtaAgentEventResume,              resumeHandler,              OtaAgentStateRequestingJob       },
+    { OtaAgentStateAll,                 OtaAgentEventSuspend,             suspendHandler,             OtaAgentStateSuspended           },
+    { OtaAgentStateAll,                 OtaAgentEventUserAbort,           userAbortHandler,           OtaAgentStateWaitingForJob       },
+    { OtaAgentStateAll,                 OtaAgentEventShutdown,            shutdownHandler,            OtaAgentStateStopped             },
 };
 
 /* MISRA rule 2.2 warns about unused variables. These 2 variables are used in log messages, which is
@@ -339,13 +657,72 @@ static const char * pOtaEventStrings[ OtaAgentEventMax ] =
     "Suspend",
     "Resume",
     "UserAbort",
-    "Shutdown"
+    "Shutdown",
+    "ReceivedFileChunk",
+    "FileChunkWritten",
+    "ReportProgress",
+    "ContinueTransfer"
 };
 
 static uint8_t pJobNameBuffer[ OTA_JOB_ID_MAX_SIZE ];
-static uint8_t pProtocolBuffer[ 20 ];
+static uint8_t pProtocolBuffer[ 24 ];
 static Sig256_t sig256Buffer;
 
+/* Download progress in percent at the last progress update. */
+static uint32_t lastReportedProgress = 0;
+
+/* Set by the progress timer once a new progress update is allowed. */
+static volatile bool progressIntervalElapsed = true;
+
+/* Set while a progress event signaled by the file block ingest or the progress timer is not
+ * handled yet. */
+static volatile bool progressEventPending = false;
+
+/* Set while a request event signaled by the file block ingest is not handled yet. A request
+ * always covers every block received before it, so one pending request event is enough. */
+static bool requestEventPending = false;
+
+/**
+ * @brief A block that is received in chunks.
+ */
+typedef struct OtaPartialBlock
+{
+    uint32_t blockIndex;    /*!< Index of the block. */
+    uint32_t bytesReceived; /*!< Bytes of the block received so far, 0 if the entry is unused. */
+} OtaPartialBlock_t;
+
+/* Blocks received in chunks that are not complete yet, one for each HTTP response in flight. */
+static OtaPartialBlock_t partialBlocks[ otaconfigHTTP_MAX_PARALLEL_REQUESTS ];
+
+/* Number of pre-signed url refreshes since the last block was received. */
+static uint32_t urlRefreshCount = 0;
+
+/* Fingerprint of the job document of the active transfer, 0 if none. */
+static uint32_t activeJobFingerprint = 0;
+
+/* Hash and length of the bytes of the last job document accepted for the active transfer. */
+static uint32_t activeJobDocHash = 0;
+static uint32_t activeJobDocLength = 0;
+
+/**
+ * @brief State of the measurement of the data protocols offered by a job.
+ */
+typedef struct OtaDataProbe
+{
+    uint32_t candidates;       /*!< Data protocols left to measure. */
+    uint32_t protocol;         /*!< Data protocol being measured, 0 if none. */
+    uint32_t startMs;          /*!< Time the transfer over the data protocol started. */
+    uint32_t blocksReceived;   /*!< File blocks received over the data protocol. */
+    uint32_t latencyMs;        /*!< Time from the start of the transfer to the first file block. */
+    OtaDataProbeResult_t best; /*!< Fastest data protocol measured so far. */
+} OtaDataProbe_t;
+
+/* Measurement of the data protocols of the active job. */
+static OtaDataProbe_t dataProbe;
+
+/* Data protocol measured fastest, used by the following jobs that offer it. */
+static OtaDataProbeResult_t dataProbeResult;
+
 static void otaTimerCallback( OtaTimerId_t otaTimerId )
 {
     if( otaTimerId == OtaRequestTimer )
@@ -370,6 +747,13 @@ static void otaTimerCallback( OtaTimerId_t otaTimerId )
 
         ( void ) otaAgent.pOtaInterface->pal.reset( &otaAgent.fileContext );
     }
+    else if( otaTimerId == OtaProgressTimer )
+    {
+        progressIntervalElapsed = true;
+
+        /* Report the progress made during the interval even if no further block arrives. */
+        reportReceiveProgress();
+    }
     else
     {
         LogWarn( ( "Invalid ota timer id: "
@@ -396,130 +780,445 @@ static bool inSelftest( void )
     return selfTest;
 }
 
-static OtaErr_t updateJobStatusFromImageState( OtaImageState_t state,
-                                               int32_t subReason )
+/*
+ * Passive listening only applies to MQTT since blocks received over HTTP are always the response
+ * to our own request.
+ */
+static bool passiveListenActive( void )
 {
-    OtaErr_t err = OtaErrNone;
-    int32_t reason = 0;
-
-    if( state == OtaImageStateTesting )
-    {
-        /* We discovered we're ready for test mode, put job status in self_test active. */
-        err = otaControlInterface.updateJobStatus( &otaAgent,
-                                                   JobStatusInProgress,
-                                                   JobReasonSelfTestActive,
-                                                   0 );
-    }
-    else
-    {
-        if( state == OtaImageStateAccepted )
-        {
-            /* Now that we have accepted the firmware update, we can complete the job. */
-            err = otaControlInterface.updateJobStatus( &otaAgent,
-                                                       JobStatusSucceeded,
-                                                       JobReasonAccepted,
-                                                       appFirmwareVersion.u.signedVersion32 );
-        }
-        else
+    bool passive = false;
+
+    #if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_MQTT )
+        /* MISRA rule 14.3 requires controlling expressions to be not invariant. otaconfigENABLE_PASSIVE_STREAM_LISTEN
+         * is one of the OTA library configuration and users can change it when they build their application.
+         * So this is a false positive. */
+        /* coverity[misra_c_2012_rule_14_3_violation] */
+        if( ( otaconfigENABLE_PASSIVE_STREAM_LISTEN == 1U ) &&
+            ( otaDataInterface.decodeFileBlock == decodeFileBlock_Mqtt ) )
         {
-            /*
-             * The firmware update was either rejected or aborted, complete the job as FAILED (Job service
-             * will not allow us to set REJECTED after the job has been started already).
-             */
-            reason = ( state == OtaImageStateRejected ) ? JobReasonRejected : JobReasonAborted;
-            err = otaControlInterface.updateJobStatus( &otaAgent,
-                                                       JobStatusFailed,
-                                                       reason,
-                                                       subReason );
+            passive = true;
         }
+    #endif
 
-        /*
-         * We don't need the job name memory anymore since we're done with this job.
-         */
-        ( void ) memset( otaAgent.pActiveJobName, 0, OTA_JOB_ID_MAX_SIZE );
+    return passive;
+}
+
+/*
+ * The jitter is a FNV-1a hash of the thing name and the number of blocks remaining. Thing names are
+ * unique within a fleet, so the devices waiting on the same stream spread their requests over the
+ * jitter window instead of sending them all at once.
+ */
+static uint32_t passiveRequestHoldoff( void )
+{
+    uint32_t hash = OTA_FNV_OFFSET_BASIS;
+    uint32_t i = 0;
+
+    for( i = 0; ( i < otaconfigMAX_THINGNAME_LEN ) && ( otaAgent.pThingName[ i ] != 0U ); i++ )
+    {
+        hash ^= otaAgent.pThingName[ i ];
+        hash *= OTA_FNV_PRIME;
     }
 
-    return err;
+    hash ^= otaAgent.fileContext.blocksRemaining;
+    hash *= OTA_FNV_PRIME;
+
+    return otaconfigPASSIVE_REQUEST_HOLDOFF_MS + ( hash % ( otaconfigPASSIVE_REQUEST_JITTER_MS + 1U ) );
 }
 
-static OtaErr_t setImageStateWithReason( OtaImageState_t stateToSet,
-                                         uint32_t reasonToSet )
+static OtaErr_t selectDataInterface( void )
 {
     OtaErr_t err = OtaErrNone;
-    OtaImageState_t state = stateToSet;
-    uint32_t reason = reasonToSet;
-    OtaPalStatus_t palStatus;
+    uint32_t protocols = 0;
+    bool probeAvailable = false;
 
-    /* Call the platform specific code to set the image state. */
-    palStatus = otaAgent.pOtaInterface->pal.setPlatformImageState( &( otaAgent.fileContext ), state );
+    protocols = getProbeDataProtocols( otaAgent.fileContext.pProtocols );
 
-    /*
-     * If the platform image state couldn't be set correctly, force fail the update by setting the
-     * image state to "Rejected" unless it's already in "Aborted".
-     */
-    if( ( OTA_PAL_MAIN_ERR( palStatus ) != OtaPalSuccess ) && ( state != OtaImageStateAborted ) )
+    /* MISRA rule 14.3 requires controlling expressions to be not invariant. otaconfigENABLE_DATA_PROTOCOL_PROBE
+     * is one of the OTA library configuration and users can change it when they build their application.
+     * So this is a false positive. */
+    /* coverity[misra_c_2012_rule_14_3_violation] */
+    if( otaconfigENABLE_DATA_PROTOCOL_PROBE == 1U )
     {
-        /* Intentionally override state since we failed within this function. */
-        state = OtaImageStateRejected;
-
-        /*
-         * Capture the failure reason if not already set (and we're not already Aborted as checked above). Otherwise Keep
-         * the original reject reason code since it is possible for the PAL to fail to update the image state in some
-         * cases (e.g. a reset already caused the bundle rollback and we failed to rollback again).
-         */
-        if( reason == 0U )
-        {
-            /* Intentionally override reason since we failed within this function. */
-            reason = palStatus;
-        }
+        /* Measuring needs a clock and more than one protocol to choose from. */
+        probeAvailable = ( otaAgent.pOtaInterface->os.timer.getTimeMs != NULL ) &&
+                         ( ( protocols & ( protocols - 1U ) ) != 0U );
     }
 
-    /* Now update the image state and job status on service side. */
-    otaAgent.imageState = state;
-
-    if( strlen( ( const char * ) otaAgent.pActiveJobName ) > 0u )
+    if( ( dataProbe.protocol != 0U ) && ( ( protocols & dataProbe.protocol ) != 0U ) )
     {
-        err = updateJobStatusFromImageState( state, ( int32_t ) reason );
+        /* The job is received again while measuring, keep measuring the same protocol. */
+        err = setDataInterfaceForProtocol( &otaDataInterface, dataProbe.protocol );
     }
-    else
+    else if( ( protocols & dataProbeResult.protocol ) != 0U )
     {
-        err = OtaErrNoActiveJob;
+        LogInfo( ( "Using the data protocol measured fastest: protocol=%u, bytesPerSecond=%u",
+                   ( unsigned int ) dataProbeResult.protocol,
+                   ( unsigned int ) dataProbeResult.bytesPerSecond ) );
+
+        err = setDataInterfaceForProtocol( &otaDataInterface, dataProbeResult.protocol );
     }
+    else if( probeAvailable == true )
+    {
+        ( void ) memset( &dataProbe, 0, sizeof( dataProbe ) );
+        dataProbe.protocol = nextProbeDataProtocol( protocols );
+        dataProbe.candidates = protocols & ~dataProbe.protocol;
 
-    if( err != OtaErrNone )
+        LogInfo( ( "Measuring the data protocols of the job: protocols=%u",
+                   ( unsigned int ) protocols ) );
+
+        err = setDataInterfaceForProtocol( &otaDataInterface, dataProbe.protocol );
+    }
+    else
     {
-        LogWarn( ( "Failed to set image state with reason: "
-                   "OtaErr_t=%s"
-                   ", OtaPalStatus_t=%s"
-                   ", state=%d"
-                   ", reason=%d",
-                   OTA_Err_strerror( err ),
-                   OTA_PalStatus_strerror( OTA_PAL_MAIN_ERR( palStatus ) ),
-                   stateToSet,
-                   reasonToSet ) );
+        err = setDataInterface( &otaDataInterface, otaAgent.fileContext.pProtocols );
     }
 
     return err;
 }
 
-static OtaErr_t startHandler( const OtaEventData_t * pEventData )
+static void recordProbeBlocks( uint32_t blocksReceived )
 {
-    OtaErr_t retVal = OtaErrNone;
-    OtaEventMsg_t eventMsg = { 0 };
+    if( ( dataProbe.protocol != 0U ) && ( blocksReceived > 0U ) )
+    {
+        if( dataProbe.blocksReceived == 0U )
+        {
+            dataProbe.latencyMs = otaAgent.pOtaInterface->os.timer.getTimeMs() - dataProbe.startMs;
+        }
 
-    ( void ) pEventData;
+        dataProbe.blocksReceived += blocksReceived;
+    }
+}
 
-    /* Start self-test timer, if platform is in self-test. */
-    if( inSelftest() == true )
+static void measureDataProtocol( void )
+{
+    uint32_t elapsedMs = 0;
+    uint32_t bytesReceived = 0;
+    uint32_t bytesPerSecond = 0;
+
+    elapsedMs = otaAgent.pOtaInterface->os.timer.getTimeMs() - dataProbe.startMs;
+
+    if( elapsedMs == 0U )
     {
-        ( void ) otaAgent.pOtaInterface->os.timer.start( OtaSelfTestTimer,
-                                                         "OtaSelfTestTimer",
-                                                         otaconfigSELF_TEST_RESPONSE_WAIT_MS,
-                                                         otaTimerCallback );
+        elapsedMs = 1U;
     }
 
-    /* Send event to OTA task to get job document. */
-    eventMsg.eventId = OtaAgentEventRequestJobDocument;
+    /* Measured in whole file blocks, the protocols are compared over the same block size.
+     * Split the division to not overflow 32 bits. */
+    bytesReceived = dataProbe.blocksReceived * OTA_FILE_BLOCK_SIZE;
+    bytesPerSecond = ( ( bytesReceived / elapsedMs ) * 1000U ) +
+                     ( ( ( bytesReceived % elapsedMs ) * 1000U ) / elapsedMs );
+
+    LogInfo( ( "Measured data protocol: protocol=%u, bytesPerSecond=%u, latencyMs=%u",
+               ( unsigned int ) dataProbe.protocol,
+               ( unsigned int ) bytesPerSecond,
+               ( unsigned int ) dataProbe.latencyMs ) );
+
+    if( ( dataProbe.best.protocol == 0U ) ||
+        ( bytesPerSecond > dataProbe.best.bytesPerSecond ) ||
+        ( ( bytesPerSecond == dataProbe.best.bytesPerSecond ) && ( dataProbe.latencyMs < dataProbe.best.latencyMs ) ) )
+    {
+        dataProbe.best.protocol = dataProbe.protocol;
+        dataProbe.best.bytesPerSecond = bytesPerSecond;
+        dataProbe.best.latencyMs = dataProbe.latencyMs;
+    }
+}
+
+static void finishDataProbe( void )
+{
+    OtaPalStatus_t palStatus = OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
+
+    dataProbeResult = dataProbe.best;
+    dataProbe.protocol = 0;
+    dataProbe.candidates = 0;
+
+    if( otaAgent.pOtaInterface->pal.saveProbeResult != NULL )
+    {
+        palStatus = otaAgent.pOtaInterface->pal.saveProbeResult( &dataProbeResult );
+
+        if( OTA_PAL_MAIN_ERR( palStatus ) != OtaPalSuccess )
+        {
+            /* The result is still used until the next reboot. */
+            LogWarn( ( "Failed to store the data protocol measured fastest: "
+                       "OtaPalStatus_t=%s",
+                       OTA_PalStatus_strerror( OTA_PAL_MAIN_ERR( palStatus ) ) ) );
+        }
+    }
+}
+
+static void switchDataProtocol( void )
+{
+    OtaErr_t err = OtaErrNone;
+    uint32_t protocol = 0;
+    uint32_t protocolInUse = dataProbe.protocol;
+
+    measureDataProtocol();
+
+    if( dataProbe.candidates != 0U )
+    {
+        protocol = nextProbeDataProtocol( dataProbe.candidates );
+        dataProbe.candidates &= ~protocol;
+        dataProbe.protocol = protocol;
+    }
+    else
+    {
+        protocol = dataProbe.best.protocol;
+        finishDataProbe();
+    }
+
+    if( protocol != protocolInUse )
+    {
+        if( otaDataInterface.cleanup != NULL )
+        {
+            ( void ) otaDataInterface.cleanup( &otaAgent );
+        }
+
+        err = setDataInterfaceForProtocol( &otaDataInterface, protocol );
+
+        if( err == OtaErrNone )
+        {
+            err = otaDataInterface.initFileTransfer( &otaAgent );
+        }
+
+        if( err != OtaErrNone )
+        {
+            /* The request timer retries the request over the data interface that is set. */
+            LogWarn( ( "Failed to switch the data protocol: protocol=%u, OtaErr_t=%s",
+                       ( unsigned int ) protocol,
+                       OTA_Err_strerror( err ) ) );
+        }
+    }
+
+    dataProbe.startMs = otaAgent.pOtaInterface->os.timer.getTimeMs();
+    dataProbe.blocksReceived = 0;
+    dataProbe.latencyMs = 0;
+}
+
+static void resetReceiveProgress( void )
+{
+    ( void ) otaAgent.pOtaInterface->os.timer.stop( OtaProgressTimer );
+
+    lastReportedProgress = 0;
+    progressIntervalElapsed = true;
+    progressEventPending = false;
+}
+
+static uint32_t receiveProgress( void )
+{
+    uint32_t numBlocks = 0;
+    uint32_t progress = 0;
+
+    numBlocks = ( otaAgent.fileContext.fileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+
+    if( numBlocks > 0U )
+    {
+        progress = ( ( numBlocks - otaAgent.fileContext.blocksRemaining ) * 100U ) / numBlocks;
+    }
+
+    return progress;
+}
+
+static bool receiveProgressDue( void )
+{
+    return ( progressIntervalElapsed == true ) &&
+           ( receiveProgress() >= ( lastReportedProgress + otaconfigOTA_STATUS_MIN_PROGRESS_PERCENT ) );
+}
+
+static void reportReceiveProgress( void )
+{
+    OtaEventMsg_t eventMsg = { 0 };
+
+    if( ( progressEventPending == false ) && ( receiveProgressDue() == true ) )
+    {
+        eventMsg.eventId = OtaAgentEventReportProgress;
+
+        if( OTA_SignalEvent( &eventMsg ) == true )
+        {
+            progressEventPending = true;
+        }
+        else
+        {
+            LogWarn( ( "Failed to signal the OTA Agent to report the download progress" ) );
+        }
+    }
+}
+
+static OtaErr_t reportProgressHandler( const OtaEventData_t * pEventData )
+{
+    OtaErr_t err = OtaErrNone;
+    OtaOsStatus_t osErr = OtaOsSuccess;
+    uint32_t progress = 0;
+
+    ( void ) pEventData;
+
+    progressEventPending = false;
+
+    if( receiveProgressDue() == true )
+    {
+        progress = receiveProgress();
+
+        err = otaControlInterface.updateJobStatus( &otaAgent, JobStatusInProgress, JobReasonReceiving, 0 );
+
+        if( err == OtaErrNone )
+        {
+            lastReportedProgress = progress;
+
+            /* MISRA rule 14.3 requires controlling expressions to be not invariant. otaconfigOTA_STATUS_MIN_INTERVAL_MS
+             * is one of the OTA library configuration and users can change it when they build their application.
+             * So this is a false positive. */
+            /* coverity[misra_c_2012_rule_14_3_violation] */
+            if( otaconfigOTA_STATUS_MIN_INTERVAL_MS > 0U )
+            {
+                progressIntervalElapsed = false;
+
+                osErr = otaAgent.pOtaInterface->os.timer.start( OtaProgressTimer,
+                                                                "OtaProgressTimer",
+                                                                otaconfigOTA_STATUS_MIN_INTERVAL_MS,
+                                                                otaTimerCallback );
+
+                if( osErr != OtaOsSuccess )
+                {
+                    /* Without the timer the interval can never elapse, so only limit by progress. */
+                    progressIntervalElapsed = true;
+                }
+            }
+        }
+        else
+        {
+            /* Progress updates are best effort. Don't hold up the download, the next update
+             * will catch up. */
+            LogWarn( ( "Failed to update the download progress: OtaErr_t=%s",
+                       OTA_Err_strerror( err ) ) );
+        }
+    }
+
+    /* A failed progress update must not stop the download, so stay in the current state. */
+    return OtaErrNone;
+}
+
+static OtaErr_t updateJobStatusFromImageState( OtaImageState_t state,
+                                               int32_t subReason )
+{
+    OtaErr_t err = OtaErrNone;
+    int32_t reason = 0;
+
+    if( state == OtaImageStateTesting )
+    {
+        /* We discovered we're ready for test mode, put job status in self_test active. */
+        err = otaControlInterface.updateJobStatus( &otaAgent,
+                                                   JobStatusInProgress,
+                                                   JobReasonSelfTestActive,
+                                                   0 );
+    }
+    else
+    {
+        if( state == OtaImageStateAccepted )
+        {
+            /* Now that we have accepted the firmware update, we can complete the job. */
+            err = otaControlInterface.updateJobStatus( &otaAgent,
+                                                       JobStatusSucceeded,
+                                                       JobReasonAccepted,
+                                                       appFirmwareVersion.u.signedVersion32 );
+        }
+        else
+        {
+            /*
+             * The firmware update was either rejected or aborted, complete the job as FAILED (Job service
+             * will not allow us to set REJECTED after the job has been started already).
+             */
+            reason = ( state == OtaImageStateRejected ) ? JobReasonRejected : JobReasonAborted;
+            err = otaControlInterface.updateJobStatus( &otaAgent,
+                                                       JobStatusFailed,
+                                                       reason,
+                                                       subReason );
+        }
+
+        /*
+         * We don't need the job name memory anymore since we're done with this job.
+         */
+        ( void ) memset( otaAgent.pActiveJobName, 0, OTA_JOB_ID_MAX_SIZE );
+    }
+
+    return err;
+}
+
+static OtaErr_t setImageStateWithReason( OtaImageState_t stateToSet,
+                                         uint32_t reasonToSet )
+{
+    OtaErr_t err = OtaErrNone;
+    OtaImageState_t state = stateToSet;
+    uint32_t reason = reasonToSet;
+    OtaPalStatus_t palStatus;
+
+    /* Call the platform specific code to set the image state. */
+    palStatus = otaAgent.pOtaInterface->pal.setPlatformImageState( &( otaAgent.fileContext ), state );
+
+    /*
+     * If the platform image state couldn't be set correctly, force fail the update by setting the
+     * image state to "Rejected" unless it's already in "Aborted".
+     */
+    if( ( OTA_PAL_MAIN_ERR( palStatus ) != OtaPalSuccess ) && ( state != OtaImageStateAborted ) )
+    {
+        /* Intentionally override state since we failed within this function. */
+        state = OtaImageStateRejected;
+
+        /*
+         * Capture the failure reason if not already set (and we're not already Aborted as checked above). Otherwise Keep
+         * the original reject reason code since it is possible for the PAL to fail to update the image state in some
+         * cases (e.g. a reset already caused the bundle rollback and we failed to rollback again).
+         */
+        if( reason == 0U )
+        {
+            /* Intentionally override reason since we failed within this function. */
+            reason = palStatus;
+        }
+    }
+
+    /* Now update the image state and job status on service side. */
+    otaAgent.imageState = state;
+
+    if( strlen( ( const char * ) otaAgent.pActiveJobName ) > 0u )
+    {
+        err = updateJobStatusFromImageState( state, ( int32_t ) reason );
+    }
+    else
+    {
+        err = OtaErrNoActiveJob;
+    }
+
+    if( err != OtaErrNone )
+    {
+        LogWarn( ( "Failed to set image state with reason: "
+                   "OtaErr_t=%s"
+                   ", OtaPalStatus_t=%s"
+                   ", state=%d"
+                   ", reason=%d",
+                   OTA_Err_strerror( err ),
+                   OTA_PalStatus_strerror( OTA_PAL_MAIN_ERR( palStatus ) ),
+                   stateToSet,
+                   reasonToSet ) );
+    }
+
+    return err;
+}
+
+static OtaErr_t startHandler( const OtaEventData_t * pEventData )
+{
+    OtaErr_t retVal = OtaErrNone;
+    OtaEventMsg_t eventMsg = { 0 };
+
+    ( void ) pEventData;
+
+    /* Start self-test timer, if platform is in self-test. */
+    if( inSelftest() == true )
+    {
+        ( void ) otaAgent.pOtaInterface->os.timer.start( OtaSelfTestTimer,
+                                                         "OtaSelfTestTimer",
+                                                         otaconfigSELF_TEST_RESPONSE_WAIT_MS,
+                                                         otaTimerCallback );
+    }
+
+    /* Send event to OTA task to get job document. */
+    eventMsg.eventId = OtaAgentEventRequestJobDocument;
 
     if( OTA_SignalEvent( &eventMsg ) == false )
     {
@@ -680,7 +1379,7 @@ static OtaErr_t processValidFileContext( void )
     if( inSelftest() == false )
     {
         /* Init data interface routines */
-        retVal = setDataInterface( &otaDataInterface, otaAgent.fileContext.pProtocols );
+        retVal = selectDataInterface();
 
         if( retVal == OtaErrNone )
         {
@@ -758,6 +1457,38 @@ static OtaErr_t processJobHandler( const OtaEventData_t * pEventData )
     return retVal;
 }
 
+static OtaErr_t continueTransferHandler( const OtaEventData_t * pEventData )
+{
+    OtaErr_t err = OtaErrNone;
+    OtaEventMsg_t eventMsg = { 0 };
+
+    ( void ) pEventData;
+
+    /* Only the data interface is set up again. The blocks received, the statistics and the
+     * download progress are kept, unlike when initFileHandler starts a transfer. */
+    err = otaDataInterface.initFileTransfer( &otaAgent );
+
+    if( err == OtaErrNone )
+    {
+        /* The responses in flight are not received anymore, their blocks are requested again. */
+        ( void ) memset( partialBlocks, 0, sizeof( partialBlocks ) );
+
+        eventMsg.eventId = OtaAgentEventRequestFileBlock;
+        requestEventPending = OTA_SignalEvent( &eventMsg );
+
+        if( requestEventPending == false )
+        {
+            err = OtaErrSignalEventFailed;
+        }
+    }
+    else
+    {
+        LogError( ( "Failed to continue the file transfer: OtaErr_t=%s", OTA_Err_strerror( err ) ) );
+    }
+
+    return err;
+}
+
 static OtaErr_t initFileHandler( const OtaEventData_t * pEventData )
 {
     OtaErr_t err = OtaErrUninitialized;
@@ -818,9 +1549,24 @@ static OtaErr_t initFileHandler( const OtaEventData_t * pEventData )
         /* Reset the OTA statistics. */
         ( void ) memset( &otaAgent.statistics, 0, sizeof( otaAgent.statistics ) );
 
+        /* Start reporting the progress of the new transfer from zero. */
+        resetReceiveProgress();
+
+        /* Forget the chunks of any previous transfer. */
+        ( void ) memset( partialBlocks, 0, sizeof( partialBlocks ) );
+
+        if( dataProbe.protocol != 0U )
+        {
+            /* Measure the data protocol from the start of the transfer. */
+            dataProbe.startMs = otaAgent.pOtaInterface->os.timer.getTimeMs();
+            dataProbe.blocksReceived = 0;
+            dataProbe.latencyMs = 0;
+        }
+
         eventMsg.eventId = OtaAgentEventRequestFileBlock;
+        requestEventPending = OTA_SignalEvent( &eventMsg );
 
-        if( OTA_SignalEvent( &eventMsg ) == false )
+        if( requestEventPending == false )
         {
             err = OtaErrSignalEventFailed;
         }
@@ -839,6 +1585,8 @@ static OtaErr_t requestDataHandler( const OtaEventData_t * pEventData )
 
     ( void ) pEventData;
 
+    requestEventPending = false;
+
     if( otaAgent.fileContext.blocksRemaining > 0U )
     {
         /* Start the request timer. */
@@ -852,14 +1600,21 @@ static OtaErr_t requestDataHandler( const OtaEventData_t * pEventData )
             /* Request data blocks. */
             err = otaDataInterface.requestFileBlock( &otaAgent );
 
-            /* Each request increases the momentum until a response is received. Too much momentum is
-             * interpreted as a failure to communicate and will cause us to abort the OTA. */
-            otaAgent.requestMomentum++;
-        }
-        else
-        {
-            /* Stop the request timer. */
-            ( void ) otaAgent.pOtaInterface->os.timer.stop( OtaRequestTimer );
+            if( ( err == OtaErrUrlExpired ) && ( urlRefreshCount < otaconfigMAX_NUM_URL_REFRESH ) )
+            {
+                err = refreshUpdateUrl();
+            }
+            else
+            {
+                /* Each request increases the momentum until a response is received. Too much momentum is
+                 * interpreted as a failure to communicate and will cause us to abort the OTA. */
+                otaAgent.requestMomentum++;
+            }
+        }
+        else
+        {
+            /* Stop the request timer. */
+            ( void ) otaAgent.pOtaInterface->os.timer.stop( OtaRequestTimer );
 
             /* Failed to send data request abort and close file. */
             err = setImageStateWithReason( OtaImageStateAborted, ( uint32_t ) err );
@@ -891,12 +1646,37 @@ static OtaErr_t requestDataHandler( const OtaEventData_t * pEventData )
     return err;
 }
 
+static OtaErr_t refreshUpdateUrl( void )
+{
+    OtaEventMsg_t eventMsg = { 0 };
+
+    LogWarn( ( "The pre-signed url was rejected: Requesting the job document for a fresh url: "
+               "Refresh count=%u",
+               ( unsigned int ) ( urlRefreshCount + 1U ) ) );
+
+    /* The job document of the active job only updates the url, the blocks received so far
+     * stay in the bitmap and the download continues with the missing ones. */
+    ( void ) otaAgent.pOtaInterface->os.timer.stop( OtaRequestTimer );
+    urlRefreshCount++;
+
+    /* Progress is only reported while waiting for file blocks. Allow the next update as soon
+     * as the transfer continues, a pending progress event is dropped in the meantime. */
+    ( void ) otaAgent.pOtaInterface->os.timer.stop( OtaProgressTimer );
+    progressIntervalElapsed = true;
+    progressEventPending = false;
+
+    eventMsg.eventId = OtaAgentEventRequestJobDocument;
+
+    return ( OTA_SignalEvent( &eventMsg ) == true ) ? OtaErrNone : OtaErrSignalEventFailed;
+}
+
 static void dataHandlerCleanup( IngestResult_t result )
 {
     OtaEventMsg_t eventMsg = { 0 };
 
-    /* Stop the request timer. */
+    /* Stop the request and progress timers. */
     ( void ) otaAgent.pOtaInterface->os.timer.stop( OtaRequestTimer );
+    ( void ) otaAgent.pOtaInterface->os.timer.stop( OtaProgressTimer );
 
     /* Negative result codes mean we should stop the OTA process
      * because we are either done or in an unrecoverable error state.
@@ -918,13 +1698,15 @@ static void dataHandlerCleanup( IngestResult_t result )
 
     /* Clear any remaining string memory holding the job name since this job is done. */
     ( void ) memset( otaAgent.pActiveJobName, 0, OTA_JOB_ID_MAX_SIZE );
+
+    /* A measurement that did not finish is started over by the next job. */
+    ( void ) memset( &dataProbe, 0, sizeof( dataProbe ) );
 }
 
 static OtaErr_t processDataHandler( const OtaEventData_t * pEventData )
 {
-    OtaErr_t err = OtaErrNone;
     OtaPalStatus_t closeResult = OTA_PAL_COMBINE_ERR( OtaPalUninitialized, 0 );
-    OtaEventMsg_t eventMsg = { 0 };
+    uint32_t blocksReceived = 0;
 
     /* Get the file context. */
     OtaFileContext_t * pFileContext = &( otaAgent.fileContext );
@@ -933,10 +1715,67 @@ static OtaErr_t processDataHandler( const OtaEventData_t * pEventData )
     IngestResult_t result = ingestDataBlock( pFileContext,
                                              pEventData->data,
                                              pEventData->dataLength,
-                                             &closeResult );
+                                             &closeResult,
+                                             &blocksReceived );
+
+    return handleIngestResult( result, closeResult, blocksReceived, pEventData );
+}
+
+static OtaErr_t processChunkHandler( const OtaEventData_t * pEventData )
+{
+    OtaPalStatus_t closeResult = OTA_PAL_COMBINE_ERR( OtaPalUninitialized, 0 );
+    uint32_t blocksCompleted = 0;
+
+    /* Chunk events carry their own buffer, which is sized independently of the file blocks. */
+    const OtaFileChunkEventData_t * pChunkData = ( const OtaFileChunkEventData_t * ) ( const void * ) pEventData;
+
+    /* Write the chunk to the file right away, there is no need to buffer a whole block. */
+    IngestResult_t result = ingestDataChunk( &( otaAgent.fileContext ),
+                                             pChunkData->data,
+                                             pChunkData->dataLength,
+                                             false,
+                                             &closeResult,
+                                             &blocksCompleted );
+
+    return handleIngestResult( result, closeResult, blocksCompleted, pEventData );
+}
+
+static OtaErr_t processWrittenChunkHandler( const OtaEventData_t * pEventData )
+{
+    OtaPalStatus_t closeResult = OTA_PAL_COMBINE_ERR( OtaPalUninitialized, 0 );
+    uint32_t blocksCompleted = 0;
+
+    /* The data plane already wrote the chunk to the file, only the blocks are marked received. */
+    IngestResult_t result = ingestDataChunk( &( otaAgent.fileContext ),
+                                             pEventData->data,
+                                             pEventData->dataLength,
+                                             true,
+                                             &closeResult,
+                                             &blocksCompleted );
+
+    return handleIngestResult( result, closeResult, blocksCompleted, pEventData );
+}
+
+static OtaErr_t handleIngestResult( IngestResult_t result,
+                                    OtaPalStatus_t closeResult,
+                                    uint32_t blocksReceived,
+                                    const OtaEventData_t * pEventData )
+{
+    OtaErr_t err = OtaErrNone;
+    OtaEventMsg_t eventMsg = { 0 };
+    uint32_t blocksLeft = blocksReceived;
 
     if( result == IngestResultFileComplete )
     {
+        recordProbeBlocks( blocksReceived );
+
+        if( ( dataProbe.protocol != 0U ) && ( dataProbe.candidates == 0U ) && ( dataProbe.blocksReceived > 0U ) )
+        {
+            /* The file completed over the last data protocol to measure. */
+            measureDataProtocol();
+            finishDataProbe();
+        }
+
         /* File receive is complete and authenticated. Update the job status with the self_test ready identifier. */
         err = otaControlInterface.updateJobStatus( &otaAgent, JobStatusInProgress, JobReasonSigCheckPassed, 0 );
         dataHandlerCleanup( result );
@@ -967,15 +1806,40 @@ static OtaErr_t processDataHandler( const OtaEventData_t * pEventData )
 
             /* Reset the momentum counter since we received a good block. */
             otaAgent.requestMomentum = 0;
+
+            /* The current url works, allow refreshing it again once it expires. */
+            urlRefreshCount = 0;
+
+            recordProbeBlocks( blocksReceived );
+
             /* We're actively receiving a file so update the job status as needed. */
-            err = otaControlInterface.updateJobStatus( &otaAgent, JobStatusInProgress, JobReasonReceiving, 0 );
+            reportReceiveProgress();
         }
 
-        if( otaAgent.numOfBlocksToReceive > 1U )
+        while( ( blocksLeft > 0U ) && ( otaAgent.numOfBlocksToReceive > 1U ) )
         {
             otaAgent.numOfBlocksToReceive--;
+            blocksLeft--;
         }
-        else
+
+        if( ( blocksLeft > 0U ) && ( dataProbe.protocol != 0U ) &&
+            ( dataProbe.blocksReceived >= otaconfigDATA_PROTOCOL_PROBE_NUM_BLOCKS ) )
+        {
+            /* The request is complete, request the next blocks over the next protocol. */
+            switchDataProtocol();
+        }
+
+        if( ( blocksLeft > 0U ) && ( passiveListenActive() == true ) )
+        {
+            /* Other devices may still be requesting blocks on the shared stream. Only request the
+             * next blocks ourselves once the stream has been idle for the hold-off time. Every block
+             * received afterwards restarts the hold-off. */
+            ( void ) otaAgent.pOtaInterface->os.timer.start( OtaRequestTimer,
+                                                             "OtaRequestTimer",
+                                                             passiveRequestHoldoff(),
+                                                             otaTimerCallback );
+        }
+        else if( blocksLeft > 0U )
         {
             /* Start the request timer. */
             ( void ) otaAgent.pOtaInterface->os.timer.start( OtaRequestTimer,
@@ -985,12 +1849,27 @@ static OtaErr_t processDataHandler( const OtaEventData_t * pEventData )
 
             eventMsg.eventId = OtaAgentEventRequestFileBlock;
 
-            if( OTA_SignalEvent( &eventMsg ) == false )
+            /* Blocks that arrive while a request event is queued are covered by it. Otherwise the
+             * second request would look like a retry to the data plane, since no block arrives
+             * between the two. */
+            if( requestEventPending == true )
+            {
+                LogDebug( ( "Request for the next blocks is already pending." ) );
+            }
+            else if( OTA_SignalEvent( &eventMsg ) == false )
             {
                 LogWarn( ( "Failed to trigger requesting the next block: Unable to signal event: "
                            "event=%d",
                            eventMsg.eventId ) );
             }
+            else
+            {
+                requestEventPending = true;
+            }
+        }
+        else
+        {
+            /* More blocks of the current request are expected. */
         }
     }
 
@@ -1313,216 +2192,1012 @@ static DocParseErr_t extractAndStoreArray( const char * pKey,
 {
     DocParseErr_t err = DocParseErrNone;
 
-    /* For string and array, pParamAdd should be pointing to a uint8_t pointer. */
-    char ** pCharPtr = pParamAdd;
+    /* For string and array, pParamAdd should be pointing to a uint8_t pointer. */
+    char ** pCharPtr = pParamAdd;
+
+    if( *pParamSizeAdd == 0 )
+    {
+        /* Free previously allocated buffer. */
+        if( *pCharPtr != NULL )
+        {
+            otaAgent.pOtaInterface->os.mem.free( *pCharPtr );
+        }
+
+        /* Malloc memory for a copy of the value string plus a zero terminator. */
+        *pCharPtr = otaAgent.pOtaInterface->os.mem.malloc( valueLength + 1U );
+
+        if( *pCharPtr == NULL )
+        {
+            /* Stop processing on error. */
+            err = DocParseErrOutOfMemory;
+
+            LogError( ( "Memory allocation failed "
+                        "[key: valueLength]=[%s: %lu]",
+                        pKey,
+                        valueLength ) );
+        }
+    }
+    else
+    {
+        if( *pParamSizeAdd < ( valueLength + 1U ) )
+        {
+            err = DocParseErrUserBufferInsuffcient;
+
+            LogError( ( "Insufficient user memory: "
+                        "[key: valueLength]=[%s: %lu]",
+                        pKey,
+                        valueLength ) );
+        }
+    }
+
+    if( err == DocParseErrNone )
+    {
+        /* Copy parameter string into newly allocated memory. */
+        ( void ) memcpy( *pCharPtr, pValueInJson, valueLength );
+
+        /* Zero terminate the new string. */
+        ( *pCharPtr )[ valueLength ] = '\0';
+
+        LogInfo( ( "Extracted parameter: "
+                   "[key: value]=[%s: %s]",
+                   pKey,
+                   *pCharPtr ) );
+    }
+
+    return err;
+}
+
+/* Store the parameter from the json to the offset specified by the document model. */
+
+static DocParseErr_t extractParameter( JsonDocParam_t docParam,
+                                       void * pContextBase,
+                                       const char * pValueInJson,
+                                       size_t valueLength )
+{
+    DocParseErr_t err = DocParseErrNone;
+    void * pParamAdd;
+    uint32_t * pParamSizeAdd;
+
+    /* Get destination offset to parameter storage location.*/
+    pParamAdd = ( uint8_t * ) pContextBase + docParam.pDestOffset;
+
+    /* Get destination buffer size to parameter storage location. */
+    pParamSizeAdd = ( void * ) ( ( uint8_t * ) pContextBase + docParam.pDestSizeOffset );
+
+    if( ( ModelParamTypeStringCopy == docParam.modelParamType ) || ( ModelParamTypeArrayCopy == docParam.modelParamType ) )
+    {
+        err = extractAndStoreArray( docParam.pSrcKey, pValueInJson, valueLength, pParamAdd, pParamSizeAdd );
+    }
+    else if( ModelParamTypeUInt32 == docParam.modelParamType )
+    {
+        uint32_t * pUint32 = pParamAdd;
+        char * pEnd;
+        const char * pStart = pValueInJson;
+        errno = 0;
+
+        *pUint32 = ( uint32_t ) strtoul( pStart, &pEnd, 0 );
+
+        if( ( errno == 0 ) && ( pEnd == &pValueInJson[ valueLength ] ) )
+        {
+            LogInfo( ( "Extracted parameter: [key: value]=[%s: %u]",
+                       docParam.pSrcKey, *pUint32 ) );
+        }
+        else
+        {
+            err = DocParseErrInvalidNumChar;
+        }
+    }
+    else if( ModelParamTypeSigBase64 == docParam.modelParamType )
+    {
+        err = decodeAndStoreKey( pValueInJson, valueLength, pParamAdd );
+    }
+    else if( ModelParamTypeIdent == docParam.modelParamType )
+    {
+        LogDebug( ( "Identified parameter: [ %s ]",
+                    docParam.pSrcKey ) );
+
+        *( bool * ) pParamAdd = true;
+    }
+    else
+    {
+        LogWarn( ( "Invalid parameter type: %d", docParam.modelParamType ) );
+    }
+
+    if( err != DocParseErrNone )
+    {
+        LogError( ( "Failed to extract document parameter: error=%d, paramter key=%s",
+                    err, docParam.pSrcKey ) );
+    }
+
+    return err;
+}
+
+/* Write an array of CBOR text strings as the text of a JSON array, so that it is stored
+ * like the array of a JSON job document. */
+
+static DocParseErr_t writeCborTextArray( const CborValue * pArray,
+                                         char * pText,
+                                         size_t textSize,
+                                         size_t * pTextLength )
+{
+    DocParseErr_t err = DocParseErrNone;
+    CborError cborResult = CborNoError;
+    CborValue cborElement;
+    CborValue chunkNext;
+    const char * pString = NULL;
+    size_t stringLength = 0;
+    size_t textLength = 1U;
+
+    pText[ 0 ] = '[';
+    cborResult = cbor_value_enter_container( pArray, &cborElement );
+
+    while( ( CborNoError == cborResult ) && ( err == DocParseErrNone ) && ( false == cbor_value_at_end( &cborElement ) ) )
+    {
+        if( ( false == cbor_value_is_text_string( &cborElement ) ) ||
+            ( false == cbor_value_is_length_known( &cborElement ) ) )
+        {
+            err = DocParseErrFieldTypeMismatch;
+        }
+        else
+        {
+            cborResult = cbor_value_get_text_string_chunk( &cborElement, &pString, &stringLength, &chunkNext );
+        }
+
+        /* Room for the string, its quotes, the separator and the closing bracket. */
+        if( ( CborNoError == cborResult ) && ( err == DocParseErrNone ) &&
+            ( ( textSize - textLength ) < ( stringLength + 4U ) ) )
+        {
+            err = DocParseErrUserBufferInsuffcient;
+        }
+
+        if( ( CborNoError == cborResult ) && ( err == DocParseErrNone ) )
+        {
+            if( textLength > 1U )
+            {
+                pText[ textLength ] = ',';
+                textLength++;
+            }
+
+            pText[ textLength ] = '"';
+            ( void ) memcpy( &pText[ textLength + 1U ], pString, stringLength );
+            pText[ textLength + stringLength + 1U ] = '"';
+            textLength += stringLength + 2U;
+
+            cborResult = cbor_value_advance( &cborElement );
+        }
+    }
+
+    if( ( CborNoError != cborResult ) && ( err == DocParseErrNone ) )
+    {
+        err = DocParseErrInvalidCborBuffer;
+    }
+
+    if( err == DocParseErrNone )
+    {
+        pText[ textLength ] = ']';
+        *pTextLength = textLength + 1U;
+    }
+
+    return err;
+}
+
+/* Store a raw signature from a CBOR byte string in the file context. */
+
+static DocParseErr_t storeCborSignature( const CborValue * pValue,
+                                         void * pParamAdd )
+{
+    DocParseErr_t err = DocParseErrNone;
+    CborValue chunkNext;
+    const uint8_t * pSignature = NULL;
+    size_t signatureSize = 0;
+    Sig256_t ** pSig256 = pParamAdd;
+
+    /* pSig256 should point to pSignature in OtaFileContext_t, which is statically allocated. */
+    assert( *pSig256 != NULL );
+
+    if( ( false == cbor_value_is_byte_string( pValue ) ) ||
+        ( false == cbor_value_is_length_known( pValue ) ) )
+    {
+        err = DocParseErrFieldTypeMismatch;
+    }
+    else if( CborNoError != cbor_value_get_byte_string_chunk( pValue, &pSignature, &signatureSize, &chunkNext ) )
+    {
+        err = DocParseErrInvalidCborBuffer;
+    }
+    else if( signatureSize > sizeof( ( *pSig256 )->data ) )
+    {
+        LogError( ( "Signature is larger than the signature buffer: "
+                    "size=%lu, buffer size=%lu",
+                    ( unsigned long ) signatureSize,
+                    ( unsigned long ) sizeof( ( *pSig256 )->data ) ) );
+        err = DocParseErrUserBufferInsuffcient;
+    }
+    else
+    {
+        ( void ) memcpy( ( *pSig256 )->data, pSignature, signatureSize );
+        ( *pSig256 )->size = ( uint16_t ) signatureSize;
+
+        LogInfo( ( "Extracted parameter [ %s: %u bytes ]",
+                   OTA_JsonFileSignatureKey,
+                   ( *pSig256 )->size ) );
+    }
+
+    return err;
+}
+
+/* Store the parameter from a CBOR data item to the offset specified by the document model.
+ * Strings, arrays of strings, unsigned integers and the signature are decoded from the CBOR
+ * types; the signature is the raw signature in a byte string instead of Base64 text. */
+
+static DocParseErr_t extractCborParameter( JsonDocParam_t docParam,
+                                           void * pContextBase,
+                                           const char * pValueInCbor,
+                                           size_t valueLength )
+{
+    DocParseErr_t err = DocParseErrNone;
+    CborParser cborParser;
+    CborValue cborValue;
+    CborValue chunkNext;
+    const char * pString = NULL;
+    size_t stringLength = 0;
+    uint64_t number = 0;
+    char arrayText[ OTA_CBOR_TEXT_ARRAY_MAX_LENGTH ];
+    void * pParamAdd;
+    uint32_t * pParamSizeAdd;
+
+    /* Get destination offset to parameter storage location.*/
+    pParamAdd = ( uint8_t * ) pContextBase + docParam.pDestOffset;
+
+    /* Get destination buffer size to parameter storage location. */
+    pParamSizeAdd = ( void * ) ( ( uint8_t * ) pContextBase + docParam.pDestSizeOffset );
+
+    /* The data item was checked when the document was tokenized. */
+    if( CborNoError != cbor_parser_init( ( const uint8_t * ) pValueInCbor, valueLength, 0, &cborParser, &cborValue ) )
+    {
+        err = DocParseErrInvalidCborBuffer;
+    }
+    else if( ModelParamTypeStringCopy == docParam.modelParamType )
+    {
+        if( ( false == cbor_value_is_text_string( &cborValue ) ) ||
+            ( false == cbor_value_is_length_known( &cborValue ) ) )
+        {
+            err = DocParseErrFieldTypeMismatch;
+        }
+        else if( CborNoError != cbor_value_get_text_string_chunk( &cborValue, &pString, &stringLength, &chunkNext ) )
+        {
+            err = DocParseErrInvalidCborBuffer;
+        }
+        else
+        {
+            err = extractAndStoreArray( docParam.pSrcKey, pString, stringLength, pParamAdd, pParamSizeAdd );
+        }
+    }
+    else if( ModelParamTypeArrayCopy == docParam.modelParamType )
+    {
+        if( false == cbor_value_is_array( &cborValue ) )
+        {
+            err = DocParseErrFieldTypeMismatch;
+        }
+        else
+        {
+            err = writeCborTextArray( &cborValue, arrayText, sizeof( arrayText ), &stringLength );
+        }
+
+        if( err == DocParseErrNone )
+        {
+            err = extractAndStoreArray( docParam.pSrcKey, arrayText, stringLength, pParamAdd, pParamSizeAdd );
+        }
+    }
+    else if( ModelParamTypeUInt32 == docParam.modelParamType )
+    {
+        if( false == cbor_value_is_unsigned_integer( &cborValue ) )
+        {
+            err = DocParseErrFieldTypeMismatch;
+        }
+        else if( ( CborNoError != cbor_value_get_uint64( &cborValue, &number ) ) || ( number > UINT32_MAX ) )
+        {
+            err = DocParseErrInvalidNumChar;
+        }
+        else
+        {
+            *( uint32_t * ) pParamAdd = ( uint32_t ) number;
+
+            LogInfo( ( "Extracted parameter: [key: value]=[%s: %u]",
+                       docParam.pSrcKey, *( uint32_t * ) pParamAdd ) );
+        }
+    }
+    else if( ModelParamTypeSigBase64 == docParam.modelParamType )
+    {
+        err = storeCborSignature( &cborValue, pParamAdd );
+    }
+    else if( ModelParamTypeIdent == docParam.modelParamType )
+    {
+        LogDebug( ( "Identified parameter: [ %s ]",
+                    docParam.pSrcKey ) );
+
+        *( bool * ) pParamAdd = true;
+    }
+    else
+    {
+        LogWarn( ( "Invalid parameter type: %d", docParam.modelParamType ) );
+    }
+
+    if( err != DocParseErrNone )
+    {
+        LogError( ( "Failed to extract document parameter: error=%d, paramter key=%s",
+                    err, docParam.pSrcKey ) );
+    }
+
+    return err;
+}
+
+/* Check if all the required parameters for job document are extracted from the JSON */
+
+static DocParseErr_t verifyRequiredParamsExtracted( const JsonDocParam_t * pModelParam,
+                                                    const JsonDocModel_t * pDocModel )
+{
+    uint32_t scanIndex = 0;
+    DocParseErr_t err = DocParseErrNone;
+    uint32_t missingParams = ( pDocModel->paramsReceivedBitmap & pDocModel->paramsRequiredBitmap )
+                             ^ pDocModel->paramsRequiredBitmap;
+
+    if( missingParams != 0U )
+    {
+        /* The job document did not have all required document model parameters. */
+        for( scanIndex = 0U; scanIndex < pDocModel->numModelParams; scanIndex++ )
+        {
+            if( ( missingParams & ( ( uint32_t ) 1U << scanIndex ) ) != 0U )
+            {
+                LogInfo( ( "Failed job document content check: "
+                           "Required job document parameter was not extracted: "
+                           "parameter=%s",
+                           pModelParam[ scanIndex ].pSrcKey ) );
+            }
+        }
+
+        err = DocParseErrMalformedDoc;
+    }
+
+    return err;
+}
+
+/* Skip the whitespace of a validated JSON document. */
+
+static size_t skipJsonSpace( const char * pJson,
+                             size_t index,
+                             size_t length )
+{
+    size_t i = index;
+
+    while( ( i < length ) &&
+           ( ( pJson[ i ] == ' ' ) || ( pJson[ i ] == '\t' ) || ( pJson[ i ] == '\n' ) || ( pJson[ i ] == '\r' ) ) )
+    {
+        i++;
+    }
+
+    return i;
+}
+
+/* Skip a string of a validated JSON document, starting at its opening quote. */
+
+static size_t skipJsonString( const char * pJson,
+                              size_t index,
+                              size_t length )
+{
+    size_t i = index + 1U;
+    size_t quoteIndex = 0;
+    size_t numBackslashes = 0;
+    const char * pQuote = NULL;
+    bool closed = false;
+
+    while( ( closed == false ) && ( i < length ) )
+    {
+        pQuote = memchr( &pJson[ i ], ( int ) '"', length - i );
+
+        if( pQuote == NULL )
+        {
+            i = length;
+        }
+        else
+        {
+            /* The quote is escaped if it follows an odd number of backslashes. */
+            quoteIndex = ( size_t ) ( pQuote - pJson );
+            numBackslashes = 0U;
+
+            while( ( ( quoteIndex - numBackslashes ) > ( index + 1U ) ) &&
+                   ( pJson[ quoteIndex - numBackslashes - 1U ] == '\\' ) )
+            {
+                numBackslashes++;
+            }
+
+            /* Step over the quote. */
+            i = quoteIndex + 1U;
+            closed = ( ( numBackslashes % 2U ) == 0U );
+        }
+    }
+
+    return i;
+}
+
+/* Skip a value of a validated JSON document. */
+
+static size_t skipJsonValue( const char * pJson,
+                             size_t index,
+                             size_t length )
+{
+    size_t i = index;
+    uint32_t nesting = 0;
+
+    if( ( i < length ) && ( pJson[ i ] == '"' ) )
+    {
+        i = skipJsonString( pJson, i, length );
+    }
+    else if( ( i < length ) && ( ( pJson[ i ] == '{' ) || ( pJson[ i ] == '[' ) ) )
+    {
+        /* Count the brackets up to the one that closes the value, skipping the strings
+         * since they may contain brackets. */
+        do
+        {
+            if( pJson[ i ] == '"' )
+            {
+                i = skipJsonString( pJson, i, length );
+            }
+            else
+            {
+                if( ( pJson[ i ] == '{' ) || ( pJson[ i ] == '[' ) )
+                {
+                    nesting++;
+                }
+                else if( ( pJson[ i ] == '}' ) || ( pJson[ i ] == ']' ) )
+                {
+                    nesting--;
+                }
+                else
+                {
+                    /* Other characters do not change the nesting. */
+                }
+
+                i++;
+            }
+        } while( ( nesting > 0U ) && ( i < length ) );
+    }
+    else
+    {
+        /* Numbers and literals end at a separator, a closing bracket or whitespace. */
+        while( ( i < length ) &&
+               ( pJson[ i ] != ',' ) && ( pJson[ i ] != '}' ) && ( pJson[ i ] != ']' ) &&
+               ( pJson[ i ] != ' ' ) && ( pJson[ i ] != '\t' ) && ( pJson[ i ] != '\n' ) && ( pJson[ i ] != '\r' ) )
+        {
+            i++;
+        }
+    }
+
+    return i;
+}
+
+/* Match a key of an object against the model parameters that may be in the object. The key
+ * path is looked up in the hash table of the model, which holds every key path in its own slot.
+ * The key paths of the candidates all start with the key path of the object, so a key path of
+ * the table that holds a candidate is the key path of the key if its last key is the key. */
+
+static uint32_t matchJsonKey( const JsonDocModel_t * pDocModel,
+                              uint32_t candidates,
+                              size_t pathLength,
+                              uint32_t keyPathHash,
+                              const char * pKey,
+                              size_t keyLength,
+                              uint32_t * pChildren )
+{
+    const JsonKeyTable_t * pKeyTable = pDocModel->pKeyTable;
+    const JsonKeyPath_t * pKeyPath = NULL;
+    uint8_t slot = pKeyTable->slots[ OTA_JSON_KEY_SLOT( keyPathHash, pKeyTable->multiplier ) ];
+    uint32_t matches = 0;
+
+    *pChildren = 0U;
+
+    if( slot != 0U )
+    {
+        pKeyPath = &( pKeyTable->keyPaths[ slot - 1U ] );
+
+        /* Rule out the keys that are not in the model but have the hash of a key path. */
+        if( ( pKeyPath->hash == keyPathHash ) &&
+            ( ( ( pKeyPath->matches | pKeyPath->children ) & candidates ) != 0U ) &&
+            ( pKeyPath->keyOffset == pathLength ) &&
+            ( pKeyPath->keyLength == keyLength ) &&
+            ( strncmp( &( pDocModel->pBodyDef[ pKeyPath->paramIndex ].pSrcKey[ pathLength ] ), pKey, keyLength ) == 0 ) )
+        {
+            matches = pKeyPath->matches & candidates;
+
+            /* The key paths of these parameters continue in the value of this key. */
+            *pChildren = pKeyPath->children & candidates;
+        }
+    }
+
+    /* Keys only known at run time are not in the table, and have no separator. */
+    if( ( matches == 0U ) && ( *pChildren == 0U ) && ( pathLength == 0U ) )
+    {
+        matches = matchDynamicJsonKey( pDocModel->pKeyTable,
+                                       pDocModel->pBodyDef,
+                                       pDocModel->numModelParams,
+                                       candidates,
+                                       pKey,
+                                       keyLength );
+    }
+
+    return matches;
+}
+
+/* Match a key against the model parameters with a key that is only known at run time, like
+ * the file signature key of the PAL. There are few of them, so they are compared one by one. */
+
+static uint32_t matchDynamicJsonKey( const JsonKeyTable_t * pKeyTable,
+                                     const JsonDocParam_t * pBodyDef,
+                                     uint16_t numModelParams,
+                                     uint32_t candidates,
+                                     const char * pKey,
+                                     size_t keyLength )
+{
+    uint32_t dynamicParams = pKeyTable->dynamicParams & candidates;
+    uint32_t matches = 0;
+    uint16_t paramIndex = 0;
+    const char * pSrcKey = NULL;
+
+    for( paramIndex = 0; ( paramIndex < numModelParams ) && ( ( dynamicParams >> paramIndex ) != 0U ); paramIndex++ )
+    {
+        pSrcKey = pBodyDef[ paramIndex ].pSrcKey;
+
+        if( ( ( dynamicParams & ( ( uint32_t ) 1U << paramIndex ) ) != 0U ) &&
+            ( strlen( pSrcKey ) == keyLength ) &&
+            ( strncmp( pSrcKey, pKey, keyLength ) == 0 ) )
+        {
+            matches |= ( uint32_t ) 1U << paramIndex;
+        }
+    }
+
+    return matches;
+}
+
+/* Continue the FNV-1a hash of a key path with the characters of a key. */
+
+static uint32_t hashJsonKey( uint32_t hash,
+                             const char * pKey,
+                             size_t keyLength )
+{
+    uint32_t keyHash = hash;
+    size_t i = 0;
+
+    for( i = 0; i < keyLength; i++ )
+    {
+        keyHash ^= ( uint32_t ) ( uint8_t ) pKey[ i ];
+        keyHash *= OTA_FNV_PRIME;
+    }
+
+    return keyHash;
+}
+
+/* Record the value of model parameters found in the JSON document. */
+
+static void recordJsonValue( JsonDocModel_t * pDocModel,
+                             uint32_t valueParams,
+                             const char * pValue,
+                             size_t valueLength )
+{
+    uint16_t paramIndex = 0;
+
+    /* Stop at the last parameter of the value. */
+    for( paramIndex = 0; ( paramIndex < pDocModel->numModelParams ) && ( ( valueParams >> paramIndex ) != 0U ); paramIndex++ )
+    {
+        if( ( valueParams & ( ( uint32_t ) 1U << paramIndex ) ) != 0U )
+        {
+            /* Mark parameter as received in the bitmap. */
+            pDocModel->paramsReceivedBitmap |= ( ( uint32_t ) 1U << paramIndex );
+            pDocModel->valueSpans[ paramIndex ].pValue = pValue;
+            pDocModel->valueSpans[ paramIndex ].valueLength = valueLength;
+        }
+    }
+}
+
+/* Get the bitmap of all the parameters of a document model. */
+
+static uint32_t allModelParams( uint16_t numModelParams )
+{
+    return ( numModelParams < OTA_DOC_MODEL_MAX_PARAMS ) ?
+           ( ( ( uint32_t ) 1U << numModelParams ) - 1U ) : UINT32_MAX;
+}
+
+/* Match a key of an object, or an element of an array, against the model parameters that
+ * may be in the object or array. The key is NULL for an element of an array. */
+
+static void matchJsonDocValue( const JsonDocModel_t * pDocModel,
+                               JsonDocLevel_t * pLevel,
+                               const char * pKey,
+                               size_t keyLength,
+                               uint32_t searched,
+                               uint32_t * pFoundInFile,
+                               JsonDocMatch_t * pMatch )
+{
+    uint16_t paramIndex = 0;
+    uint32_t keyPathHash = 0;
+
+    pMatch->matches = 0U;
+    pMatch->children = 0U;
+    pMatch->pathLength = 0U;
+    pMatch->pathHash = OTA_FNV_OFFSET_BASIS;
+    pMatch->inFileParams = pLevel->inFileParams;
+
+    if( pLevel->isObject == true )
+    {
+        keyPathHash = hashJsonKey( pLevel->pathHash, pKey, keyLength );
+        pMatch->matches = matchJsonKey( pDocModel, pLevel->candidates & ~searched, pLevel->pathLength, keyPathHash, pKey, keyLength, &( pMatch->children ) );
+        pMatch->pathLength = pLevel->pathLength + keyLength + 1U;
+        pMatch->pathHash = hashJsonKey( keyPathHash, OTA_JSON_SEPARATOR, 1U );
+
+        /* A parameter is taken from the document before the file group, and only
+         * from its first occurrence. */
+        if( pMatch->inFileParams == true )
+        {
+            pMatch->matches &= ~pDocModel->paramsReceivedBitmap;
+            *pFoundInFile |= pMatch->matches;
+        }
+        else
+        {
+            pMatch->matches &= ( ~pDocModel->paramsReceivedBitmap | *pFoundInFile );
+            *pFoundInFile &= ~pMatch->matches;
+        }
+    }
+    else
+    {
+        /* Only the first element of the file group is searched. */
+        pMatch->children = pLevel->candidates;
+        pLevel->candidates = 0U;
+        pMatch->inFileParams = true;
+    }
+
+    /* The parameters after a file group are searched in its first element. */
+    pMatch->fileGroupParams = 0U;
 
-    if( *pParamSizeAdd == 0 )
+    for( paramIndex = 0; ( paramIndex < pDocModel->numModelParams ) && ( ( pMatch->matches >> paramIndex ) != 0U ); paramIndex++ )
     {
-        /* Free previously allocated buffer. */
-        if( *pCharPtr != NULL )
+        if( ( ( pMatch->matches & ( ( uint32_t ) 1U << paramIndex ) ) != 0U ) &&
+            ( OTA_STORE_NESTED_JSON == pDocModel->pBodyDef[ paramIndex ].pDestOffset ) )
         {
-            otaAgent.pOtaInterface->os.mem.free( *pCharPtr );
+            pMatch->fileGroupParams = ~( ( ( uint32_t ) 2U << paramIndex ) - 1U ) & allModelParams( pDocModel->numModelParams );
         }
+    }
+}
 
-        /* Malloc memory for a copy of the value string plus a zero terminator. */
-        *pCharPtr = otaAgent.pOtaInterface->os.mem.malloc( valueLength + 1U );
+/* Start the level of an object, or of the array of the file group, walked into. */
 
-        if( *pCharPtr == NULL )
-        {
-            /* Stop processing on error. */
-            err = DocParseErrOutOfMemory;
+static void enterJsonDocLevel( JsonDocLevel_t * pValueLevel,
+                               const JsonDocMatch_t * pMatch,
+                               const char * pValue,
+                               bool isObject )
+{
+    pValueLevel->pValue = pValue;
+    pValueLevel->valueParams = pMatch->matches;
+    pValueLevel->isObject = isObject;
+    pValueLevel->candidates = ( isObject == true ) ? pMatch->children : pMatch->fileGroupParams;
+    pValueLevel->pathLength = ( isObject == true ) ? pMatch->pathLength : 0U;
+    pValueLevel->pathHash = ( isObject == true ) ? pMatch->pathHash : OTA_FNV_OFFSET_BASIS;
+    pValueLevel->inFileParams = pMatch->inFileParams;
+}
 
-            LogError( ( "Memory allocation failed "
-                        "[key: valueLength]=[%s: %lu]",
-                        pKey,
-                        valueLength ) );
+/* Walk a validated JSON document once and record the values of the model parameters.
+ *
+ * The values are the ones coreJSON would find for the key paths of the model. Only the
+ * objects that may hold a parameter are walked into; other values are skipped. Only the
+ * first occurrence of a key path is searched. The parameters after the file group of the
+ * model that are not in the document are searched in the first element of the file group. */
+
+static void tokenizeJSONbyModel( const char * pJson,
+                                 uint32_t messageLength,
+                                 JsonDocModel_t * pDocModel )
+{
+    JsonDocLevel_t levels[ OTA_MAX_JSON_DEPTH ];
+    JsonDocLevel_t * pLevel = NULL;
+    JsonDocMatch_t match;
+    const size_t length = ( size_t ) messageLength;
+    size_t depth = 0;
+    size_t index = 0;
+    size_t valueStart = 0;
+    size_t keyLength = 0;
+    uint32_t searchedInDoc = 0;
+    uint32_t searchedInFile = 0;
+    uint32_t foundInFile = 0;
+    uint32_t * pSearched = NULL;
+    const char * pKey = NULL;
+
+    index = skipJsonSpace( pJson, 0U, length );
+
+    if( ( index < length ) && ( pJson[ index ] == '{' ) )
+    {
+        levels[ 0 ].pValue = &pJson[ index ];
+        levels[ 0 ].valueParams = 0U;
+        levels[ 0 ].candidates = allModelParams( pDocModel->numModelParams );
+        levels[ 0 ].pathLength = 0U;
+        levels[ 0 ].pathHash = OTA_FNV_OFFSET_BASIS;
+        levels[ 0 ].isObject = true;
+        levels[ 0 ].inFileParams = false;
+        depth = 1U;
+        index++;
+    }
+
+    while( ( depth > 0U ) && ( index < length ) )
+    {
+        pLevel = &levels[ depth - 1U ];
+        pSearched = ( pLevel->inFileParams == true ) ? &searchedInFile : &searchedInDoc;
+        index = skipJsonSpace( pJson, index, length );
+
+        if( index >= length )
+        {
+            /* The document ends inside a value. */
         }
-    }
-    else
-    {
-        if( *pParamSizeAdd < ( valueLength + 1U ) )
+        else if( pJson[ index ] == ',' )
         {
-            err = DocParseErrUserBufferInsuffcient;
-
-            LogError( ( "Insufficient user memory: "
-                        "[key: valueLength]=[%s: %lu]",
-                        pKey,
-                        valueLength ) );
+            index++;
         }
-    }
+        else if( ( pJson[ index ] == '}' ) || ( pJson[ index ] == ']' ) )
+        {
+            /* A key path is only searched in its first object. */
+            index++;
+            recordJsonValue( pDocModel, pLevel->valueParams, pLevel->pValue, ( size_t ) ( &pJson[ index ] - pLevel->pValue ) );
+            *pSearched |= ( pLevel->isObject == true ) ? pLevel->candidates : 0U;
+            depth--;
+        }
+        else
+        {
+            pKey = NULL;
+            keyLength = 0U;
 
-    if( err == DocParseErrNone )
-    {
-        /* Copy parameter string into newly allocated memory. */
-        ( void ) memcpy( *pCharPtr, pValueInJson, valueLength );
+            if( pLevel->isObject == true )
+            {
+                /* Read the key and step over the colon to the value. */
+                pKey = &pJson[ index + 1U ];
+                index = skipJsonString( pJson, index, length );
+                keyLength = ( size_t ) ( &pJson[ index ] - pKey ) - 1U;
+                index = skipJsonSpace( pJson, skipJsonSpace( pJson, index, length ) + 1U, length );
+            }
 
-        /* Zero terminate the new string. */
-        ( *pCharPtr )[ valueLength ] = '\0';
+            matchJsonDocValue( pDocModel, pLevel, pKey, keyLength, *pSearched, &foundInFile, &match );
+            valueStart = index;
 
-        LogInfo( ( "Extracted parameter: "
-                   "[key: value]=[%s: %s]",
-                   pKey,
-                   *pCharPtr ) );
+            if( ( index < length ) && ( depth < OTA_MAX_JSON_DEPTH ) &&
+                ( ( ( match.children != 0U ) && ( pJson[ index ] == '{' ) ) ||
+                  ( ( match.fileGroupParams != 0U ) && ( pJson[ index ] == '[' ) ) ) )
+            {
+                /* Walk into the object, or into the array of the file group. */
+                enterJsonDocLevel( &levels[ depth ], &match, &pJson[ index ], ( pJson[ index ] == '{' ) );
+                depth++;
+                index++;
+            }
+            else
+            {
+                index = skipJsonValue( pJson, index, length );
+
+                /* The key path is not searched in the next objects with this key. */
+                *pSearched |= ( pLevel->isObject == true ) ? match.children : 0U;
+
+                if( ( index > ( valueStart + 1U ) ) && ( pJson[ valueStart ] == '"' ) )
+                {
+                    /* Strings are recorded without their quotes. */
+                    recordJsonValue( pDocModel, match.matches, &pJson[ valueStart + 1U ], index - valueStart - 2U );
+                }
+                else
+                {
+                    recordJsonValue( pDocModel, match.matches, &pJson[ valueStart ], index - valueStart );
+                }
+            }
+        }
     }
+}
 
-    return err;
+/* Check if a job document is encoded in CBOR. */
+
+static bool isCborJobDoc( const char * pDoc,
+                          uint32_t messageLength )
+{
+    return ( pDoc != NULL ) && ( messageLength > 0U ) &&
+           ( ( ( uint8_t ) pDoc[ 0 ] & OTA_CBOR_MAJOR_TYPE_MASK ) == OTA_CBOR_MAP_MAJOR_TYPE );
 }
 
-/* Store the parameter from the json to the offset specified by the document model. */
+/* Walk a CBOR job document once and record the values of the model parameters.
+ *
+ * The key paths of the model are matched as in a JSON job document, and the value of a
+ * parameter is the encoded CBOR data item, so it is decoded by its type when it is stored.
+ * tinycbor checks the data items skipped, and the document must end with its map. */
 
-static DocParseErr_t extractParameter( JsonDocParam_t docParam,
-                                       void * pContextBase,
-                                       const char * pValueInJson,
-                                       size_t valueLength )
+static DocParseErr_t tokenizeCBORbyModel( const uint8_t * pCbor,
+                                          size_t length,
+                                          JsonDocModel_t * pDocModel )
 {
     DocParseErr_t err = DocParseErrNone;
-    void * pParamAdd;
-    uint32_t * pParamSizeAdd;
+    CborError cborResult = CborNoError;
+    CborParser cborParser;
+    CborValue containers[ OTA_MAX_JSON_DEPTH ];
+    CborValue cborValue;
+    CborValue chunkNext;
+    JsonDocLevel_t levels[ OTA_MAX_JSON_DEPTH ];
+    JsonDocLevel_t * pLevel = NULL;
+    JsonDocMatch_t match;
+    const uint8_t * pValueStart = NULL;
+    const char * pKey = NULL;
+    size_t keyLength = 0;
+    size_t depth = 0;
+    uint32_t searchedInDoc = 0;
+    uint32_t searchedInFile = 0;
+    uint32_t foundInFile = 0;
+    uint32_t * pSearched = NULL;
 
-    /* Get destination offset to parameter storage location.*/
-    pParamAdd = ( uint8_t * ) pContextBase + docParam.pDestOffset;
+    pDocModel->isCborDoc = true;
 
-    /* Get destination buffer size to parameter storage location. */
-    pParamSizeAdd = ( void * ) ( ( uint8_t * ) pContextBase + docParam.pDestSizeOffset );
+    cborResult = cbor_parser_init( pCbor, length, 0, &cborParser, &containers[ 0 ] );
 
-    if( ( ModelParamTypeStringCopy == docParam.modelParamType ) || ( ModelParamTypeArrayCopy == docParam.modelParamType ) )
+    if( ( CborNoError == cborResult ) && ( false == cbor_value_is_map( &containers[ 0 ] ) ) )
     {
-        err = extractAndStoreArray( docParam.pSrcKey, pValueInJson, valueLength, pParamAdd, pParamSizeAdd );
+        cborResult = CborErrorIllegalType;
     }
-    else if( ModelParamTypeUInt32 == docParam.modelParamType )
+
+    if( CborNoError == cborResult )
     {
-        uint32_t * pUint32 = pParamAdd;
-        char * pEnd;
-        const char * pStart = pValueInJson;
-        errno = 0;
+        levels[ 0 ].pValue = ( const char * ) pCbor;
+        levels[ 0 ].valueParams = 0U;
+        levels[ 0 ].candidates = allModelParams( pDocModel->numModelParams );
+        levels[ 0 ].pathLength = 0U;
+        levels[ 0 ].pathHash = OTA_FNV_OFFSET_BASIS;
+        levels[ 0 ].isObject = true;
+        levels[ 0 ].inFileParams = false;
+        depth = 1U;
 
-        *pUint32 = ( uint32_t ) strtoul( pStart, &pEnd, 0 );
+        cborResult = cbor_value_enter_container( &containers[ 0 ], &cborValue );
+    }
 
-        if( ( errno == 0 ) && ( pEnd == &pValueInJson[ valueLength ] ) )
+    while( ( CborNoError == cborResult ) && ( depth > 0U ) )
+    {
+        pLevel = &levels[ depth - 1U ];
+        pSearched = ( pLevel->inFileParams == true ) ? &searchedInFile : &searchedInDoc;
+
+        if( true == cbor_value_at_end( &cborValue ) )
         {
-            LogInfo( ( "Extracted parameter: [key: value]=[%s: %u]",
-                       docParam.pSrcKey, *pUint32 ) );
+            /* A key path is only searched in its first object. */
+            cborResult = cbor_value_leave_container( &containers[ depth - 1U ], &cborValue );
+            cborValue = containers[ depth - 1U ];
+            recordJsonValue( pDocModel,
+                             pLevel->valueParams,
+                             pLevel->pValue,
+                             ( size_t ) ( cbor_value_get_next_byte( &cborValue ) - ( const uint8_t * ) pLevel->pValue ) );
+            *pSearched |= ( pLevel->isObject == true ) ? pLevel->candidates : 0U;
+            depth--;
         }
         else
         {
-            err = DocParseErrInvalidNumChar;
+            pKey = NULL;
+            keyLength = 0U;
+
+            if( pLevel->isObject == true )
+            {
+                /* Keys are text strings in one piece, like the keys of the model. */
+                if( ( false == cbor_value_is_text_string( &cborValue ) ) ||
+                    ( false == cbor_value_is_length_known( &cborValue ) ) )
+                {
+                    cborResult = CborErrorMapKeyNotString;
+                }
+                else
+                {
+                    cborResult = cbor_value_get_text_string_chunk( &cborValue, &pKey, &keyLength, &chunkNext );
+                }
+
+                if( CborNoError == cborResult )
+                {
+                    cborResult = cbor_value_advance( &cborValue );
+                }
+            }
+
+            if( CborNoError == cborResult )
+            {
+                matchJsonDocValue( pDocModel, pLevel, pKey, keyLength, *pSearched, &foundInFile, &match );
+                pValueStart = cbor_value_get_next_byte( &cborValue );
+
+                if( ( depth < OTA_MAX_JSON_DEPTH ) &&
+                    ( ( ( match.children != 0U ) && ( true == cbor_value_is_map( &cborValue ) ) ) ||
+                      ( ( match.fileGroupParams != 0U ) && ( true == cbor_value_is_array( &cborValue ) ) ) ) )
+                {
+                    /* Walk into the map, or into the array of the file group. */
+                    enterJsonDocLevel( &levels[ depth ], &match, ( const char * ) pValueStart, cbor_value_is_map( &cborValue ) );
+                    containers[ depth ] = cborValue;
+                    cborResult = cbor_value_enter_container( &containers[ depth ], &cborValue );
+                    depth++;
+                }
+                else
+                {
+                    cborResult = cbor_value_advance( &cborValue );
+
+                    /* The key path is not searched in the next maps with this key. */
+                    *pSearched |= ( pLevel->isObject == true ) ? match.children : 0U;
+                    recordJsonValue( pDocModel,
+                                     match.matches,
+                                     ( const char * ) pValueStart,
+                                     ( size_t ) ( cbor_value_get_next_byte( &cborValue ) - pValueStart ) );
+                }
+            }
         }
     }
-    else if( ModelParamTypeSigBase64 == docParam.modelParamType )
-    {
-        err = decodeAndStoreKey( pValueInJson, valueLength, pParamAdd );
-    }
-    else if( ModelParamTypeIdent == docParam.modelParamType )
-    {
-        LogDebug( ( "Identified parameter: [ %s ]",
-                    docParam.pSrcKey ) );
 
-        *( bool * ) pParamAdd = true;
-    }
-    else
+    if( ( CborNoError == cborResult ) && ( cbor_value_get_next_byte( &containers[ 0 ] ) != &pCbor[ length ] ) )
     {
-        LogWarn( ( "Invalid parameter type: %d", docParam.modelParamType ) );
+        cborResult = CborErrorGarbageAtEnd;
     }
 
-    if( err != DocParseErrNone )
+    if( CborNoError != cborResult )
     {
-        LogError( ( "Failed to extract document parameter: error=%d, paramter key=%s",
-                    err, docParam.pSrcKey ) );
+        LogError( ( "Invalid CBOR document: "
+                    "CborError=%d",
+                    cborResult ) );
+        err = DocParseErrInvalidCborBuffer;
     }
 
     return err;
 }
 
-/* Check if all the required parameters for job document are extracted from the JSON */
+/* Validate a JSON or CBOR job document and record the values of the model parameters. */
 
-static DocParseErr_t verifyRequiredParamsExtracted( const JsonDocParam_t * pModelParam,
-                                                    const JsonDocModel_t * pDocModel )
+static DocParseErr_t tokenizeJobDoc( const char * pDoc,
+                                     uint32_t messageLength,
+                                     JsonDocModel_t * pDocModel )
 {
-    uint32_t scanIndex = 0;
     DocParseErr_t err = DocParseErrNone;
-    uint32_t missingParams = ( pDocModel->paramsReceivedBitmap & pDocModel->paramsRequiredBitmap )
-                             ^ pDocModel->paramsRequiredBitmap;
 
-    if( missingParams != 0U )
+    if( isCborJobDoc( pDoc, messageLength ) == true )
     {
-        /* The job document did not have all required document model parameters. */
-        for( scanIndex = 0U; scanIndex < pDocModel->numModelParams; scanIndex++ )
+        err = tokenizeCBORbyModel( ( const uint8_t * ) pDoc, ( size_t ) messageLength, pDocModel );
+    }
+    else
+    {
+        err = validateJSON( pDoc, messageLength );
+
+        if( err == DocParseErrNone )
         {
-            if( ( missingParams & ( ( uint32_t ) 1U << scanIndex ) ) != 0U )
-            {
-                LogInfo( ( "Failed job document content check: "
-                           "Required job document parameter was not extracted: "
-                           "parameter=%s",
-                           pModelParam[ scanIndex ].pSrcKey ) );
-            }
+            tokenizeJSONbyModel( pDoc, messageLength, pDocModel );
         }
-
-        err = DocParseErrMalformedDoc;
     }
 
     return err;
 }
 
-/* Extract the desired fields from the JSON document based on the specified document model. */
+/* Store the values of the model parameters found in a tokenized JSON document. */
 
-static DocParseErr_t parseJSONbyModel( const char * pJson,
-                                       uint32_t messageLength,
-                                       JsonDocModel_t * pDocModel )
+static DocParseErr_t extractJSONbyModel( JsonDocModel_t * pDocModel )
 {
     const JsonDocParam_t * pModelParam = NULL;
-    DocParseErr_t err;
-    JSONStatus_t result;
+    const JsonDocSpan_t * pValueSpan = NULL;
+    DocParseErr_t err = DocParseErrNone;
     uint16_t paramIndex = 0;
-    const char * pFileParams = NULL;
-    uint32_t fileParamsLength = 0;
 
     /* Fetch the model parameters from the DocModel*/
     pModelParam = pDocModel->pBodyDef;
 
-    /* Check the validity of the JSON document */
-    err = validateJSON( pJson, messageLength );
-
-    /* Traverse the docModel and search the JSON if it containing the Source Key specified*/
-    for( paramIndex = 0; paramIndex < pDocModel->numModelParams; paramIndex++ )
+    /* Traverse the docModel and store the values of the parameters received. */
+    for( paramIndex = 0; ( paramIndex < pDocModel->numModelParams ) && ( err == DocParseErrNone ); paramIndex++ )
     {
-        const char * pQueryKey = pDocModel->pBodyDef[ paramIndex ].pSrcKey;
-        size_t queryKeyLength = strlen( pQueryKey );
-        const char * pValueInJson = NULL;
-        size_t valueLength = 0;
-        result = JSON_SearchConst( pJson, messageLength, pQueryKey, queryKeyLength, &pValueInJson, &valueLength, NULL );
-
-        /* If not found in pJSon search for the key in FileParameters JSON*/
-        if( ( result != JSONSuccess ) && ( pFileParams != NULL ) )
-        {
-            result = JSON_SearchConst( pFileParams, fileParamsLength, pQueryKey, queryKeyLength, &pValueInJson, &valueLength, NULL );
-        }
+        pValueSpan = &( pDocModel->valueSpans[ paramIndex ] );
 
-        if( result == JSONSuccess )
+        /* Parameters that are not stored, including the file group, only need to be received. */
+        if( ( ( pDocModel->paramsReceivedBitmap & ( ( uint32_t ) 1U << paramIndex ) ) != 0U ) &&
+            ( OTA_DONT_STORE_PARAM != ( int32_t ) pModelParam[ paramIndex ].pDestOffset ) &&
+            ( OTA_STORE_NESTED_JSON != pModelParam[ paramIndex ].pDestOffset ) )
         {
-            /* Mark parameter as received in the bitmap. */
-            pDocModel->paramsReceivedBitmap |= ( ( uint32_t ) 1U << paramIndex );
-
-            if( OTA_DONT_STORE_PARAM == ( int32_t ) pModelParam[ paramIndex ].pDestOffset )
-            {
-                /* Do nothing if we don't need to store the parameter */
-                continue;
-            }
-            else if( OTA_STORE_NESTED_JSON == pModelParam[ paramIndex ].pDestOffset )
+            if( pDocModel->isCborDoc == true )
             {
-                pFileParams = pValueInJson + 1;
-                fileParamsLength = ( uint32_t ) valueLength - 2U;
+                err = extractCborParameter( pModelParam[ paramIndex ],
+                                            pDocModel->contextBase,
+                                            pValueSpan->pValue,
+                                            pValueSpan->valueLength );
             }
             else
             {
                 err = extractParameter( pModelParam[ paramIndex ],
                                         pDocModel->contextBase,
-                                        pValueInJson,
-                                        valueLength );
-            }
-
-            if( err != DocParseErrNone )
-            {
-                break;
+                                        pValueSpan->pValue,
+                                        pValueSpan->valueLength );
             }
         }
     }
@@ -1547,6 +3222,7 @@ static DocParseErr_t parseJSONbyModel( const char * pJson,
 
 static DocParseErr_t initDocModel( JsonDocModel_t * pDocModel,
                                    const JsonDocParam_t * pBodyDef,
+                                   const JsonKeyTable_t * pKeyTable,
                                    void * contextBaseAddr,
                                    uint32_t contextSize,
                                    uint16_t numJobParams )
@@ -1562,9 +3238,9 @@ static DocParseErr_t initDocModel( JsonDocModel_t * pDocModel,
         LogError( ( "Parameter check failed: pDocModel is NULL." ) );
         err = DocParseErrNullModelPointer;
     }
-    else if( pBodyDef == NULL )
+    else if( ( pBodyDef == NULL ) || ( pKeyTable == NULL ) )
     {
-        LogError( ( "Parameter check failed: pBodyDef is NULL." ) );
+        LogError( ( "Parameter check failed: pBodyDef or pKeyTable is NULL." ) );
         err = DocParseErrNullBodyPointer;
     }
     else if( numJobParams > OTA_DOC_MODEL_MAX_PARAMS )
@@ -1584,6 +3260,8 @@ static DocParseErr_t initDocModel( JsonDocModel_t * pDocModel,
         pDocModel->numModelParams = numJobParams;
         pDocModel->paramsReceivedBitmap = 0;
         pDocModel->paramsRequiredBitmap = 0;
+        pDocModel->pKeyTable = pKeyTable;
+        pDocModel->isCborDoc = false;
 
         /* Scan the model and detect all required parameters (i.e. not optional). */
         for( scanIndex = 0; scanIndex < pDocModel->numModelParams; scanIndex++ )
@@ -1652,23 +3330,52 @@ static OtaErr_t validateUpdateVersion( const OtaFileContext_t * pFileContext )
     return err;
 }
 
+/* Set a read-only view of the values found in a tokenized job document. */
+
+static void initJobDocView( const JsonDocModel_t * pDocModel,
+                            OtaJobDocView_t * pDocView )
+{
+    pDocView->pKeyTable = ( const void * ) pDocModel->pKeyTable;
+    pDocView->pParams = ( const void * ) pDocModel->pBodyDef;
+    pDocView->numParams = pDocModel->numModelParams;
+    pDocView->pSpans = ( const void * ) pDocModel->valueSpans;
+    pDocView->spansFound = pDocModel->paramsReceivedBitmap;
+}
+
 /* If there is an error is parsing the json check if it can be handled by external callback. */
 
 static OtaJobParseErr_t parseJobDocFromCustomCallback( const char * pJson,
                                                        uint32_t messageLength,
+                                                       const JsonDocModel_t * pDocModel,
                                                        OtaFileContext_t * pFileContext,
                                                        OtaFileContext_t ** pFinalFile )
 {
     OtaErr_t otaErr = OtaErrNone;
     OtaJobParseErr_t err = OtaJobParseErrNone;
     size_t jobNameLen = 0;
+    OtaJobDocView_t docView;
 
     assert( pFileContext != NULL );
 
-    /* We have an unknown job parser error. Check to see if we can pass control to a callback for parsing */
-    if( otaAgent.customJobCallback != NULL )
+    /* We have an unknown job parser error. Check to see if we can pass control to a callback for parsing.
+     * The custom job callback only gets JSON documents, it was registered before CBOR job documents. */
+    if( ( otaAgent.customJobDocCallback != NULL ) ||
+        ( ( otaAgent.customJobCallback != NULL ) && ( isCborJobDoc( pJson, messageLength ) == false ) ) )
     {
-        err = otaAgent.customJobCallback( pJson, messageLength );
+        /* The values found in the document are passed along so that they are not searched again. */
+        if( ( otaAgent.customJobDocCallback != NULL ) && ( pDocModel != NULL ) )
+        {
+            initJobDocView( pDocModel, &docView );
+            err = otaAgent.customJobDocCallback( pJson, messageLength, &docView );
+        }
+        else if( otaAgent.customJobDocCallback != NULL )
+        {
+            err = otaAgent.customJobDocCallback( pJson, messageLength, NULL );
+        }
+        else
+        {
+            err = otaAgent.customJobCallback( pJson, messageLength );
+        }
 
         if( err == OtaJobParseErrNone )
         {
@@ -1752,26 +3459,11 @@ static OtaJobParseErr_t verifyActiveJobStatus( OtaFileContext_t * pFileContext,
         }
         else
         {
-            /* The same job is being reported so update the url. */
+            /* The same job is being reported. The job document is parsed into the active file
+             * context, so it already holds the new url while the receive bitmap is kept. */
             LogInfo( ( "New job document ID is identical to the current job: "
                        "Updating the URL based on the new job document." ) );
 
-            if( otaAgent.fileContext.pUpdateUrlPath != NULL )
-            {
-                if( otaAgent.fileContext.updateUrlMaxSize == 0u )
-                {
-                    /* The buffer is allocated by us, free first then update. */
-                    otaAgent.pOtaInterface->os.mem.free( otaAgent.fileContext.pUpdateUrlPath );
-                    otaAgent.fileContext.pUpdateUrlPath = pFileContext->pUpdateUrlPath;
-                    pFileContext->pUpdateUrlPath = NULL;
-                }
-                else
-                {
-                    /* The buffer is provided by user, directly copy the new url to it. */
-                    ( void ) memcpy( otaAgent.fileContext.pUpdateUrlPath, pFileContext->pUpdateUrlPath, otaAgent.fileContext.updateUrlMaxSize );
-                }
-            }
-
             *pFinalFile = &( otaAgent.fileContext );
             *pUpdateJob = true;
 
@@ -1899,6 +3591,10 @@ static OtaJobParseErr_t validateAndStartJob( OtaFileContext_t * pFileContext,
             }
         }
     }
+    else if( err == OtaJobParseErrUpdateCurrentJob )
+    {
+        LogInfo( ( "Continuing the active job with the updated job document." ) );
+    }
     else
     {
         LogError( ( "Failed to validate and start the job: OtaJobParseErr_t=%s", OTA_JobParse_strerror( err ) ) );
@@ -1909,7 +3605,7 @@ static OtaJobParseErr_t validateAndStartJob( OtaFileContext_t * pFileContext,
 
 /* This is the OTA job document model describing the parameters, their types, destination and how to extract. */
 
-static const JsonDocParam_t otaJobDocModelParamStructure[ OTA_NUM_JOB_PARAMS ] =
+static const JsonDocParam_t otaJobDocModelParamStructure[] =
 {
     { OTA_JSON_CLIENT_TOKEN_KEY,    OTA_JOB_PARAM_OPTIONAL, OTA_DONT_STORE_PARAM,         OTA_DONT_STORE_PARAM,  ModelParamTypeStringInDoc },
     { OTA_JSON_TIMESTAMP_KEY,       OTA_JOB_PARAM_OPTIONAL, OTA_DONT_STORE_PARAM,         OTA_DONT_STORE_PARAM,  ModelParamTypeUInt32      },
@@ -1934,6 +3630,143 @@ static const JsonDocParam_t otaJobDocModelParamStructure[ OTA_NUM_JOB_PARAMS ] =
     { OTA_JSON_FILETYPE_KEY,        OTA_JOB_PARAM_OPTIONAL, U16_OFFSET( OtaFileContext_t, fileType ),            OTA_DONT_STORE_PARAM, ModelParamTypeUInt32}
 };
 
+/* The parameter indices of ota_job_doc_key_table.h are generated from the model above, a
+ * model with another number of parameters means that the header is stale. */
+
+typedef char otaJobDocModelSizeCheck_t[ ( ( sizeof( otaJobDocModelParamStructure ) / sizeof( otaJobDocModelParamStructure[ 0 ] ) ) ==
+                                          OTA_NUM_JOB_PARAMS ) ? 1 : -1 ];
+
+#if ( OTA_JOB_DOC_NUM_PARAMS != OTA_NUM_JOB_PARAMS )
+    #error "ota_job_doc_key_table.h is stale, run tools/json_key_table.py."
+#endif
+
+/* Parameters of the job document model that identify the update. The other fields, like
+ * the timestamps, the version number and the pre-signed url with its authentication scheme,
+ * change every time the job document is sent and are left out of the fingerprint. */
+
+static const uint16_t otaJobDocFingerprintParams[] =
+{
+    OTA_JOB_DOC_PARAM_JOB_ID,
+    OTA_JOB_DOC_PARAM_SELF_TEST,
+    OTA_JOB_DOC_PARAM_UPDATED_BY,
+    OTA_JOB_DOC_PARAM_STREAM_NAME,
+    OTA_JOB_DOC_PARAM_PROTOCOLS,
+    OTA_JOB_DOC_PARAM_FILE_PATH,
+    OTA_JOB_DOC_PARAM_FILE_SIZE,
+    OTA_JOB_DOC_PARAM_FILE_ID,
+    OTA_JOB_DOC_PARAM_FILE_CERT_NAME,
+    OTA_JOB_DOC_PARAM_FILE_SIGNATURE,
+    OTA_JOB_DOC_PARAM_FILE_ATTRIBUTE,
+    OTA_JOB_DOC_PARAM_FILETYPE
+};
+
+/* Validate and tokenize the OTA job document and hash the fields that identify the update. */
+
+static DocParseErr_t fingerprintJobDoc( const char * pJson,
+                                        uint32_t messageLength,
+                                        JsonDocModel_t * pDocModel,
+                                        uint32_t * pFingerprint )
+{
+    DocParseErr_t err = DocParseErrNone;
+    const JsonDocSpan_t * pValueSpan = NULL;
+    uint32_t hash = OTA_FNV_OFFSET_BASIS;
+    size_t i = 0;
+
+    err = tokenizeJobDoc( pJson, messageLength, pDocModel );
+
+    if( err == DocParseErrNone )
+    {
+        for( i = 0; i < ( sizeof( otaJobDocFingerprintParams ) / sizeof( otaJobDocFingerprintParams[ 0 ] ) ); i++ )
+        {
+            /* The length separates the fields, and is 0 for the fields not in the document.
+             * The spans of those fields are not set by the tokenizer. */
+            pValueSpan = &( pDocModel->valueSpans[ otaJobDocFingerprintParams[ i ] ] );
+
+            if( ( pDocModel->paramsReceivedBitmap & ( ( uint32_t ) 1U << otaJobDocFingerprintParams[ i ] ) ) != 0U )
+            {
+                hash ^= ( uint32_t ) pValueSpan->valueLength;
+                hash *= OTA_FNV_PRIME;
+                hash = hashJsonKey( hash, pValueSpan->pValue, pValueSpan->valueLength );
+            }
+            else
+            {
+                hash *= OTA_FNV_PRIME;
+            }
+        }
+    }
+
+    *pFingerprint = hash;
+
+    return err;
+}
+
+/* Check if a job document fingerprint is the one of the active job. */
+
+static bool isActiveJobDoc( uint32_t fingerprint )
+{
+    return ( activeJobFingerprint != 0U ) &&
+           ( fingerprint == activeJobFingerprint ) &&
+           ( strlen( ( const char * ) otaAgent.pActiveJobName ) > 0u );
+}
+
+/* Check if the job document of an event has the bytes of the job document of the active job. */
+
+static bool isActiveJobDocCopy( const OtaEventData_t * pEventData )
+{
+    return ( pEventData->dataLength == activeJobDocLength ) &&
+           ( hashJsonKey( OTA_FNV_OFFSET_BASIS,
+                          ( const char * ) pEventData->data,
+                          ( size_t ) pEventData->dataLength ) == activeJobDocHash ) &&
+           ( isActiveJobDoc( activeJobFingerprint ) == true );
+}
+
+/* Parameters of the job document model with the pre-signed url. They are the only fields
+ * of the job document of the active job that the transfer uses again. */
+
+static const uint16_t otaJobDocUrlParams[] =
+{
+    OTA_JOB_DOC_PARAM_UPDATE_DATA_URL,
+    OTA_JOB_DOC_PARAM_AUTH_SCHEME
+};
+
+/* Store the pre-signed url of a tokenized job document of the active job, and its
+ * authentication scheme, in the file context. */
+
+static DocParseErr_t updateActiveJobUrl( const JsonDocModel_t * pDocModel )
+{
+    DocParseErr_t err = DocParseErrNone;
+    const JsonDocSpan_t * pValueSpan = NULL;
+    uint16_t paramIndex = 0;
+    size_t i = 0;
+
+    for( i = 0; ( i < ( sizeof( otaJobDocUrlParams ) / sizeof( otaJobDocUrlParams[ 0 ] ) ) ) && ( err == DocParseErrNone ); i++ )
+    {
+        paramIndex = otaJobDocUrlParams[ i ];
+        pValueSpan = &( pDocModel->valueSpans[ paramIndex ] );
+
+        if( ( pDocModel->paramsReceivedBitmap & ( ( uint32_t ) 1U << paramIndex ) ) == 0U )
+        {
+            /* The value of the active job is kept. */
+        }
+        else if( pDocModel->isCborDoc == true )
+        {
+            err = extractCborParameter( pDocModel->pBodyDef[ paramIndex ],
+                                        pDocModel->contextBase,
+                                        pValueSpan->pValue,
+                                        pValueSpan->valueLength );
+        }
+        else
+        {
+            err = extractParameter( pDocModel->pBodyDef[ paramIndex ],
+                                    pDocModel->contextBase,
+                                    pValueSpan->pValue,
+                                    pValueSpan->valueLength );
+        }
+    }
+
+    return err;
+}
+
 /* Parse the OTA job document and validate. Return the populated
  * OTA context if valid otherwise return NULL.
  */
@@ -1948,9 +3781,12 @@ static OtaFileContext_t * parseJobDoc( const char * pJson,
     OtaFileContext_t * pFinalFile = NULL;
     OtaFileContext_t * pFileContext = &( otaAgent.fileContext );
     JsonDocModel_t otaJobDocModel;
+    const JsonDocModel_t * pTokenizedModel = NULL;
+    uint32_t fingerprint = 0;
 
     parseError = initDocModel( &otaJobDocModel,
                                otaJobDocModelParamStructure,
+                               &otaJobDocKeyTable,
                                ( void * ) pFileContext,
                                ( uint32_t ) sizeof( OtaFileContext_t ),
                                OTA_NUM_JOB_PARAMS );
@@ -1961,7 +3797,15 @@ static OtaFileContext_t * parseJobDoc( const char * pJson,
     }
     else
     {
-        parseError = parseJSONbyModel( pJson, messageLength, &otaJobDocModel );
+        /* Copies of the job document of the active job are caught by ignoreActiveJobDoc
+         * before they get here, so every job document is extracted. */
+        parseError = fingerprintJobDoc( pJson, messageLength, &otaJobDocModel, &fingerprint );
+
+        if( parseError == DocParseErrNone )
+        {
+            pTokenizedModel = &otaJobDocModel;
+            parseError = extractJSONbyModel( &otaJobDocModel );
+        }
 
         if( parseError == DocParseErrNone )
         {
@@ -1969,11 +3813,22 @@ static OtaFileContext_t * parseJobDoc( const char * pJson,
         }
         else
         {
-            err = parseJobDocFromCustomCallback( pJson, messageLength, pFileContext, &pFinalFile );
+            err = parseJobDocFromCustomCallback( pJson, messageLength, pTokenizedModel, pFileContext, &pFinalFile );
+        }
+
+        /* Only a job document parsed by the model and accepted for a transfer is fingerprinted. */
+        activeJobFingerprint = ( ( parseError == DocParseErrNone ) && ( pFinalFile != NULL ) ) ? fingerprint : 0U;
+
+        if( activeJobFingerprint != 0U )
+        {
+            /* An unchanged copy of the job document is then recognized without parsing it. */
+            activeJobDocHash = hashJsonKey( OTA_FNV_OFFSET_BASIS, pJson, ( size_t ) messageLength );
+            activeJobDocLength = messageLength;
         }
     }
 
-    if( err != OtaJobParseErrNone )
+    /* An update of the active job is not a failure. */
+    if( ( err != OtaJobParseErrNone ) && ( err != OtaJobParseErrUpdateCurrentJob ) )
     {
         /* If job parsing failed AND there's a job ID, update the job state to FAILED with
          * a reason code.  Without a job ID, we can't update the status in the job service. */
@@ -2091,6 +3946,7 @@ static OtaFileContext_t * getFileContextFromJob( const char * pRawMsg,
             }
 
             pUpdateFile->blocksRemaining = numBlocks; /* Initialize our blocks remaining counter. */
+            urlRefreshCount = 0;
 
             /* Create/Open the OTA file on the file system. */
             palStatus = otaAgent.pOtaInterface->pal.createFile( pUpdateFile );
@@ -2226,18 +4082,34 @@ static IngestResult_t processDataBlock( OtaFileContext_t * pFileContext,
 static IngestResult_t decodeAndStoreDataBlock( OtaFileContext_t * pFileContext,
                                                const uint8_t * pRawMsg,
                                                uint32_t messageSize,
+                                               uint32_t messageBlock,
                                                uint8_t ** pPayload,
                                                uint32_t * uBlockSize,
-                                               uint32_t * uBlockIndex )
+                                               uint32_t * uBlockIndex,
+                                               uint32_t * pNumBlocks )
 {
     IngestResult_t eIngestResult = IngestResultUninitialized;
+    OtaErr_t decodeErr = OtaErrNone;
     int32_t lFileId = 0;
     int32_t sBlockSize = 0;
     int32_t sBlockIndex = 0;
     size_t payloadSize = 0;
 
+    if( messageBlock > 0U )
+    {
+        /* The further blocks of a message are decoded into the payload buffer of its first block. */
+        if( ( otaAgent.fileContext.pDecodeMem != NULL ) &&
+            ( otaAgent.fileContext.decodeMemMaxSize != 0u ) )
+        {
+            payloadSize = otaAgent.fileContext.decodeMemMaxSize;
+        }
+        else
+        {
+            payloadSize = ( 1UL << otaconfigLOG2_FILE_BLOCK_SIZE );
+        }
+    }
     /* If we are expecting a data block, allocate space for it. */
-    if( ( pFileContext->pRxBlockBitmap != NULL ) && ( pFileContext->blocksRemaining > 0U ) )
+    else if( ( pFileContext->pRxBlockBitmap != NULL ) && ( pFileContext->blocksRemaining > 0U ) )
     {
         ( void ) otaAgent.pOtaInterface->os.timer.start( OtaRequestTimer,
                                                          "OtaRequestTimer",
@@ -2269,17 +4141,47 @@ static IngestResult_t decodeAndStoreDataBlock( OtaFileContext_t * pFileContext,
     if( payloadSize > 0u )
     {
         /* Decode the file block received. */
-        if( OtaErrNone != otaDataInterface.decodeFileBlock(
+        if( otaDataInterface.decodeFileBlockAt != NULL )
+        {
+            decodeErr = otaDataInterface.decodeFileBlockAt(
+                pRawMsg,
+                messageSize,
+                messageBlock,
+                &lFileId,
+                &sBlockIndex,
+                &sBlockSize,
+                pPayload,
+                &payloadSize,
+                pNumBlocks );
+        }
+        else
+        {
+            decodeErr = otaDataInterface.decodeFileBlock(
                 pRawMsg,
                 messageSize,
                 &lFileId,
                 &sBlockIndex,
                 &sBlockSize,
                 pPayload,
-                &payloadSize ) )
+                &payloadSize );
+            *pNumBlocks = 1U;
+        }
+
+        if( OtaErrStaleFileBlock == decodeErr )
+        {
+            /* The data plane already requested the block again, it is not counted as received. */
+            eIngestResult = IngestResultStale_Continue;
+        }
+        else if( OtaErrNone != decodeErr )
         {
             eIngestResult = IngestResultBadData;
         }
+        else if( ( passiveListenActive() == true ) && ( ( uint32_t ) lFileId != pFileContext->serverFileID ) )
+        {
+            /* A shared stream carries every file of the stream. Skip the blocks of other files. */
+            LogDebug( ( "Ignoring block of another file on the shared stream: File ID=%d", lFileId ) );
+            eIngestResult = IngestResultOtherFile_Continue;
+        }
         else
         {
             *uBlockIndex = ( uint32_t ) sBlockIndex;
@@ -2373,16 +4275,25 @@ static IngestResult_t ingestDataBlockCleanup( OtaFileContext_t * pFileContext,
  * expecting, close the file and perform the final signature check on it. If the close and signature
  * check are OK, let the caller know so it can be used by the system. Firmware updates generally
  * reboot the system and perform a self test phase. If the close or signature check fails, abort
- * the file transfer and return the result and any available details to the caller.
+ * the file transfer and return the result and any available details to the caller. The blocks of
+ * a multi-block stream response are ingested in turn, and pBlocksReceived returns how many of them
+ * belong to this file.
  */
 static IngestResult_t ingestDataBlock( OtaFileContext_t * pFileContext,
                                        const uint8_t * pRawMsg,
                                        uint32_t messageSize,
-                                       OtaPalStatus_t * pCloseResult )
+                                       OtaPalStatus_t * pCloseResult,
+                                       uint32_t * pBlocksReceived )
 {
     IngestResult_t eIngestResult = IngestResultUninitialized;
+    IngestResult_t eBlockResult = IngestResultUninitialized;
+    IngestResult_t eContinueResult = IngestResultUninitialized;
     uint32_t uBlockSize = 0;
     uint32_t uBlockIndex = 0;
+    uint32_t messageBlock = 0;
+    uint32_t numBlocks = 1;
+    uint32_t fileBlocks = 0;
+    bool blockAccepted = false;
     uint8_t * pPayload = NULL;
 
     /* Check if the file context is NULL. */
@@ -2400,17 +4311,51 @@ static IngestResult_t ingestDataBlock( OtaFileContext_t * pFileContext,
         }
     }
 
-    /* Decode the received data block. */
-    if( eIngestResult == IngestResultUninitialized )
+    /* A stream response may carry several blocks, ingest them in turn. Once the file is complete,
+     * the further blocks of the message can only be duplicates. */
+    while( ( eIngestResult == IngestResultUninitialized ) && ( messageBlock < numBlocks ) &&
+           ( ( messageBlock == 0U ) || ( pFileContext->blocksRemaining > 0U ) ) )
     {
         /* If we have a block bitmap available then process the message. */
-        eIngestResult = decodeAndStoreDataBlock( pFileContext, pRawMsg, messageSize, &pPayload, &uBlockSize, &uBlockIndex );
+        eBlockResult = decodeAndStoreDataBlock( pFileContext, pRawMsg, messageSize, messageBlock, &pPayload, &uBlockSize, &uBlockIndex, &numBlocks );
+
+        /* Validate the data block and process it to store the information.*/
+        if( eBlockResult == IngestResultUninitialized )
+        {
+            eBlockResult = processDataBlock( pFileContext, uBlockIndex, uBlockSize, pCloseResult, pPayload );
+        }
+
+        if( eBlockResult < IngestResultAccepted_Continue )
+        {
+            /* A bad block fails the whole message. */
+            eIngestResult = eBlockResult;
+        }
+        else
+        {
+            if( eBlockResult == IngestResultAccepted_Continue )
+            {
+                blockAccepted = true;
+            }
+            else
+            {
+                eContinueResult = eBlockResult;
+            }
+
+            /* Blocks of other files on a shared stream were not requested for this file, and blocks
+             * of stale requests were requested again. */
+            if( ( eBlockResult != IngestResultOtherFile_Continue ) && ( eBlockResult != IngestResultStale_Continue ) )
+            {
+                fileBlocks++;
+            }
+
+            messageBlock++;
+        }
     }
 
-    /* Validate the data block and process it to store the information.*/
     if( eIngestResult == IngestResultUninitialized )
     {
-        eIngestResult = processDataBlock( pFileContext, uBlockIndex, uBlockSize, pCloseResult, pPayload );
+        eIngestResult = ( blockAccepted == true ) ? IngestResultAccepted_Continue : eContinueResult;
+        *pBlocksReceived = fileBlocks;
     }
 
     /* If the ingestion is complete close the file and cleanup.*/
@@ -2429,6 +4374,256 @@ static IngestResult_t ingestDataBlock( OtaFileContext_t * pFileContext,
     return eIngestResult;
 }
 
+/*
+ * processDataChunkSpan
+ *
+ * Write the part of a chunk that falls into one block. A block that does not fit in one chunk is
+ * tracked in partialBlocks until all of its bytes are written, and only then marked as received
+ * in the bitmap. The chunks of a block must arrive in order, other chunks are ignored so that the
+ * block is requested again. pData is NULL if the data plane already wrote the span to the file.
+ */
+static IngestResult_t processDataChunkSpan( OtaFileContext_t * pFileContext,
+                                            uint32_t blockIndex,
+                                            uint32_t blockOffset,
+                                            const uint8_t * pData,
+                                            uint32_t spanSize,
+                                            uint32_t * pBlocksCompleted )
+{
+    IngestResult_t eIngestResult = IngestResultUninitialized;
+    OtaPartialBlock_t * pPartialBlock = NULL;
+    OtaPartialBlock_t wholeBlock = { 0 };
+    uint32_t blockSize = OTA_FILE_BLOCK_SIZE;
+    uint32_t byte = 0;
+    uint32_t i = 0;
+    uint8_t bitMask = 0;
+    int32_t iBytesWritten = 0;
+
+    /* The last block of the file may be shorter than a full block. */
+    if( ( pFileContext->fileSize - ( blockIndex * OTA_FILE_BLOCK_SIZE ) ) < OTA_FILE_BLOCK_SIZE )
+    {
+        blockSize = pFileContext->fileSize - ( blockIndex * OTA_FILE_BLOCK_SIZE );
+    }
+
+    /* Create bit mask and byte offset for use in our bitmap. */
+    bitMask = ( uint8_t ) ( 1U << ( blockIndex % BITS_PER_BYTE ) );
+    byte = blockIndex >> LOG2_BITS_PER_BYTE;
+
+    if( ( pFileContext->pRxBlockBitmap[ byte ] & bitMask ) == 0U )
+    {
+        LogDebug( ( "Ignoring file data of a block already received: Block index=%u", blockIndex ) );
+        eIngestResult = IngestResultDuplicate_Continue;
+    }
+    else if( ( blockOffset == 0U ) && ( spanSize == blockSize ) )
+    {
+        /* The whole block is in this chunk, it does not need to be tracked. */
+        wholeBlock.blockIndex = blockIndex;
+        pPartialBlock = &wholeBlock;
+    }
+    else
+    {
+        /* Find the block if some of it was already received. */
+        for( i = 0; ( i < otaconfigHTTP_MAX_PARALLEL_REQUESTS ) && ( pPartialBlock == NULL ); i++ )
+        {
+            if( ( partialBlocks[ i ].bytesReceived > 0U ) && ( partialBlocks[ i ].blockIndex == blockIndex ) )
+            {
+                pPartialBlock = &partialBlocks[ i ];
+            }
+        }
+
+        /* The start of a block restarts it, for example after the request timed out. */
+        for( i = 0; ( i < otaconfigHTTP_MAX_PARALLEL_REQUESTS ) && ( pPartialBlock == NULL ) && ( blockOffset == 0U ); i++ )
+        {
+            if( partialBlocks[ i ].bytesReceived == 0U )
+            {
+                pPartialBlock = &partialBlocks[ i ];
+            }
+        }
+
+        if( pPartialBlock == NULL )
+        {
+            LogWarn( ( "Ignoring file data, no room to track the block: Block index=%u, Offset=%u",
+                       blockIndex, blockOffset ) );
+            eIngestResult = IngestResultDuplicate_Continue;
+        }
+        else if( blockOffset == 0U )
+        {
+            pPartialBlock->blockIndex = blockIndex;
+            pPartialBlock->bytesReceived = 0;
+        }
+        else if( pPartialBlock->bytesReceived != blockOffset )
+        {
+            LogWarn( ( "Ignoring file data out of order: Block index=%u, Offset=%u, Expected offset=%u",
+                       blockIndex, blockOffset, pPartialBlock->bytesReceived ) );
+            eIngestResult = IngestResultDuplicate_Continue;
+        }
+        else
+        {
+            /* The chunk continues the block. */
+        }
+    }
+
+    /* Data written to the file by the data plane is not passed to the PAL again. */
+    if( ( eIngestResult == IngestResultUninitialized ) && ( pData != NULL ) )
+    {
+        /* The PAL does not modify the data it writes. */
+        iBytesWritten = otaAgent.pOtaInterface->pal.writeBlock( pFileContext,
+                                                                ( blockIndex * OTA_FILE_BLOCK_SIZE ) + blockOffset,
+                                                                ( uint8_t * ) pData,
+                                                                spanSize );
+    }
+
+    if( eIngestResult == IngestResultUninitialized )
+    {
+
+        if( iBytesWritten < 0 )
+        {
+            eIngestResult = IngestResultWriteBlockFailed;
+            LogError( ( "Failed to ingest received chunk: IngestResult_t=%d",
+                        eIngestResult ) );
+        }
+        else
+        {
+            eIngestResult = IngestResultAccepted_Continue;
+            pPartialBlock->bytesReceived += spanSize;
+
+            if( pPartialBlock->bytesReceived == blockSize )
+            {
+                LogInfo( ( "Received valid file block: Block index=%u, Size=%u",
+                           blockIndex, blockSize ) );
+
+                /* Mark this block as received in our bitmap. */
+                pFileContext->pRxBlockBitmap[ byte ] &= ( uint8_t ) ~bitMask;
+                pFileContext->blocksRemaining--;
+                pPartialBlock->bytesReceived = 0;
+                ( *pBlocksCompleted )++;
+            }
+        }
+    }
+
+    return eIngestResult;
+}
+
+/*
+ * ingestDataChunk
+ *
+ * A chunk of file data of any size was received at a file offset. Write it to persistent storage
+ * block by block, so that no memory is needed to assemble whole blocks. If the data plane already
+ * wrote the chunk to the file, the message only holds its offset and length and the blocks are
+ * just marked received. If this completes the last block we're expecting, close the file and
+ * perform the final signature check on it.
+ */
+static IngestResult_t ingestDataChunk( OtaFileContext_t * pFileContext,
+                                       const uint8_t * pRawMsg,
+                                       uint32_t messageSize,
+                                       bool dataWritten,
+                                       OtaPalStatus_t * pCloseResult,
+                                       uint32_t * pBlocksCompleted )
+{
+    IngestResult_t eIngestResult = IngestResultUninitialized;
+    IngestResult_t spanResult = IngestResultUninitialized;
+    uint32_t offset = 0;
+    uint32_t dataSize = 0;
+    uint32_t spanSize = 0;
+    uint32_t blockOffset = 0;
+    uint32_t i = 0;
+
+    if( ( pFileContext->pRxBlockBitmap == NULL ) || ( pFileContext->blocksRemaining == 0U ) )
+    {
+        eIngestResult = IngestResultUnexpectedBlock;
+    }
+    else if( pFileContext->pFile == NULL )
+    {
+        LogError( ( "Parameter check failed: pFileContext->pFile is NULL." ) );
+        eIngestResult = IngestResultBadFileHandle;
+    }
+    else if( ( messageSize < OTA_FILE_CHUNK_OFFSET_SIZE ) || ( messageSize > OTA_FILE_CHUNK_EVENT_SIZE ) )
+    {
+        LogError( ( "File chunk size %u out of range: Expected the file offset and up to %u bytes of data.",
+                    messageSize,
+                    otaconfigFILE_CHUNK_SIZE ) );
+        eIngestResult = IngestResultBadData;
+    }
+    else if( ( dataWritten == true ) && ( messageSize != OTA_FILE_CHUNK_WRITTEN_SIZE ) )
+    {
+        LogError( ( "Written file chunk size %u is not the size of the file offset and length.", messageSize ) );
+        eIngestResult = IngestResultBadData;
+    }
+    else
+    {
+        for( i = 0; i < OTA_FILE_CHUNK_OFFSET_SIZE; i++ )
+        {
+            offset = ( offset << 8U ) | pRawMsg[ i ];
+        }
+
+        if( dataWritten == true )
+        {
+            for( i = OTA_FILE_CHUNK_OFFSET_SIZE; i < OTA_FILE_CHUNK_WRITTEN_SIZE; i++ )
+            {
+                dataSize = ( dataSize << 8U ) | pRawMsg[ i ];
+            }
+        }
+        else
+        {
+            dataSize = messageSize - OTA_FILE_CHUNK_OFFSET_SIZE;
+        }
+
+        if( ( offset > pFileContext->fileSize ) || ( dataSize > ( pFileContext->fileSize - offset ) ) )
+        {
+            LogError( ( "File chunk outside of the file: Offset=%u, Size=%u", offset, dataSize ) );
+            eIngestResult = IngestResultBlockOutOfRange;
+        }
+    }
+
+    if( eIngestResult == IngestResultUninitialized )
+    {
+        ( void ) otaAgent.pOtaInterface->os.timer.start( OtaRequestTimer,
+                                                         "OtaRequestTimer",
+                                                         otaconfigFILE_REQUEST_WAIT_MS,
+                                                         otaTimerCallback );
+
+        *pCloseResult = OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 ); /* This is a success path. */
+        eIngestResult = IngestResultDuplicate_Continue;
+        i = OTA_FILE_CHUNK_OFFSET_SIZE;
+
+        /* Split the chunk at the block boundaries. */
+        while( ( dataSize > 0U ) && ( eIngestResult >= IngestResultAccepted_Continue ) )
+        {
+            blockOffset = offset % OTA_FILE_BLOCK_SIZE;
+            spanSize = OTA_FILE_BLOCK_SIZE - blockOffset;
+
+            if( spanSize > dataSize )
+            {
+                spanSize = dataSize;
+            }
+
+            spanResult = processDataChunkSpan( pFileContext,
+                                               offset >> otaconfigLOG2_FILE_BLOCK_SIZE,
+                                               blockOffset,
+                                               ( dataWritten == true ) ? NULL : &pRawMsg[ i ],
+                                               spanSize,
+                                               pBlocksCompleted );
+
+            /* The chunk is accepted if any of it is written. */
+            if( ( spanResult < IngestResultAccepted_Continue ) || ( spanResult == IngestResultAccepted_Continue ) )
+            {
+                eIngestResult = spanResult;
+            }
+
+            offset += spanSize;
+            i += spanSize;
+            dataSize -= spanSize;
+        }
+    }
+
+    /* If the ingestion is complete close the file and cleanup.*/
+    if( eIngestResult == IngestResultAccepted_Continue )
+    {
+        eIngestResult = ingestDataBlockCleanup( pFileContext, pCloseResult );
+    }
+
+    return eIngestResult;
+}
+
 /*
  * Clean up after the OTA process is done. Possibly free memory for re-use.
  */
@@ -2486,6 +4681,8 @@ static void handleUnexpectedEvents( const OtaEventMsg_t * pEventMsg )
             break;
 
         case OtaAgentEventReceivedFileBlock:
+        case OtaAgentEventReceivedFileChunk:
+        case OtaAgentEventFileChunkWritten:
 
             /* Let the application know to release buffer.*/
             otaAgent.OtaAppCallback( OtaJobEventProcessed, ( const void * ) pEventMsg->pEventData );
@@ -2502,6 +4699,90 @@ static void handleUnexpectedEvents( const OtaEventMsg_t * pEventMsg )
     }
 }
 
+/*
+ * The job document of the active job is sent again while the file is transferred, for
+ * example by notify-next after the job status is updated, or as the answer to the job
+ * request that refreshes the pre-signed url. It does not change the update, so it is
+ * acknowledged without aborting the transfer or starting it over. An unchanged copy is
+ * recognized from its bytes, a copy with other execution fields or another url from its
+ * fingerprint. The transfer waiting for a fresh url continues from the url of the copy.
+ */
+static bool ignoreActiveJobDoc( const OtaEventMsg_t * pEventMsg )
+{
+    bool ignore = false;
+    JsonDocModel_t otaJobDocModel;
+    uint32_t fingerprint = 0;
+    OtaEventMsg_t eventMsg = { 0 };
+
+    if( ( pEventMsg->eventId == OtaAgentEventReceivedJobDocument ) &&
+        ( pEventMsg->pEventData != NULL ) &&
+        ( activeJobFingerprint != 0U ) &&
+        ( otaAgent.fileContext.pFile != NULL ) )
+    {
+        if( isActiveJobDocCopy( pEventMsg->pEventData ) == true )
+        {
+            ignore = true;
+        }
+        else if( ( initDocModel( &otaJobDocModel,
+                                 otaJobDocModelParamStructure,
+                                 &otaJobDocKeyTable,
+                                 ( void * ) &( otaAgent.fileContext ),
+                                 ( uint32_t ) sizeof( OtaFileContext_t ),
+                                 OTA_NUM_JOB_PARAMS ) == DocParseErrNone ) &&
+                 ( fingerprintJobDoc( ( const char * ) pEventMsg->pEventData->data,
+                                      pEventMsg->pEventData->dataLength,
+                                      &otaJobDocModel,
+                                      &fingerprint ) == DocParseErrNone ) &&
+                 ( isActiveJobDoc( fingerprint ) == true ) )
+        {
+            if( otaAgent.state != OtaAgentStateWaitingForJob )
+            {
+                /* The data interface still uses the url of the active job. */
+                ignore = true;
+            }
+            else if( updateActiveJobUrl( &otaJobDocModel ) == DocParseErrNone )
+            {
+                ignore = true;
+
+                /* Further copies of this job document are recognized from their bytes. */
+                activeJobDocHash = hashJsonKey( OTA_FNV_OFFSET_BASIS,
+                                                ( const char * ) pEventMsg->pEventData->data,
+                                                ( size_t ) pEventMsg->pEventData->dataLength );
+                activeJobDocLength = pEventMsg->pEventData->dataLength;
+            }
+            else
+            {
+                /* The url does not fit, the job document is processed like a new one. */
+            }
+        }
+        else
+        {
+            /* Not a job document of the active job, it is processed in the current state. */
+        }
+    }
+
+    if( ignore == true )
+    {
+        LogInfo( ( "Job document is identical to the active job: Continuing the transfer." ) );
+
+        /* Let the application know to release buffer.*/
+        otaAgent.OtaAppCallback( OtaJobEventProcessed, ( const void * ) pEventMsg->pEventData );
+
+        if( otaAgent.state == OtaAgentStateWaitingForJob )
+        {
+            /* The transfer waits for the job document with a fresh url. */
+            eventMsg.eventId = OtaAgentEventContinueTransfer;
+
+            if( OTA_SignalEvent( &eventMsg ) == false )
+            {
+                LogError( ( "Failed to continue the transfer: Unable to signal event." ) );
+            }
+        }
+    }
+
+    return ignore;
+}
+
 /*
  * Execute the handler for selected index from the transition table.
  */
@@ -2575,7 +4856,8 @@ void otaAgentTask( void * pUnused )
         /*
          * Receive the next event form the OTA event queue to process.
          */
-        if( otaAgent.pOtaInterface->os.event.recv( NULL, &eventMsg, 0 ) == OtaOsSuccess )
+        if( ( otaAgent.pOtaInterface->os.event.recv( NULL, &eventMsg, 0 ) == OtaOsSuccess ) &&
+            ( ignoreActiveJobDoc( &eventMsg ) == false ) )
         {
             /*
              * Search transition index if available in the table.
@@ -2613,7 +4895,9 @@ bool OTA_SignalEvent( const OtaEventMsg_t * const pEventMsg )
     OtaOsStatus_t err = OtaOsSuccess;
 
     /* Check if file block received and update statistics.*/
-    if( pEventMsg->eventId == OtaAgentEventReceivedFileBlock )
+    if( ( pEventMsg->eventId == OtaAgentEventReceivedFileBlock ) ||
+        ( pEventMsg->eventId == OtaAgentEventReceivedFileChunk ) ||
+        ( pEventMsg->eventId == OtaAgentEventFileChunkWritten ) )
     {
         otaAgent.statistics.otaPacketsReceived++;
     }
@@ -2625,7 +4909,9 @@ bool OTA_SignalEvent( const OtaEventMsg_t * const pEventMsg )
         retVal = true;
         LogDebug( ( "Added event message to OTA event queue." ) );
 
-        if( pEventMsg->eventId == OtaAgentEventReceivedFileBlock )
+        if( ( pEventMsg->eventId == OtaAgentEventReceivedFileBlock ) ||
+            ( pEventMsg->eventId == OtaAgentEventReceivedFileChunk ) ||
+            ( pEventMsg->eventId == OtaAgentEventFileChunkWritten ) )
         {
             otaAgent.statistics.otaPacketsQueued++;
         }
@@ -2638,7 +4924,9 @@ bool OTA_SignalEvent( const OtaEventMsg_t * const pEventMsg )
                     "OtaOsStatus_t=%s",
                     OTA_OsStatus_strerror( err ) ) );
 
-        if( pEventMsg->eventId == OtaAgentEventReceivedFileBlock )
+        if( ( pEventMsg->eventId == OtaAgentEventReceivedFileBlock ) ||
+            ( pEventMsg->eventId == OtaAgentEventReceivedFileChunk ) ||
+            ( pEventMsg->eventId == OtaAgentEventFileChunkWritten ) )
         {
             otaAgent.statistics.otaPacketsDropped++;
         }
@@ -2792,6 +5080,18 @@ OtaErr_t OTA_Init( OtaAppBuffer_t * pOtaBuffer,
          */
         otaAgent.imageState = OtaImageStateUnknown;
 
+        /*
+         * Load the data protocol measured fastest before the reboot, if it was stored.
+         */
+        ( void ) memset( &dataProbe, 0, sizeof( dataProbe ) );
+        ( void ) memset( &dataProbeResult, 0, sizeof( dataProbeResult ) );
+
+        if( ( otaAgent.pOtaInterface->pal.loadProbeResult != NULL ) &&
+            ( OTA_PAL_MAIN_ERR( otaAgent.pOtaInterface->pal.loadProbeResult( &dataProbeResult ) ) != OtaPalSuccess ) )
+        {
+            ( void ) memset( &dataProbeResult, 0, sizeof( dataProbeResult ) );
+        }
+
         /*
          * Initialize OTA event interface.
          */
@@ -2900,6 +5200,83 @@ OtaState_t OTA_GetState( void )
     return otaAgent.state;
 }
 
+/*
+ * Register the custom job callback with the values found in the job document.
+ */
+void OTA_SetCustomJobDocCallback( OtaCustomJobDocCallback_t customJobDocCallback )
+{
+    otaAgent.customJobDocCallback = customJobDocCallback;
+}
+
+/*
+ * Get the value of a key of the job document model with one lookup in the hash table of
+ * the model. Only a key path that ends at a parameter of the model has a value.
+ */
+bool OTA_GetJobDocValue( const OtaJobDocView_t * pDocView,
+                         const char * pKey,
+                         const char ** pValue,
+                         size_t * pValueLength )
+{
+    const JsonKeyTable_t * pKeyTable = NULL;
+    const JsonDocParam_t * pBodyDef = NULL;
+    const JsonDocSpan_t * pValueSpans = NULL;
+    const JsonKeyPath_t * pKeyPath = NULL;
+    uint32_t matches = 0;
+    uint32_t hash = 0;
+    uint8_t slot = 0;
+    uint16_t paramIndex = 0;
+    size_t keyLength = 0;
+
+    if( ( pDocView != NULL ) && ( pDocView->pKeyTable != NULL ) && ( pDocView->pParams != NULL ) &&
+        ( pDocView->pSpans != NULL ) && ( pKey != NULL ) && ( pValue != NULL ) && ( pValueLength != NULL ) )
+    {
+        pKeyTable = ( const JsonKeyTable_t * ) pDocView->pKeyTable;
+        pBodyDef = ( const JsonDocParam_t * ) pDocView->pParams;
+        pValueSpans = ( const JsonDocSpan_t * ) pDocView->pSpans;
+        keyLength = strlen( pKey );
+        hash = hashJsonKey( OTA_FNV_OFFSET_BASIS, pKey, keyLength );
+        slot = pKeyTable->slots[ OTA_JSON_KEY_SLOT( hash, pKeyTable->multiplier ) ];
+
+        if( slot != 0U )
+        {
+            pKeyPath = &( pKeyTable->keyPaths[ slot - 1U ] );
+
+            if( ( pKeyPath->hash == hash ) &&
+                ( ( ( size_t ) pKeyPath->keyOffset + pKeyPath->keyLength ) == keyLength ) &&
+                ( strncmp( pBodyDef[ pKeyPath->paramIndex ].pSrcKey, pKey, keyLength ) == 0 ) )
+            {
+                matches = pKeyPath->matches;
+            }
+        }
+
+        if( matches == 0U )
+        {
+            matches = matchDynamicJsonKey( pKeyTable,
+                                           pBodyDef,
+                                           pDocView->numParams,
+                                           allModelParams( pDocView->numParams ),
+                                           pKey,
+                                           keyLength );
+        }
+
+        matches &= pDocView->spansFound;
+    }
+
+    if( matches != 0U )
+    {
+        /* Parameters with the same key have the same value, take the first one. */
+        while( ( matches & ( ( uint32_t ) 1U << paramIndex ) ) == 0U )
+        {
+            paramIndex++;
+        }
+
+        *pValue = pValueSpans[ paramIndex ].pValue;
+        *pValueLength = pValueSpans[ paramIndex ].valueLength;
+    }
+
+    return matches != 0U;
+}
+
 /*
  * Return the details of the packets received.
  */
@@ -3205,6 +5582,14 @@ const char * OTA_Err_strerror( OtaErr_t err )
             str = "OtaErrActivateFailed";
             break;
 
+        case OtaErrUrlExpired:
+            str = "OtaErrUrlExpired";
+            break;
+
+        case OtaErrStaleFileBlock:
+            str = "OtaErrStaleFileBlock";
+            break;
+
         default:
             str = "InvalidErrorCode";
     }
@@ -25,7 +25,7 @@
 
 /**
  * @file ota_base64.c
- * @brief Implements a Base64 decoding routine.
+ * @brief Implements Base64 decoding and encoding routines.
  */
 
 #include "ota_base64_private.h"
@@ -109,6 +109,16 @@
  */
 #define BASE64_INDEX_VALUE_UPPER_BOUND           63U
 
+/**
+ * @brief Number of bytes of data encoded into four Base64 symbols.
+ */
+#define NUM_OCTETS_PER_BASE64_BLOCK              3U
+
+/**
+ * @brief The Base64 symbols, indexed by their Base64 index.
+ */
+static const uint8_t pBase64IndexToSymbolMap[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
 /**
  * @brief This table takes is indexed by an Ascii character and returns the respective Base64 index.
  *        The Ascii character used to index into this table is assumed to represent a symbol in a
@@ -404,9 +414,267 @@ static Base64Status_t decodeBase64IndexBuffer( uint32_t * pBase64IndexBuffer,
     return returnVal;
 }
 
+/**
+ * @brief         Count the groups of four Base64 digits at the start of the
+ *                encoded data. This is the validation pass of the decoding
+ *                of four symbols at a time: a group with a formatting symbol,
+ *                padding or an invalid symbol ends the count.
+ *
+ * @param[in]     pEncodedData Pointer to the encoded data.
+ * @param[in]     maxNumGroups Maximum number of groups to count, no more
+ *                than fit in the encoded data and in the output buffer.
+ *
+ * @return        Number of groups of four Base64 digits.
+ */
+static size_t countBase64DigitGroups( const uint8_t * pEncodedData,
+                                      size_t maxNumGroups )
+{
+    size_t numGroups = 0;
+    const uint8_t * pGroup = pEncodedData;
+
+    assert( pEncodedData != NULL );
+
+    /* The indexes of the formatting and invalid symbols are above 63 and all have the 64 bit set,
+     * so a group is only Base64 digits when the bitwise or of its indexes is at most 63. */
+    while( ( numGroups < maxNumGroups ) &&
+           ( ( pBase64SymbolToIndexMap[ pGroup[ 0 ] ] |
+               pBase64SymbolToIndexMap[ pGroup[ 1 ] ] |
+               pBase64SymbolToIndexMap[ pGroup[ 2 ] ] |
+               pBase64SymbolToIndexMap[ pGroup[ 3 ] ] ) <= VALID_BASE64_SYMBOL_INDEX_RANGE_MAX ) )
+    {
+        ++numGroups;
+        pGroup = &pGroup[ MAX_NUM_BASE64_DATA ];
+    }
+
+    return numGroups;
+}
+
+/**
+ * @brief         Decode groups of four Base64 digits into three octets each.
+ *
+ * @param[out]    pDest Pointer to a buffer for storing the decoded data, with
+ *                room for three octets per group.
+ * @param[in]     pEncodedData Pointer to the groups of Base64 digits, as
+ *                counted by countBase64DigitGroups.
+ * @param[in]     numGroups Number of groups to decode.
+ */
+static void decodeBase64DigitGroups( uint8_t * pDest,
+                                     const uint8_t * pEncodedData,
+                                     size_t numGroups )
+{
+    size_t groupIndex = 0;
+    const uint8_t * pGroup = pEncodedData;
+    uint8_t * pOctets = pDest;
+    uint32_t base64IndexBuffer;
+
+    assert( pDest != NULL );
+    assert( pEncodedData != NULL );
+
+    for( groupIndex = 0; groupIndex < numGroups; groupIndex++ )
+    {
+        base64IndexBuffer = ( ( uint32_t ) pBase64SymbolToIndexMap[ pGroup[ 0 ] ] << ( 3 * SEXTET_SIZE ) ) |
+                            ( ( uint32_t ) pBase64SymbolToIndexMap[ pGroup[ 1 ] ] << ( 2 * SEXTET_SIZE ) ) |
+                            ( ( uint32_t ) pBase64SymbolToIndexMap[ pGroup[ 2 ] ] << SEXTET_SIZE ) |
+                            ( uint32_t ) pBase64SymbolToIndexMap[ pGroup[ 3 ] ];
+
+        pOctets[ 0 ] = ( uint8_t ) ( base64IndexBuffer >> SIZE_OF_TWO_OCTETS );
+        pOctets[ 1 ] = ( uint8_t ) ( base64IndexBuffer >> SIZE_OF_ONE_OCTET );
+        pOctets[ 2 ] = ( uint8_t ) base64IndexBuffer;
+
+        pGroup = &pGroup[ MAX_NUM_BASE64_DATA ];
+        pOctets = &pOctets[ NUM_OCTETS_PER_BASE64_BLOCK ];
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+Base64Status_t base64DecodeInit( Base64DecodeContext_t * pContext )
+{
+    Base64Status_t returnVal = Base64Success;
+
+    if( pContext == NULL )
+    {
+        returnVal = Base64NullPointerInput;
+    }
+    else
+    {
+        pContext->base64IndexBuffer = 0;
+        pContext->numDataInBuffer = 0;
+        pContext->numPadding = 0;
+        pContext->numWhitespace = 0;
+        pContext->encodedLen = 0;
+    }
+
+    return returnVal;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Groups of four Base64 digits that start where the previous symbols have been
+ * decoded are decoded four symbols at a time. Formatting symbols, padding and
+ * invalid symbols are decoded one symbol at a time, which reports the errors.
+ */
+Base64Status_t base64DecodeUpdate( Base64DecodeContext_t * pContext,
+                                   uint8_t * pDest,
+                                   const size_t destLen,
+                                   size_t * pResultLen,
+                                   const uint8_t * pEncodedData,
+                                   const size_t encodedLen )
+{
+    uint32_t base64IndexBuffer = 0;
+    uint32_t numDataInBuffer = 0;
+    const uint8_t * pCurrBase64Symbol = pEncodedData;
+    size_t outputLen = 0;
+    size_t numGroups = 0;
+    size_t maxNumGroups = 0;
+    int64_t numPadding = 0;
+    int64_t numWhitespace = 0;
+    Base64Status_t returnVal = Base64Success;
+
+    if( ( pContext == NULL ) || ( pEncodedData == NULL ) || ( pDest == NULL ) || ( pResultLen == NULL ) )
+    {
+        returnVal = Base64NullPointerInput;
+    }
+    else
+    {
+        /* Continue from the symbols of the previous calls. */
+        base64IndexBuffer = pContext->base64IndexBuffer;
+        numDataInBuffer = pContext->numDataInBuffer;
+        numPadding = pContext->numPadding;
+        numWhitespace = pContext->numWhitespace;
+    }
+
+    while( ( returnVal == Base64Success ) &&
+           ( pCurrBase64Symbol < ( pEncodedData + encodedLen ) ) )
+    {
+        uint8_t base64Index = 0;
+        uint8_t base64AsciiSymbol = 0;
+
+        /* Where the buffer is empty and no whitespace or padding has been parsed, every symbol
+         * of a group of Base64 digits would be valid and the group would fill the buffer, so the
+         * groups that fit in the output are decoded four symbols at a time. */
+        if( ( numDataInBuffer == 0U ) && ( numPadding == 0 ) && ( numWhitespace == 0 ) )
+        {
+            maxNumGroups = ( size_t ) ( ( pEncodedData + encodedLen ) - pCurrBase64Symbol ) / MAX_NUM_BASE64_DATA;
+
+            if( ( ( destLen - outputLen ) / NUM_OCTETS_PER_BASE64_BLOCK ) < maxNumGroups )
+            {
+                maxNumGroups = ( destLen - outputLen ) / NUM_OCTETS_PER_BASE64_BLOCK;
+            }
+
+            numGroups = countBase64DigitGroups( pCurrBase64Symbol, maxNumGroups );
+            decodeBase64DigitGroups( &pDest[ outputLen ], pCurrBase64Symbol, numGroups );
+            pCurrBase64Symbol = &pCurrBase64Symbol[ numGroups * MAX_NUM_BASE64_DATA ];
+            outputLen += numGroups * NUM_OCTETS_PER_BASE64_BLOCK;
+        }
+
+        if( pCurrBase64Symbol < ( pEncodedData + encodedLen ) )
+        {
+            /* Read in the next Ascii character that represents the current Base64 symbol. */
+            base64AsciiSymbol = *pCurrBase64Symbol++;
+            /* Get the Base64 index that represents the Base64 symbol. */
+            base64Index = pBase64SymbolToIndexMap[ base64AsciiSymbol ];
+
+            /* Validate the input and update counters for padding and whitespace. */
+            returnVal = preprocessBase64Index( base64Index,
+                                               &numPadding,
+                                               &numWhitespace );
+
+            if( returnVal == Base64Success )
+            {
+                /* Add the current Base64 index to a buffer. */
+                updateBase64DecodingBuffer( base64Index,
+                                            &base64IndexBuffer,
+                                            &numDataInBuffer );
+
+                /* Decode the buffer when it's full and store the result. */
+                if( numDataInBuffer == MAX_NUM_BASE64_DATA )
+                {
+                    returnVal = decodeBase64IndexBuffer( &base64IndexBuffer,
+                                                         &numDataInBuffer,
+                                                         pDest,
+                                                         destLen,
+                                                         &outputLen );
+                }
+            }
+        }
+    }
+
+    if( returnVal == Base64Success )
+    {
+        /* Keep the symbols that do not make a full group for the next calls. */
+        pContext->base64IndexBuffer = base64IndexBuffer;
+        pContext->numDataInBuffer = numDataInBuffer;
+        pContext->numPadding = numPadding;
+        pContext->numWhitespace = numWhitespace;
+        pContext->encodedLen += encodedLen;
+        *pResultLen = outputLen;
+    }
+
+    return returnVal;
+}
+
+/*-----------------------------------------------------------*/
+
+Base64Status_t base64DecodeFinal( Base64DecodeContext_t * pContext,
+                                  uint8_t * pDest,
+                                  const size_t destLen,
+                                  size_t * pResultLen )
+{
+    size_t outputLen = 0;
+    Base64Status_t returnVal = Base64Success;
+
+    if( ( pContext == NULL ) || ( pDest == NULL ) || ( pResultLen == NULL ) )
+    {
+        returnVal = Base64NullPointerInput;
+    }
+    else if( pContext->encodedLen < MIN_VALID_ENCODED_DATA_SIZE )
+    {
+        returnVal = Base64InvalidInputSize;
+    }
+
+    /* This scenario is only possible when the number of encoded symbols ( excluding newlines
+     * and padding ) being decoded mod four is equal to one. There is no valid scenario where
+     * data can be encoded to create a result of this size. Therefore if this size is
+     * encountered, it's assumed that the incoming Base64 data is not encoded correctly. */
+    else if( pContext->numDataInBuffer == 1U )
+    {
+        returnVal = Base64InvalidInputSize;
+    }
+
+    /* Handle the scenarios where there is padding at the end of the encoded data.
+     *
+     * Note: This implementation assumes that non-zero padding bits are an error. This prevents
+     * having multiple non-matching encoded data strings map to identical decoded strings. */
+    else if( ( pContext->numDataInBuffer == 2U ) || ( pContext->numDataInBuffer == 3U ) )
+    {
+        returnVal = decodeBase64IndexBuffer( &pContext->base64IndexBuffer,
+                                             &pContext->numDataInBuffer,
+                                             pDest,
+                                             destLen,
+                                             &outputLen );
+    }
+    else
+    {
+        /* No symbols left to decode. */
+    }
+
+    if( returnVal == Base64Success )
+    {
+        *pResultLen = outputLen;
+    }
+
+    return returnVal;
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Decode Base64 encoded data.
  *
+ * All of the encoded data is decoded with one update of a decoding context.
+ *
  * @param[out] pDest Pointer to a buffer for storing the decoded result.
  * @param[in]  destLen Length of the pDest buffer.
  * @param[out] pResultLen Pointer to the length of the decoded result.
@@ -426,12 +694,9 @@ Base64Status_t base64Decode( uint8_t * pDest,
                              const uint8_t * pEncodedData,
                              const size_t encodedLen )
 {
-    uint32_t base64IndexBuffer = 0;
-    uint32_t numDataInBuffer = 0;
-    const uint8_t * pCurrBase64Symbol = pEncodedData;
+    Base64DecodeContext_t context;
     size_t outputLen = 0;
-    int64_t numPadding = 0;
-    int64_t numWhitespace = 0;
+    size_t finalLen = 0;
     Base64Status_t returnVal = Base64Success;
 
     if( ( pEncodedData == NULL ) || ( pDest == NULL ) || ( pResultLen == NULL ) )
@@ -444,72 +709,88 @@ Base64Status_t base64Decode( uint8_t * pDest,
         returnVal = Base64InvalidInputSize;
     }
 
-    /* This loop will decode the first (encodedLen - (encodedLen % 4)) amount of data. */
-    while( ( returnVal == Base64Success ) &&
-           ( pCurrBase64Symbol < ( pEncodedData + encodedLen ) ) )
+    if( returnVal == Base64Success )
     {
-        uint8_t base64Index = 0;
-        /* Read in the next Ascii character that represents the current Base64 symbol. */
-        uint8_t base64AsciiSymbol = *pCurrBase64Symbol++;
-        /* Get the Base64 index that represents the Base64 symbol. */
-        base64Index = pBase64SymbolToIndexMap[ base64AsciiSymbol ];
+        ( void ) base64DecodeInit( &context );
+        returnVal = base64DecodeUpdate( &context,
+                                        pDest,
+                                        destLen,
+                                        &outputLen,
+                                        pEncodedData,
+                                        encodedLen );
+    }
 
-        /* Validate the input and update counters for padding and whitespace. */
-        returnVal = preprocessBase64Index( base64Index,
-                                           &numPadding,
-                                           &numWhitespace );
+    if( returnVal == Base64Success )
+    {
+        returnVal = base64DecodeFinal( &context,
+                                       &pDest[ outputLen ],
+                                       destLen - outputLen,
+                                       &finalLen );
+    }
 
-        if( returnVal != Base64Success )
-        {
-            break;
-        }
+    if( returnVal == Base64Success )
+    {
+        *pResultLen = outputLen + finalLen;
+    }
 
-        /* Add the current Base64 index to a buffer. */
-        updateBase64DecodingBuffer( base64Index,
-                                    &base64IndexBuffer,
-                                    &numDataInBuffer );
+    return returnVal;
+}
 
-        /* Decode the buffer when it's full and store the result. */
-        if( numDataInBuffer == MAX_NUM_BASE64_DATA )
-        {
-            returnVal = decodeBase64IndexBuffer( &base64IndexBuffer,
-                                                 &numDataInBuffer,
-                                                 pDest,
-                                                 destLen,
-                                                 &outputLen );
-        }
-    }
+/*-----------------------------------------------------------*/
 
-    if( returnVal == Base64Success )
+Base64Status_t base64Encode( uint8_t * pDest,
+                             const size_t destLen,
+                             size_t * pResultLen,
+                             const uint8_t * pData,
+                             const size_t dataLen )
+{
+    Base64Status_t returnVal = Base64Success;
+    size_t encodedLen = 0;
+    size_t inputIndex = 0;
+    size_t outputLen = 0;
+    uint32_t octets = 0;
+
+    if( ( pData == NULL ) || ( pDest == NULL ) || ( pResultLen == NULL ) )
     {
-        /* This scenario is only possible when the number of encoded symbols ( excluding newlines
-         * and padding ) being decoded mod four is equal to one. There is no valid scenario where
-         * data can be encoded to create a result of this size. Therefore if this size is
-         * encountered, it's assumed that the incoming Base64 data is not encoded correctly. */
-        if( numDataInBuffer == 1U )
+        returnVal = Base64NullPointerInput;
+    }
+    else
+    {
+        /* Every three bytes of data, or less at the end, are encoded into four symbols. */
+        encodedLen = ( ( dataLen + ( NUM_OCTETS_PER_BASE64_BLOCK - 1U ) ) / NUM_OCTETS_PER_BASE64_BLOCK ) * MAX_NUM_BASE64_DATA;
+
+        if( destLen < encodedLen )
         {
-            returnVal = Base64InvalidInputSize;
+            returnVal = Base64InvalidBufferSize;
         }
     }
 
     if( returnVal == Base64Success )
     {
-        /* Handle the scenarios where there is padding at the end of the encoded data.
-         *
-         * Note: This implementation assumes that non-zero padding bits are an error. This prevents
-         * having multiple non-matching encoded data strings map to identical decoded strings. */
-        if( ( numDataInBuffer == 2U ) || ( numDataInBuffer == 3U ) )
+        for( inputIndex = 0; inputIndex < dataLen; inputIndex += NUM_OCTETS_PER_BASE64_BLOCK )
         {
-            returnVal = decodeBase64IndexBuffer( &base64IndexBuffer,
-                                                 &numDataInBuffer,
-                                                 pDest,
-                                                 destLen,
-                                                 &outputLen );
+            /* Pack the next three bytes, zero filling past the end of the data. */
+            octets = ( uint32_t ) pData[ inputIndex ] << SIZE_OF_TWO_OCTETS;
+
+            if( ( inputIndex + 1U ) < dataLen )
+            {
+                octets |= ( uint32_t ) pData[ inputIndex + 1U ] << SIZE_OF_ONE_OCTET;
+            }
+
+            if( ( inputIndex + 2U ) < dataLen )
+            {
+                octets |= ( uint32_t ) pData[ inputIndex + 2U ];
+            }
+
+            pDest[ outputLen ] = pBase64IndexToSymbolMap[ ( octets >> ( 3 * SEXTET_SIZE ) ) & BASE64_INDEX_VALUE_UPPER_BOUND ];
+            pDest[ outputLen + 1U ] = pBase64IndexToSymbolMap[ ( octets >> ( 2 * SEXTET_SIZE ) ) & BASE64_INDEX_VALUE_UPPER_BOUND ];
+            pDest[ outputLen + 2U ] = ( ( inputIndex + 1U ) < dataLen ) ?
+                                      pBase64IndexToSymbolMap[ ( octets >> SEXTET_SIZE ) & BASE64_INDEX_VALUE_UPPER_BOUND ] : ( uint8_t ) '=';
+            pDest[ outputLen + 3U ] = ( ( inputIndex + 2U ) < dataLen ) ?
+                                      pBase64IndexToSymbolMap[ octets & BASE64_INDEX_VALUE_UPPER_BOUND ] : ( uint8_t ) '=';
+            outputLen += MAX_NUM_BASE64_DATA;
         }
-    }
 
-    if( returnVal == Base64Success )
-    {
         *pResultLen = outputLen;
     }
 
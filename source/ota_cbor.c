@@ -29,6 +29,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "cbor.h"
 #include "ota_cbor_private.h"
 
@@ -37,6 +38,36 @@
  */
 #define OTA_CBOR_GETSTREAMREQUEST_ITEM_COUNT    6
 
+/**
+ * @brief Bits of the keys found in a Get Stream response map.
+ */
+#define OTA_CBOR_FILEID_FOUND                 0x1U
+#define OTA_CBOR_BLOCKID_FOUND                0x2U
+#define OTA_CBOR_BLOCKSIZE_FOUND              0x4U
+#define OTA_CBOR_BLOCKPAYLOAD_FOUND           0x8U
+#define OTA_CBOR_STREAMRESPONSE_KEYS_FOUND    0xfU
+
+/**
+ * @brief Heads of the Get Stream response in the layout of the service.
+ */
+#define OTA_CBOR_STREAMRESPONSE_MAP_HEAD     0xa4U /*!< Map of 4 pairs. */
+#define OTA_CBOR_ONE_LETTER_KEY_HEAD         0x61U /*!< Text string of 1 byte. */
+#define OTA_CBOR_STREAMRESPONSE_INT_COUNT    3U    /*!< File ID, block ID and block size. */
+
+/**
+ * @brief Fields of the initial byte of a CBOR data item (RFC 8949).
+ */
+#define OTA_CBOR_MAJOR_TYPE_SHIFT            5U
+#define OTA_CBOR_ADDITIONAL_INFO_MASK        0x1fU
+#define OTA_CBOR_MAJOR_TYPE_UNSIGNED         0U
+#define OTA_CBOR_MAJOR_TYPE_NEGATIVE         1U
+#define OTA_CBOR_MAJOR_TYPE_BYTE_STRING      2U
+#define OTA_CBOR_MAJOR_TYPE_TEXT_STRING      3U
+#define OTA_CBOR_MAJOR_TYPE_MAP              5U
+#define OTA_CBOR_ARGUMENT_1_BYTE             24U
+#define OTA_CBOR_ARGUMENT_2_BYTES            25U
+#define OTA_CBOR_ARGUMENT_4_BYTES            26U
+
 /* ========================================================================== */
 
 /**
@@ -60,6 +91,117 @@ static CborError checkDataType( CborType expectedType,
     return cborResult;
 }
 
+/**
+ * @brief Helper function to decode an integer value of a map.
+ *
+ * @param[in] pCborMap Map to find the value in.
+ * @param[in] pKey Key of the value.
+ * @param[out] pValue Decoded value.
+ * @return CborError
+ */
+static CborError decodeIntValue( const CborValue * pCborMap,
+                                 const char * pKey,
+                                 int32_t * pValue )
+{
+    CborError cborResult = CborNoError;
+    CborValue cborValue;
+
+    cborResult = cbor_value_map_find_value( pCborMap,
+                                            pKey,
+                                            &cborValue );
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = checkDataType( CborIntegerType, &cborValue );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_value_get_int( &cborValue,
+                                         ( int * ) pValue );
+    }
+
+    return cborResult;
+}
+
+/**
+ * @brief Helper function to decode the block ID, size and payload of a block map.
+ *
+ * @param[in] pCborMap Map of the block.
+ * @param[out] pBlockId Decoded block id value.
+ * @param[out] pBlockSize Decoded block size value.
+ * @param[out] pPayload Buffer for the decoded payload.
+ * @param[in,out] pPayloadSize maximum size of the buffer as in and actual
+ * payload size for the decoded payload as out.
+ * @return CborError
+ */
+static CborError decodeBlock( const CborValue * pCborMap,
+                              int32_t * pBlockId,
+                              int32_t * pBlockSize,
+                              uint8_t ** pPayload,
+                              size_t * pPayloadSize )
+{
+    CborError cborResult = CborNoError;
+    CborValue cborValue;
+    size_t payloadSizeReceived = 0;
+
+    /* Find the block ID. */
+    cborResult = decodeIntValue( pCborMap,
+                                 OTA_CBOR_BLOCKID_KEY,
+                                 pBlockId );
+
+    /* Find the block size. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = decodeIntValue( pCborMap,
+                                     OTA_CBOR_BLOCKSIZE_KEY,
+                                     pBlockSize );
+    }
+
+    /* Find the payload bytes. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_value_map_find_value( pCborMap,
+                                                OTA_CBOR_BLOCKPAYLOAD_KEY,
+                                                &cborValue );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = checkDataType( CborByteStringType, &cborValue );
+    }
+
+    /* Calculate the size we need to malloc for the payload. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_value_calculate_string_length( &cborValue,
+                                                         &payloadSizeReceived );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        /* Check if the received payload size is less than or equal to buffer size. */
+        if( payloadSizeReceived <= ( *pPayloadSize ) )
+        {
+            *pPayloadSize = payloadSizeReceived;
+        }
+        else
+        {
+            cborResult = CborErrorOutOfMemory;
+        }
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_value_copy_byte_string( &cborValue,
+                                                  *pPayload,
+                                                  pPayloadSize,
+                                                  NULL );
+    }
+
+    return cborResult;
+}
+
 /**
  * @brief Decode a Get Stream response message from AWS IoT OTA.
  *
@@ -84,8 +226,7 @@ bool OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pMessageBuffer,
 {
     CborError cborResult = CborNoError;
     CborParser cborParser;
-    CborValue cborValue, cborMap;
-    size_t payloadSizeReceived = 0;
+    CborValue cborMap;
 
     if( ( pFileId == NULL ) ||
         ( pBlockId == NULL ) ||
@@ -119,99 +260,601 @@ bool OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pMessageBuffer,
     /* Find the file ID. */
     if( CborNoError == cborResult )
     {
-        cborResult = cbor_value_map_find_value( &cborMap,
-                                                OTA_CBOR_FILEID_KEY,
-                                                &cborValue );
+        cborResult = decodeIntValue( &cborMap,
+                                     OTA_CBOR_FILEID_KEY,
+                                     pFileId );
     }
 
+    /* Find the block ID, size and payload. */
     if( CborNoError == cborResult )
     {
-        cborResult = checkDataType( CborIntegerType, &cborValue );
+        cborResult = decodeBlock( &cborMap,
+                                  pBlockId,
+                                  pBlockSize,
+                                  pPayload,
+                                  pPayloadSize );
     }
 
-    if( CborNoError == cborResult )
+    return CborNoError == cborResult;
+}
+
+/**
+ * @brief Helper function to decode the value of a Get Stream response map
+ * entry into the output field of its key.
+ *
+ * Keys that are not part of a single block response are skipped.
+ *
+ * @param[in] key Key of the entry, the keys of the service are one character.
+ * @param[in] pCborValue Value of the entry.
+ * @param[out] pFileId Decoded file id value.
+ * @param[out] pBlockId Decoded block id value.
+ * @param[out] pBlockSize Decoded block size value.
+ * @param[out] pPayload View of the payload in the message.
+ * @param[out] pPayloadSize Size of the payload.
+ * @param[in,out] pKeysFound Bits of the keys found in the map.
+ * @return CborError
+ */
+static CborError decodeStreamResponseEntry( char key,
+                                            CborValue * pCborValue,
+                                            int32_t * pFileId,
+                                            int32_t * pBlockId,
+                                            int32_t * pBlockSize,
+                                            const uint8_t ** pPayload,
+                                            size_t * pPayloadSize,
+                                            uint32_t * pKeysFound )
+{
+    CborError cborResult = CborNoError;
+    CborValue chunkNext;
+    int32_t * pValue = NULL;
+    uint32_t keyFound = 0;
+
+    if( key == OTA_CBOR_FILEID_KEY[ 0 ] )
     {
-        cborResult = cbor_value_get_int( &cborValue,
-                                         ( int * ) pFileId );
+        pValue = pFileId;
+        keyFound = OTA_CBOR_FILEID_FOUND;
+    }
+    else if( key == OTA_CBOR_BLOCKID_KEY[ 0 ] )
+    {
+        pValue = pBlockId;
+        keyFound = OTA_CBOR_BLOCKID_FOUND;
+    }
+    else if( key == OTA_CBOR_BLOCKSIZE_KEY[ 0 ] )
+    {
+        pValue = pBlockSize;
+        keyFound = OTA_CBOR_BLOCKSIZE_FOUND;
+    }
+    else if( key == OTA_CBOR_BLOCKPAYLOAD_KEY[ 0 ] )
+    {
+        keyFound = OTA_CBOR_BLOCKPAYLOAD_FOUND;
+    }
+    else if( key == OTA_CBOR_BLOCKS_KEY[ 0 ] )
+    {
+        /* The blocks of a response with several blocks are copied by
+         * OTA_CBOR_Decode_GetStreamResponseMessageBlock. */
+        cborResult = CborErrorUnsupportedType;
+    }
+    else
+    {
+        /* Skip the other keys. */
+    }
+
+    if( ( *pKeysFound & keyFound ) != 0U )
+    {
+        cborResult = CborErrorDuplicateObjectKeys;
+    }
+    else if( pValue != NULL )
+    {
+        cborResult = checkDataType( CborIntegerType, pCborValue );
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_value_get_int( pCborValue,
+                                             ( int * ) pValue );
+        }
+    }
+    else if( keyFound == OTA_CBOR_BLOCKPAYLOAD_FOUND )
+    {
+        cborResult = checkDataType( CborByteStringType, pCborValue );
+
+        /* A string that is not chunked is one piece of the message. */
+        if( ( CborNoError == cborResult ) && ( false == cbor_value_is_length_known( pCborValue ) ) )
+        {
+            cborResult = CborErrorUnknownLength;
+        }
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_value_get_byte_string_chunk( pCborValue,
+                                                           pPayload,
+                                                           pPayloadSize,
+                                                           &chunkNext );
+        }
+    }
+    else
+    {
+        /* Nothing to decode. */
     }
 
-    /* Find the block ID. */
     if( CborNoError == cborResult )
     {
-        cborResult = cbor_value_map_find_value( &cborMap,
-                                                OTA_CBOR_BLOCKID_KEY,
-                                                &cborValue );
+        *pKeysFound |= keyFound;
     }
 
+    return cborResult;
+}
+
+/**
+ * @brief Decode a Get Stream response message from AWS IoT OTA in a single
+ * pass over its map, without copying the payload.
+ *
+ * Every key of the map is read once and its value is decoded into the output
+ * field of the key, unlike looking up each key from the start of the map. The
+ * payload is returned as a view into the message buffer, so it is only valid
+ * as long as the message is.
+ *
+ * @param[in] pMessageBuffer message to decode.
+ * @param[in] messageSize size of the message to decode.
+ * @param[out] pFileId Decoded file id value.
+ * @param[out] pBlockId Decoded block id value.
+ * @param[out] pBlockSize Decoded block size value.
+ * @param[out] pPayload View of the payload in the message.
+ * @param[out] pPayloadSize Size of the payload.
+ *
+ * @return TRUE when success, FALSE for a message that is not a single block
+ * response or has a chunked payload.
+ */
+bool OTA_CBOR_Decode_GetStreamResponseMessageView( const uint8_t * pMessageBuffer,
+                                                   size_t messageSize,
+                                                   int32_t * pFileId,
+                                                   int32_t * pBlockId,
+                                                   int32_t * pBlockSize,
+                                                   const uint8_t ** pPayload,
+                                                   size_t * pPayloadSize )
+{
+    CborError cborResult = CborNoError;
+    CborParser cborParser;
+    CborValue cborMap, cborEntry, chunkNext;
+    const char * pKey = NULL;
+    size_t keyLength = 0;
+    uint32_t keysFound = 0;
+
+    if( ( pFileId == NULL ) ||
+        ( pBlockId == NULL ) ||
+        ( pBlockSize == NULL ) ||
+        ( pPayload == NULL ) ||
+        ( pPayloadSize == NULL ) )
+    {
+        cborResult = CborUnknownError;
+    }
+
+    /* Initialize the parser. */
     if( CborNoError == cborResult )
     {
-        cborResult = checkDataType( CborIntegerType, &cborValue );
+        cborResult = cbor_parser_init( pMessageBuffer,
+                                       messageSize,
+                                       0,
+                                       &cborParser,
+                                       &cborMap );
     }
 
     if( CborNoError == cborResult )
     {
-        cborResult = cbor_value_get_int( &cborValue,
-                                         ( int * ) pBlockId );
+        if( false == cbor_value_is_map( &cborMap ) )
+        {
+            cborResult = CborErrorIllegalType;
+        }
     }
 
-    /* Find the block size. */
     if( CborNoError == cborResult )
     {
-        cborResult = cbor_value_map_find_value( &cborMap,
-                                                OTA_CBOR_BLOCKSIZE_KEY,
-                                                &cborValue );
+        cborResult = cbor_value_enter_container( &cborMap,
+                                                 &cborEntry );
+    }
+
+    /* Walk the keys and values of the map once. */
+    while( ( CborNoError == cborResult ) && ( false == cbor_value_at_end( &cborEntry ) ) )
+    {
+        if( ( false == cbor_value_is_text_string( &cborEntry ) ) ||
+            ( false == cbor_value_is_length_known( &cborEntry ) ) )
+        {
+            cborResult = CborErrorMapKeyNotString;
+        }
+        else
+        {
+            cborResult = cbor_value_get_text_string_chunk( &cborEntry,
+                                                           &pKey,
+                                                           &keyLength,
+                                                           &chunkNext );
+        }
+
+        /* Move from the key to its value. */
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_value_advance( &cborEntry );
+        }
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = decodeStreamResponseEntry( ( keyLength == 1U ) ? pKey[ 0 ] : '\0',
+                                                    &cborEntry,
+                                                    pFileId,
+                                                    pBlockId,
+                                                    pBlockSize,
+                                                    pPayload,
+                                                    pPayloadSize,
+                                                    &keysFound );
+        }
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_value_advance( &cborEntry );
+        }
     }
 
     if( CborNoError == cborResult )
     {
-        cborResult = checkDataType( CborIntegerType, &cborValue );
+        if( keysFound != OTA_CBOR_STREAMRESPONSE_KEYS_FOUND )
+        {
+            cborResult = CborErrorTooFewItems;
+        }
+    }
+
+    return CborNoError == cborResult;
+}
+
+/**
+ * @brief Read the head of a CBOR data item with an argument of up to 32 bits.
+ *
+ * @param[in] pMessageBuffer Message to read.
+ * @param[in] messageSize Size of the message.
+ * @param[in,out] pIndex Index of the head, then of the byte after it.
+ * @param[out] pMajorType Major type of the data item.
+ * @param[out] pArgument Argument of the data item.
+ * @return true if the head fits in the message and its argument is not
+ * indefinite or larger than 32 bits.
+ */
+static bool readHeadFast( const uint8_t * pMessageBuffer,
+                          size_t messageSize,
+                          size_t * pIndex,
+                          uint8_t * pMajorType,
+                          uint32_t * pArgument )
+{
+    bool result = false;
+    size_t argumentSize = 0;
+    size_t i = 0;
+    uint8_t additionalInfo = 0;
+    uint32_t argument = 0;
+
+    if( *pIndex < messageSize )
+    {
+        additionalInfo = pMessageBuffer[ *pIndex ] & OTA_CBOR_ADDITIONAL_INFO_MASK;
+
+        if( additionalInfo < OTA_CBOR_ARGUMENT_1_BYTE )
+        {
+            argument = additionalInfo;
+            result = true;
+        }
+        else if( additionalInfo <= OTA_CBOR_ARGUMENT_4_BYTES )
+        {
+            /* The argument follows in 1, 2 or 4 bytes. */
+            argumentSize = ( size_t ) 1U << ( additionalInfo - OTA_CBOR_ARGUMENT_1_BYTE );
+            result = ( argumentSize < ( messageSize - *pIndex ) );
+        }
+        else
+        {
+            /* 8 byte arguments, indefinite lengths and reserved values are left to tinycbor. */
+        }
+    }
+
+    if( result == true )
+    {
+        *pMajorType = ( uint8_t ) ( pMessageBuffer[ *pIndex ] >> OTA_CBOR_MAJOR_TYPE_SHIFT );
+
+        for( i = 1U; i <= argumentSize; i++ )
+        {
+            argument = ( argument << 8U ) | pMessageBuffer[ *pIndex + i ];
+        }
+
+        *pArgument = argument;
+        *pIndex += 1U + argumentSize;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Read a one letter text string key.
+ *
+ * @param[in] pMessageBuffer Message to read.
+ * @param[in] messageSize Size of the message.
+ * @param[in,out] pIndex Index of the key, then of the value after it.
+ * @param[in] key Expected letter of the key.
+ * @return true if the key is the expected one.
+ */
+static bool readKeyFast( const uint8_t * pMessageBuffer,
+                         size_t messageSize,
+                         size_t * pIndex,
+                         char key )
+{
+    bool result = false;
+
+    if( ( ( messageSize - *pIndex ) > 2U ) &&
+        ( pMessageBuffer[ *pIndex ] == OTA_CBOR_ONE_LETTER_KEY_HEAD ) &&
+        ( pMessageBuffer[ *pIndex + 1U ] == ( uint8_t ) key ) )
+    {
+        *pIndex += 2U;
+        result = true;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Read an integer that fits in 32 bits.
+ *
+ * @param[in] pMessageBuffer Message to read.
+ * @param[in] messageSize Size of the message.
+ * @param[in,out] pIndex Index of the integer, then of the byte after it.
+ * @param[out] pValue Value of the integer.
+ * @return true if the value is an integer that fits in 32 bits.
+ */
+static bool readIntFast( const uint8_t * pMessageBuffer,
+                         size_t messageSize,
+                         size_t * pIndex,
+                         int32_t * pValue )
+{
+    bool result = false;
+    uint8_t majorType = 0;
+    uint32_t argument = 0;
+
+    result = readHeadFast( pMessageBuffer, messageSize, pIndex, &majorType, &argument );
+
+    if( ( result == true ) && ( argument <= ( uint32_t ) INT32_MAX ) )
+    {
+        if( majorType == OTA_CBOR_MAJOR_TYPE_UNSIGNED )
+        {
+            *pValue = ( int32_t ) argument;
+        }
+        else if( majorType == OTA_CBOR_MAJOR_TYPE_NEGATIVE )
+        {
+            *pValue = -1 - ( int32_t ) argument;
+        }
+        else
+        {
+            result = false;
+        }
+    }
+    else
+    {
+        result = false;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Decode a Get Stream response message in the layout of the service
+ * without tinycbor.
+ *
+ * The message must be a map of the file ID, block ID, block size and payload
+ * keys in this order, with integers of up to 32 bits and a definite length
+ * payload that ends the message. Any other encoding is left to the decoders
+ * that use tinycbor.
+ *
+ * @param[in] pMessageBuffer message to decode.
+ * @param[in] messageSize size of the message to decode.
+ * @param[out] pFileId Decoded file id value.
+ * @param[out] pBlockId Decoded block id value.
+ * @param[out] pBlockSize Decoded block size value.
+ * @param[out] pPayload View of the payload in the message.
+ * @param[out] pPayloadSize Size of the payload.
+ *
+ * @return TRUE when success, FALSE for a message in another layout.
+ */
+bool OTA_CBOR_Decode_GetStreamResponseMessageFast( const uint8_t * pMessageBuffer,
+                                                   size_t messageSize,
+                                                   int32_t * pFileId,
+                                                   int32_t * pBlockId,
+                                                   int32_t * pBlockSize,
+                                                   const uint8_t ** pPayload,
+                                                   size_t * pPayloadSize )
+{
+    /* Keys of the integer values, in the order of the service. */
+    const char * pIntKeys = OTA_CBOR_FILEID_KEY OTA_CBOR_BLOCKID_KEY OTA_CBOR_BLOCKSIZE_KEY;
+    int32_t intValues[ OTA_CBOR_STREAMRESPONSE_INT_COUNT ] = { 0 };
+    bool result = false;
+    size_t index = 1U;
+    size_t i = 0;
+    uint8_t majorType = 0;
+    uint32_t payloadSize = 0;
+
+    if( ( pMessageBuffer != NULL ) &&
+        ( messageSize > 0U ) &&
+        ( pFileId != NULL ) &&
+        ( pBlockId != NULL ) &&
+        ( pBlockSize != NULL ) &&
+        ( pPayload != NULL ) &&
+        ( pPayloadSize != NULL ) )
+    {
+        result = ( pMessageBuffer[ 0 ] == OTA_CBOR_STREAMRESPONSE_MAP_HEAD );
+    }
+
+    for( i = 0; ( i < OTA_CBOR_STREAMRESPONSE_INT_COUNT ) && ( result == true ); i++ )
+    {
+        result = readKeyFast( pMessageBuffer, messageSize, &index, pIntKeys[ i ] );
+
+        if( result == true )
+        {
+            result = readIntFast( pMessageBuffer, messageSize, &index, &intValues[ i ] );
+        }
+    }
+
+    if( result == true )
+    {
+        result = readKeyFast( pMessageBuffer, messageSize, &index, OTA_CBOR_BLOCKPAYLOAD_KEY[ 0 ] );
+    }
+
+    if( result == true )
+    {
+        result = readHeadFast( pMessageBuffer, messageSize, &index, &majorType, &payloadSize );
+    }
+
+    /* The payload is a byte string that ends the message. */
+    if( result == true )
+    {
+        result = ( majorType == OTA_CBOR_MAJOR_TYPE_BYTE_STRING ) &&
+                 ( payloadSize == ( messageSize - index ) );
     }
 
+    if( result == true )
+    {
+        *pFileId = intValues[ 0 ];
+        *pBlockId = intValues[ 1 ];
+        *pBlockSize = intValues[ 2 ];
+        *pPayload = &pMessageBuffer[ index ];
+        *pPayloadSize = payloadSize;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Decode a block of a Get Stream response message that may carry
+ * several blocks.
+ *
+ * The blocks before blockNumber are skipped without being decoded, so the
+ * payloads of the message are copied once when its blocks are decoded in turn.
+ *
+ * @param[in] pMessageBuffer message to decode.
+ * @param[in] messageSize size of the message to decode.
+ * @param[in] blockNumber Position of the block in the message, from 0.
+ * @param[out] pFileId Decoded file id value.
+ * @param[out] pBlockId Decoded block id value.
+ * @param[out] pBlockSize Decoded block size value.
+ * @param[out] pPayload Buffer for the decoded payload.
+ * @param[in,out] pPayloadSize maximum size of the buffer as in and actual
+ * payload size for the decoded payload as out.
+ * @param[out] pNumBlocks Number of blocks in the message.
+ *
+ * @return TRUE when success, otherwise FALSE.
+ */
+bool OTA_CBOR_Decode_GetStreamResponseMessageBlock( const uint8_t * pMessageBuffer,
+                                                    size_t messageSize,
+                                                    size_t blockNumber,
+                                                    int32_t * pFileId,
+                                                    int32_t * pBlockId,
+                                                    int32_t * pBlockSize,
+                                                    uint8_t ** pPayload,
+                                                    size_t * pPayloadSize,
+                                                    size_t * pNumBlocks )
+{
+    CborError cborResult = CborNoError;
+    CborParser cborParser;
+    CborValue cborMap, cborBlocks, cborBlock;
+    size_t numBlocks = 0;
+    size_t i = 0;
+
+    if( ( pFileId == NULL ) ||
+        ( pBlockId == NULL ) ||
+        ( pBlockSize == NULL ) ||
+        ( pPayload == NULL ) ||
+        ( pPayloadSize == NULL ) ||
+        ( pNumBlocks == NULL ) )
+    {
+        cborResult = CborUnknownError;
+    }
+
+    /* Initialize the parser. */
     if( CborNoError == cborResult )
     {
-        cborResult = cbor_value_get_int( &cborValue,
-                                         ( int * ) pBlockSize );
+        cborResult = cbor_parser_init( pMessageBuffer,
+                                       messageSize,
+                                       0,
+                                       &cborParser,
+                                       &cborMap );
     }
 
-    /* Find the payload bytes. */
     if( CborNoError == cborResult )
     {
-        cborResult = cbor_value_map_find_value( &cborMap,
-                                                OTA_CBOR_BLOCKPAYLOAD_KEY,
-                                                &cborValue );
+        if( false == cbor_value_is_map( &cborMap ) )
+        {
+            cborResult = CborErrorIllegalType;
+        }
     }
 
+    /* Find the file ID, shared by the blocks of the message. */
     if( CborNoError == cborResult )
     {
-        cborResult = checkDataType( CborByteStringType, &cborValue );
+        cborResult = decodeIntValue( &cborMap,
+                                     OTA_CBOR_FILEID_KEY,
+                                     pFileId );
     }
 
-    /* Calculate the size we need to malloc for the payload. */
+    /* Find the array of blocks. */
     if( CborNoError == cborResult )
     {
-        cborResult = cbor_value_calculate_string_length( &cborValue,
-                                                         &payloadSizeReceived );
+        cborResult = cbor_value_map_find_value( &cborMap,
+                                                OTA_CBOR_BLOCKS_KEY,
+                                                &cborBlocks );
     }
 
     if( CborNoError == cborResult )
     {
-        /* Check if the received payload size is less than or equal to buffer size. */
-        if( payloadSizeReceived <= ( *pPayloadSize ) )
+        if( CborInvalidType == cbor_value_get_type( &cborBlocks ) )
         {
-            *pPayloadSize = payloadSizeReceived;
+            /* A response in the format of the service carries one block in its map. */
+            numBlocks = 1;
+            cborBlock = cborMap;
         }
         else
         {
-            cborResult = CborErrorOutOfMemory;
+            cborResult = checkDataType( CborArrayType, &cborBlocks );
+
+            if( CborNoError == cborResult )
+            {
+                cborResult = cbor_value_get_array_length( &cborBlocks,
+                                                          &numBlocks );
+            }
+
+            if( CborNoError == cborResult )
+            {
+                cborResult = cbor_value_enter_container( &cborBlocks,
+                                                         &cborBlock );
+            }
         }
     }
 
     if( CborNoError == cborResult )
     {
-        cborResult = cbor_value_copy_byte_string( &cborValue,
-                                                  *pPayload,
-                                                  pPayloadSize,
-                                                  NULL );
+        if( blockNumber >= numBlocks )
+        {
+            cborResult = CborErrorTooFewItems;
+        }
+    }
+
+    /* Skip the blocks before the requested one. */
+    for( i = 0; ( CborNoError == cborResult ) && ( i < blockNumber ); i++ )
+    {
+        cborResult = cbor_value_advance( &cborBlock );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = checkDataType( CborMapType, &cborBlock );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = decodeBlock( &cborBlock,
+                                  pBlockId,
+                                  pBlockSize,
+                                  pPayload,
+                                  pPayloadSize );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        *pNumBlocks = numBlocks;
     }
 
     return CborNoError == cborResult;
@@ -242,7 +885,7 @@ bool OTA_CBOR_Encode_GetStreamRequestMessage( uint8_t * pMessageBuffer,
                                               int32_t fileId,
                                               int32_t blockSize,
                                               int32_t blockOffset,
-                                              uint8_t * pBlockBitmap,
+                                              const uint8_t * pBlockBitmap,
                                               size_t blockBitmapSize,
                                               int32_t numOfBlocksRequested )
 {
@@ -364,3 +1007,316 @@ bool OTA_CBOR_Encode_GetStreamRequestMessage( uint8_t * pMessageBuffer,
 
     return CborNoError == cborResult;
 }
+
+/**
+ * @brief Write the head of a CBOR data item.
+ *
+ * @param[in,out] pMessageBuffer Buffer of the message.
+ * @param[in] messageBufferSize Size of the buffer.
+ * @param[in,out] pIndex Index of the head, then of the byte after it.
+ * @param[in] majorType Major type of the data item.
+ * @param[in] argument Argument of the data item.
+ * @param[in] fixedWidth true to write the argument in 4 bytes, so that it
+ * can be patched with any other value.
+ * @return true if the head fits in the buffer.
+ */
+static bool writeHead( uint8_t * pMessageBuffer,
+                       size_t messageBufferSize,
+                       size_t * pIndex,
+                       uint8_t majorType,
+                       uint32_t argument,
+                       bool fixedWidth )
+{
+    bool result = false;
+    size_t argumentSize = 4U;
+    uint8_t additionalInfo = OTA_CBOR_ARGUMENT_4_BYTES;
+    size_t i = 0;
+
+    if( fixedWidth == false )
+    {
+        if( argument < OTA_CBOR_ARGUMENT_1_BYTE )
+        {
+            argumentSize = 0U;
+            additionalInfo = ( uint8_t ) argument;
+        }
+        else if( argument <= UINT8_MAX )
+        {
+            argumentSize = 1U;
+            additionalInfo = OTA_CBOR_ARGUMENT_1_BYTE;
+        }
+        else if( argument <= UINT16_MAX )
+        {
+            argumentSize = 2U;
+            additionalInfo = OTA_CBOR_ARGUMENT_2_BYTES;
+        }
+        else
+        {
+            /* Written in 4 bytes. */
+        }
+    }
+
+    if( ( *pIndex < messageBufferSize ) && ( argumentSize < ( messageBufferSize - *pIndex ) ) )
+    {
+        pMessageBuffer[ *pIndex ] = ( uint8_t ) ( ( uint8_t ) ( majorType << OTA_CBOR_MAJOR_TYPE_SHIFT ) | additionalInfo );
+
+        for( i = argumentSize; i > 0U; i-- )
+        {
+            pMessageBuffer[ *pIndex + i ] = ( uint8_t ) argument;
+            argument >>= 8U;
+        }
+
+        *pIndex += 1U + argumentSize;
+        result = true;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Write an integer in 5 bytes, so that it can be patched with any
+ * other value.
+ *
+ * @param[in,out] pMessageBuffer Buffer of the message.
+ * @param[in] messageBufferSize Size of the buffer.
+ * @param[in,out] pIndex Index of the integer, then of the byte after it.
+ * @param[in] value Value of the integer.
+ * @return true if the integer fits in the buffer.
+ */
+static bool writeIntFixed( uint8_t * pMessageBuffer,
+                           size_t messageBufferSize,
+                           size_t * pIndex,
+                           int32_t value )
+{
+    bool result = false;
+
+    if( value < 0 )
+    {
+        /* Negative integers are encoded as -1 - argument. */
+        result = writeHead( pMessageBuffer, messageBufferSize, pIndex, OTA_CBOR_MAJOR_TYPE_NEGATIVE, ( uint32_t ) ( -1 - value ), true );
+    }
+    else
+    {
+        result = writeHead( pMessageBuffer, messageBufferSize, pIndex, OTA_CBOR_MAJOR_TYPE_UNSIGNED, ( uint32_t ) value, true );
+    }
+
+    return result;
+}
+
+/**
+ * @brief Write a string, with its head of major type text or byte string.
+ *
+ * @param[in,out] pMessageBuffer Buffer of the message.
+ * @param[in] messageBufferSize Size of the buffer.
+ * @param[in,out] pIndex Index of the string, then of the byte after it.
+ * @param[in] majorType Major type of the string.
+ * @param[in] pString Bytes of the string, NULL to write zeros.
+ * @param[in] stringSize Size of the string.
+ * @return true if the string fits in the buffer.
+ */
+static bool writeString( uint8_t * pMessageBuffer,
+                         size_t messageBufferSize,
+                         size_t * pIndex,
+                         uint8_t majorType,
+                         const void * pString,
+                         size_t stringSize )
+{
+    bool result = false;
+
+    if( stringSize <= UINT32_MAX )
+    {
+        result = writeHead( pMessageBuffer, messageBufferSize, pIndex, majorType, ( uint32_t ) stringSize, false );
+    }
+
+    if( ( result == true ) && ( stringSize <= ( messageBufferSize - *pIndex ) ) )
+    {
+        if( pString != NULL )
+        {
+            ( void ) memcpy( &pMessageBuffer[ *pIndex ], pString, stringSize );
+        }
+        else
+        {
+            ( void ) memset( &pMessageBuffer[ *pIndex ], 0, stringSize );
+        }
+
+        *pIndex += stringSize;
+    }
+    else
+    {
+        result = false;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Write a key of the Get Stream request followed by an integer in 5 bytes.
+ *
+ * @param[in,out] pMessageBuffer Buffer of the message.
+ * @param[in] messageBufferSize Size of the buffer.
+ * @param[in,out] pIndex Index of the key, then of the byte after the value.
+ * @param[in] pKey Key of the integer.
+ * @param[out] pValueIndex Index of the integer.
+ * @param[in] value Value of the integer.
+ * @return true if the key and integer fit in the buffer.
+ */
+static bool writeIntEntry( uint8_t * pMessageBuffer,
+                           size_t messageBufferSize,
+                           size_t * pIndex,
+                           const char * pKey,
+                           size_t * pValueIndex,
+                           int32_t value )
+{
+    bool result = false;
+
+    result = writeString( pMessageBuffer, messageBufferSize, pIndex, OTA_CBOR_MAJOR_TYPE_TEXT_STRING, pKey, strlen( pKey ) );
+
+    if( result == true )
+    {
+        *pValueIndex = *pIndex;
+        result = writeIntFixed( pMessageBuffer, messageBufferSize, pIndex, value );
+    }
+
+    return result;
+}
+
+/**
+ * @brief Encode the template of the Get Stream Request messages of a file
+ * transfer.
+ *
+ * The block offset and the number of blocks requested are encoded in 5 bytes
+ * and the block bitmap as a byte string of blockBitmapSize zeros, so that
+ * OTA_CBOR_Patch_GetStreamRequestMessage can write them in place.
+ *
+ * @param[in,out] pMessageBuffer Buffer to store the encoded template.
+ * @param[in] messageBufferSize Size of the buffer to store the encoded template.
+ * @param[out] pRequest Positions of the fields in the template.
+ * @param[in] pClientToken Client token in the encoded message.
+ * @param[in] fileId Value of file id in the encoded message.
+ * @param[in] blockSize Value of block size in the encoded message.
+ * @param[in] blockBitmapSize Size of the bitmap of every request.
+ *
+ * @return TRUE when success, otherwise FALSE.
+ */
+bool OTA_CBOR_Encode_GetStreamRequestTemplate( uint8_t * pMessageBuffer,
+                                               size_t messageBufferSize,
+                                               OtaCborGetStreamRequest_t * pRequest,
+                                               const char * pClientToken,
+                                               int32_t fileId,
+                                               int32_t blockSize,
+                                               size_t blockBitmapSize )
+{
+    bool result = false;
+    size_t index = 0;
+    size_t valueIndex = 0;
+
+    if( ( pMessageBuffer != NULL ) &&
+        ( pRequest != NULL ) &&
+        ( pClientToken != NULL ) )
+    {
+        pRequest->messageSize = 0;
+        result = writeHead( pMessageBuffer, messageBufferSize, &index, OTA_CBOR_MAJOR_TYPE_MAP, OTA_CBOR_GETSTREAMREQUEST_ITEM_COUNT, false );
+    }
+
+    /* Encode the client token key and value. */
+    if( result == true )
+    {
+        result = writeString( pMessageBuffer, messageBufferSize, &index, OTA_CBOR_MAJOR_TYPE_TEXT_STRING, OTA_CBOR_CLIENTTOKEN_KEY, strlen( OTA_CBOR_CLIENTTOKEN_KEY ) );
+    }
+
+    if( result == true )
+    {
+        result = writeString( pMessageBuffer, messageBufferSize, &index, OTA_CBOR_MAJOR_TYPE_TEXT_STRING, pClientToken, strlen( pClientToken ) );
+    }
+
+    /* Encode the file id, block size and block offset keys and values. */
+    if( result == true )
+    {
+        result = writeIntEntry( pMessageBuffer, messageBufferSize, &index, OTA_CBOR_FILEID_KEY, &valueIndex, fileId );
+    }
+
+    if( result == true )
+    {
+        result = writeIntEntry( pMessageBuffer, messageBufferSize, &index, OTA_CBOR_BLOCKSIZE_KEY, &valueIndex, blockSize );
+    }
+
+    if( result == true )
+    {
+        result = writeIntEntry( pMessageBuffer, messageBufferSize, &index, OTA_CBOR_BLOCKOFFSET_KEY, &pRequest->blockOffsetIndex, 0 );
+    }
+
+    /* Encode the block bitmap key and a bitmap of zeros. */
+    if( result == true )
+    {
+        result = writeString( pMessageBuffer, messageBufferSize, &index, OTA_CBOR_MAJOR_TYPE_TEXT_STRING, OTA_CBOR_BLOCKBITMAP_KEY, strlen( OTA_CBOR_BLOCKBITMAP_KEY ) );
+    }
+
+    if( result == true )
+    {
+        result = writeString( pMessageBuffer, messageBufferSize, &index, OTA_CBOR_MAJOR_TYPE_BYTE_STRING, NULL, blockBitmapSize );
+        pRequest->blockBitmapIndex = index - blockBitmapSize;
+        pRequest->blockBitmapSize = blockBitmapSize;
+    }
+
+    /* Encode the number of blocks requested key and value. */
+    if( result == true )
+    {
+        result = writeIntEntry( pMessageBuffer, messageBufferSize, &index, OTA_CBOR_NUMBEROFBLOCKS_KEY, &pRequest->numOfBlocksIndex, 0 );
+    }
+
+    if( result == true )
+    {
+        pRequest->messageSize = index;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Write the fields of a Get Stream Request message into its template.
+ *
+ * @param[in,out] pMessageBuffer Template encoded by
+ * OTA_CBOR_Encode_GetStreamRequestTemplate.
+ * @param[in] pRequest Positions of the fields in the template.
+ * @param[in] blockOffset Value of block offset in the encoded message.
+ * @param[in] pBlockBitmap bitmap in the encoded message.
+ * @param[in] blockBitmapSize Size of the provided bitmap buffer, the size
+ * the template was encoded for.
+ * @param[in] numOfBlocksRequested number of blocks to request in the encoded message.
+ *
+ * @return TRUE when success, FALSE if the template is not encoded or is for
+ * another bitmap size.
+ */
+bool OTA_CBOR_Patch_GetStreamRequestMessage( uint8_t * pMessageBuffer,
+                                             const OtaCborGetStreamRequest_t * pRequest,
+                                             int32_t blockOffset,
+                                             const uint8_t * pBlockBitmap,
+                                             size_t blockBitmapSize,
+                                             int32_t numOfBlocksRequested )
+{
+    bool result = false;
+    size_t index = 0;
+
+    if( ( pMessageBuffer != NULL ) &&
+        ( pRequest != NULL ) &&
+        ( pBlockBitmap != NULL ) &&
+        ( pRequest->messageSize > 0U ) &&
+        ( pRequest->blockBitmapSize == blockBitmapSize ) )
+    {
+        /* The integers were written in 5 bytes, which always fit. */
+        index = pRequest->blockOffsetIndex;
+        result = writeIntFixed( pMessageBuffer, pRequest->messageSize, &index, blockOffset );
+    }
+
+    if( result == true )
+    {
+        index = pRequest->numOfBlocksIndex;
+        result = writeIntFixed( pMessageBuffer, pRequest->messageSize, &index, numOfBlocksRequested );
+    }
+
+    if( result == true )
+    {
+        ( void ) memcpy( &pMessageBuffer[ pRequest->blockBitmapIndex ], pBlockBitmap, blockBitmapSize );
+    }
+
+    return result;
+}
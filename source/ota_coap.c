@@ -0,0 +1,293 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_coap.c
+ * @brief Data transfer over CoAP with block-wise transfer routines.
+ */
+
+/* Standard library include. */
+#include <string.h>
+#include <assert.h>
+
+/* OTA includes. */
+#include "ota.h"
+#include "ota_private.h"
+#include "ota_coap_private.h"
+
+/**
+ * @brief Log base 2 of the smallest Block2 size, SZX 0.
+ */
+#define OTA_COAP_LOG2_MIN_BLOCK_SIZE    4U
+
+/**
+ * @brief Log base 2 of the largest Block2 size, SZX 6.
+ */
+#define OTA_COAP_LOG2_MAX_BLOCK_SIZE    10U
+
+/**
+ * @brief Log base 2 of the size of the CoAP blocks that the file blocks are requested in.
+ */
+#if ( otaconfigLOG2_FILE_BLOCK_SIZE < OTA_COAP_LOG2_MAX_BLOCK_SIZE )
+    #define OTA_COAP_LOG2_BLOCK_SIZE    ( ( uint32_t ) otaconfigLOG2_FILE_BLOCK_SIZE )
+#else
+    #define OTA_COAP_LOG2_BLOCK_SIZE    OTA_COAP_LOG2_MAX_BLOCK_SIZE
+#endif
+
+#if ( otaconfigLOG2_FILE_BLOCK_SIZE < OTA_COAP_LOG2_MIN_BLOCK_SIZE )
+    #error "otaconfigLOG2_FILE_BLOCK_SIZE must be at least 4 for data over CoAP."
+#endif
+
+/**
+ * @brief Size exponent of the Block2 option of the requests.
+ */
+#define OTA_COAP_BLOCK_SZX    ( ( uint8_t ) ( OTA_COAP_LOG2_BLOCK_SIZE - OTA_COAP_LOG2_MIN_BLOCK_SIZE ) )
+
+/**
+ * @brief Check if a block of the file has not been received yet.
+ *
+ * @param[in] pFileContext File context with the receive block bitmap.
+ * @param[in] blockIndex Index of the block.
+ * @return true if the block still needs to be received.
+ */
+static bool isBlockNeeded( const OtaFileContext_t * pFileContext,
+                           uint32_t blockIndex );
+
+/**
+ * @brief Find the first range of missing blocks.
+ *
+ * Contiguous missing blocks are coalesced into one range of up to
+ * otaconfigCOAP_MAX_NUM_BLOCKS_REQUEST blocks.
+ *
+ * @param[in] pFileContext File context with the receive block bitmap.
+ * @param[out] pFirstBlock Index of the first block of the range.
+ * @return Number of blocks in the range, 0 if no block is left to request.
+ */
+static uint32_t findMissingRange( const OtaFileContext_t * pFileContext,
+                                  uint32_t * pFirstBlock );
+
+/*
+ * Init file transfer by initializing the coap module with the uri.
+ */
+OtaErr_t initFileTransfer_Coap( OtaAgentContext_t * pAgentCtx )
+{
+    OtaCoapStatus_t coapStatus = OtaCoapSuccess;
+    char * pUri = NULL;
+
+    LogDebug( ( "Invoking initFileTransfer_Coap" ) );
+    assert( pAgentCtx != NULL && pAgentCtx->pOtaInterface != NULL );
+
+    /* The uri of the file is the update data url of the job document. */
+    pUri = ( char * ) pAgentCtx->fileContext.pUpdateUrlPath;
+
+    /* Set up the session with the CoAP server. */
+    coapStatus = pAgentCtx->pOtaInterface->coap.init( pUri );
+
+    if( coapStatus != OtaCoapSuccess )
+    {
+        LogError( ( "Error occured while initializing coap:"
+                    "OtaCoapStatus_t=%s"
+                    , OTA_COAP_strerror( coapStatus ) ) );
+    }
+
+    return coapStatus == OtaCoapSuccess ? OtaErrNone : OtaErrInitFileTransferFailed;
+}
+
+/*
+ * Request the next range of file blocks with Block2 transfers.
+ */
+OtaErr_t requestFileBlock_Coap( OtaAgentContext_t * pAgentCtx )
+{
+    OtaErr_t err = OtaErrNone;
+    OtaCoapStatus_t coapStatus = OtaCoapSuccess;
+    uint32_t firstBlock = 0;
+    uint32_t numBlocks = 0;
+    uint32_t rangeStart = 0;
+    uint32_t rangeEnd = 0;
+    uint32_t numCoapBlocks = 0;
+
+    assert( pAgentCtx != NULL && pAgentCtx->pOtaInterface != NULL );
+    LogDebug( ( "Invoking requestFileBlock_Coap" ) );
+
+    /* Request the first missing blocks, also after a timeout. */
+    numBlocks = findMissingRange( &( pAgentCtx->fileContext ), &firstBlock );
+
+    if( numBlocks > 0U )
+    {
+        /* The last block of the file may be shorter than a full block. */
+        rangeStart = firstBlock * OTA_FILE_BLOCK_SIZE;
+        rangeEnd = ( firstBlock + numBlocks ) * OTA_FILE_BLOCK_SIZE;
+
+        if( rangeEnd > pAgentCtx->fileContext.fileSize )
+        {
+            rangeEnd = pAgentCtx->fileContext.fileSize;
+        }
+
+        numCoapBlocks = ( ( rangeEnd - rangeStart ) + ( ( 1UL << OTA_COAP_LOG2_BLOCK_SIZE ) - 1U ) ) >> OTA_COAP_LOG2_BLOCK_SIZE;
+
+        coapStatus = pAgentCtx->pOtaInterface->coap.request( rangeStart >> OTA_COAP_LOG2_BLOCK_SIZE,
+                                                             numCoapBlocks,
+                                                             OTA_COAP_BLOCK_SZX );
+
+        if( coapStatus != OtaCoapSuccess )
+        {
+            LogError( ( "Error occured while requesting data block:"
+                        "OtaCoapStatus_t=%s"
+                        , OTA_COAP_strerror( coapStatus ) ) );
+            err = OtaErrRequestFileBlockFailed;
+        }
+    }
+    else
+    {
+        LogWarn( ( "No missing file blocks left to request." ) );
+    }
+
+    if( err == OtaErrNone )
+    {
+        /* Only request the next range once every block of this one is received. */
+        pAgentCtx->numOfBlocksToReceive = ( numBlocks > 0U ) ? numBlocks : 1U;
+    }
+
+    return err;
+}
+
+/*
+ * Check if a block of the file has not been received yet.
+ */
+static bool isBlockNeeded( const OtaFileContext_t * pFileContext,
+                           uint32_t blockIndex )
+{
+    uint8_t bitMask = ( uint8_t ) ( 1U << ( blockIndex % BITS_PER_BYTE ) );
+
+    /* Bits of the blocks not received yet are set. */
+    return ( pFileContext->pRxBlockBitmap[ blockIndex >> LOG2_BITS_PER_BYTE ] & bitMask ) != 0U;
+}
+
+/*
+ * Find the first range of missing blocks.
+ */
+static uint32_t findMissingRange( const OtaFileContext_t * pFileContext,
+                                  uint32_t * pFirstBlock )
+{
+    uint32_t numBlocks = 0;
+    uint32_t blockIndex = 0;
+    uint32_t rangeBlocks = 0;
+
+    numBlocks = ( pFileContext->fileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+
+    /* Find the first missing block, skipping the bytes of the bitmap with every block received. */
+    while( ( blockIndex < numBlocks ) && ( isBlockNeeded( pFileContext, blockIndex ) == false ) )
+    {
+        if( ( ( blockIndex % BITS_PER_BYTE ) == 0U ) &&
+            ( pFileContext->pRxBlockBitmap[ blockIndex >> LOG2_BITS_PER_BYTE ] == 0U ) )
+        {
+            blockIndex += BITS_PER_BYTE;
+        }
+        else
+        {
+            blockIndex++;
+        }
+    }
+
+    *pFirstBlock = blockIndex;
+
+    /* Coalesce the contiguous missing blocks into one range. */
+    while( ( ( blockIndex + rangeBlocks ) < numBlocks ) &&
+           ( rangeBlocks < otaconfigCOAP_MAX_NUM_BLOCKS_REQUEST ) &&
+           ( isBlockNeeded( pFileContext, blockIndex + rangeBlocks ) == true ) )
+    {
+        rangeBlocks++;
+    }
+
+    return rangeBlocks;
+}
+
+/*
+ * File blocks are received over CoAP as file chunks.
+ */
+OtaErr_t decodeFileBlock_Coap( const uint8_t * pMessageBuffer,
+                               size_t messageSize,
+                               int32_t * pFileId,
+                               int32_t * pBlockId,
+                               int32_t * pBlockSize,
+                               uint8_t ** pPayload,
+                               size_t * pPayloadSize )
+{
+    ( void ) pMessageBuffer;
+    ( void ) messageSize;
+    ( void ) pFileId;
+    ( void ) pBlockId;
+    ( void ) pBlockSize;
+    ( void ) pPayload;
+    ( void ) pPayloadSize;
+
+    LogError( ( "Received a file block of size %d over CoAP, "
+                "the payload of Block2 responses must be passed as file chunks.",
+                ( int ) messageSize ) );
+
+    return OtaErrInvalidArg;
+}
+
+/*
+ * Perform any cleanup operations required for data plane.
+ */
+OtaErr_t cleanupData_Coap( const OtaAgentContext_t * pAgentCtx )
+{
+    OtaCoapStatus_t coapStatus = OtaCoapSuccess;
+
+    assert( pAgentCtx != NULL && pAgentCtx->pOtaInterface != NULL );
+    coapStatus = pAgentCtx->pOtaInterface->coap.deinit();
+
+    return coapStatus == OtaCoapSuccess ? OtaErrNone : OtaErrCleanupDataFailed;
+}
+
+const char * OTA_COAP_strerror( OtaCoapStatus_t status )
+{
+    const char * str = NULL;
+
+    switch( status )
+    {
+        case OtaCoapSuccess:
+            str = "OtaCoapSuccess";
+            break;
+
+        case OtaCoapInitFailed:
+            str = "OtaCoapInitFailed";
+            break;
+
+        case OtaCoapDeinitFailed:
+            str = "OtaCoapDeinitFailed";
+            break;
+
+        case OtaCoapRequestFailed:
+            str = "OtaCoapRequestFailed";
+            break;
+
+        default:
+            str = "InvalidErrorCode";
+    }
+
+    return str;
+}
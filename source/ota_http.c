@@ -39,11 +39,174 @@
 #include "ota_http_private.h"
 
 /**
- * @brief Track the current block for HTTP requests
+ * @brief Blocks of a HTTP range request made with a context id.
+ */
+typedef struct OtaHttpRangeContext
+{
+    uint32_t contextId; /*!< Context id of the request, 0 if no request was made. */
+    uint32_t nextBlock; /*!< Index of the next block expected in the response. */
+    uint32_t endBlock;  /*!< Index after the last block of the range. */
+} OtaHttpRangeContext_t;
+
+/**
+ * @brief Whether range requests are made with a context id.
+ *
+ */
+static bool parallelRequests;
+
+/**
+ * @brief Whether the file blocks of range requests start with their file offset.
+ *
+ */
+static bool offsetRequests;
+
+/**
+ * @brief Index of the next block expected in the response to a HTTP request without
+ * a context id or a file offset.
  *
  */
 static uint32_t currBlock;
 
+/**
+ * @brief The range requests made with a context id, indexed by the context id.
+ *
+ */
+static OtaHttpRangeContext_t pRangeContexts[ otaconfigHTTP_MAX_PARALLEL_REQUESTS ];
+
+/**
+ * @brief Generation of the next range request with a context id.
+ *
+ * Each request gets a new generation in its context id, so that the late blocks
+ * of a previous request on the same context are not taken for blocks of the
+ * current one.
+ */
+static uint32_t requestGeneration;
+
+/**
+ * @brief Check if a block of the file has not been received yet.
+ *
+ * @param[in] pFileContext File context with the receive block bitmap.
+ * @param[in] blockIndex Index of the block.
+ * @return true if the block still needs to be received.
+ */
+static bool isBlockNeeded( const OtaFileContext_t * pFileContext,
+                           uint32_t blockIndex );
+
+/**
+ * @brief Check if a block is part of a range request with a context id still in flight.
+ *
+ * @param[in] blockIndex Index of the block.
+ * @return true if the block is already requested.
+ */
+static bool isBlockInFlight( uint32_t blockIndex );
+
+/**
+ * @brief Find the first range of missing blocks that are not requested yet.
+ *
+ * Contiguous missing blocks are coalesced into one range of up to
+ * otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST blocks.
+ *
+ * @param[in] pFileContext File context with the receive block bitmap.
+ * @param[out] pFirstBlock Index of the first block of the range.
+ * @return Number of blocks in the range, 0 if no block is left to request.
+ */
+static uint32_t findMissingRange( const OtaFileContext_t * pFileContext,
+                                  uint32_t * pFirstBlock );
+
+/**
+ * @brief Request a range of file blocks over HTTP.
+ *
+ * The file data of a response to requestWithOffset is passed with its file offset, so
+ * late data of a previous request is stored at its own offset. The response to request
+ * is decoded as consecutive blocks starting from firstBlock.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @param[in] firstBlock Index of the first block to request.
+ *
+ * @param[in] endBlock Index after the last block to request.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+static OtaErr_t requestBlockRange( OtaAgentContext_t * pAgentCtx,
+                                   uint32_t firstBlock,
+                                   uint32_t endBlock );
+
+/**
+ * @brief Keep up to otaconfigHTTP_MAX_PARALLEL_REQUESTS range requests in flight.
+ *
+ * A new range of missing blocks is requested for every context as soon as its previous
+ * range is complete. After a timeout, the ranges are derived from the missing blocks again.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+static OtaErr_t requestParallelRanges( OtaAgentContext_t * pAgentCtx );
+
+/**
+ * @brief Request a range of file blocks with the context id of a range request.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ *
+ * @param[in] slot Index of the range request in pRangeContexts.
+ *
+ * @param[in] firstBlock Index of the first block to request.
+ *
+ * @param[in] endBlock Index after the last block to request.
+ *
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+static OtaErr_t requestContextRange( OtaAgentContext_t * pAgentCtx,
+                                     uint32_t slot,
+                                     uint32_t firstBlock,
+                                     uint32_t endBlock );
+
+/**
+ * @brief Map the status of a range request to the OTA error code.
+ *
+ * @param[in] httpStatus Status returned by the HTTP interface.
+ *
+ * @return OtaErrUrlExpired if the pre-signed url was rejected, otherwise the OTA error code.
+ */
+static OtaErr_t httpStatusToErr( OtaHttpStatus_t httpStatus );
+
+/**
+ * @brief Get the range request that a file block received with a context id belongs to.
+ *
+ * @param[in] pMessageBuffer The message starting with the context id.
+ *
+ * @param[in] messageSize The size of the message in bytes.
+ *
+ * @param[out] ppRange The range request in flight for the context id.
+ *
+ * @return OtaErrNone if the request is in flight, OtaErrStaleFileBlock if the request was
+ * replaced or is complete, otherwise OtaErrInvalidArg.
+ */
+static OtaErr_t getRangeContext( const uint8_t * pMessageBuffer,
+                                 size_t messageSize,
+                                 OtaHttpRangeContext_t ** ppRange );
+
+/**
+ * @brief Get the first block of file data received with its file offset.
+ *
+ * @param[in] pMessageBuffer The message starting with the file offset.
+ *
+ * @param[in] messageSize The size of the message in bytes.
+ *
+ * @param[out] pFirstBlock Index of the block at the file offset.
+ *
+ * @return OtaErrNone if the file offset is at a block boundary, otherwise OtaErrInvalidArg.
+ */
+static OtaErr_t getResponseOffset( const uint8_t * pMessageBuffer,
+                                   size_t messageSize,
+                                   uint32_t * pFirstBlock );
+
+/**
+ * @brief Reset the state of the range requests.
+ */
+static void resetRanges( void );
+
 /*
  * Init file transfer by initializing the http module with the pre-signed url.
  */
@@ -59,6 +222,9 @@ OtaErr_t initFileTransfer_Http( OtaAgentContext_t * pAgentCtx )
     /* File context from OTA agent. */
     fileContext = &( pAgentCtx->fileContext );
 
+    /* Start the download from the first block. */
+    resetRanges();
+
     /* Get pre-signed URL from pAgentCtx. */
     pURL = ( char * ) fileContext->pUpdateUrlPath;
 
@@ -76,9 +242,79 @@ OtaErr_t initFileTransfer_Http( OtaAgentContext_t * pAgentCtx )
 }
 
 /*
- * Check for next available OTA job from the job service.
+ * Request the next range of file blocks over HTTP.
  */
 OtaErr_t requestDataBlock_Http( OtaAgentContext_t * pAgentCtx )
+{
+    OtaErr_t err = OtaErrNone;
+    uint32_t firstBlock = 0;
+    uint32_t numBlocks = 0;
+
+    assert( pAgentCtx != NULL && pAgentCtx->pOtaInterface != NULL );
+
+    if( pAgentCtx->pOtaInterface->http.requestWithContext != NULL )
+    {
+        parallelRequests = true;
+        err = requestParallelRanges( pAgentCtx );
+    }
+    else
+    {
+        offsetRequests = ( pAgentCtx->pOtaInterface->http.requestWithOffset != NULL ) ? true : false;
+
+        /* Request the first missing blocks, also after a timeout or an interrupted download. */
+        numBlocks = findMissingRange( &( pAgentCtx->fileContext ), &firstBlock );
+
+        if( numBlocks > 0U )
+        {
+            err = requestBlockRange( pAgentCtx, firstBlock, firstBlock + numBlocks );
+        }
+        else
+        {
+            LogWarn( ( "No missing file blocks left to request." ) );
+        }
+
+        if( err == OtaErrNone )
+        {
+            /* Only request the next range once every block of this one is received. */
+            pAgentCtx->numOfBlocksToReceive = ( numBlocks > 0U ) ? numBlocks : 1U;
+        }
+    }
+
+    return err;
+}
+
+/*
+ * Request a range of file blocks over HTTP with a context id.
+ */
+OtaErr_t requestDataBlockRange_Http( OtaAgentContext_t * pAgentCtx,
+                                     uint32_t firstBlock,
+                                     uint32_t endBlock )
+{
+    assert( pAgentCtx != NULL && pAgentCtx->pOtaInterface != NULL );
+    assert( pAgentCtx->pOtaInterface->http.requestWithContext != NULL );
+
+    /* Only one range is in flight, a new one replaces the previous range. */
+    parallelRequests = true;
+    ( void ) memset( pRangeContexts, 0, sizeof( pRangeContexts ) );
+
+    return requestContextRange( pAgentCtx, 0, firstBlock, endBlock );
+}
+
+/*
+ * Check if a file block was received with a context id.
+ */
+bool isContextBlock_Http( const uint8_t * pMessageBuffer,
+                          size_t messageSize )
+{
+    return ( messageSize > OTA_HTTP_CONTEXT_ID_SIZE ) && ( pMessageBuffer[ 0 ] == OTA_HTTP_CONTEXT_ID_TAG );
+}
+
+/*
+ * Request a range of file blocks over HTTP.
+ */
+static OtaErr_t requestBlockRange( OtaAgentContext_t * pAgentCtx,
+                                   uint32_t firstBlock,
+                                   uint32_t endBlock )
 {
     OtaHttpStatus_t httpStatus = OtaHttpSuccess;
 
@@ -89,25 +325,32 @@ OtaErr_t requestDataBlock_Http( OtaAgentContext_t * pAgentCtx )
     OtaFileContext_t * fileContext = NULL;
 
     assert( pAgentCtx != NULL && pAgentCtx->pOtaInterface != NULL );
+    assert( firstBlock < endBlock );
     LogDebug( ( "Invoking requestDataBlock_Http" ) );
 
     fileContext = &( pAgentCtx->fileContext );
 
-    /* Calculate ranges. */
-    rangeStart = currBlock * OTA_FILE_BLOCK_SIZE;
+    /* Calculate ranges. The last block of the file may be shorter than a full block. */
+    rangeStart = firstBlock * OTA_FILE_BLOCK_SIZE;
+    rangeEnd = ( endBlock * OTA_FILE_BLOCK_SIZE ) - 1U;
 
-    if( fileContext->blocksRemaining == 1U )
+    if( rangeEnd >= fileContext->fileSize )
     {
         rangeEnd = fileContext->fileSize - 1U;
     }
+
+    /* Request file data over HTTP using the rangeStart and rangeEnd. */
+    if( offsetRequests == true )
+    {
+        httpStatus = pAgentCtx->pOtaInterface->http.requestWithOffset( rangeStart, rangeEnd );
+    }
     else
     {
-        rangeEnd = rangeStart + OTA_FILE_BLOCK_SIZE - 1U;
+        /* The response to this request is decoded as consecutive blocks from the first block. */
+        currBlock = firstBlock;
+        httpStatus = pAgentCtx->pOtaInterface->http.request( rangeStart, rangeEnd );
     }
 
-    /* Request file data over HTTP using the rangeStart and rangeEnd. */
-    httpStatus = pAgentCtx->pOtaInterface->http.request( rangeStart, rangeEnd );
-
     if( httpStatus != OtaHttpSuccess )
     {
         LogError( ( "Error occured while requesting data block:"
@@ -115,11 +358,303 @@ OtaErr_t requestDataBlock_Http( OtaAgentContext_t * pAgentCtx )
                     , OTA_HTTP_strerror( httpStatus ) ) );
     }
 
-    return httpStatus == OtaHttpSuccess ? OtaErrNone : OtaErrRequestFileBlockFailed;
+    return httpStatusToErr( httpStatus );
+}
+
+/*
+ * Map the status of a range request to the OTA error.
+ */
+static OtaErr_t httpStatusToErr( OtaHttpStatus_t httpStatus )
+{
+    OtaErr_t err = OtaErrNone;
+
+    if( httpStatus == OtaHttpUrlExpired )
+    {
+        /* The agent fetches a fresh url instead of retrying with this one. */
+        err = OtaErrUrlExpired;
+    }
+    else if( httpStatus != OtaHttpSuccess )
+    {
+        err = OtaErrRequestFileBlockFailed;
+    }
+    else
+    {
+        err = OtaErrNone;
+    }
+
+    return err;
 }
 
 /*
- * Decode a cbor encoded fileblock received from streaming service.
+ * Request a range of file blocks with the context id of a range request.
+ */
+static OtaErr_t requestContextRange( OtaAgentContext_t * pAgentCtx,
+                                     uint32_t slot,
+                                     uint32_t firstBlock,
+                                     uint32_t endBlock )
+{
+    OtaErr_t err = OtaErrNone;
+    OtaHttpStatus_t httpStatus = OtaHttpSuccess;
+    uint32_t contextId = 0;
+    uint32_t rangeEnd = 0;
+
+    assert( slot < otaconfigHTTP_MAX_PARALLEL_REQUESTS );
+    assert( firstBlock < endBlock );
+
+    /* The first byte of the context id tells the file blocks of the response apart from the
+     * messages of other data protocols. */
+    contextId = ( OTA_HTTP_CONTEXT_ID_TAG << 24U ) |
+                ( ( requestGeneration & OTA_HTTP_CONTEXT_ID_GENERATION_MASK ) << OTA_HTTP_CONTEXT_ID_GENERATION_SHIFT ) |
+                slot;
+    requestGeneration++;
+
+    pRangeContexts[ slot ].contextId = contextId;
+    pRangeContexts[ slot ].nextBlock = firstBlock;
+    pRangeContexts[ slot ].endBlock = endBlock;
+
+    /* The last block of the file may be shorter than a full block. */
+    rangeEnd = endBlock * OTA_FILE_BLOCK_SIZE;
+
+    if( rangeEnd > pAgentCtx->fileContext.fileSize )
+    {
+        rangeEnd = pAgentCtx->fileContext.fileSize;
+    }
+
+    httpStatus = pAgentCtx->pOtaInterface->http.requestWithContext( contextId,
+                                                                    firstBlock * OTA_FILE_BLOCK_SIZE,
+                                                                    rangeEnd - 1U );
+
+    if( httpStatus != OtaHttpSuccess )
+    {
+        LogError( ( "Error occured while requesting data block:"
+                    "Context id=%u, OtaHttpStatus_t=%s",
+                    contextId, OTA_HTTP_strerror( httpStatus ) ) );
+        err = httpStatusToErr( httpStatus );
+    }
+
+    return err;
+}
+
+/*
+ * Keep several range requests with a context id in flight.
+ */
+static OtaErr_t requestParallelRanges( OtaAgentContext_t * pAgentCtx )
+{
+    OtaErr_t err = OtaErrNone;
+    OtaHttpRangeContext_t * pRange = NULL;
+    uint32_t slot = 0;
+    uint32_t blockIndex = 0;
+    uint32_t firstBlock = 0;
+    uint32_t numBlocks = 0;
+
+    /* The agent resets the momentum on every block received, so a request without any block
+     * received since the previous one is a retry after the request timer expired. The blocks
+     * still in flight are requested again under new context ids, the late blocks of the
+     * timed out requests are ignored. */
+    if( pAgentCtx->requestMomentum > 0U )
+    {
+        LogInfo( ( "Requesting the missing blocks of the timed out ranges again." ) );
+        ( void ) memset( pRangeContexts, 0, sizeof( pRangeContexts ) );
+    }
+
+    for( slot = 0; ( slot < otaconfigHTTP_MAX_PARALLEL_REQUESTS ) && ( err == OtaErrNone ); slot++ )
+    {
+        pRange = &pRangeContexts[ slot ];
+
+        /* Blocks received as chunks of file data do not go through the range. */
+        blockIndex = pRange->nextBlock;
+
+        while( ( blockIndex < pRange->endBlock ) &&
+               ( isBlockNeeded( &( pAgentCtx->fileContext ), blockIndex ) == false ) )
+        {
+            blockIndex++;
+        }
+
+        /* Refill the context as soon as every block of its range is received. */
+        if( blockIndex >= pRange->endBlock )
+        {
+            numBlocks = findMissingRange( &( pAgentCtx->fileContext ), &firstBlock );
+
+            if( numBlocks > 0U )
+            {
+                err = requestContextRange( pAgentCtx, slot, firstBlock, firstBlock + numBlocks );
+            }
+        }
+    }
+
+    /* Check the ranges again after every block received. */
+    pAgentCtx->numOfBlocksToReceive = 1U;
+
+    return err;
+}
+
+/*
+ * Check if a block of the file has not been received yet.
+ */
+static bool isBlockNeeded( const OtaFileContext_t * pFileContext,
+                           uint32_t blockIndex )
+{
+    uint8_t bitMask = ( uint8_t ) ( 1U << ( blockIndex % BITS_PER_BYTE ) );
+
+    /* Bits of the blocks not received yet are set. */
+    return ( pFileContext->pRxBlockBitmap[ blockIndex >> LOG2_BITS_PER_BYTE ] & bitMask ) != 0U;
+}
+
+/*
+ * Check if a block is part of a range request with a context id still in flight.
+ */
+static bool isBlockInFlight( uint32_t blockIndex )
+{
+    bool inFlight = false;
+    uint32_t contextId = 0;
+
+    for( contextId = 0; ( contextId < otaconfigHTTP_MAX_PARALLEL_REQUESTS ) && ( inFlight == false ); contextId++ )
+    {
+        inFlight = ( ( blockIndex >= pRangeContexts[ contextId ].nextBlock ) &&
+                     ( blockIndex < pRangeContexts[ contextId ].endBlock ) ) ? true : false;
+    }
+
+    return inFlight;
+}
+
+/*
+ * Find the first range of missing blocks that are not requested yet.
+ */
+static uint32_t findMissingRange( const OtaFileContext_t * pFileContext,
+                                  uint32_t * pFirstBlock )
+{
+    uint32_t numBlocks = 0;
+    uint32_t blockIndex = 0;
+    uint32_t rangeBlocks = 0;
+
+    numBlocks = ( pFileContext->fileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+
+    /* Find the first missing block, skipping the bytes of the bitmap with every block received. */
+    while( ( blockIndex < numBlocks ) &&
+           ( ( isBlockNeeded( pFileContext, blockIndex ) == false ) || ( isBlockInFlight( blockIndex ) == true ) ) )
+    {
+        if( ( ( blockIndex % BITS_PER_BYTE ) == 0U ) &&
+            ( pFileContext->pRxBlockBitmap[ blockIndex >> LOG2_BITS_PER_BYTE ] == 0U ) )
+        {
+            blockIndex += BITS_PER_BYTE;
+        }
+        else
+        {
+            blockIndex++;
+        }
+    }
+
+    *pFirstBlock = blockIndex;
+
+    /* Coalesce the contiguous missing blocks into one range. */
+    while( ( ( blockIndex + rangeBlocks ) < numBlocks ) &&
+           ( rangeBlocks < otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST ) &&
+           ( isBlockNeeded( pFileContext, blockIndex + rangeBlocks ) == true ) &&
+           ( isBlockInFlight( blockIndex + rangeBlocks ) == false ) )
+    {
+        rangeBlocks++;
+    }
+
+    return rangeBlocks;
+}
+
+/*
+ * Get the range request of a file block received with a context id.
+ */
+static OtaErr_t getRangeContext( const uint8_t * pMessageBuffer,
+                                 size_t messageSize,
+                                 OtaHttpRangeContext_t ** ppRange )
+{
+    OtaErr_t err = OtaErrNone;
+    uint32_t contextId = 0;
+    uint32_t slot = 0;
+    uint32_t i = 0;
+
+    if( isContextBlock_Http( pMessageBuffer, messageSize ) == false )
+    {
+        LogError( ( "Incoming file block of size %d does not start with a context id.",
+                    ( int ) messageSize ) );
+        err = OtaErrInvalidArg;
+    }
+    else
+    {
+        for( i = 0; i < OTA_HTTP_CONTEXT_ID_SIZE; i++ )
+        {
+            contextId = ( contextId << 8U ) | pMessageBuffer[ i ];
+        }
+
+        slot = contextId & OTA_HTTP_CONTEXT_ID_SLOT_MASK;
+
+        /* The generation in the context id tells a late block of a replaced request apart. */
+        if( ( slot < otaconfigHTTP_MAX_PARALLEL_REQUESTS ) &&
+            ( pRangeContexts[ slot ].contextId == contextId ) &&
+            ( pRangeContexts[ slot ].nextBlock < pRangeContexts[ slot ].endBlock ) )
+        {
+            *ppRange = &pRangeContexts[ slot ];
+        }
+        else
+        {
+            LogWarn( ( "Ignoring a file block of a request no longer in flight: Context id=%u",
+                       contextId ) );
+            err = OtaErrStaleFileBlock;
+        }
+    }
+
+    return err;
+}
+
+/*
+ * Get the first block of file data received with its file offset.
+ */
+static OtaErr_t getResponseOffset( const uint8_t * pMessageBuffer,
+                                   size_t messageSize,
+                                   uint32_t * pFirstBlock )
+{
+    OtaErr_t err = OtaErrNone;
+    uint32_t offset = 0;
+    uint32_t i = 0;
+
+    if( messageSize <= OTA_HTTP_FILE_OFFSET_SIZE )
+    {
+        LogError( ( "Incoming file block of size %d does not start with a file offset.",
+                    ( int ) messageSize ) );
+        err = OtaErrInvalidArg;
+    }
+    else
+    {
+        for( i = 0; i < OTA_HTTP_FILE_OFFSET_SIZE; i++ )
+        {
+            offset = ( offset << 8U ) | pMessageBuffer[ i ];
+        }
+
+        if( ( offset % OTA_FILE_BLOCK_SIZE ) != 0U )
+        {
+            LogError( ( "Incoming file block at offset %u does not start a block.",
+                        ( unsigned int ) offset ) );
+            err = OtaErrInvalidArg;
+        }
+        else
+        {
+            *pFirstBlock = offset >> otaconfigLOG2_FILE_BLOCK_SIZE;
+        }
+    }
+
+    return err;
+}
+
+/*
+ * Reset the state of the range requests.
+ */
+static void resetRanges( void )
+{
+    currBlock = 0;
+    parallelRequests = false;
+    offsetRequests = false;
+    ( void ) memset( pRangeContexts, 0, sizeof( pRangeContexts ) );
+}
+
+/*
+ * Decode a file block received over HTTP.
  */
 OtaErr_t decodeFileBlock_Http( const uint8_t * pMessageBuffer,
                                size_t messageSize,
@@ -130,28 +665,127 @@ OtaErr_t decodeFileBlock_Http( const uint8_t * pMessageBuffer,
                                size_t * pPayloadSize )
 {
     OtaErr_t err = OtaErrNone;
+    uint32_t numBlocks = 0;
+
+    err = decodeFileBlockAt_Http( pMessageBuffer,
+                                  messageSize,
+                                  0,
+                                  pFileId,
+                                  pBlockId,
+                                  pBlockSize,
+                                  pPayload,
+                                  pPayloadSize,
+                                  &numBlocks );
+
+    if( ( err == OtaErrNone ) && ( numBlocks > 1U ) )
+    {
+        LogError( ( "Incoming file data of %u blocks, expected one block.",
+                    ( unsigned int ) numBlocks ) );
+        err = OtaErrInvalidArg;
+    }
+
+    return err;
+}
+
+/*
+ * Decode a file block of a response body that may carry several blocks.
+ */
+OtaErr_t decodeFileBlockAt_Http( const uint8_t * pMessageBuffer,
+                                 size_t messageSize,
+                                 uint32_t blockNumber,
+                                 int32_t * pFileId,
+                                 int32_t * pBlockId,
+                                 int32_t * pBlockSize,
+                                 uint8_t ** pPayload,
+                                 size_t * pPayloadSize,
+                                 uint32_t * pNumBlocks )
+{
+    OtaErr_t err = OtaErrNone;
+    OtaHttpRangeContext_t * pRange = NULL;
+    const uint8_t * pBlockData = pMessageBuffer;
+    size_t blockDataSize = messageSize;
+    size_t blockOffset = 0;
+    uint32_t numBlocks = 0;
+    uint32_t blockIndex = 0;
 
     assert( pMessageBuffer != NULL && pFileId != NULL && pBlockId != NULL &&
-            pBlockSize != NULL && pPayload != NULL && pPayloadSize != NULL );
+            pBlockSize != NULL && pPayload != NULL && pPayloadSize != NULL &&
+            pNumBlocks != NULL );
 
-    if( messageSize > OTA_FILE_BLOCK_SIZE )
+    /* Blocks of range requests with a context id start with the context id. */
+    if( parallelRequests == true )
     {
-        LogError( ( "Incoming file block size %d larger than block size %d.",
-                    ( int ) messageSize, ( int ) OTA_FILE_BLOCK_SIZE ) );
-        err = OtaErrInvalidArg;
+        err = getRangeContext( pMessageBuffer, messageSize, &pRange );
+
+        if( err == OtaErrNone )
+        {
+            blockIndex = pRange->nextBlock;
+            pBlockData = &pMessageBuffer[ OTA_HTTP_CONTEXT_ID_SIZE ];
+            blockDataSize = messageSize - OTA_HTTP_CONTEXT_ID_SIZE;
+        }
+    }
+    else if( offsetRequests == true )
+    {
+        /* Blocks of range requests with offset start with their file offset from the
+         * Content-Range of the response. */
+        err = getResponseOffset( pMessageBuffer, messageSize, &blockIndex );
+
+        if( err == OtaErrNone )
+        {
+            blockIndex += blockNumber;
+            pBlockData = &pMessageBuffer[ OTA_HTTP_FILE_OFFSET_SIZE ];
+            blockDataSize = messageSize - OTA_HTTP_FILE_OFFSET_SIZE;
+        }
     }
     else
     {
+        /* Other responses are the consecutive blocks of the range requested last. */
+        blockIndex = currBlock;
+    }
+
+    /* The body holds consecutive blocks of the range, only the last block of the file may be
+     * shorter than a full block. */
+    if( err == OtaErrNone )
+    {
+        numBlocks = ( uint32_t ) ( ( blockDataSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE );
+        blockOffset = ( size_t ) blockNumber << otaconfigLOG2_FILE_BLOCK_SIZE;
+
+        if( blockNumber >= numBlocks )
+        {
+            LogError( ( "Incoming file data of %u bytes has no block %u.",
+                        ( unsigned int ) blockDataSize, ( unsigned int ) blockNumber ) );
+            err = OtaErrInvalidArg;
+        }
+    }
+
+    if( err == OtaErrNone )
+    {
+        pBlockData = &pBlockData[ blockOffset ];
+        blockDataSize -= blockOffset;
+
+        if( blockDataSize > OTA_FILE_BLOCK_SIZE )
+        {
+            blockDataSize = OTA_FILE_BLOCK_SIZE;
+        }
+
         *pFileId = 0;
-        *pBlockId = ( int32_t ) currBlock;
-        *pBlockSize = ( int32_t ) messageSize;
+        *pBlockId = ( int32_t ) blockIndex;
+        *pBlockSize = ( int32_t ) blockDataSize;
+        *pNumBlocks = numBlocks;
 
         /* The data received over HTTP does not require any decoding. */
-        ( void ) memcpy( *pPayload, pMessageBuffer, messageSize );
-        *pPayloadSize = messageSize;
-
-        /* Current block is processed, set the file block to next. */
-        currBlock++;
+        ( void ) memcpy( *pPayload, pBlockData, blockDataSize );
+        *pPayloadSize = blockDataSize;
+
+        /* The response continues with the next block of the range. */
+        if( pRange != NULL )
+        {
+            pRange->nextBlock++;
+        }
+        else
+        {
+            currBlock++;
+        }
     }
 
     return err;
@@ -167,8 +801,8 @@ OtaErr_t cleanupData_Http( const OtaAgentContext_t * pAgentCtx )
     assert( pAgentCtx != NULL && pAgentCtx->pOtaInterface != NULL );
     httpStatus = pAgentCtx->pOtaInterface->http.deinit();
 
-    /* Reset currBlock. */
-    currBlock = 0;
+    /* Forget the ranges in flight. */
+    resetRanges();
 
     return httpStatus == OtaHttpSuccess ? OtaErrNone : OtaErrCleanupDataFailed;
 }
@@ -195,6 +829,10 @@ const char * OTA_HTTP_strerror( OtaHttpStatus_t status )
             str = "OtaHttpRequestFailed";
             break;
 
+        case OtaHttpUrlExpired:
+            str = "OtaHttpUrlExpired";
+            break;
+
         default:
             str = "InvalidErrorCode";
     }
@@ -0,0 +1,742 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_hybrid.c
+ * @brief Data transfer over MQTT and HTTP at the same time.
+ */
+
+/* Standard library include. */
+#include <string.h>
+#include <assert.h>
+
+/* OTA includes. */
+#include "ota.h"
+#include "ota_private.h"
+#include "ota_mqtt_private.h"
+#include "ota_http_private.h"
+#include "ota_hybrid_private.h"
+
+/**
+ * @brief The requests and the measured throughput of one data protocol.
+ */
+typedef struct OtaHybridTransport
+{
+    uint32_t blocksPending;  /*!< Blocks of the last request not delivered yet, 0 if no request is in flight. */
+    uint32_t bytesPending;   /*!< Bytes of the last request delivered so far. */
+    uint32_t requestMs;      /*!< Time the last request was sent. */
+    uint32_t lastBlockMs;    /*!< Time the last request was sent or last delivered a block. */
+    uint32_t blocksReceived; /*!< Blocks delivered during the current transfer. */
+    uint32_t bytesMeasured;  /*!< Bytes delivered by the requests measured so far. */
+    uint32_t busyMs;         /*!< Time the requests measured so far were in flight. */
+} OtaHybridTransport_t;
+
+/**
+ * @brief Requests and throughput of MQTT during the current transfer.
+ */
+static OtaHybridTransport_t mqttTransport;
+
+/**
+ * @brief Requests and throughput of HTTP during the current transfer.
+ */
+static OtaHybridTransport_t httpTransport;
+
+/**
+ * @brief Index of the first block of the HTTP range in flight.
+ */
+static uint32_t httpFirstBlock;
+
+/**
+ * @brief Whether HTTP is used, which needs requests with a context id.
+ */
+static bool httpAvailable;
+
+/**
+ * @brief Clock of the OS interface, NULL if not available.
+ */
+static OtaGetTimeMs_t getTimeMs;
+
+/**
+ * @brief Bitmap of the blocks requested over MQTT.
+ */
+static uint8_t pMqttBlockBitmap[ OTA_MAX_BLOCK_BITMAP_SIZE ];
+
+/**
+ * @brief Check if a block of the file has not been received yet.
+ *
+ * @param[in] pFileContext File context with the receive block bitmap.
+ * @param[in] blockIndex Index of the block.
+ * @return true if the block still needs to be received.
+ */
+static bool isBlockNeeded( const OtaFileContext_t * pFileContext,
+                           uint32_t blockIndex );
+
+/**
+ * @brief Check if a block is requested over MQTT and not delivered yet.
+ *
+ * @param[in] blockIndex Index of the block.
+ * @return true if the block is in flight over MQTT.
+ */
+static bool isMqttBlockInFlight( uint32_t blockIndex );
+
+/**
+ * @brief Check if a block is part of the HTTP range in flight.
+ *
+ * @param[in] blockIndex Index of the block.
+ * @return true if the block is in flight over HTTP.
+ */
+static bool isHttpBlockInFlight( uint32_t blockIndex );
+
+/**
+ * @brief Find the block that separates the blocks needed in two ranges.
+ *
+ * @param[in] pFileContext File context with the receive block bitmap.
+ * @param[in] numBlocks Number of blocks of the file.
+ * @param[in] headBlocks Number of blocks needed to put in the first range.
+ * @return Index of the first block of the second range.
+ */
+static uint32_t findSplitBlock( const OtaFileContext_t * pFileContext,
+                                uint32_t numBlocks,
+                                uint32_t headBlocks );
+
+/**
+ * @brief Start measuring a request sent over a data protocol.
+ *
+ * @param[in] pTransport The data protocol.
+ * @param[in] numBlocks Number of blocks requested.
+ */
+static void startRequest( OtaHybridTransport_t * pTransport,
+                          uint32_t numBlocks );
+
+/**
+ * @brief Add a file block delivered over a data protocol to its measurement.
+ *
+ * The throughput is measured over the time the requests are in flight, so a
+ * data protocol that is idle between its requests is not measured slower.
+ *
+ * @param[in] pTransport The data protocol.
+ * @param[in] blockSize Size of the file block in bytes.
+ */
+static void recordBlock( OtaHybridTransport_t * pTransport,
+                         size_t blockSize );
+
+/**
+ * @brief Check if the request in flight over a data protocol timed out.
+ *
+ * The request timed out when it delivered no block for the request wait time.
+ * Without a clock, any request sent again without a block received since the
+ * previous one is taken as a retry after the request timer expired.
+ *
+ * @param[in] pTransport The data protocol.
+ * @param[in] requestMomentum Requests sent without a block received since.
+ * @return true if the request should be sent again.
+ */
+static bool isRequestExpired( const OtaHybridTransport_t * pTransport,
+                              uint32_t requestMomentum );
+
+/**
+ * @brief Stop measuring the request in flight over a data protocol after a timeout.
+ *
+ * @param[in] pTransport The data protocol.
+ */
+static void abandonRequest( OtaHybridTransport_t * pTransport );
+
+/**
+ * @brief Get the throughput of a data protocol to split the blocks by.
+ *
+ * Without a clock, the number of blocks delivered stands in for the throughput,
+ * which follows it as long as both data protocols are kept busy.
+ *
+ * @param[in] pTransport The data protocol.
+ * @return The throughput in bytes per second, at least 1 once measured and 0
+ * if not measured yet.
+ */
+static uint32_t getThroughput( const OtaHybridTransport_t * pTransport );
+
+/**
+ * @brief Get the number of blocks left to split off for the end of the file.
+ *
+ * The blocks left are split by the throughput of the data protocols. A data
+ * protocol that is not measured yet is assumed as fast as the other one. Both
+ * data protocols get at least one block while more than one is left, so that
+ * a data protocol that was slow is measured again.
+ *
+ * @param[in] blocksLeft Number of blocks left to receive.
+ * @param[in] headThroughput Throughput of the data protocol downloading from the start.
+ * @param[in] tailThroughput Throughput of the data protocol downloading from the end.
+ * @return Number of blocks for the data protocol downloading from the end.
+ */
+static uint32_t getTailBlocks( uint32_t blocksLeft,
+                               uint32_t headThroughput,
+                               uint32_t tailThroughput );
+
+/**
+ * @brief Request the next range of blocks over HTTP if no range is in flight.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ * @param[in] startBlock Index of the first block of the HTTP part of the file.
+ * @param[in] endBlock Index after the last block of the HTTP part of the file.
+ * @param[out] pRequested Set to true if a range is requested.
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+static OtaErr_t requestHttpRange( OtaAgentContext_t * pAgentCtx,
+                                  uint32_t startBlock,
+                                  uint32_t endBlock,
+                                  bool * pRequested );
+
+/**
+ * @brief Request the next blocks over MQTT if no request is in flight.
+ *
+ * @param[in] pAgentCtx The OTA agent context.
+ * @param[in] startBlock Index of the first block of the MQTT part of the file.
+ * @param[in] endBlock Index after the last block of the MQTT part of the file.
+ * @param[out] pRequested Set to true if blocks are requested.
+ * @return The OTA error code. See OTA Agent error codes information in ota.h.
+ */
+static OtaErr_t requestMqttBlocks( OtaAgentContext_t * pAgentCtx,
+                                   uint32_t startBlock,
+                                   uint32_t endBlock,
+                                   bool * pRequested );
+
+static bool isBlockNeeded( const OtaFileContext_t * pFileContext,
+                           uint32_t blockIndex )
+{
+    uint8_t bitMask = ( uint8_t ) ( 1U << ( blockIndex % BITS_PER_BYTE ) );
+
+    /* Bits of the blocks not received yet are set. */
+    return ( pFileContext->pRxBlockBitmap[ blockIndex >> LOG2_BITS_PER_BYTE ] & bitMask ) != 0U;
+}
+
+static bool isMqttBlockInFlight( uint32_t blockIndex )
+{
+    uint8_t bitMask = ( uint8_t ) ( 1U << ( blockIndex % BITS_PER_BYTE ) );
+
+    return ( mqttTransport.blocksPending > 0U ) &&
+           ( ( pMqttBlockBitmap[ blockIndex >> LOG2_BITS_PER_BYTE ] & bitMask ) != 0U );
+}
+
+static bool isHttpBlockInFlight( uint32_t blockIndex )
+{
+    return ( blockIndex >= httpFirstBlock ) && ( blockIndex < ( httpFirstBlock + httpTransport.blocksPending ) );
+}
+
+static uint32_t findSplitBlock( const OtaFileContext_t * pFileContext,
+                                uint32_t numBlocks,
+                                uint32_t headBlocks )
+{
+    uint32_t blockIndex = 0;
+    uint32_t blocksNeeded = 0;
+
+    while( ( blockIndex < numBlocks ) && ( blocksNeeded < headBlocks ) )
+    {
+        if( isBlockNeeded( pFileContext, blockIndex ) == true )
+        {
+            blocksNeeded++;
+        }
+
+        blockIndex++;
+    }
+
+    return blockIndex;
+}
+
+static void startRequest( OtaHybridTransport_t * pTransport,
+                          uint32_t numBlocks )
+{
+    pTransport->blocksPending = numBlocks;
+    pTransport->bytesPending = 0;
+    pTransport->requestMs = ( getTimeMs != NULL ) ? getTimeMs() : 0U;
+    pTransport->lastBlockMs = pTransport->requestMs;
+}
+
+static void recordBlock( OtaHybridTransport_t * pTransport,
+                         size_t blockSize )
+{
+    pTransport->blocksReceived++;
+
+    if( pTransport->blocksPending > 0U )
+    {
+        pTransport->blocksPending--;
+        pTransport->bytesPending += ( uint32_t ) blockSize;
+        pTransport->lastBlockMs = ( getTimeMs != NULL ) ? getTimeMs() : 0U;
+
+        if( ( pTransport->blocksPending == 0U ) && ( getTimeMs != NULL ) )
+        {
+            pTransport->busyMs += getTimeMs() - pTransport->requestMs;
+            pTransport->bytesMeasured += pTransport->bytesPending;
+        }
+    }
+}
+
+static bool isRequestExpired( const OtaHybridTransport_t * pTransport,
+                              uint32_t requestMomentum )
+{
+    bool expired = false;
+
+    if( pTransport->blocksPending == 0U )
+    {
+        /* No request in flight. */
+    }
+    else if( getTimeMs != NULL )
+    {
+        expired = ( ( getTimeMs() - pTransport->lastBlockMs ) >= otaconfigFILE_REQUEST_WAIT_MS ) ? true : false;
+    }
+    else
+    {
+        expired = ( requestMomentum > 0U ) ? true : false;
+    }
+
+    return expired;
+}
+
+static void abandonRequest( OtaHybridTransport_t * pTransport )
+{
+    /* The blocks delivered until the timeout still tell how fast the data protocol is. */
+    if( ( pTransport->blocksPending > 0U ) && ( getTimeMs != NULL ) )
+    {
+        pTransport->busyMs += getTimeMs() - pTransport->requestMs;
+        pTransport->bytesMeasured += pTransport->bytesPending;
+    }
+
+    pTransport->blocksPending = 0;
+}
+
+static uint32_t getThroughput( const OtaHybridTransport_t * pTransport )
+{
+    uint32_t throughput = 0;
+
+    if( getTimeMs == NULL )
+    {
+        /* Start from an even split. */
+        throughput = pTransport->blocksReceived + 1U;
+    }
+    else if( pTransport->busyMs > 0U )
+    {
+        /* Split the division to not overflow 32 bits. */
+        throughput = ( ( pTransport->bytesMeasured / pTransport->busyMs ) * 1000U ) +
+                     ( ( ( pTransport->bytesMeasured % pTransport->busyMs ) * 1000U ) / pTransport->busyMs );
+
+        /* A data protocol that was measured but delivered nothing is told apart
+         * from one that is not measured yet. */
+        if( throughput == 0U )
+        {
+            throughput = 1U;
+        }
+    }
+    else
+    {
+        /* Not measured yet. */
+        throughput = 0;
+    }
+
+    return throughput;
+}
+
+static uint32_t getTailBlocks( uint32_t blocksLeft,
+                               uint32_t headThroughput,
+                               uint32_t tailThroughput )
+{
+    uint32_t tailBlocks = 0;
+    uint32_t head = headThroughput;
+    uint32_t tail = tailThroughput;
+
+    if( ( head == 0U ) && ( tail == 0U ) )
+    {
+        head = 1U;
+        tail = 1U;
+    }
+    else if( head == 0U )
+    {
+        head = tail;
+    }
+    else if( tail == 0U )
+    {
+        tail = head;
+    }
+    else
+    {
+        /* Both are measured. */
+    }
+
+    if( blocksLeft > 1U )
+    {
+        tailBlocks = ( uint32_t ) ( ( ( ( uint64_t ) blocksLeft * tail ) + ( ( ( uint64_t ) head + tail ) / 2U ) ) /
+                                    ( ( uint64_t ) head + tail ) );
+
+        if( tailBlocks == 0U )
+        {
+            tailBlocks = 1U;
+        }
+        else if( tailBlocks == blocksLeft )
+        {
+            tailBlocks = blocksLeft - 1U;
+        }
+        else
+        {
+            /* Both data protocols get blocks. */
+        }
+    }
+    else
+    {
+        /* The last block goes to the faster data protocol. */
+        tailBlocks = ( tail > head ) ? blocksLeft : 0U;
+    }
+
+    return tailBlocks;
+}
+
+static OtaErr_t requestHttpRange( OtaAgentContext_t * pAgentCtx,
+                                  uint32_t startBlock,
+                                  uint32_t endBlock,
+                                  bool * pRequested )
+{
+    OtaErr_t err = OtaErrNone;
+    const OtaFileContext_t * pFileContext = &( pAgentCtx->fileContext );
+    uint32_t firstBlock = startBlock;
+    uint32_t rangeBlocks = 0;
+
+    if( ( httpAvailable == true ) && ( httpTransport.blocksPending == 0U ) )
+    {
+        /* Skip the blocks received and the blocks MQTT is fetching. */
+        while( ( firstBlock < endBlock ) &&
+               ( ( isBlockNeeded( pFileContext, firstBlock ) == false ) || ( isMqttBlockInFlight( firstBlock ) == true ) ) )
+        {
+            firstBlock++;
+        }
+
+        /* Request the contiguous blocks needed as one range. */
+        while( ( ( firstBlock + rangeBlocks ) < endBlock ) &&
+               ( rangeBlocks < otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST ) &&
+               ( isBlockNeeded( pFileContext, firstBlock + rangeBlocks ) == true ) &&
+               ( isMqttBlockInFlight( firstBlock + rangeBlocks ) == false ) )
+        {
+            rangeBlocks++;
+        }
+
+        if( rangeBlocks > 0U )
+        {
+            err = requestDataBlockRange_Http( pAgentCtx, firstBlock, firstBlock + rangeBlocks );
+
+            if( err == OtaErrNone )
+            {
+                httpFirstBlock = firstBlock;
+                startRequest( &httpTransport, rangeBlocks );
+                *pRequested = true;
+            }
+        }
+    }
+
+    return err;
+}
+
+static OtaErr_t requestMqttBlocks( OtaAgentContext_t * pAgentCtx,
+                                   uint32_t startBlock,
+                                   uint32_t endBlock,
+                                   bool * pRequested )
+{
+    OtaErr_t err = OtaErrNone;
+    const OtaFileContext_t * pFileContext = &( pAgentCtx->fileContext );
+    uint32_t numBlocks = 0;
+    uint32_t bitmapLen = 0;
+    uint32_t mqttBlocks = 0;
+    uint32_t blockIndex = 0;
+
+    if( mqttTransport.blocksPending == 0U )
+    {
+        numBlocks = ( pFileContext->fileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+        bitmapLen = ( numBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
+
+        /* MQTT requests the blocks needed in its part, except the blocks HTTP is fetching. */
+        ( void ) memset( pMqttBlockBitmap, 0, bitmapLen );
+
+        for( blockIndex = startBlock; blockIndex < endBlock; blockIndex++ )
+        {
+            if( ( isBlockNeeded( pFileContext, blockIndex ) == true ) &&
+                ( isHttpBlockInFlight( blockIndex ) == false ) )
+            {
+                pMqttBlockBitmap[ blockIndex >> LOG2_BITS_PER_BYTE ] |= ( uint8_t ) ( 1U << ( blockIndex % BITS_PER_BYTE ) );
+                mqttBlocks++;
+            }
+        }
+
+        if( mqttBlocks > 0U )
+        {
+            err = requestFileBlockBitmap_Mqtt( pAgentCtx, pMqttBlockBitmap );
+
+            if( err == OtaErrNone )
+            {
+                startRequest( &mqttTransport,
+                              ( mqttBlocks < otaconfigMAX_NUM_BLOCKS_REQUEST ) ? mqttBlocks : otaconfigMAX_NUM_BLOCKS_REQUEST );
+                *pRequested = true;
+            }
+        }
+    }
+
+    return err;
+}
+
+/*
+ * Init file transfer by subscribing to the data stream and initializing the http module.
+ */
+OtaErr_t initFileTransfer_Hybrid( OtaAgentContext_t * pAgentCtx )
+{
+    OtaErr_t err = OtaErrNone;
+
+    assert( pAgentCtx != NULL );
+
+    /* Every transfer starts from an even split between the two protocols. */
+    ( void ) memset( &mqttTransport, 0, sizeof( mqttTransport ) );
+    ( void ) memset( &httpTransport, 0, sizeof( httpTransport ) );
+    httpFirstBlock = 0;
+    getTimeMs = pAgentCtx->pOtaInterface->os.timer.getTimeMs;
+
+    /* File blocks over HTTP are told apart from the ones over MQTT by the context id. */
+    httpAvailable = ( pAgentCtx->pOtaInterface->http.requestWithContext != NULL ) ? true : false;
+
+    err = initFileTransfer_Mqtt( pAgentCtx );
+
+    if( ( err == OtaErrNone ) && ( httpAvailable == true ) )
+    {
+        err = initFileTransfer_Http( pAgentCtx );
+
+        if( err != OtaErrNone )
+        {
+            ( void ) cleanupData_Mqtt( pAgentCtx );
+        }
+    }
+    else if( err == OtaErrNone )
+    {
+        LogWarn( ( "HTTP requests with a context id are not supported, downloading over MQTT only." ) );
+    }
+    else
+    {
+        /* Failed to subscribe to the data stream. */
+    }
+
+    return err;
+}
+
+/*
+ * Request file blocks over MQTT and HTTP from two disjoint parts of the file.
+ */
+OtaErr_t requestFileBlock_Hybrid( OtaAgentContext_t * pAgentCtx )
+{
+    OtaErr_t err = OtaErrNone;
+    OtaErr_t httpErr = OtaErrNone;
+    OtaErr_t mqttErr = OtaErrNone;
+    const OtaFileContext_t * pFileContext = NULL;
+    bool requested = false;
+    uint32_t numBlocks = 0;
+    uint32_t headThroughput = 0;
+    uint32_t tailThroughput = 0;
+    uint32_t tailBlocks = 0;
+    uint32_t splitBlock = 0;
+
+    assert( pAgentCtx != NULL );
+
+    pFileContext = &( pAgentCtx->fileContext );
+
+    numBlocks = ( pFileContext->fileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+
+    /* Requests that timed out are sent again. */
+    if( isRequestExpired( &mqttTransport, pAgentCtx->requestMomentum ) == true )
+    {
+        abandonRequest( &mqttTransport );
+    }
+
+    if( isRequestExpired( &httpTransport, pAgentCtx->requestMomentum ) == true )
+    {
+        abandonRequest( &httpTransport );
+    }
+
+    /* The primary data protocol downloads the file from the start. */
+    #if ( configOTA_PRIMARY_DATA_PROTOCOL == OTA_DATA_OVER_MQTT )
+        headThroughput = getThroughput( &mqttTransport );
+        tailThroughput = ( httpAvailable == true ) ? getThroughput( &httpTransport ) : 0U;
+        tailBlocks = ( httpAvailable == true ) ? getTailBlocks( pFileContext->blocksRemaining, headThroughput, tailThroughput ) : 0U;
+    #else
+        headThroughput = ( httpAvailable == true ) ? getThroughput( &httpTransport ) : 0U;
+        tailThroughput = getThroughput( &mqttTransport );
+        tailBlocks = ( httpAvailable == true ) ? getTailBlocks( pFileContext->blocksRemaining, headThroughput, tailThroughput ) : pFileContext->blocksRemaining;
+    #endif
+
+    splitBlock = findSplitBlock( pFileContext, numBlocks, pFileContext->blocksRemaining - tailBlocks );
+
+    LogDebug( ( "Split the blocks left by throughput: head=%u, tail=%u, split block=%u",
+                ( unsigned int ) headThroughput,
+                ( unsigned int ) tailThroughput,
+                ( unsigned int ) splitBlock ) );
+
+    #if ( configOTA_PRIMARY_DATA_PROTOCOL == OTA_DATA_OVER_MQTT )
+        httpErr = requestHttpRange( pAgentCtx, splitBlock, numBlocks, &requested );
+        mqttErr = requestMqttBlocks( pAgentCtx, 0, splitBlock, &requested );
+    #else
+        httpErr = requestHttpRange( pAgentCtx, 0, splitBlock, &requested );
+        mqttErr = requestMqttBlocks( pAgentCtx, splitBlock, numBlocks, &requested );
+    #endif
+
+    /* Schedule the two protocols again after every block received. */
+    pAgentCtx->numOfBlocksToReceive = 1U;
+
+    /* A failed request is retried with the next request as long as the other protocol is
+     * still making progress. */
+    if( requested == false )
+    {
+        err = ( httpErr != OtaErrNone ) ? httpErr : mqttErr;
+    }
+
+    return err;
+}
+
+/*
+ * Decode a file block received over MQTT or HTTP.
+ */
+OtaErr_t decodeFileBlock_Hybrid( const uint8_t * pMessageBuffer,
+                                 size_t messageSize,
+                                 int32_t * pFileId,
+                                 int32_t * pBlockId,
+                                 int32_t * pBlockSize,
+                                 uint8_t ** pPayload,
+                                 size_t * pPayloadSize )
+{
+    OtaErr_t err = OtaErrNone;
+
+    assert( pMessageBuffer != NULL && pFileId != NULL && pBlockId != NULL &&
+            pBlockSize != NULL && pPayload != NULL && pPayloadSize != NULL );
+
+    /* The context id in front of the file blocks over HTTP tells the data protocols apart. */
+    if( isContextBlock_Http( pMessageBuffer, messageSize ) == true )
+    {
+        err = decodeFileBlock_Http( pMessageBuffer,
+                                    messageSize,
+                                    pFileId,
+                                    pBlockId,
+                                    pBlockSize,
+                                    pPayload,
+                                    pPayloadSize );
+
+        if( err == OtaErrNone )
+        {
+            recordBlock( &httpTransport, *pPayloadSize );
+        }
+    }
+    else
+    {
+        err = decodeFileBlock_Mqtt( pMessageBuffer,
+                                    messageSize,
+                                    pFileId,
+                                    pBlockId,
+                                    pBlockSize,
+                                    pPayload,
+                                    pPayloadSize );
+
+        if( err == OtaErrNone )
+        {
+            recordBlock( &mqttTransport, *pPayloadSize );
+        }
+    }
+
+    return err;
+}
+
+/*
+ * Decode a block of a message received over MQTT or HTTP that may carry several blocks.
+ */
+OtaErr_t decodeFileBlockAt_Hybrid( const uint8_t * pMessageBuffer,
+                                   size_t messageSize,
+                                   uint32_t blockNumber,
+                                   int32_t * pFileId,
+                                   int32_t * pBlockId,
+                                   int32_t * pBlockSize,
+                                   uint8_t ** pPayload,
+                                   size_t * pPayloadSize,
+                                   uint32_t * pNumBlocks )
+{
+    OtaErr_t err = OtaErrNone;
+
+    assert( pMessageBuffer != NULL && pFileId != NULL && pBlockId != NULL &&
+            pBlockSize != NULL && pPayload != NULL && pPayloadSize != NULL &&
+            pNumBlocks != NULL );
+
+    if( isContextBlock_Http( pMessageBuffer, messageSize ) == true )
+    {
+        err = decodeFileBlockAt_Http( pMessageBuffer,
+                                      messageSize,
+                                      blockNumber,
+                                      pFileId,
+                                      pBlockId,
+                                      pBlockSize,
+                                      pPayload,
+                                      pPayloadSize,
+                                      pNumBlocks );
+
+        if( err == OtaErrNone )
+        {
+            recordBlock( &httpTransport, *pPayloadSize );
+        }
+    }
+    else
+    {
+        err = decodeFileBlockAt_Mqtt( pMessageBuffer,
+                                      messageSize,
+                                      blockNumber,
+                                      pFileId,
+                                      pBlockId,
+                                      pBlockSize,
+                                      pPayload,
+                                      pPayloadSize,
+                                      pNumBlocks );
+
+        if( err == OtaErrNone )
+        {
+            recordBlock( &mqttTransport, *pPayloadSize );
+        }
+    }
+
+    return err;
+}
+
+/*
+ * Perform any cleanup operations required for data plane.
+ */
+OtaErr_t cleanupData_Hybrid( const OtaAgentContext_t * pAgentCtx )
+{
+    OtaErr_t mqttErr = OtaErrNone;
+    OtaErr_t httpErr = OtaErrNone;
+
+    assert( pAgentCtx != NULL );
+
+    mqttErr = cleanupData_Mqtt( pAgentCtx );
+
+    if( httpAvailable == true )
+    {
+        httpErr = cleanupData_Http( pAgentCtx );
+    }
+
+    mqttTransport.blocksPending = 0;
+    httpTransport.blocksPending = 0;
+
+    return ( mqttErr != OtaErrNone ) ? mqttErr : httpErr;
+}
@@ -45,6 +45,14 @@
     #include "ota_http_private.h"
 #endif
 
+#if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_COAP )
+    #include "ota_coap_private.h"
+#endif
+
+#if ( otaconfigENABLE_HYBRID_DATA_TRANSFER == 1U ) && ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_MQTT ) && ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP )
+    #include "ota_hybrid_private.h"
+#endif
+
 /* Check if primary protocol is enabled in aws_iot_ota_agent_config.h. */
 
 #if !( configENABLED_DATA_PROTOCOLS & configOTA_PRIMARY_DATA_PROTOCOL )
@@ -78,20 +86,46 @@ OtaErr_t setDataInterface( OtaDataInterface_t * pDataInterface,
         const char * pProtocolPriority[ OTA_DATA_NUM_PROTOCOLS ] =
         {
             "MQTT",
-            "HTTP"
+            "HTTP",
+            "COAP"
         };
     #elif ( configOTA_PRIMARY_DATA_PROTOCOL == OTA_DATA_OVER_HTTP )
         const char * pProtocolPriority[ OTA_DATA_NUM_PROTOCOLS ] =
         {
             "HTTP",
-            "MQTT"
+            "MQTT",
+            "COAP"
+        };
+    #elif ( configOTA_PRIMARY_DATA_PROTOCOL == OTA_DATA_OVER_COAP )
+        const char * pProtocolPriority[ OTA_DATA_NUM_PROTOCOLS ] =
+        {
+            "COAP",
+            "MQTT",
+            "HTTP"
         };
     #endif /* if ( configOTA_PRIMARY_DATA_PROTOCOL == OTA_DATA_OVER_MQTT ) */
 
     assert( pDataInterface != NULL );
     assert( pProtocol != NULL );
 
-    for( i = 0; i < OTA_DATA_NUM_PROTOCOLS; i++ )
+    #if ( otaconfigENABLE_HYBRID_DATA_TRANSFER == 1U ) && ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_MQTT ) && ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP )
+        /* Download over both protocols when the job offers both. */
+        if( ( NULL != strstr( ( const char * ) pProtocol, "MQTT" ) ) &&
+            ( NULL != strstr( ( const char * ) pProtocol, "HTTP" ) ) )
+        {
+            pDataInterface->initFileTransfer = initFileTransfer_Hybrid;
+            pDataInterface->requestFileBlock = requestFileBlock_Hybrid;
+            pDataInterface->decodeFileBlock = decodeFileBlock_Hybrid;
+            pDataInterface->decodeFileBlockAt = decodeFileBlockAt_Hybrid;
+            pDataInterface->cleanup = cleanupData_Hybrid;
+
+            LogInfo( ( "Data interface is set to MQTT and HTTP.\r\n" ) );
+
+            err = OtaErrNone;
+        }
+    #endif /* if ( otaconfigENABLE_HYBRID_DATA_TRANSFER == 1U ) && ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_MQTT ) && ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP ) */
+
+    for( i = 0; ( err != OtaErrNone ) && ( i < OTA_DATA_NUM_PROTOCOLS ); i++ )
     {
         if( NULL != strstr( ( const char * ) pProtocol, pProtocolPriority[ i ] ) )
         {
@@ -101,6 +135,7 @@ OtaErr_t setDataInterface( OtaDataInterface_t * pDataInterface,
                     pDataInterface->initFileTransfer = initFileTransfer_Mqtt;
                     pDataInterface->requestFileBlock = requestFileBlock_Mqtt;
                     pDataInterface->decodeFileBlock = decodeFileBlock_Mqtt;
+                    pDataInterface->decodeFileBlockAt = decodeFileBlockAt_Mqtt;
                     pDataInterface->cleanup = cleanupData_Mqtt;
 
                     LogInfo( ( "Data interface is set to MQTT.\r\n" ) );
@@ -116,6 +151,7 @@ OtaErr_t setDataInterface( OtaDataInterface_t * pDataInterface,
                     pDataInterface->initFileTransfer = initFileTransfer_Http;
                     pDataInterface->requestFileBlock = requestDataBlock_Http;
                     pDataInterface->decodeFileBlock = decodeFileBlock_Http;
+                    pDataInterface->decodeFileBlockAt = decodeFileBlockAt_Http;
                     pDataInterface->cleanup = cleanupData_Http;
 
                     LogInfo( ( "Data interface is set to HTTP.\r\n" ) );
@@ -124,8 +160,99 @@ OtaErr_t setDataInterface( OtaDataInterface_t * pDataInterface,
                     break;
                 }
             #endif /* if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP ) */
+
+            #if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_COAP )
+                if( strcmp( pProtocolPriority[ i ], "COAP" ) == 0 )
+                {
+                    pDataInterface->initFileTransfer = initFileTransfer_Coap;
+                    pDataInterface->requestFileBlock = requestFileBlock_Coap;
+                    pDataInterface->decodeFileBlock = decodeFileBlock_Coap;
+                    pDataInterface->decodeFileBlockAt = NULL;
+                    pDataInterface->cleanup = cleanupData_Coap;
+
+                    LogInfo( ( "Data interface is set to CoAP.\r\n" ) );
+
+                    err = OtaErrNone;
+                    break;
+                }
+            #endif /* if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_COAP ) */
         }
     }
 
     return err;
 }
+
+OtaErr_t setDataInterfaceForProtocol( OtaDataInterface_t * pDataInterface,
+                                      uint32_t protocol )
+{
+    const char * pProtocolName = NULL;
+
+    assert( pDataInterface != NULL );
+
+    /* A single protocol name selects the data interface of that protocol. */
+    if( protocol == OTA_DATA_OVER_MQTT )
+    {
+        pProtocolName = "[\"MQTT\"]";
+    }
+    else if( protocol == OTA_DATA_OVER_HTTP )
+    {
+        pProtocolName = "[\"HTTP\"]";
+    }
+    else
+    {
+        pProtocolName = "[\"COAP\"]";
+    }
+
+    return setDataInterface( pDataInterface, ( const uint8_t * ) pProtocolName );
+}
+
+uint32_t getProbeDataProtocols( const uint8_t * pProtocol )
+{
+    uint32_t protocols = 0;
+
+    assert( pProtocol != NULL );
+
+    #if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_MQTT )
+        if( NULL != strstr( ( const char * ) pProtocol, "MQTT" ) )
+        {
+            protocols |= OTA_DATA_OVER_MQTT;
+        }
+    #endif
+
+    #if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP )
+        if( NULL != strstr( ( const char * ) pProtocol, "HTTP" ) )
+        {
+            protocols |= OTA_DATA_OVER_HTTP;
+        }
+    #endif
+
+    #if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_COAP )
+        if( NULL != strstr( ( const char * ) pProtocol, "COAP" ) )
+        {
+            protocols |= OTA_DATA_OVER_COAP;
+        }
+    #endif
+
+    #if ( otaconfigENABLE_HYBRID_DATA_TRANSFER == 1U ) && ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_MQTT ) && ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP )
+        /* A download over MQTT and HTTP at the same time already uses both. */
+        if( ( protocols & ( OTA_DATA_OVER_MQTT | OTA_DATA_OVER_HTTP ) ) == ( OTA_DATA_OVER_MQTT | OTA_DATA_OVER_HTTP ) )
+        {
+            protocols = 0;
+        }
+    #endif
+
+    return protocols;
+}
+
+uint32_t nextProbeDataProtocol( uint32_t protocols )
+{
+    uint32_t protocol = configOTA_PRIMARY_DATA_PROTOCOL;
+
+    /* The other protocols follow the primary one in the order of their values. */
+    if( ( protocols & protocol ) == 0U )
+    {
+        protocol = protocols & ( ~protocols + 1U );
+    }
+
+    return protocol;
+}
@@ -38,6 +38,10 @@
 #include "ota.h"
 #include "ota_private.h"
 #include "ota_cbor_private.h"
+#include "ota_base64_private.h"
+
+/* Include JSON library. */
+#include "core_json.h"
 
 /* Private include. */
 #include "ota_mqtt_private.h"
@@ -48,6 +52,36 @@
 /* Stream GET message constants. */
 #define OTA_CLIENT_TOKEN                   "rdy"            /*!< Arbitrary client token sent in the stream "GET" message. */
 
+/* JSON stream message keys. */
+#define OTA_JSON_CLIENTTOKEN_KEY           "c"              /*!< Client token key of a JSON stream message. */
+#define OTA_JSON_FILEID_KEY                "f"              /*!< File ID key of a JSON stream message. */
+#define OTA_JSON_BLOCKSIZE_KEY             "l"              /*!< Block size key of a JSON stream message. */
+#define OTA_JSON_BLOCKOFFSET_KEY           "o"              /*!< Block offset key of a JSON stream request. */
+#define OTA_JSON_BLOCKBITMAP_KEY           "b"              /*!< Block bitmap key of a JSON stream request. */
+#define OTA_JSON_NUMBEROFBLOCKS_KEY        "n"              /*!< Number of blocks key of a JSON stream request. */
+#define OTA_JSON_BLOCKID_KEY               "i"              /*!< Block ID key of a JSON stream response. */
+#define OTA_JSON_BLOCKPAYLOAD_KEY          "p"              /*!< Block payload key of a JSON stream response. */
+
+/* Fields of a JSON stream response, as bits of StreamResponseJson_t::fieldsFound. */
+#define OTA_JSON_FIELD_FILEID              0x1U             /*!< The file ID of the stream response was decoded. */
+#define OTA_JSON_FIELD_BLOCKID             0x2U             /*!< The block ID of the stream response was decoded. */
+#define OTA_JSON_FIELD_BLOCKSIZE           0x4U             /*!< The block size of the stream response was decoded. */
+#define OTA_JSON_FIELD_BLOCKPAYLOAD        0x8U             /*!< The block payload of the stream response was found. */
+#define OTA_JSON_FIELDS_ALL                0xFU             /*!< All the fields of a stream response. */
+
+/**
+ * @brief Fields of a JSON stream response decoded in the walk over its members.
+ */
+typedef struct StreamResponseJson
+{
+    int32_t fileId;       /*!< The server file ID. */
+    int32_t blockId;      /*!< The file block ID. */
+    int32_t blockSize;    /*!< The file block size. */
+    size_t payloadIndex;  /*!< Index of the first character of the Base64 payload. */
+    size_t payloadLength; /*!< Length of the Base64 payload. */
+    uint32_t fieldsFound; /*!< OTA_JSON_FIELD_* bits of the fields decoded so far. */
+} StreamResponseJson_t;
+
 /* Agent to Job Service status message constants. */
 #define OTA_STATUS_MSG_MAX_SIZE            128U         /*!< Max length of a job status message to the service. */
 
@@ -67,6 +101,16 @@
 #define MQTT_API_STREAMS                   "/streams/"                /*!< Stream API identifier. */
 #define MQTT_API_DATA_CBOR                 "/data/cbor"               /*!< Stream API suffix. */
 #define MQTT_API_GET_CBOR                  "/get/cbor"                /*!< Stream API suffix. */
+#define MQTT_API_DATA_JSON                 "/data/json"               /*!< Stream API suffix. */
+#define MQTT_API_GET_JSON                  "/get/json"                /*!< Stream API suffix. */
+
+#if ( otaconfigENABLE_MQTT_JSON_STREAM == 1U )
+    #define MQTT_API_DATA_STREAM           MQTT_API_DATA_JSON         /*!< Stream API suffix of the data topic. */
+    #define MQTT_API_GET_STREAM            MQTT_API_GET_JSON          /*!< Stream API suffix of the request topic. */
+#else
+    #define MQTT_API_DATA_STREAM           MQTT_API_DATA_CBOR         /*!< Stream API suffix of the data topic. */
+    #define MQTT_API_GET_STREAM            MQTT_API_GET_CBOR          /*!< Stream API suffix of the request topic. */
+#endif
 
 /* NOTE: The format specifiers in this string are placeholders only; the lengths of these
  * strings are used to calculate buffer sizes.
@@ -75,8 +119,8 @@ static const char pOtaJobsGetNextTopicTemplate[] = MQTT_API_THINGS "%s"MQTT_API_
 static const char pOtaJobsGetNextAcceptedTopicTemplate[] = MQTT_API_THINGS "%s"MQTT_API_JOBS_NEXT_GET_ACCEPTED; /*!< Topic template for getting next job. */
 static const char pOtaJobsNotifyNextTopicTemplate[] = MQTT_API_THINGS "%s"MQTT_API_JOBS_NOTIFY_NEXT;            /*!< Topic template to notify next . */
 static const char pOtaJobStatusTopicTemplate[] = MQTT_API_THINGS "%s"MQTT_API_JOBS "%s"MQTT_API_UPDATE;         /*!< Topic template to update the current job. */
-static const char pOtaStreamDataTopicTemplate[] = MQTT_API_THINGS "%s"MQTT_API_STREAMS "%s"MQTT_API_DATA_CBOR;  /*!< Topic template to receive data over a stream. */
-static const char pOtaGetStreamTopicTemplate[] = MQTT_API_THINGS "%s"MQTT_API_STREAMS "%s"MQTT_API_GET_CBOR;    /*!< Topic template to request next data over a stream. */
+static const char pOtaStreamDataTopicTemplate[] = MQTT_API_THINGS "%s"MQTT_API_STREAMS "%s"MQTT_API_DATA_STREAM;  /*!< Topic template to receive data over a stream. */
+static const char pOtaGetStreamTopicTemplate[] = MQTT_API_THINGS "%s"MQTT_API_STREAMS "%s"MQTT_API_GET_STREAM;    /*!< Topic template to request next data over a stream. */
 
 static const char pOtaGetNextJobMsgTemplate[] = "{\"clientToken\":\"%u:%s\"}";                                  /*!< Used to specify client token id to authenticate job. */
 static const char pOtaStringReceive[] = "receive";                                                              /*!< Used to build the job receive template. */
@@ -144,6 +188,27 @@ static const char asciiDigits[] =
 #define TOPIC_GET_STREAM_BUFFER_SIZE           ( TOPIC_PLUS_THINGNAME_LEN( pOtaGetStreamTopicTemplate ) + STREAM_NAME_MAX_LEN )  /*!< Max buffer size for `streams/<stream_name>/get/cbor` topic. */
 #define MSG_GET_NEXT_BUFFER_SIZE               ( TOPIC_PLUS_THINGNAME_LEN( pOtaGetNextJobMsgTemplate ) + U32_MAX_LEN )           /*!< Max buffer size for message of `jobs/$next/get topic`. */
 
+/**
+ * @brief Buffer to store the topic generated for receiving the data stream.
+ *
+ * It is kept for the duration of the file transfer so it can be passed as the
+ * MQTT 5 response topic of the stream requests.
+ */
+static char pRxStreamTopic[ TOPIC_STREAM_DATA_BUFFER_SIZE ];
+static uint16_t rxStreamTopicLen = 0; /*!< Length of the topic in pRxStreamTopic. */
+
+#if ( otaconfigENABLE_MQTT_JSON_STREAM != 1U )
+
+/**
+ * @brief Get Stream request of the file transfer.
+ *
+ * The request is encoded once per file transfer, the next requests only write
+ * the block bitmap and the other fields that change into it.
+ */
+    static uint8_t pGetStreamRequestMsg[ OTA_REQUEST_MSG_MAX_SIZE ];
+    static OtaCborGetStreamRequest_t getStreamRequest = { 0 }; /*!< Positions of the fields in pGetStreamRequestMsg. */
+#endif
+
 /**
  * @brief Subscribe to the jobs notification topic (i.e. New file version available).
  *
@@ -182,6 +247,172 @@ static OtaMqttStatus_t publishStatusMessage( OtaAgentContext_t * pAgentCtx,
                                              uint32_t msgSize,
                                              uint8_t qos );
 
+/**
+ * @brief Publish a message, with the MQTT 5 properties if the MQTT interface supports them.
+ *
+ * @param[in] pAgentCtx Agent context which stores the mqtt interface.
+ * @param[in] pTopic Topic to publish to.
+ * @param[in] topicLen Length of the topic.
+ * @param[in] pMsg Message to publish.
+ * @param[in] msgSize Size of message to send.
+ * @param[in] qos Quality of service level for mqtt.
+ * @param[in] pProperties MQTT 5 properties of the message, ignored if publishWithProperties is NULL.
+ * @return OtaMqttStatus_t OtaMqttSuccess if the message is publish is successful.
+ */
+static OtaMqttStatus_t publishMessage( const OtaAgentContext_t * pAgentCtx,
+                                       const char * pTopic,
+                                       uint16_t topicLen,
+                                       const char * pMsg,
+                                       uint32_t msgSize,
+                                       uint8_t qos,
+                                       const OtaMqttPublishProperties_t * pProperties );
+
+/**
+ * @brief Decode a stream response in the format of the data stream.
+ *
+ * This function decodes a JSON stream response if otaconfigENABLE_MQTT_JSON_STREAM
+ * is enabled, and a CBOR stream response otherwise.
+ *
+ * @param[in] pMessageBuffer The message to be decoded.
+ * @param[in] messageSize     The size of the message in bytes.
+ * @param[out] pFileId        The server file ID.
+ * @param[out] pBlockId       The file block ID.
+ * @param[out] pBlockSize     The file block size.
+ * @param[in,out] pPayload    The buffer to decode the payload into.
+ * @param[in,out] pPayloadSize The size of the payload buffer, then the payload size.
+ *
+ * @return true if the message was decoded, false otherwise.
+ */
+static bool decodeStreamResponse_Mqtt( const uint8_t * pMessageBuffer,
+                                       size_t messageSize,
+                                       int32_t * pFileId,
+                                       int32_t * pBlockId,
+                                       int32_t * pBlockSize,
+                                       uint8_t ** pPayload,
+                                       size_t * pPayloadSize );
+
+/**
+ * @brief Skip the whitespace of a JSON stream response.
+ *
+ * @param[in] pJson The JSON stream response.
+ * @param[in] index Index to start at.
+ * @param[in] length Length of the JSON stream response.
+ * @return Index of the first character that is not whitespace, or length.
+ */
+static size_t skipStreamJsonSpace( const char * pJson,
+                                   size_t index,
+                                   size_t length );
+
+/**
+ * @brief Count the decimal digits of a JSON stream response.
+ *
+ * @param[in] pJson The JSON stream response.
+ * @param[in] index Index to start at.
+ * @param[in] length Length of the JSON stream response.
+ * @return Number of decimal digits starting at index.
+ */
+static size_t countStreamJsonDigits( const char * pJson,
+                                     size_t index,
+                                     size_t length );
+
+/**
+ * @brief Check a string of a JSON stream response and step over it.
+ *
+ * @param[in] pJson The JSON stream response.
+ * @param[in] length Length of the JSON stream response.
+ * @param[in,out] pIndex Index of the opening quote, then of the character after the closing quote.
+ * @return true if the string is a valid JSON string, false otherwise.
+ */
+static bool scanStreamJsonString( const char * pJson,
+                                  size_t length,
+                                  size_t * pIndex );
+
+/**
+ * @brief Check a non-negative integer of a JSON stream response and step over it.
+ *
+ * @param[in] pJson The JSON stream response.
+ * @param[in] length Length of the JSON stream response.
+ * @param[in,out] pIndex Index of the first digit, then of the character after the last one.
+ * @param[out] pValue The value of the integer.
+ * @return true if the value is a non-negative integer that fits in a int32_t.
+ */
+static bool scanStreamJsonInt32( const char * pJson,
+                                 size_t length,
+                                 size_t * pIndex,
+                                 int32_t * pValue );
+
+/**
+ * @brief Check a number of a JSON stream response and step over it.
+ *
+ * @param[in] pJson The JSON stream response.
+ * @param[in] length Length of the JSON stream response.
+ * @param[in,out] pIndex Index of the number, then of the character after it.
+ * @return true if the value is a valid JSON number, false otherwise.
+ */
+static bool scanStreamJsonNumber( const char * pJson,
+                                  size_t length,
+                                  size_t * pIndex );
+
+/**
+ * @brief Check a value of a key of a JSON stream response that is not decoded and step over it.
+ *
+ * @param[in] pJson The JSON stream response.
+ * @param[in] length Length of the JSON stream response.
+ * @param[in,out] pIndex Index of the value, then of the character after it.
+ * @return true if the value is valid JSON, false otherwise.
+ */
+static bool scanStreamJsonValue( const char * pJson,
+                                 size_t length,
+                                 size_t * pIndex );
+
+/**
+ * @brief Check a member of a JSON stream response and decode its value if it has one of the response keys.
+ *
+ * Only the first member with a response key is decoded, the value of any later
+ * one with the same key is checked and skipped.
+ *
+ * @param[in] pJson The JSON stream response.
+ * @param[in] length Length of the JSON stream response.
+ * @param[in] keyIndex Index of the first character of the key of the member.
+ * @param[in] keyLength Length of the key of the member.
+ * @param[in,out] pIndex Index of the value of the member, then of the character after it.
+ * @param[in,out] pResponse The fields of the stream response decoded so far.
+ * @return true if the value is valid, false otherwise.
+ */
+static bool scanStreamJsonMember( const char * pJson,
+                                  size_t length,
+                                  size_t keyIndex,
+                                  size_t keyLength,
+                                  size_t * pIndex,
+                                  StreamResponseJson_t * pResponse );
+
+#if ( otaconfigENABLE_MQTT_JSON_STREAM != 1U )
+
+/**
+ * @brief Decode a CBOR stream response with one block in a single pass and copy its payload.
+ *
+ * A response in the layout of the service is decoded without tinycbor, any other one
+ * in a single pass over its map with tinycbor.
+ *
+ * @param[in] pMessageBuffer The message to be decoded.
+ * @param[in] messageSize     The size of the message in bytes.
+ * @param[out] pFileId        The server file ID.
+ * @param[out] pBlockId       The file block ID.
+ * @param[out] pBlockSize     The file block size.
+ * @param[in,out] pPayload    The buffer to copy the payload into.
+ * @param[in,out] pPayloadSize The size of the payload buffer, then the payload size.
+ * @return true if the message was decoded, false if it is not a response with one block, its
+ * payload is chunked or does not fit the buffer.
+ */
+    static bool decodeStreamResponseView_Mqtt( const uint8_t * pMessageBuffer,
+                                               size_t messageSize,
+                                               int32_t * pFileId,
+                                               int32_t * pBlockId,
+                                               int32_t * pBlockSize,
+                                               uint8_t ** pPayload,
+                                               size_t * pPayloadSize );
+#endif
+
 /**
  * @brief Populate the message buffer with the job status message.
  *
@@ -299,11 +530,12 @@ static size_t stringBuilderUInt32Decimal( char * pBuffer,
 
     assert( bufferSizeBytes >= U32_MAX_LEN );
 
-    while( value )
+    /* Render at least one digit so zero is not an empty string. */
+    do
     {
         *pCur++ = asciiDigits[ ( value % 10 ) ];
         value /= 10;
-    }
+    } while( value );
 
     while( pCur > workBuf )
     {
@@ -454,7 +686,7 @@ static OtaMqttStatus_t unsubscribeFromDataStream( const OtaAgentContext_t * pAge
         NULL, /* Thing Name not available at compile time, initialized below. */
         MQTT_API_STREAMS,
         NULL, /* Stream Name not available at compile time, initialized below. */
-        MQTT_API_DATA_CBOR,
+        MQTT_API_DATA_STREAM,
         NULL
     };
 
@@ -585,6 +817,43 @@ static OtaMqttStatus_t unsubscribeFromJobNotificationTopic( const OtaAgentContex
     return mqttStatus;
 }
 
+/*
+ * Publish a message, with the MQTT 5 properties if the MQTT interface supports them.
+ */
+static OtaMqttStatus_t publishMessage( const OtaAgentContext_t * pAgentCtx,
+                                       const char * pTopic,
+                                       uint16_t topicLen,
+                                       const char * pMsg,
+                                       uint32_t msgSize,
+                                       uint8_t qos,
+                                       const OtaMqttPublishProperties_t * pProperties )
+{
+    OtaMqttStatus_t mqttStatus = OtaMqttSuccess;
+
+    assert( pAgentCtx != NULL );
+    assert( pProperties != NULL );
+
+    if( pAgentCtx->pOtaInterface->mqtt.publishWithProperties != NULL )
+    {
+        mqttStatus = pAgentCtx->pOtaInterface->mqtt.publishWithProperties( pTopic,
+                                                                           topicLen,
+                                                                           pMsg,
+                                                                           msgSize,
+                                                                           qos,
+                                                                           pProperties );
+    }
+    else
+    {
+        mqttStatus = pAgentCtx->pOtaInterface->mqtt.publish( pTopic,
+                                                             topicLen,
+                                                             pMsg,
+                                                             msgSize,
+                                                             qos );
+    }
+
+    return mqttStatus;
+}
+
 /*
  * Publish a message to the job status topic.
  */
@@ -595,6 +864,7 @@ static OtaMqttStatus_t publishStatusMessage( OtaAgentContext_t * pAgentCtx,
 {
     OtaMqttStatus_t mqttStatus = OtaMqttSuccess;
     size_t topicLen = 0;
+    OtaMqttPublishProperties_t properties = { 0 };
 
     /* This buffer is used to store the generated MQTT topic. The static size
      * is calculated from the template and the corresponding parameters. */
@@ -632,11 +902,17 @@ static OtaMqttStatus_t publishStatusMessage( OtaAgentContext_t * pAgentCtx,
                 "message=%s",
                 pMsg ) );
 
-    mqttStatus = pAgentCtx->pOtaInterface->mqtt.publish( pTopicBuffer,
-                                                         ( uint16_t ) topicLen,
-                                                         &pMsg[ 0 ],
-                                                         msgSize,
-                                                         qos );
+    /* The topic changes with every job, the MQTT client rebinds the alias
+     * when it is published with a different topic. */
+    properties.topicAlias = otaconfigMQTT_TOPIC_ALIAS_JOB_STATUS;
+
+    mqttStatus = publishMessage( pAgentCtx,
+                                 pTopicBuffer,
+                                 ( uint16_t ) topicLen,
+                                 &pMsg[ 0 ],
+                                 msgSize,
+                                 qos,
+                                 &properties );
 
     if( mqttStatus == OtaMqttSuccess )
     {
@@ -675,12 +951,13 @@ static uint32_t buildStatusMessageReceiving( char * pMsgBuffer,
     const char * payloadStringParts[] =
     {
         NULL, /* Job status is not available at compile time, initialized below. */
+        "\"",
         pOtaStringReceive,
-        ":",
+        "\":\"",
         NULL, /* Received string is not available at compile time, initialized below. */
         "/",
         NULL, /* # blocks string is not available at compile time, initialized below. */
-        "}}",
+        "\"}}",
         NULL
     };
 
@@ -692,22 +969,20 @@ static uint32_t buildStatusMessageReceiving( char * pMsgBuffer,
     received = numBlocks - pOTAFileCtx->blocksRemaining;
 
     payloadStringParts[ 0 ] = pOtaJobStatusStrings[ status ];
-    payloadStringParts[ 3 ] = receivedString;
-    payloadStringParts[ 5 ] = numBlocksString;
+    payloadStringParts[ 4 ] = receivedString;
+    payloadStringParts[ 6 ] = numBlocksString;
 
     ( void ) stringBuilderUInt32Decimal( receivedString, sizeof( receivedString ), received );
-    ( void ) stringBuilderUInt32Decimal( numBlocksString, sizeof( numBlocksString ), received );
+    ( void ) stringBuilderUInt32Decimal( numBlocksString, sizeof( numBlocksString ), numBlocks );
 
-    if( ( received % otaconfigOTA_UPDATE_STATUS_FREQUENCY ) == 0U ) /* Output a status update once in a while. */
-    {
-        msgSize = ( uint32_t ) stringBuilder(
-            pMsgBuffer,
-            msgBufferSize,
-            payloadStringParts );
+    /* The agent rate limits the progress updates, so always build the message. */
+    msgSize = ( uint32_t ) stringBuilder(
+        pMsgBuffer,
+        msgBufferSize,
+        payloadStringParts );
 
-        /* The buffer is static and the size is calculated to fit. */
-        assert( ( msgSize > 0U ) && ( msgSize < msgBufferSize ) );
-    }
+    /* The buffer is static and the size is calculated to fit. */
+    assert( ( msgSize > 0U ) && ( msgSize < msgBufferSize ) );
 
     return msgSize;
 }
@@ -1042,9 +1317,6 @@ OtaErr_t initFileTransfer_Mqtt( OtaAgentContext_t * pAgentCtx )
     OtaErr_t result = OtaErrInitFileTransferFailed;
     OtaMqttStatus_t mqttStatus = OtaMqttSuccess;
 
-    /* This buffer is used to store the generated MQTT topic. The static size
-     * is calculated from the template and the corresponding parameters. */
-    static char pRxStreamTopic[ TOPIC_STREAM_DATA_BUFFER_SIZE ]; /*!< Buffer to store the topic generated for requesting data stream. */
     uint16_t topicLen = 0;
     const OtaFileContext_t * pFileContext = NULL;
 
@@ -1055,7 +1327,7 @@ OtaErr_t initFileTransfer_Mqtt( OtaAgentContext_t * pAgentCtx )
         NULL, /* Thing Name not available at compile time, initialized below. */
         MQTT_API_STREAMS,
         NULL, /* Stream Name not available at compile time, initialized below. */
-        MQTT_API_DATA_CBOR,
+        MQTT_API_DATA_STREAM,
         NULL
     };
 
@@ -1065,6 +1337,11 @@ OtaErr_t initFileTransfer_Mqtt( OtaAgentContext_t * pAgentCtx )
     pTopicParts[ 1 ] = ( const char * ) pAgentCtx->pThingName;
     pTopicParts[ 3 ] = ( const char * ) pFileContext->pStreamName;
 
+    #if ( otaconfigENABLE_MQTT_JSON_STREAM != 1U )
+        /* The Get Stream request of the new file is encoded with its first request. */
+        getStreamRequest.messageSize = 0;
+    #endif
+
     topicLen = ( uint16_t ) stringBuilder(
         pRxStreamTopic,
         sizeof( pRxStreamTopic ),
@@ -1072,6 +1349,7 @@ OtaErr_t initFileTransfer_Mqtt( OtaAgentContext_t * pAgentCtx )
 
     /* The buffer is static and the size is calculated to fit. */
     assert( ( topicLen > 0U ) && ( topicLen < sizeof( pRxStreamTopic ) ) );
+    rxStreamTopicLen = topicLen;
 
     mqttStatus = pAgentCtx->pOtaInterface->mqtt.subscribe( pRxStreamTopic,
                                                            topicLen,
@@ -1101,6 +1379,17 @@ OtaErr_t initFileTransfer_Mqtt( OtaAgentContext_t * pAgentCtx )
  * Request file block by publishing to the get stream topic.
  */
 OtaErr_t requestFileBlock_Mqtt( OtaAgentContext_t * pAgentCtx )
+{
+    assert( pAgentCtx != NULL );
+
+    return requestFileBlockBitmap_Mqtt( pAgentCtx, pAgentCtx->fileContext.pRxBlockBitmap );
+}
+
+/*
+ * Request the file blocks set in the bitmap by publishing to the get stream topic.
+ */
+OtaErr_t requestFileBlockBitmap_Mqtt( OtaAgentContext_t * pAgentCtx,
+                                      const uint8_t * pBitmap )
 {
     OtaErr_t result = OtaErrRequestFileBlockFailed;
     OtaMqttStatus_t mqttStatus = OtaMqttSuccess;
@@ -1110,8 +1399,13 @@ OtaErr_t requestFileBlock_Mqtt( OtaAgentContext_t * pAgentCtx )
     uint32_t bitmapLen = 0;
     uint32_t msgSizeToPublish = 0;
     uint32_t topicLen = 0;
-    bool cborEncodeRet = false;
-    char pMsg[ OTA_REQUEST_MSG_MAX_SIZE ];
+    bool encodeRet = false;
+    const char * pRequestMsg = NULL;
+    OtaMqttPublishProperties_t properties = { 0 };
+
+    #if ( otaconfigENABLE_MQTT_JSON_STREAM == 1U )
+        char pMsg[ OTA_REQUEST_MSG_MAX_SIZE ];
+    #endif
 
     /* This buffer is used to store the generated MQTT topic. The static size
      * is calculated from the template and the corresponding parameters. */
@@ -1125,12 +1419,14 @@ OtaErr_t requestFileBlock_Mqtt( OtaAgentContext_t * pAgentCtx )
         NULL, /* Thing Name not available at compile time, initialized below. */
         MQTT_API_STREAMS,
         NULL, /* Stream Name not available at compile time, initialized below. */
-        MQTT_API_GET_CBOR,
+        MQTT_API_GET_STREAM,
         NULL
     };
 
     assert( pAgentCtx != NULL );
 
+    assert( pBitmap != NULL );
+
     /* Get the current file context. */
     pFileContext = &( pAgentCtx->fileContext );
 
@@ -1143,18 +1439,50 @@ OtaErr_t requestFileBlock_Mqtt( OtaAgentContext_t * pAgentCtx )
     numBlocks = ( pFileContext->fileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
     bitmapLen = ( numBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
 
-    cborEncodeRet = OTA_CBOR_Encode_GetStreamRequestMessage( ( uint8_t * ) pMsg,
-                                                             sizeof( pMsg ),
-                                                             &msgSizeFromStream,
-                                                             OTA_CLIENT_TOKEN,
-                                                             ( int32_t ) pFileContext->serverFileID,
-                                                             ( int32_t ) blockSize,
-                                                             0,
-                                                             pFileContext->pRxBlockBitmap,
-                                                             bitmapLen,
-                                                             ( int32_t ) otaconfigMAX_NUM_BLOCKS_REQUEST );
+    #if ( otaconfigENABLE_MQTT_JSON_STREAM == 1U )
+        encodeRet = encodeStreamRequestJson_Mqtt( pMsg,
+                                                  sizeof( pMsg ),
+                                                  &msgSizeFromStream,
+                                                  OTA_CLIENT_TOKEN,
+                                                  ( int32_t ) pFileContext->serverFileID,
+                                                  ( int32_t ) blockSize,
+                                                  0,
+                                                  pBitmap,
+                                                  bitmapLen,
+                                                  ( int32_t ) otaconfigMAX_NUM_BLOCKS_REQUEST );
+        pRequestMsg = pMsg;
+    #else
+        /* Encode the request once per transfer, the next ones only copy the bitmap into it. */
+        if( ( getStreamRequest.messageSize == 0U ) || ( getStreamRequest.blockBitmapSize != bitmapLen ) )
+        {
+            encodeRet = OTA_CBOR_Encode_GetStreamRequestTemplate( pGetStreamRequestMsg,
+                                                                  sizeof( pGetStreamRequestMsg ),
+                                                                  &getStreamRequest,
+                                                                  OTA_CLIENT_TOKEN,
+                                                                  ( int32_t ) pFileContext->serverFileID,
+                                                                  ( int32_t ) blockSize,
+                                                                  bitmapLen );
+        }
+        else
+        {
+            encodeRet = true;
+        }
 
-    if( cborEncodeRet == true )
+        if( encodeRet == true )
+        {
+            encodeRet = OTA_CBOR_Patch_GetStreamRequestMessage( pGetStreamRequestMsg,
+                                                                &getStreamRequest,
+                                                                0,
+                                                                pBitmap,
+                                                                bitmapLen,
+                                                                ( int32_t ) otaconfigMAX_NUM_BLOCKS_REQUEST );
+        }
+
+        msgSizeFromStream = getStreamRequest.messageSize;
+        pRequestMsg = ( const char * ) pGetStreamRequestMsg;
+    #endif /* if ( otaconfigENABLE_MQTT_JSON_STREAM == 1U ) */
+
+    if( encodeRet == true )
     {
         msgSizeToPublish = ( uint32_t ) msgSizeFromStream;
 
@@ -1168,11 +1496,21 @@ OtaErr_t requestFileBlock_Mqtt( OtaAgentContext_t * pAgentCtx )
         /* The buffer is static and the size is calculated to fit. */
         assert( ( topicLen > 0U ) && ( topicLen < sizeof( pTopicBuffer ) ) );
 
-        mqttStatus = pAgentCtx->pOtaInterface->mqtt.publish( pTopicBuffer,
-                                                             ( uint16_t ) topicLen,
-                                                             &pMsg[ 0 ],
-                                                             msgSizeToPublish,
-                                                             0 );
+        /* The request topic is the same for every block of the file, so after
+         * the first request only the alias is sent. The data topic is passed as
+         * the response topic so the stream replies can be routed without
+         * matching the topic. */
+        properties.topicAlias = otaconfigMQTT_TOPIC_ALIAS_GET_STREAM;
+        properties.pResponseTopic = pRxStreamTopic;
+        properties.responseTopicLength = rxStreamTopicLen;
+
+        mqttStatus = publishMessage( pAgentCtx,
+                                     pTopicBuffer,
+                                     ( uint16_t ) topicLen,
+                                     pRequestMsg,
+                                     msgSizeToPublish,
+                                     0,
+                                     &properties );
 
         if( mqttStatus == OtaMqttSuccess )
         {
@@ -1192,13 +1530,587 @@ OtaErr_t requestFileBlock_Mqtt( OtaAgentContext_t * pAgentCtx )
     else
     {
         result = OtaErrFailedToEncodeCbor;
-        LogError( ( "Failed to CBOR encode stream request message: "
-                    "OTA_CBOR_Encode_GetStreamRequestMessage returned error." ) );
+        LogError( ( "Failed to encode stream request message: "
+                    "Message does not fit in the buffer." ) );
     }
 
     return result;
 }
 
+static size_t skipStreamJsonSpace( const char * pJson,
+                                   size_t index,
+                                   size_t length )
+{
+    size_t i = index;
+
+    while( ( i < length ) &&
+           ( ( pJson[ i ] == ' ' ) || ( pJson[ i ] == '\t' ) || ( pJson[ i ] == '\n' ) || ( pJson[ i ] == '\r' ) ) )
+    {
+        i++;
+    }
+
+    return i;
+}
+
+static size_t countStreamJsonDigits( const char * pJson,
+                                     size_t index,
+                                     size_t length )
+{
+    size_t i = index;
+
+    while( ( i < length ) && ( pJson[ i ] >= '0' ) && ( pJson[ i ] <= '9' ) )
+    {
+        i++;
+    }
+
+    return i - index;
+}
+
+static bool scanStreamJsonString( const char * pJson,
+                                  size_t length,
+                                  size_t * pIndex )
+{
+    bool valid = true;
+    bool closed = false;
+    size_t i = *pIndex + 1U;
+    size_t j = 0;
+
+    while( ( valid == true ) && ( closed == false ) )
+    {
+        if( i >= length )
+        {
+            valid = false;
+        }
+        else if( pJson[ i ] == '"' )
+        {
+            closed = true;
+            i++;
+        }
+        else if( pJson[ i ] == '\\' )
+        {
+            if( ( ( i + 1U ) < length ) && ( pJson[ i + 1U ] != '\0' ) &&
+                ( strchr( "\"\\/bfnrt", ( int ) pJson[ i + 1U ] ) != NULL ) )
+            {
+                i += 2U;
+            }
+            else if( ( ( i + 5U ) < length ) && ( pJson[ i + 1U ] == 'u' ) )
+            {
+                /* A \u escape has four hex digits. */
+                for( j = i + 2U; ( valid == true ) && ( j < ( i + 6U ) ); j++ )
+                {
+                    valid = ( ( pJson[ j ] >= '0' ) && ( pJson[ j ] <= '9' ) ) ||
+                            ( ( pJson[ j ] >= 'a' ) && ( pJson[ j ] <= 'f' ) ) ||
+                            ( ( pJson[ j ] >= 'A' ) && ( pJson[ j ] <= 'F' ) );
+                }
+
+                i += 6U;
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else if( ( uint8_t ) pJson[ i ] < 0x20U )
+        {
+            /* Control characters must be escaped. */
+            valid = false;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    *pIndex = i;
+
+    return valid;
+}
+
+static bool scanStreamJsonInt32( const char * pJson,
+                                 size_t length,
+                                 size_t * pIndex,
+                                 int32_t * pValue )
+{
+    bool valid = false;
+    uint32_t value = 0;
+    size_t digits = countStreamJsonDigits( pJson, *pIndex, length );
+    size_t i = *pIndex;
+
+    /* Only plain decimal digits without leading zeros, and no more than fit in a int32_t. */
+    if( ( digits > 0U ) && ( ( digits == 1U ) || ( pJson[ i ] != '0' ) ) )
+    {
+        valid = true;
+
+        for( i = *pIndex; ( valid == true ) && ( i < ( *pIndex + digits ) ); i++ )
+        {
+            if( value > ( ( ( uint32_t ) INT32_MAX - ( uint32_t ) ( pJson[ i ] - '0' ) ) / 10U ) )
+            {
+                valid = false;
+            }
+            else
+            {
+                value = ( value * 10U ) + ( uint32_t ) ( pJson[ i ] - '0' );
+            }
+        }
+    }
+
+    if( valid == true )
+    {
+        *pValue = ( int32_t ) value;
+        *pIndex = i;
+    }
+
+    return valid;
+}
+
+static bool scanStreamJsonNumber( const char * pJson,
+                                  size_t length,
+                                  size_t * pIndex )
+{
+    bool valid = false;
+    size_t digits = 0;
+    size_t i = *pIndex;
+
+    if( ( i < length ) && ( pJson[ i ] == '-' ) )
+    {
+        i++;
+    }
+
+    /* An integer part without leading zeros, then an optional fraction and exponent. */
+    digits = countStreamJsonDigits( pJson, i, length );
+    valid = ( digits > 0U ) && ( ( digits == 1U ) || ( pJson[ i ] != '0' ) );
+    i += digits;
+
+    if( ( valid == true ) && ( i < length ) && ( pJson[ i ] == '.' ) )
+    {
+        digits = countStreamJsonDigits( pJson, i + 1U, length );
+        valid = ( digits > 0U );
+        i += digits + 1U;
+    }
+
+    if( ( valid == true ) && ( i < length ) && ( ( pJson[ i ] == 'e' ) || ( pJson[ i ] == 'E' ) ) )
+    {
+        i++;
+
+        if( ( i < length ) && ( ( pJson[ i ] == '+' ) || ( pJson[ i ] == '-' ) ) )
+        {
+            i++;
+        }
+
+        digits = countStreamJsonDigits( pJson, i, length );
+        valid = ( digits > 0U );
+        i += digits;
+    }
+
+    *pIndex = i;
+
+    return valid;
+}
+
+static bool scanStreamJsonValue( const char * pJson,
+                                 size_t length,
+                                 size_t * pIndex )
+{
+    bool valid = false;
+    size_t i = *pIndex;
+    size_t depth = 0;
+
+    if( i >= length )
+    {
+        valid = false;
+    }
+    else if( pJson[ i ] == '"' )
+    {
+        valid = scanStreamJsonString( pJson, length, &i );
+    }
+    else if( ( pJson[ i ] == '{' ) || ( pJson[ i ] == '[' ) )
+    {
+        /* Find the end of the object or array, then let coreJSON check it. */
+        valid = true;
+        depth = 1U;
+        i++;
+
+        while( ( valid == true ) && ( depth > 0U ) )
+        {
+            if( i >= length )
+            {
+                valid = false;
+            }
+            else if( pJson[ i ] == '"' )
+            {
+                valid = scanStreamJsonString( pJson, length, &i );
+            }
+            else
+            {
+                if( ( pJson[ i ] == '{' ) || ( pJson[ i ] == '[' ) )
+                {
+                    depth++;
+                }
+                else if( ( pJson[ i ] == '}' ) || ( pJson[ i ] == ']' ) )
+                {
+                    depth--;
+                }
+                else
+                {
+                    /* Empty else MISRA 15.7 */
+                }
+
+                i++;
+            }
+        }
+
+        valid = ( valid == true ) && ( JSON_Validate( &pJson[ *pIndex ], i - *pIndex ) == JSONSuccess );
+    }
+    else if( ( ( length - i ) >= CONST_STRLEN( "true" ) ) && ( strncmp( &pJson[ i ], "true", CONST_STRLEN( "true" ) ) == 0 ) )
+    {
+        valid = true;
+        i += CONST_STRLEN( "true" );
+    }
+    else if( ( ( length - i ) >= CONST_STRLEN( "false" ) ) && ( strncmp( &pJson[ i ], "false", CONST_STRLEN( "false" ) ) == 0 ) )
+    {
+        valid = true;
+        i += CONST_STRLEN( "false" );
+    }
+    else if( ( ( length - i ) >= CONST_STRLEN( "null" ) ) && ( strncmp( &pJson[ i ], "null", CONST_STRLEN( "null" ) ) == 0 ) )
+    {
+        valid = true;
+        i += CONST_STRLEN( "null" );
+    }
+    else
+    {
+        valid = scanStreamJsonNumber( pJson, length, &i );
+    }
+
+    *pIndex = i;
+
+    return valid;
+}
+
+static bool scanStreamJsonMember( const char * pJson,
+                                  size_t length,
+                                  size_t keyIndex,
+                                  size_t keyLength,
+                                  size_t * pIndex,
+                                  StreamResponseJson_t * pResponse )
+{
+    bool valid = false;
+    size_t i = *pIndex;
+    char key = ( keyLength == 1U ) ? pJson[ keyIndex ] : '\0';
+
+    /* The keys of a stream response are all one character long. */
+    if( ( key == OTA_JSON_FILEID_KEY[ 0 ] ) && ( ( pResponse->fieldsFound & OTA_JSON_FIELD_FILEID ) == 0U ) )
+    {
+        valid = scanStreamJsonInt32( pJson, length, &i, &pResponse->fileId );
+        pResponse->fieldsFound |= OTA_JSON_FIELD_FILEID;
+    }
+    else if( ( key == OTA_JSON_BLOCKID_KEY[ 0 ] ) && ( ( pResponse->fieldsFound & OTA_JSON_FIELD_BLOCKID ) == 0U ) )
+    {
+        valid = scanStreamJsonInt32( pJson, length, &i, &pResponse->blockId );
+        pResponse->fieldsFound |= OTA_JSON_FIELD_BLOCKID;
+    }
+    else if( ( key == OTA_JSON_BLOCKSIZE_KEY[ 0 ] ) && ( ( pResponse->fieldsFound & OTA_JSON_FIELD_BLOCKSIZE ) == 0U ) )
+    {
+        valid = scanStreamJsonInt32( pJson, length, &i, &pResponse->blockSize );
+        pResponse->fieldsFound |= OTA_JSON_FIELD_BLOCKSIZE;
+    }
+    else if( ( key == OTA_JSON_BLOCKPAYLOAD_KEY[ 0 ] ) && ( ( pResponse->fieldsFound & OTA_JSON_FIELD_BLOCKPAYLOAD ) == 0U ) )
+    {
+        valid = ( i < length ) && ( pJson[ i ] == '"' ) && ( scanStreamJsonString( pJson, length, &i ) == true );
+        pResponse->payloadIndex = *pIndex + 1U;
+        pResponse->payloadLength = ( valid == true ) ? ( i - pResponse->payloadIndex - 1U ) : 0U;
+        pResponse->fieldsFound |= OTA_JSON_FIELD_BLOCKPAYLOAD;
+    }
+    else
+    {
+        valid = scanStreamJsonValue( pJson, length, &i );
+    }
+
+    *pIndex = i;
+
+    return valid;
+}
+
+/*
+ * Encode a JSON stream request message.
+ */
+bool encodeStreamRequestJson_Mqtt( char * pMessageBuffer,
+                                   size_t messageBufferSize,
+                                   size_t * pEncodedMessageSize,
+                                   const char * pClientToken,
+                                   int32_t fileId,
+                                   int32_t blockSize,
+                                   int32_t blockOffset,
+                                   const uint8_t * pBlockBitmap,
+                                   size_t blockBitmapSize,
+                                   int32_t numOfBlocksRequested )
+{
+    bool encodeRet = false;
+    char fileIdString[ U32_MAX_LEN + 1 ];
+    char blockSizeString[ U32_MAX_LEN + 1 ];
+    char blockOffsetString[ U32_MAX_LEN + 1 ];
+    char numOfBlocksString[ U32_MAX_LEN + 1 ];
+
+    /* The bitmap is Base64 encoded in JSON stream requests. */
+    char bitmapString[ ( ( ( OTA_MAX_BLOCK_BITMAP_SIZE + 2U ) / 3U ) * 4U ) + 1U ];
+    size_t bitmapStringLength = 0;
+    size_t messageLength = 0;
+    int i;
+
+    /* NULL-terminated list of JSON payload components */
+    /* NOTE: this must conform to the following format, do not add spaces, etc. */
+    /*       "{\"c\":\"%s\",\"f\":%u,\"l\":%u,\"o\":%u,\"n\":%u,\"b\":\"%s\"}" */
+    const char * pMessageParts[] =
+    {
+        "{\"" OTA_JSON_CLIENTTOKEN_KEY "\":\"",
+        NULL, /* Client token, initialized below. */
+        "\",\"" OTA_JSON_FILEID_KEY "\":",
+        NULL, /* File ID, initialized below. */
+        ",\"" OTA_JSON_BLOCKSIZE_KEY "\":",
+        NULL, /* Block size, initialized below. */
+        ",\"" OTA_JSON_BLOCKOFFSET_KEY "\":",
+        NULL, /* Block offset, initialized below. */
+        ",\"" OTA_JSON_NUMBEROFBLOCKS_KEY "\":",
+        NULL, /* Number of blocks, initialized below. */
+        ",\"" OTA_JSON_BLOCKBITMAP_KEY "\":\"",
+        NULL, /* Block bitmap, initialized below. */
+        "\"}",
+        NULL
+    };
+
+    if( ( pMessageBuffer != NULL ) && ( pEncodedMessageSize != NULL ) &&
+        ( pClientToken != NULL ) && ( pBlockBitmap != NULL ) &&
+        ( fileId >= 0 ) && ( blockSize >= 0 ) && ( blockOffset >= 0 ) && ( numOfBlocksRequested >= 0 ) &&
+        ( base64Encode( ( uint8_t * ) bitmapString,
+                        sizeof( bitmapString ) - 1U,
+                        &bitmapStringLength,
+                        pBlockBitmap,
+                        blockBitmapSize ) == Base64Success ) )
+    {
+        bitmapString[ bitmapStringLength ] = '\0';
+
+        ( void ) stringBuilderUInt32Decimal( fileIdString, sizeof( fileIdString ), ( uint32_t ) fileId );
+        ( void ) stringBuilderUInt32Decimal( blockSizeString, sizeof( blockSizeString ), ( uint32_t ) blockSize );
+        ( void ) stringBuilderUInt32Decimal( blockOffsetString, sizeof( blockOffsetString ), ( uint32_t ) blockOffset );
+        ( void ) stringBuilderUInt32Decimal( numOfBlocksString, sizeof( numOfBlocksString ), ( uint32_t ) numOfBlocksRequested );
+
+        pMessageParts[ 1 ] = pClientToken;
+        pMessageParts[ 3 ] = fileIdString;
+        pMessageParts[ 5 ] = blockSizeString;
+        pMessageParts[ 7 ] = blockOffsetString;
+        pMessageParts[ 9 ] = numOfBlocksString;
+        pMessageParts[ 11 ] = bitmapString;
+
+        /* The message buffer is given by the caller, so check that it fits before building it. */
+        for( i = 0; pMessageParts[ i ] != NULL; i++ )
+        {
+            messageLength += strlen( pMessageParts[ i ] );
+        }
+
+        if( messageLength < messageBufferSize )
+        {
+            *pEncodedMessageSize = stringBuilder( pMessageBuffer, messageBufferSize, pMessageParts );
+            encodeRet = true;
+        }
+    }
+
+    return encodeRet;
+}
+
+/*
+ * Decode a JSON stream response message.
+ */
+bool decodeStreamResponseJson_Mqtt( const uint8_t * pMessageBuffer,
+                                    size_t messageSize,
+                                    int32_t * pFileId,
+                                    int32_t * pBlockId,
+                                    int32_t * pBlockSize,
+                                    uint8_t ** pPayload,
+                                    size_t * pPayloadSize )
+{
+    bool decodeRet = false;
+    bool closed = false;
+    const char * pJson = ( const char * ) pMessageBuffer;
+    StreamResponseJson_t response = { 0 };
+    size_t payloadSize = 0;
+    size_t keyIndex = 0;
+    size_t keyLength = 0;
+    size_t i = 0;
+
+    if( ( pMessageBuffer != NULL ) && ( pFileId != NULL ) && ( pBlockId != NULL ) &&
+        ( pBlockSize != NULL ) && ( pPayload != NULL ) && ( *pPayload != NULL ) && ( pPayloadSize != NULL ) )
+    {
+        i = skipStreamJsonSpace( pJson, 0U, messageSize );
+        decodeRet = ( i < messageSize ) && ( pJson[ i ] == '{' );
+        i = skipStreamJsonSpace( pJson, i + 1U, messageSize );
+
+        if( ( decodeRet == true ) && ( i < messageSize ) && ( pJson[ i ] == '}' ) )
+        {
+            closed = true;
+            i++;
+        }
+    }
+
+    /* Check the message and decode its fields in a single walk over the members of the object. */
+    while( ( decodeRet == true ) && ( closed == false ) )
+    {
+        keyIndex = i + 1U;
+        decodeRet = ( i < messageSize ) && ( pJson[ i ] == '"' ) && ( scanStreamJsonString( pJson, messageSize, &i ) == true );
+
+        if( decodeRet == true )
+        {
+            keyLength = i - keyIndex - 1U;
+            i = skipStreamJsonSpace( pJson, i, messageSize );
+            decodeRet = ( i < messageSize ) && ( pJson[ i ] == ':' );
+            i = skipStreamJsonSpace( pJson, i + 1U, messageSize );
+            decodeRet = ( decodeRet == true ) && ( scanStreamJsonMember( pJson, messageSize, keyIndex, keyLength, &i, &response ) == true );
+            i = skipStreamJsonSpace( pJson, i, messageSize );
+        }
+
+        if( decodeRet == false )
+        {
+            /* Empty else MISRA 15.7 */
+        }
+        else if( ( i < messageSize ) && ( pJson[ i ] == ',' ) )
+        {
+            i = skipStreamJsonSpace( pJson, i + 1U, messageSize );
+        }
+        else if( ( i < messageSize ) && ( pJson[ i ] == '}' ) )
+        {
+            closed = true;
+            i++;
+        }
+        else
+        {
+            decodeRet = false;
+        }
+    }
+
+    /* Only whitespace may follow the object, and all the fields must be there. */
+    decodeRet = ( decodeRet == true ) &&
+                ( skipStreamJsonSpace( pJson, i, messageSize ) == messageSize ) &&
+                ( response.fieldsFound == OTA_JSON_FIELDS_ALL );
+
+    if( decodeRet == true )
+    {
+        /* Decode the payload straight into the decode buffer. */
+        decodeRet = ( base64Decode( *pPayload,
+                                    *pPayloadSize,
+                                    &payloadSize,
+                                    ( const uint8_t * ) &pJson[ response.payloadIndex ],
+                                    response.payloadLength ) == Base64Success );
+    }
+
+    if( decodeRet == true )
+    {
+        *pFileId = response.fileId;
+        *pBlockId = response.blockId;
+        *pBlockSize = response.blockSize;
+        *pPayloadSize = payloadSize;
+    }
+
+    return decodeRet;
+}
+
+#if ( otaconfigENABLE_MQTT_JSON_STREAM != 1U )
+
+/*
+ * Decode a CBOR stream response with one block in a single pass and copy its payload.
+ */
+    static bool decodeStreamResponseView_Mqtt( const uint8_t * pMessageBuffer,
+                                               size_t messageSize,
+                                               int32_t * pFileId,
+                                               int32_t * pBlockId,
+                                               int32_t * pBlockSize,
+                                               uint8_t ** pPayload,
+                                               size_t * pPayloadSize )
+    {
+        bool decodeRet = false;
+        const uint8_t * pPayloadView = NULL;
+        size_t payloadViewSize = 0;
+
+        if( ( pPayload != NULL ) && ( *pPayload != NULL ) && ( pPayloadSize != NULL ) )
+        {
+            /* Responses in the layout of the service are decoded without tinycbor. */
+            decodeRet = OTA_CBOR_Decode_GetStreamResponseMessageFast( pMessageBuffer,
+                                                                      messageSize,
+                                                                      pFileId,
+                                                                      pBlockId,
+                                                                      pBlockSize,
+                                                                      &pPayloadView,
+                                                                      &payloadViewSize );
+
+            if( decodeRet == false )
+            {
+                decodeRet = OTA_CBOR_Decode_GetStreamResponseMessageView( pMessageBuffer,
+                                                                          messageSize,
+                                                                          pFileId,
+                                                                          pBlockId,
+                                                                          pBlockSize,
+                                                                          &pPayloadView,
+                                                                          &payloadViewSize );
+            }
+        }
+
+        if( ( decodeRet == true ) && ( payloadViewSize <= *pPayloadSize ) )
+        {
+            ( void ) memcpy( *pPayload, pPayloadView, payloadViewSize );
+            *pPayloadSize = payloadViewSize;
+        }
+        else
+        {
+            decodeRet = false;
+        }
+
+        return decodeRet;
+    }
+#endif /* if ( otaconfigENABLE_MQTT_JSON_STREAM != 1U ) */
+
+/*
+ * Decode a stream response in the format of the data stream.
+ */
+static bool decodeStreamResponse_Mqtt( const uint8_t * pMessageBuffer,
+                                       size_t messageSize,
+                                       int32_t * pFileId,
+                                       int32_t * pBlockId,
+                                       int32_t * pBlockSize,
+                                       uint8_t ** pPayload,
+                                       size_t * pPayloadSize )
+{
+    bool decodeRet = false;
+
+    #if ( otaconfigENABLE_MQTT_JSON_STREAM == 1U )
+        decodeRet = decodeStreamResponseJson_Mqtt( pMessageBuffer,
+                                                   messageSize,
+                                                   pFileId,
+                                                   pBlockId,
+                                                   pBlockSize,
+                                                   pPayload,
+                                                   pPayloadSize );
+    #else
+        /* A chunked payload is copied by the decoder that looks up each key. */
+        decodeRet = decodeStreamResponseView_Mqtt( pMessageBuffer,
+                                                   messageSize,
+                                                   pFileId,
+                                                   pBlockId,
+                                                   pBlockSize,
+                                                   pPayload,
+                                                   pPayloadSize );
+
+        if( decodeRet == false )
+        {
+            decodeRet = OTA_CBOR_Decode_GetStreamResponseMessage( pMessageBuffer,
+                                                                  messageSize,
+                                                                  pFileId,
+                                                                  pBlockId,   /* CBOR requires pointer to int and our block indices never exceed 31 bits. */
+                                                                  pBlockSize, /* CBOR requires pointer to int and our block sizes never exceed 31 bits. */
+                                                                  pPayload,
+                                                                  pPayloadSize );
+        }
+    #endif /* if ( otaconfigENABLE_MQTT_JSON_STREAM == 1U ) */
+
+    return decodeRet;
+}
+
 /*
  * Decode a cbor encoded fileblock received from streaming service.
  */
@@ -1211,18 +2123,18 @@ OtaErr_t decodeFileBlock_Mqtt( const uint8_t * pMessageBuffer,
                                size_t * pPayloadSize )
 {
     OtaErr_t result = OtaErrFailedToDecodeCbor;
-    bool cborDecodeRet = false;
-
-    /* Decode the CBOR content. */
-    cborDecodeRet = OTA_CBOR_Decode_GetStreamResponseMessage( pMessageBuffer,
-                                                              messageSize,
-                                                              pFileId,
-                                                              pBlockId,   /* CBOR requires pointer to int and our block indices never exceed 31 bits. */
-                                                              pBlockSize, /* CBOR requires pointer to int and our block sizes never exceed 31 bits. */
-                                                              pPayload,   /* This payload gets malloc'd by OTA_CBOR_Decode_GetStreamResponseMessage(). We must free it. */
-                                                              pPayloadSize );
-
-    if( ( cborDecodeRet == true ) && ( pPayload != NULL ) )
+    bool decodeRet = false;
+
+    /* Decode the stream response. */
+    decodeRet = decodeStreamResponse_Mqtt( pMessageBuffer,
+                                           messageSize,
+                                           pFileId,
+                                           pBlockId,
+                                           pBlockSize,
+                                           pPayload,
+                                           pPayloadSize );
+
+    if( ( decodeRet == true ) && ( pPayload != NULL ) )
     {
         result = OtaErrNone;
 
@@ -1232,7 +2144,83 @@ OtaErr_t decodeFileBlock_Mqtt( const uint8_t * pMessageBuffer,
     else
     {
         LogError( ( "Failed to decode MQTT file block: "
-                    "OTA_CBOR_Decode_GetStreamResponseMessage returned error." ) );
+                    "decodeStreamResponse_Mqtt returned error." ) );
+    }
+
+    return result;
+}
+
+/*
+ * Decode a block of a stream response that may carry several blocks.
+ */
+OtaErr_t decodeFileBlockAt_Mqtt( const uint8_t * pMessageBuffer,
+                                 size_t messageSize,
+                                 uint32_t blockNumber,
+                                 int32_t * pFileId,
+                                 int32_t * pBlockId,
+                                 int32_t * pBlockSize,
+                                 uint8_t ** pPayload,
+                                 size_t * pPayloadSize,
+                                 uint32_t * pNumBlocks )
+{
+    OtaErr_t result = OtaErrFailedToDecodeCbor;
+    bool decodeRet = false;
+    size_t numBlocks = 0;
+
+    assert( pNumBlocks != NULL );
+
+    #if ( otaconfigENABLE_MQTT_JSON_STREAM == 1U )
+        /* JSON stream responses carry one block. */
+        if( blockNumber == 0U )
+        {
+            decodeRet = decodeStreamResponseJson_Mqtt( pMessageBuffer,
+                                                       messageSize,
+                                                       pFileId,
+                                                       pBlockId,
+                                                       pBlockSize,
+                                                       pPayload,
+                                                       pPayloadSize );
+            numBlocks = 1U;
+        }
+    #else
+        /* The first block of a response with one block is decoded in a single pass over the map. */
+        if( blockNumber == 0U )
+        {
+            decodeRet = decodeStreamResponseView_Mqtt( pMessageBuffer,
+                                                       messageSize,
+                                                       pFileId,
+                                                       pBlockId,
+                                                       pBlockSize,
+                                                       pPayload,
+                                                       pPayloadSize );
+            numBlocks = 1U;
+        }
+
+        if( decodeRet == false )
+        {
+            decodeRet = OTA_CBOR_Decode_GetStreamResponseMessageBlock( pMessageBuffer,
+                                                                       messageSize,
+                                                                       blockNumber,
+                                                                       pFileId,
+                                                                       pBlockId,
+                                                                       pBlockSize,
+                                                                       pPayload,
+                                                                       pPayloadSize,
+                                                                       &numBlocks );
+        }
+    #endif /* if ( otaconfigENABLE_MQTT_JSON_STREAM == 1U ) */
+
+    if( ( decodeRet == true ) && ( numBlocks <= otaconfigMQTT_MAX_BLOCKS_PER_RESPONSE ) )
+    {
+        result = OtaErrNone;
+        *pNumBlocks = ( uint32_t ) numBlocks;
+    }
+    else
+    {
+        LogError( ( "Failed to decode MQTT file block: "
+                    "Block number=%u, Number of blocks=%u",
+                    ( unsigned int ) blockNumber,
+                    ( unsigned int ) numBlocks ) );
     }
 
     return result;
@@ -0,0 +1,937 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/* splice is a Linux extension. */
+#if defined( __linux__ ) && !defined( _GNU_SOURCE )
+    #define _GNU_SOURCE
+#endif
+
+/* Standard Includes.*/
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <errno.h>
+
+/* Posix includes. */
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/* OTA HTTP POSIX Interface Includes.*/
+#include "ota_http_posix.h"
+
+/* OTA Library include. */
+#include "ota_private.h"
+
+#if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+    #ifndef __linux__
+        #error "The file sink of the POSIX HTTP client needs splice, which is only available on Linux."
+    #endif
+
+    #include <fcntl.h>
+#endif
+
+/* HTTP protocol constants. */
+#define HTTP_URL_SCHEME                "http://"
+#define HTTP_DEFAULT_PORT              "80"
+#define HTTP_MAX_PORT_SIZE             6U
+#define HTTP_HEADER_END                "\r\n\r\n"
+#define HTTP_HEADER_END_LENGTH         4U
+#define HTTP_STATUS_CODE_OFFSET        9U
+#define HTTP_STATUS_OK                 200UL
+#define HTTP_STATUS_PARTIAL_CONTENT    206UL
+#define HTTP_STATUS_FORBIDDEN          403UL
+#define HTTP_CONTENT_LENGTH_HEADER     "Content-Length:"
+#define HTTP_CONTENT_RANGE_HEADER      "Content-Range:"
+#define HTTP_CONNECTION_HEADER         "Connection:"
+#define HTTP_CONTENT_RANGE_UNIT        "bytes"
+#define HTTP_CONNECTION_CLOSE          "close"
+#define HTTP_MAX_REQUEST_SIZE          ( OTA_HTTP_POSIX_MAX_PATH_SIZE + OTA_HTTP_POSIX_MAX_HOST_SIZE + 128U )
+
+/**
+ * @brief A range request waiting for its response.
+ */
+typedef struct HttpPendingRequest
+{
+    uint32_t rangeStart; /*!< Starting index of the requested file data. */
+    uint32_t rangeEnd;   /*!< End index of the requested file data. */
+} HttpPendingRequest_t;
+
+/**
+ * @brief Part of the response that is being received.
+ */
+typedef enum HttpParseState
+{
+    HttpParseHeaders = 0, /*!< Waiting for the end of the status line and headers. */
+    HttpParseBody         /*!< Receiving the response body. */
+} HttpParseState_t;
+
+static bool parseUrl( const char * pUrl );
+static bool openConnection( void );
+static void closeConnection( void );
+static bool sendRequest( const char * pRequest,
+                         size_t requestLength );
+static size_t findHeaderEnd( const uint8_t * pData,
+                             size_t dataLength );
+static const uint8_t * findHeader( const uint8_t * pHeaders,
+                                   size_t headersLength,
+                                   const char * pName );
+static void parseHeaders( const uint8_t * pHeaders,
+                          size_t headersLength );
+static void completeResponse( void );
+static void deliverBody( const uint8_t * pData,
+                         uint32_t dataLength );
+static void processReceived( void );
+static void receiveResponse( void );
+
+#if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+    static bool writeFile( const uint8_t * pData,
+                           uint32_t dataLength );
+    static void spliceBody( void );
+#endif
+
+/* Lock for the connection and the pending requests.*/
+static pthread_mutex_t clientMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Connection to the server, -1 if not connected.*/
+static int serverSocket = -1;
+
+/* Parts of the url.*/
+static char pHost[ OTA_HTTP_POSIX_MAX_HOST_SIZE ];
+static char pPort[ HTTP_MAX_PORT_SIZE ];
+static char pPath[ OTA_HTTP_POSIX_MAX_PATH_SIZE ];
+
+/* Ring of the pipelined requests, in the order of their responses.*/
+static HttpPendingRequest_t pendingRequests[ OTA_HTTP_POSIX_MAX_PIPELINED_REQUESTS ];
+static uint32_t pendingHead = 0;
+static uint32_t pendingCount = 0;
+
+/* Receive buffer and state of the response being received.*/
+static uint8_t rxBuffer[ OTA_HTTP_POSIX_BUFFER_SIZE ];
+static size_t rxLength = 0;
+static HttpParseState_t parseState = HttpParseHeaders;
+static uint32_t bodyOffset = 0;
+static uint32_t bodyRemaining = 0;
+static bool bodyValid = false;
+static bool closeAfterBody = false;
+
+/* Set once the server rejected the url, until the next init.*/
+static bool urlExpired = false;
+
+static OtaHttpPosixBodyCallback_t bodyCallback = NULL;
+static OtaHttpPosixStats_t clientStats;
+
+#if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+    /* Image file that the body is written to, -1 to pass the body to the body callback.*/
+    static int sinkFile = -1;
+
+    /* Pipe that splice moves the body through, from the socket to the file.*/
+    static int sinkPipe[ 2 ] = { -1, -1 };
+
+    static OtaHttpPosixWrittenCallback_t writtenCallback = NULL;
+#endif
+
+static bool parseUrl( const char * pUrl )
+{
+    bool urlValid = false;
+    const char * pHostStart = NULL;
+    size_t hostLength = 0;
+    size_t portLength = 0;
+    const char * pPathStart = NULL;
+
+    if( strncmp( pUrl, HTTP_URL_SCHEME, sizeof( HTTP_URL_SCHEME ) - 1U ) != 0 )
+    {
+        LogError( ( "Failed to parse url: Only plain http urls are supported." ) );
+    }
+    else
+    {
+        pHostStart = &pUrl[ sizeof( HTTP_URL_SCHEME ) - 1U ];
+        hostLength = strcspn( pHostStart, ":/" );
+        pPathStart = &pHostStart[ hostLength ];
+
+        ( void ) strcpy( pPort, HTTP_DEFAULT_PORT );
+
+        if( *pPathStart == ':' )
+        {
+            portLength = strcspn( &pPathStart[ 1 ], "/" );
+
+            if( ( portLength > 0U ) && ( portLength < HTTP_MAX_PORT_SIZE ) )
+            {
+                ( void ) memcpy( pPort, &pPathStart[ 1 ], portLength );
+                pPort[ portLength ] = '\0';
+            }
+            else
+            {
+                hostLength = 0;
+            }
+
+            pPathStart = &pPathStart[ portLength + 1U ];
+        }
+
+        if( ( hostLength == 0U ) || ( hostLength >= sizeof( pHost ) ) || ( strlen( pPathStart ) >= sizeof( pPath ) ) )
+        {
+            LogError( ( "Failed to parse url: Invalid host, port or path." ) );
+        }
+        else
+        {
+            ( void ) memcpy( pHost, pHostStart, hostLength );
+            pHost[ hostLength ] = '\0';
+
+            if( *pPathStart == '\0' )
+            {
+                ( void ) strcpy( pPath, "/" );
+            }
+            else
+            {
+                ( void ) strcpy( pPath, pPathStart );
+            }
+
+            urlValid = true;
+        }
+    }
+
+    return urlValid;
+}
+
+static bool openConnection( void )
+{
+    struct addrinfo hints;
+    struct addrinfo * pAddresses = NULL;
+    struct addrinfo * pAddress = NULL;
+    int noDelay = 1;
+    int status = 0;
+
+    ( void ) memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    status = getaddrinfo( pHost, pPort, &hints, &pAddresses );
+
+    if( status != 0 )
+    {
+        LogError( ( "Failed to resolve host: "
+                    "getaddrinfo returned error: "
+                    "host=%s "
+                    ",error=%s",
+                    pHost,
+                    gai_strerror( status ) ) );
+    }
+    else
+    {
+        for( pAddress = pAddresses; ( pAddress != NULL ) && ( serverSocket < 0 ); pAddress = pAddress->ai_next )
+        {
+            serverSocket = socket( pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol );
+
+            if( ( serverSocket >= 0 ) && ( connect( serverSocket, pAddress->ai_addr, pAddress->ai_addrlen ) != 0 ) )
+            {
+                ( void ) close( serverSocket );
+                serverSocket = -1;
+            }
+        }
+
+        freeaddrinfo( pAddresses );
+
+        if( serverSocket < 0 )
+        {
+            LogError( ( "Failed to connect: "
+                        "host=%s "
+                        ",port=%s "
+                        ",errno=%s",
+                        pHost,
+                        pPort,
+                        strerror( errno ) ) );
+        }
+        else
+        {
+            /* The range requests are small, send each one as soon as it is written. */
+            ( void ) setsockopt( serverSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof( noDelay ) );
+
+            rxLength = 0;
+            parseState = HttpParseHeaders;
+            clientStats.connections++;
+
+            LogDebug( ( "Connected to %s:%s.", pHost, pPort ) );
+        }
+    }
+
+    return( serverSocket >= 0 );
+}
+
+static void closeConnection( void )
+{
+    if( serverSocket >= 0 )
+    {
+        ( void ) close( serverSocket );
+        serverSocket = -1;
+    }
+
+    if( pendingCount > 0U )
+    {
+        LogWarn( ( "Connection closed with range requests pending: "
+                   "pending=%u",
+                   ( unsigned int ) pendingCount ) );
+
+        clientStats.resets++;
+    }
+
+    pendingHead = 0;
+    pendingCount = 0;
+    rxLength = 0;
+    parseState = HttpParseHeaders;
+}
+
+static bool sendRequest( const char * pRequest,
+                         size_t requestLength )
+{
+    size_t bytesSent = 0;
+    ssize_t sendResult = 0;
+
+    while( ( bytesSent < requestLength ) && ( sendResult >= 0 ) )
+    {
+        sendResult = send( serverSocket, &pRequest[ bytesSent ], requestLength - bytesSent, MSG_NOSIGNAL );
+
+        if( sendResult > 0 )
+        {
+            bytesSent += ( size_t ) sendResult;
+        }
+        else if( ( sendResult < 0 ) && ( errno == EINTR ) )
+        {
+            sendResult = 0;
+        }
+        else
+        {
+            sendResult = -1;
+        }
+    }
+
+    return( bytesSent == requestLength );
+}
+
+static size_t findHeaderEnd( const uint8_t * pData,
+                             size_t dataLength )
+{
+    size_t headersLength = 0;
+    size_t index = 0;
+
+    for( index = 0; ( index + HTTP_HEADER_END_LENGTH <= dataLength ) && ( headersLength == 0U ); index++ )
+    {
+        if( memcmp( &pData[ index ], HTTP_HEADER_END, HTTP_HEADER_END_LENGTH ) == 0 )
+        {
+            headersLength = index + HTTP_HEADER_END_LENGTH;
+        }
+    }
+
+    return headersLength;
+}
+
+static const uint8_t * findHeader( const uint8_t * pHeaders,
+                                   size_t headersLength,
+                                   const char * pName )
+{
+    const uint8_t * pValue = NULL;
+    size_t nameLength = strlen( pName );
+    size_t index = 0;
+
+    /* Headers start after a line feed, the status line is skipped. */
+    for( index = 0; ( index + nameLength < headersLength ) && ( pValue == NULL ); index++ )
+    {
+        if( ( pHeaders[ index ] == ( uint8_t ) '\n' ) &&
+            ( strncasecmp( ( const char * ) &pHeaders[ index + 1U ], pName, nameLength ) == 0 ) )
+        {
+            pValue = &pHeaders[ index + 1U + nameLength ];
+
+            while( *pValue == ( uint8_t ) ' ' )
+            {
+                pValue++;
+            }
+        }
+    }
+
+    return pValue;
+}
+
+static void parseHeaders( const uint8_t * pHeaders,
+                          size_t headersLength )
+{
+    unsigned long statusCode = 0;
+    const uint8_t * pValue = NULL;
+
+    /* The headers end with an empty line, so number parsing always stops inside them. */
+    statusCode = strtoul( ( const char * ) &pHeaders[ HTTP_STATUS_CODE_OFFSET ], NULL, 10 );
+
+    pValue = findHeader( pHeaders, headersLength, HTTP_CONTENT_LENGTH_HEADER );
+    bodyRemaining = ( pValue != NULL ) ? ( uint32_t ) strtoul( ( const char * ) pValue, NULL, 10 ) : 0U;
+
+    pValue = findHeader( pHeaders, headersLength, HTTP_CONNECTION_HEADER );
+    closeAfterBody = ( pValue != NULL ) &&
+                     ( strncasecmp( ( const char * ) pValue, HTTP_CONNECTION_CLOSE, sizeof( HTTP_CONNECTION_CLOSE ) - 1U ) == 0 );
+
+    bodyValid = false;
+
+    if( pendingCount == 0U )
+    {
+        LogWarn( ( "Received a response without a pending request." ) );
+    }
+    else if( statusCode == HTTP_STATUS_PARTIAL_CONTENT )
+    {
+        pValue = findHeader( pHeaders, headersLength, HTTP_CONTENT_RANGE_HEADER );
+
+        if( ( pValue != NULL ) && ( strncasecmp( ( const char * ) pValue, HTTP_CONTENT_RANGE_UNIT, sizeof( HTTP_CONTENT_RANGE_UNIT ) - 1U ) == 0 ) )
+        {
+            bodyOffset = ( uint32_t ) strtoul( ( const char * ) &pValue[ sizeof( HTTP_CONTENT_RANGE_UNIT ) ], NULL, 10 );
+        }
+        else
+        {
+            bodyOffset = pendingRequests[ pendingHead ].rangeStart;
+        }
+
+        bodyValid = true;
+    }
+    else if( statusCode == HTTP_STATUS_OK )
+    {
+        /* The server ignored the range and sends the whole file. */
+        bodyOffset = 0;
+        bodyValid = true;
+    }
+    else if( statusCode == HTTP_STATUS_FORBIDDEN )
+    {
+        /* A pre-signed url is rejected once it expired. Report it on the next request. */
+        LogWarn( ( "Range request forbidden: The url expired or is not authorized." ) );
+        urlExpired = true;
+    }
+    else
+    {
+        LogError( ( "Range request failed: "
+                    "status=%lu "
+                    ",rangeStart=%u",
+                    statusCode,
+                    ( unsigned int ) pendingRequests[ pendingHead ].rangeStart ) );
+    }
+}
+
+static void completeResponse( void )
+{
+    if( pendingCount > 0U )
+    {
+        pendingHead = ( pendingHead + 1U ) % OTA_HTTP_POSIX_MAX_PIPELINED_REQUESTS;
+        pendingCount--;
+    }
+
+    clientStats.responses++;
+    parseState = HttpParseHeaders;
+
+    if( closeAfterBody == true )
+    {
+        closeConnection();
+    }
+}
+
+static void deliverBody( const uint8_t * pData,
+                         uint32_t dataLength )
+{
+    bool sinkSet = false;
+
+    #if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+        sinkSet = ( sinkFile >= 0 );
+
+        if( ( sinkSet == true ) && ( writeFile( pData, dataLength ) == true ) && ( writtenCallback != NULL ) )
+        {
+            writtenCallback( bodyOffset, dataLength );
+            clientStats.bytesReceived += dataLength;
+        }
+    #endif
+
+    if( ( sinkSet == false ) && ( bodyCallback != NULL ) )
+    {
+        bodyCallback( bodyOffset, pData, dataLength );
+        clientStats.bytesReceived += dataLength;
+    }
+}
+
+static void processReceived( void )
+{
+    size_t position = 0;
+    size_t dataLength = 0;
+    bool moreData = true;
+
+    while( moreData == true )
+    {
+        if( parseState == HttpParseHeaders )
+        {
+            dataLength = findHeaderEnd( &rxBuffer[ position ], rxLength - position );
+
+            if( dataLength > 0U )
+            {
+                parseHeaders( &rxBuffer[ position ], dataLength );
+                position += dataLength;
+                parseState = HttpParseBody;
+            }
+            else
+            {
+                moreData = false;
+            }
+        }
+        else
+        {
+            dataLength = rxLength - position;
+
+            if( dataLength > bodyRemaining )
+            {
+                dataLength = bodyRemaining;
+            }
+
+            if( ( dataLength > 0U ) && ( bodyValid == true ) )
+            {
+                deliverBody( &rxBuffer[ position ], ( uint32_t ) dataLength );
+            }
+
+            position += dataLength;
+            bodyOffset += ( uint32_t ) dataLength;
+            bodyRemaining -= ( uint32_t ) dataLength;
+
+            if( bodyRemaining == 0U )
+            {
+                completeResponse();
+            }
+            else
+            {
+                moreData = false;
+            }
+        }
+
+        /* Closing the connection discards the rest of the buffer. */
+        if( serverSocket < 0 )
+        {
+            position = 0;
+            moreData = false;
+        }
+    }
+
+    if( serverSocket >= 0 )
+    {
+        rxLength -= position;
+        ( void ) memmove( rxBuffer, &rxBuffer[ position ], rxLength );
+
+        if( rxLength == sizeof( rxBuffer ) )
+        {
+            LogError( ( "Failed to receive response: Headers do not fit the buffer." ) );
+            closeConnection();
+        }
+    }
+}
+
+static void receiveResponse( void )
+{
+    ssize_t recvResult = 0;
+    size_t receiveLength = sizeof( rxBuffer ) - rxLength;
+
+    #if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+        size_t headersLength = 0;
+
+        /* Only take the headers off the socket, so that the body can be spliced into the file. */
+        if( ( sinkFile >= 0 ) && ( parseState == HttpParseHeaders ) )
+        {
+            recvResult = recv( serverSocket, &rxBuffer[ rxLength ], receiveLength, MSG_DONTWAIT | MSG_PEEK );
+            headersLength = ( recvResult > 0 ) ? findHeaderEnd( rxBuffer, rxLength + ( size_t ) recvResult ) : 0U;
+
+            if( headersLength > rxLength )
+            {
+                receiveLength = headersLength - rxLength;
+            }
+        }
+    #endif /* if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 ) */
+
+    recvResult = recv( serverSocket, &rxBuffer[ rxLength ], receiveLength, MSG_DONTWAIT );
+
+    if( recvResult > 0 )
+    {
+        rxLength += ( size_t ) recvResult;
+        processReceived();
+    }
+    else if( ( recvResult < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) || ( errno == EINTR ) ) )
+    {
+        LogDebug( ( "No response data available." ) );
+    }
+    else
+    {
+        LogWarn( ( "Connection closed by the server." ) );
+        closeConnection();
+    }
+}
+
+#if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+
+    static bool writeFile( const uint8_t * pData,
+                           uint32_t dataLength )
+    {
+        size_t bytesWritten = 0;
+        ssize_t writeResult = 0;
+
+        while( ( bytesWritten < dataLength ) && ( writeResult >= 0 ) )
+        {
+            writeResult = pwrite( sinkFile, &pData[ bytesWritten ], dataLength - bytesWritten, ( off_t ) ( bodyOffset + bytesWritten ) );
+
+            if( writeResult > 0 )
+            {
+                bytesWritten += ( size_t ) writeResult;
+            }
+            else if( ( writeResult < 0 ) && ( errno == EINTR ) )
+            {
+                writeResult = 0;
+            }
+            else
+            {
+                writeResult = -1;
+            }
+        }
+
+        if( bytesWritten < dataLength )
+        {
+            LogError( ( "Failed to write response body to the file: "
+                        "fileOffset=%u "
+                        ",errno=%s",
+                        ( unsigned int ) bodyOffset,
+                        strerror( errno ) ) );
+        }
+
+        return( bytesWritten == dataLength );
+    }
+
+    static void spliceBody( void )
+    {
+        loff_t fileOffset = ( loff_t ) bodyOffset;
+        size_t bytesWritten = 0;
+        ssize_t spliceResult = 0;
+        ssize_t bytesReceived = 0;
+
+        /* Never take more than the body off the socket, the next response may follow it. */
+        bytesReceived = splice( serverSocket, NULL, sinkPipe[ 1 ], NULL, bodyRemaining, SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+
+        /* Move what is in the pipe to the file, splice advances the file offset. */
+        while( ( bytesReceived > 0 ) && ( bytesWritten < ( size_t ) bytesReceived ) && ( spliceResult >= 0 ) )
+        {
+            spliceResult = splice( sinkPipe[ 0 ], NULL, sinkFile, &fileOffset, ( size_t ) bytesReceived - bytesWritten, SPLICE_F_MOVE );
+
+            if( spliceResult > 0 )
+            {
+                bytesWritten += ( size_t ) spliceResult;
+            }
+            else if( ( spliceResult < 0 ) && ( errno == EINTR ) )
+            {
+                spliceResult = 0;
+            }
+            else
+            {
+                spliceResult = -1;
+            }
+        }
+
+        if( bytesReceived > 0 )
+        {
+            if( bytesWritten == ( size_t ) bytesReceived )
+            {
+                if( writtenCallback != NULL )
+                {
+                    writtenCallback( bodyOffset, ( uint32_t ) bytesWritten );
+                }
+
+                clientStats.bytesReceived += ( uint32_t ) bytesWritten;
+                bodyOffset += ( uint32_t ) bytesWritten;
+                bodyRemaining -= ( uint32_t ) bytesWritten;
+
+                if( bodyRemaining == 0U )
+                {
+                    completeResponse();
+                }
+            }
+            else
+            {
+                LogError( ( "Failed to splice response body to the file: "
+                            "fileOffset=%u "
+                            ",errno=%s",
+                            ( unsigned int ) bodyOffset,
+                            strerror( errno ) ) );
+
+                /* Empty the pipe and drop the requests, the agent requests them again. */
+                while( read( sinkPipe[ 0 ], rxBuffer, sizeof( rxBuffer ) ) > 0 )
+                {
+                    /* Discard the data. */
+                }
+
+                closeConnection();
+            }
+        }
+        else if( ( bytesReceived < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) || ( errno == EINTR ) ) )
+        {
+            LogDebug( ( "No response data available." ) );
+        }
+        else
+        {
+            LogWarn( ( "Connection closed by the server." ) );
+            closeConnection();
+        }
+    }
+
+#endif /* if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 ) */
+
+void Posix_OtaHttpSetBodyCallback( OtaHttpPosixBodyCallback_t callback )
+{
+    ( void ) pthread_mutex_lock( &clientMutex );
+    bodyCallback = callback;
+    ( void ) pthread_mutex_unlock( &clientMutex );
+}
+
+#if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+
+    bool Posix_OtaHttpSetFileSink( int fileDescriptor,
+                                   OtaHttpPosixWrittenCallback_t callback )
+    {
+        bool sinkSet = true;
+
+        ( void ) pthread_mutex_lock( &clientMutex );
+
+        if( ( fileDescriptor >= 0 ) && ( sinkPipe[ 0 ] < 0 ) && ( pipe2( sinkPipe, O_NONBLOCK ) != 0 ) )
+        {
+            LogError( ( "Failed to set file sink: "
+                        "pipe2 returned error: "
+                        "errno=%s",
+                        strerror( errno ) ) );
+
+            sinkPipe[ 0 ] = -1;
+            sinkPipe[ 1 ] = -1;
+            sinkSet = false;
+        }
+        else if( ( fileDescriptor < 0 ) && ( sinkPipe[ 0 ] >= 0 ) )
+        {
+            ( void ) close( sinkPipe[ 0 ] );
+            ( void ) close( sinkPipe[ 1 ] );
+            sinkPipe[ 0 ] = -1;
+            sinkPipe[ 1 ] = -1;
+        }
+        else
+        {
+            /* The pipe is kept while the sink is set. */
+        }
+
+        if( sinkSet == true )
+        {
+            sinkFile = ( fileDescriptor >= 0 ) ? fileDescriptor : -1;
+            writtenCallback = callback;
+        }
+
+        ( void ) pthread_mutex_unlock( &clientMutex );
+
+        return sinkSet;
+    }
+
+#endif /* if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 ) */
+
+OtaHttpStatus_t Posix_OtaHttpInit( char * pUrl )
+{
+    OtaHttpStatus_t httpStatus = OtaHttpSuccess;
+
+    ( void ) pthread_mutex_lock( &clientMutex );
+
+    closeConnection();
+    ( void ) memset( &clientStats, 0, sizeof( clientStats ) );
+    urlExpired = false;
+
+    if( ( pUrl == NULL ) || ( parseUrl( pUrl ) == false ) || ( openConnection() == false ) )
+    {
+        httpStatus = OtaHttpInitFailed;
+    }
+
+    ( void ) pthread_mutex_unlock( &clientMutex );
+
+    return httpStatus;
+}
+
+OtaHttpStatus_t Posix_OtaHttpRequest( uint32_t rangeStart,
+                                      uint32_t rangeEnd )
+{
+    OtaHttpStatus_t httpStatus = OtaHttpRequestFailed;
+    char pRequest[ HTTP_MAX_REQUEST_SIZE ];
+    int requestLength = 0;
+
+    ( void ) pthread_mutex_lock( &clientMutex );
+
+    requestLength = snprintf( pRequest,
+                              sizeof( pRequest ),
+                              "GET %s HTTP/1.1\r\n"
+                              "Host: %s\r\n"
+                              "Range: bytes=%u-%u\r\n"
+                              "\r\n",
+                              pPath,
+                              pHost,
+                              ( unsigned int ) rangeStart,
+                              ( unsigned int ) rangeEnd );
+
+    if( urlExpired == true )
+    {
+        LogError( ( "Failed to send range request: The server rejected the url." ) );
+        httpStatus = OtaHttpUrlExpired;
+    }
+    else if( pendingCount == OTA_HTTP_POSIX_MAX_PIPELINED_REQUESTS )
+    {
+        LogError( ( "Failed to send range request: Too many requests pending." ) );
+    }
+    else if( ( requestLength <= 0 ) || ( ( size_t ) requestLength >= sizeof( pRequest ) ) )
+    {
+        LogError( ( "Failed to send range request: Request does not fit the buffer." ) );
+    }
+    else
+    {
+        /* Open the connection again if the server closed it, and retry once if the
+         * connection turns out to be broken while sending. */
+        if( ( ( serverSocket >= 0 ) || ( openConnection() == true ) ) &&
+            ( sendRequest( pRequest, ( size_t ) requestLength ) == true ) )
+        {
+            httpStatus = OtaHttpSuccess;
+        }
+        else
+        {
+            closeConnection();
+
+            if( ( openConnection() == true ) && ( sendRequest( pRequest, ( size_t ) requestLength ) == true ) )
+            {
+                httpStatus = OtaHttpSuccess;
+            }
+        }
+
+        if( httpStatus == OtaHttpSuccess )
+        {
+            pendingRequests[ ( pendingHead + pendingCount ) % OTA_HTTP_POSIX_MAX_PIPELINED_REQUESTS ].rangeStart = rangeStart;
+            pendingRequests[ ( pendingHead + pendingCount ) % OTA_HTTP_POSIX_MAX_PIPELINED_REQUESTS ].rangeEnd = rangeEnd;
+            pendingCount++;
+            clientStats.requests++;
+        }
+        else
+        {
+            LogError( ( "Failed to send range request: "
+                        "errno=%s",
+                        strerror( errno ) ) );
+        }
+    }
+
+    ( void ) pthread_mutex_unlock( &clientMutex );
+
+    return httpStatus;
+}
+
+OtaHttpStatus_t Posix_OtaHttpProcess( uint32_t timeoutMs )
+{
+    OtaHttpStatus_t httpStatus = OtaHttpSuccess;
+    struct pollfd pollSocket;
+    bool spliced = false;
+    int pollResult = 0;
+
+    ( void ) pthread_mutex_lock( &clientMutex );
+    pollSocket.fd = serverSocket;
+    ( void ) pthread_mutex_unlock( &clientMutex );
+
+    pollSocket.events = POLLIN;
+    pollSocket.revents = 0;
+
+    /* A negative descriptor is ignored by poll, which then only waits for the timeout. */
+    pollResult = poll( &pollSocket, 1, ( int ) timeoutMs );
+
+    if( ( pollResult < 0 ) && ( errno != EINTR ) )
+    {
+        LogError( ( "Failed to wait for response: "
+                    "poll returned error: "
+                    "errno=%s",
+                    strerror( errno ) ) );
+
+        httpStatus = OtaHttpRequestFailed;
+    }
+    else if( pollResult > 0 )
+    {
+        ( void ) pthread_mutex_lock( &clientMutex );
+
+        /* The connection may have been reopened by a request in the meantime. */
+        if( ( serverSocket >= 0 ) && ( serverSocket == pollSocket.fd ) )
+        {
+            /* The body is spliced once the bytes received with the headers are written. */
+            #if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+                spliced = ( sinkFile >= 0 ) && ( parseState == HttpParseBody ) && ( bodyValid == true ) && ( rxLength == 0U );
+
+                if( spliced == true )
+                {
+                    spliceBody();
+                }
+            #endif
+
+            if( spliced == false )
+            {
+                receiveResponse();
+            }
+        }
+
+        ( void ) pthread_mutex_unlock( &clientMutex );
+    }
+    else
+    {
+        LogDebug( ( "No response data within the timeout." ) );
+    }
+
+    return httpStatus;
+}
+
+uint32_t Posix_OtaHttpPendingRequests( void )
+{
+    uint32_t count = 0;
+
+    ( void ) pthread_mutex_lock( &clientMutex );
+    count = pendingCount;
+    ( void ) pthread_mutex_unlock( &clientMutex );
+
+    return count;
+}
+
+void Posix_OtaHttpGetStats( OtaHttpPosixStats_t * pStats )
+{
+    ( void ) pthread_mutex_lock( &clientMutex );
+    ( void ) memcpy( pStats, &clientStats, sizeof( clientStats ) );
+    ( void ) pthread_mutex_unlock( &clientMutex );
+}
+
+OtaHttpStatus_t Posix_OtaHttpDeinit( void )
+{
+    ( void ) pthread_mutex_lock( &clientMutex );
+
+    /* Requests dropped on purpose are not connection resets. */
+    pendingCount = 0;
+    closeConnection();
+
+    ( void ) pthread_mutex_unlock( &clientMutex );
+
+    return OtaHttpSuccess;
+}
@@ -0,0 +1,221 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#ifndef _OTA_HTTP_POSIX_H_
+#define _OTA_HTTP_POSIX_H_
+
+/* Standard library include. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* OTA library interface include. */
+#include "ota_http_interface.h"
+
+/**
+ * @brief Maximum number of range requests sent on the connection before their responses arrive.
+ */
+#ifndef OTA_HTTP_POSIX_MAX_PIPELINED_REQUESTS
+    #define OTA_HTTP_POSIX_MAX_PIPELINED_REQUESTS    8U
+#endif
+
+/**
+ * @brief Size of the buffer that receives the response headers and body.
+ */
+#ifndef OTA_HTTP_POSIX_BUFFER_SIZE
+    #define OTA_HTTP_POSIX_BUFFER_SIZE    4096U
+#endif
+
+/**
+ * @brief Maximum length of the host name in the url.
+ */
+#ifndef OTA_HTTP_POSIX_MAX_HOST_SIZE
+    #define OTA_HTTP_POSIX_MAX_HOST_SIZE    256U
+#endif
+
+/**
+ * @brief Maximum length of the path and query in the url.
+ */
+#ifndef OTA_HTTP_POSIX_MAX_PATH_SIZE
+    #define OTA_HTTP_POSIX_MAX_PATH_SIZE    2048U
+#endif
+
+/**
+ * @brief Set to 1 to build the zero-copy file sink, see Posix_OtaHttpSetFileSink.
+ *
+ * The sink moves the response body from the socket into the image file with splice,
+ * which is only available on Linux.
+ */
+#ifndef OTA_HTTP_POSIX_ENABLE_FILE_SINK
+    #define OTA_HTTP_POSIX_ENABLE_FILE_SINK    0
+#endif
+
+/**
+ * @brief Callback that is passed the response body of the range requests.
+ *
+ * The body of every response is passed in order, in chunks of any size. An application
+ * using the OTA agent copies each chunk, split to at most otaconfigFILE_CHUNK_SIZE bytes,
+ * into an OtaFileChunkEventData_t behind its file offset and signals an
+ * OtaAgentEventReceivedFileChunk event. The callback must not call the
+ * functions of this client.
+ *
+ * @param[fileOffset]    Offset of the first byte of the chunk in the file.
+ *
+ * @param[pData]         Pointer to the chunk.
+ *
+ * @param[dataLength]    Length of the chunk.
+ */
+typedef void ( * OtaHttpPosixBodyCallback_t )( uint32_t fileOffset,
+                                               const uint8_t * pData,
+                                               uint32_t dataLength );
+
+/**
+ * @brief Callback that is told which part of the file the response body was written to.
+ *
+ * It is called instead of the body callback while a file sink is set. An application using
+ * the OTA agent signals an OtaAgentEventFileChunkWritten event with the file offset and
+ * length. The callback must not call the functions of this client.
+ *
+ * @param[fileOffset]    Offset of the first byte written to the file.
+ *
+ * @param[dataLength]    Number of bytes written.
+ */
+typedef void ( * OtaHttpPosixWrittenCallback_t )( uint32_t fileOffset,
+                                                  uint32_t dataLength );
+
+/**
+ * @brief Statistics of the POSIX HTTP client.
+ */
+typedef struct OtaHttpPosixStats
+{
+    uint32_t connections;   /*!< Number of connections opened. */
+    uint32_t resets;        /*!< Number of connections lost with requests pending. */
+    uint32_t requests;      /*!< Number of range requests sent. */
+    uint32_t responses;     /*!< Number of complete responses received. */
+    uint32_t bytesReceived; /*!< Number of response body bytes passed to the callback or written to the file. */
+} OtaHttpPosixStats_t;
+
+/**
+ * @brief Set the callback that is passed the response body.
+ *
+ * @param[callback]     Body callback.
+ */
+void Posix_OtaHttpSetBodyCallback( OtaHttpPosixBodyCallback_t callback );
+
+#if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+
+/**
+ * @brief Write the response body straight into the image file.
+ *
+ * While a file sink is set, the body of the range responses is moved from the socket into
+ * the file at its file offset with splice, so it is never copied through a user space
+ * buffer. Only the body bytes received together with the headers are written with pwrite.
+ * The written callback is then told the offset and length of the data, instead of passing
+ * the data to the body callback.
+ *
+ * The descriptor must be of a regular file opened for writing, for example of the image
+ * file that the PAL opened in createFileForRx. The PAL must not buffer writes to the same
+ * file while the sink is set.
+ *
+ * @param[fileDescriptor]   Descriptor of the image file, -1 to pass the body to the body
+ *                          callback again.
+ *
+ * @param[callback]         Written callback.
+ *
+ * @return                  true if the sink is set, false if the pipe for splice could
+ *                          not be created.
+ */
+    bool Posix_OtaHttpSetFileSink( int fileDescriptor,
+                                   OtaHttpPosixWrittenCallback_t callback );
+
+#endif /* if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 ) */
+
+/**
+ * @brief Init the HTTP connection.
+ *
+ * This function parses a plain http:// url and opens a persistent HTTP/1.1 connection
+ * to its host. The reference client does not implement TLS.
+ *
+ * @param[pUrl]         Pointer to the url of the file.
+ *
+ * @return              OtaHttpSuccess if success , other error code on failure.
+ */
+OtaHttpStatus_t Posix_OtaHttpInit( char * pUrl );
+
+/**
+ * @brief Request a range of the file.
+ *
+ * This function sends the range request on the open connection without waiting for the
+ * responses to previous requests. If the connection was lost it is opened again first.
+ * Once the server answered a request with 403 Forbidden, further requests return
+ * OtaHttpUrlExpired until the client is initialized with a fresh url.
+ *
+ * @param[rangeStart]   Starting index of the file data to be requested.
+ *
+ * @param[rangeEnd]     End index of the file data to be requested.
+ *
+ * @return              OtaHttpSuccess if success , OtaHttpUrlExpired if the url was rejected,
+ *                      other error code on failure.
+ */
+OtaHttpStatus_t Posix_OtaHttpRequest( uint32_t rangeStart,
+                                      uint32_t rangeEnd );
+
+/**
+ * @brief Receive the responses to the pending range requests.
+ *
+ * This function waits up to the timeout for data on the connection and passes the response
+ * body to the body callback, or writes it to the file sink. It is called in a loop from the application task. If the
+ * connection is lost the pending requests are dropped, the OTA agent requests them again
+ * when its request timer expires.
+ *
+ * @param[timeoutMs]    The maximum amount of time (msec) to wait for data.
+ *
+ * @return              OtaHttpSuccess if success , other error code on failure.
+ */
+OtaHttpStatus_t Posix_OtaHttpProcess( uint32_t timeoutMs );
+
+/**
+ * @brief Get the number of range requests waiting for a response.
+ *
+ * @return              Number of pending requests.
+ */
+uint32_t Posix_OtaHttpPendingRequests( void );
+
+/**
+ * @brief Get the statistics of the client.
+ *
+ * @param[pStats]       Pointer to store the statistics.
+ */
+void Posix_OtaHttpGetStats( OtaHttpPosixStats_t * pStats );
+
+/**
+ * @brief Deinit the HTTP connection.
+ *
+ * This function closes the connection and drops the pending requests.
+ *
+ * @return              OtaHttpSuccess if success , other error code on failure.
+ */
+OtaHttpStatus_t Posix_OtaHttpDeinit( void );
+
+#endif /* ifndef _OTA_HTTP_POSIX_H_ */
@@ -57,7 +57,8 @@ static TimerHandle_t otaTimer[ OtaNumOfTimers ];
 /* OTA Timer callbacks.*/
 static void requestTimerCallback( TimerHandle_t T );
 static void selfTestTimerCallback( TimerHandle_t T );
-void ( * timerCallback[ OtaNumOfTimers ] )( TimerHandle_t T ) = { requestTimerCallback, selfTestTimerCallback };
+static void progressTimerCallback( TimerHandle_t T );
+void ( * timerCallback[ OtaNumOfTimers ] )( TimerHandle_t T ) = { requestTimerCallback, selfTestTimerCallback, progressTimerCallback };
 
 OtaOsStatus_t OtaInitEvent_FreeRTOS( OtaEventContext_t * pEventCtx )
 {
@@ -202,6 +203,22 @@ static void requestTimerCallback( TimerHandle_t T )
     }
 }
 
+static void progressTimerCallback( TimerHandle_t T )
+{
+    ( void ) T;
+
+    LogDebug( ( "Progress timer expired.\r\n" ) );
+
+    if( otaTimerCallback != NULL )
+    {
+        otaTimerCallback( OtaProgressTimer );
+    }
+    else
+    {
+        LogWarn( ( "Progress timer event unhandled.\r\n" ) );
+    }
+}
+
 OtaOsStatus_t OtaStartTimer_FreeRTOS( OtaTimerId_t otaTimerId,
                                       const char * const pTimerName,
                                       const uint32_t timeout,
@@ -255,8 +272,9 @@ OtaOsStatus_t OtaStartTimer_FreeRTOS( OtaTimerId_t otaTimerId,
     }
     else
     {
-        /* Reset the timer. */
-        retVal = xTimerReset( otaTimer[ otaTimerId ], portMAX_DELAY );
+        /* Restart the timer with the requested timeout. Changing the period also resets the
+         * expiry time of a running timer and starts a dormant one. */
+        retVal = xTimerChangePeriod( otaTimer[ otaTimerId ], pdMS_TO_TICKS( timeout ), portMAX_DELAY );
 
         if( retVal == pdTRUE )
         {
@@ -347,6 +365,12 @@ OtaOsStatus_t OtaDeleteTimer_FreeRTOS( OtaTimerId_t otaTimerId )
     return otaOsStatus;
 }
 
+uint32_t OtaGetTimeMs_FreeRTOS( void )
+{
+    /* The tick count wraps around, which only differences of two times allow for. */
+    return ( uint32_t ) ( xTaskGetTickCount() * portTICK_PERIOD_MS );
+}
+
 void * Malloc_FreeRTOS( size_t size )
 {
     return pvPortMalloc( size );
@@ -132,6 +132,15 @@ OtaOsStatus_t OtaStopTimer_FreeRTOS( OtaTimerId_t otaTimerId );
  */
 OtaOsStatus_t OtaDeleteTimer_FreeRTOS( OtaTimerId_t otaTimerId );
 
+/**
+ * @brief Get the time.
+ *
+ * This function returns the tick count in milliseconds on FreeRTOS platforms.
+ *
+ * @return                  The time in milliseconds.
+ */
+uint32_t OtaGetTimeMs_FreeRTOS( void );
+
 /**
  * @brief Allocate memory.
  *
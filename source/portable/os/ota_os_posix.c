@@ -52,6 +52,7 @@
 
 static void requestTimerCallback( union sigval arg );
 static void selfTestTimerCallback( union sigval arg );
+static void progressTimerCallback( union sigval arg );
 
 static OtaTimerCallback_t otaTimerCallback;
 
@@ -63,7 +64,7 @@ static timer_t otaTimers[ OtaNumOfTimers ];
 static timer_t * pOtaTimers[ OtaNumOfTimers ] = { 0 };
 
 /* OTA Timer callbacks.*/
-static void ( * timerCallback[ OtaNumOfTimers ] )( union sigval arg ) = { requestTimerCallback, selfTestTimerCallback };
+static void ( * timerCallback[ OtaNumOfTimers ] )( union sigval arg ) = { requestTimerCallback, selfTestTimerCallback, progressTimerCallback };
 
 OtaOsStatus_t Posix_OtaInitEvent( OtaEventContext_t * pEventCtx )
 {
@@ -238,6 +239,22 @@ static void requestTimerCallback( union sigval arg )
     }
 }
 
+static void progressTimerCallback( union sigval arg )
+{
+    ( void ) arg;
+
+    LogDebug( ( "Progress timer expired.\r\n" ) );
+
+    if( otaTimerCallback != NULL )
+    {
+        otaTimerCallback( OtaProgressTimer );
+    }
+    else
+    {
+        LogWarn( ( "Progress timer event unhandled.\r\n" ) );
+    }
+}
+
 OtaOsStatus_t Posix_OtaStartTimer( OtaTimerId_t otaTimerId,
                                    const char * const pTimerName,
                                    const uint32_t timeout,
@@ -265,6 +282,7 @@ OtaOsStatus_t Posix_OtaStartTimer( OtaTimerId_t otaTimerId,
 
     /* Set timeout attributes.*/
     timerAttr.it_value.tv_sec = ( time_t ) timeout / 1000;
+    timerAttr.it_value.tv_nsec = ( ( long ) timeout % 1000L ) * 1000000L;
 
     /* Create timer if required.*/
     if( pOtaTimers[ otaTimerId ] == NULL )
@@ -394,6 +412,17 @@ OtaOsStatus_t Posix_OtaDeleteTimer( OtaTimerId_t otaTimerId )
     return otaOsStatus;
 }
 
+uint32_t Posix_OtaGetTimeMs( void )
+{
+    struct timespec now = { 0 };
+
+    /* The monotonic clock does not jump when the wall clock is set. */
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    /* The time is allowed to wrap around. */
+    return ( ( uint32_t ) now.tv_sec * 1000U ) + ( ( uint32_t ) now.tv_nsec / 1000000U );
+}
+
 void * STDC_Malloc( size_t size )
 {
     /* Use standard C malloc.*/
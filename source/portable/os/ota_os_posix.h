@@ -139,6 +139,15 @@ OtaOsStatus_t Posix_OtaStopTimer( OtaTimerId_t otaTimerId );
  */
 OtaOsStatus_t Posix_OtaDeleteTimer( OtaTimerId_t otaTimerId );
 
+/**
+ * @brief Get the time.
+ *
+ * This function returns the monotonic clock in milliseconds for POSIX platforms.
+ *
+ * @return                  The time in milliseconds.
+ */
+uint32_t Posix_OtaGetTimeMs( void );
+
 /**
  * @brief Allocate memory.
  *
@@ -0,0 +1,389 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_cbor_benchmark.c
+ * @brief Benchmark the decoders of the JSON and CBOR stream response messages.
+ *
+ * A CBOR stream response is decoded with the decoder that looks up every key in the map
+ * and copies the payload, with the decoder that walks the map once and returns a view of
+ * the payload, and with the fast path for the layout of the service that does not use
+ * tinycbor. The views are copied to the same buffer as the agent does. The same block is
+ * also decoded from a JSON stream response with its Base64 payload, as it is received when
+ * otaconfigENABLE_MQTT_JSON_STREAM is enabled. The time and the CPU cycles per block and
+ * the payload throughput are reported for several payload sizes. Cycles are counted with
+ * the time stamp counter on x86 and are not reported on other targets.
+ *
+ * Usage: ota_cbor_benchmark [-n iterations]
+ */
+
+/* Standard Includes.*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Posix includes. */
+#include <unistd.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+    #include <x86intrin.h>
+    #define BENCHMARK_HAS_CYCLE_COUNTER    1
+#else
+    #define BENCHMARK_HAS_CYCLE_COUNTER    0
+#endif
+
+/* OTA library includes. */
+#include "ota.h"
+#include "ota_appversion32.h"
+#include "ota_cbor_private.h"
+#include "ota_mqtt_private.h"
+#include "ota_base64_private.h"
+
+/* 3rdparty includes. */
+#include "cbor.h"
+
+/* test includes. */
+#include "utest_helpers.h"
+
+#define BENCHMARK_MAX_PAYLOAD_SIZE    4096U
+#define BENCHMARK_MESSAGE_SIZE        ( BENCHMARK_MAX_PAYLOAD_SIZE + 64U )
+#define BENCHMARK_JSON_MESSAGE_SIZE   ( ( ( ( BENCHMARK_MAX_PAYLOAD_SIZE + 2U ) / 3U ) * 4U ) + 64U )
+#define BENCHMARK_BLOCK_INDEX         3
+
+/* Firmware version, the JSON decoder is linked with the rest of the agent. */
+const AppVersion32_t appFirmwareVersion =
+{
+    .u.x.major = 1,
+    .u.x.minor = 0,
+    .u.x.build = 0,
+};
+
+/* OTA code signing signature algorithm. */
+const char OTA_JsonFileSignatureKey[ OTA_FILE_SIG_KEY_STR_MAX_LENGTH ] = "sig-sha256-ecdsa";
+
+static const size_t payloadSizes[] = { 256U, 1024U, 4096U };
+
+static uint8_t blockPayload[ BENCHMARK_MAX_PAYLOAD_SIZE ];
+static uint8_t message[ BENCHMARK_MESSAGE_SIZE ];
+static char jsonMessage[ BENCHMARK_JSON_MESSAGE_SIZE ];
+static size_t jsonMessageSize = 0;
+static uint8_t decodedPayload[ BENCHMARK_MAX_PAYLOAD_SIZE ];
+
+/* Decoder of a stream response into decodedPayload. */
+typedef bool ( * BenchmarkDecoder_t )( size_t messageSize,
+                                       size_t * pPayloadSize );
+
+typedef struct BenchmarkCase
+{
+    const char * pName;
+    BenchmarkDecoder_t decode;
+} BenchmarkCase_t;
+
+static double nowSeconds( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( double ) now.tv_sec + ( ( double ) now.tv_nsec / 1e9 );
+}
+
+static uint64_t nowCycles( void )
+{
+    #if ( BENCHMARK_HAS_CYCLE_COUNTER == 1 )
+        return ( uint64_t ) __rdtsc();
+    #else
+        return 0U;
+    #endif
+}
+
+/* Decode by looking up every key and copying the payload. */
+static bool decodeLookup( size_t messageSize,
+                          size_t * pPayloadSize )
+{
+    int32_t fileId = 0;
+    int32_t blockId = 0;
+    int32_t blockSize = 0;
+    uint8_t * pPayload = decodedPayload;
+
+    *pPayloadSize = sizeof( decodedPayload );
+
+    return OTA_CBOR_Decode_GetStreamResponseMessage( message,
+                                                     messageSize,
+                                                     &fileId,
+                                                     &blockId,
+                                                     &blockSize,
+                                                     &pPayload,
+                                                     pPayloadSize );
+}
+
+/* Decode in one pass over the map and copy the payload view. */
+static bool decodeView( size_t messageSize,
+                        size_t * pPayloadSize )
+{
+    int32_t fileId = 0;
+    int32_t blockId = 0;
+    int32_t blockSize = 0;
+    const uint8_t * pPayload = NULL;
+    bool result = false;
+
+    result = OTA_CBOR_Decode_GetStreamResponseMessageView( message,
+                                                           messageSize,
+                                                           &fileId,
+                                                           &blockId,
+                                                           &blockSize,
+                                                           &pPayload,
+                                                           pPayloadSize );
+
+    if( result == true )
+    {
+        ( void ) memcpy( decodedPayload, pPayload, *pPayloadSize );
+    }
+
+    return result;
+}
+
+/* Decode the layout of the service without tinycbor and copy the payload view, like the agent does. */
+static bool decodeFast( size_t messageSize,
+                        size_t * pPayloadSize )
+{
+    int32_t fileId = 0;
+    int32_t blockId = 0;
+    int32_t blockSize = 0;
+    const uint8_t * pPayload = NULL;
+    bool result = false;
+
+    result = OTA_CBOR_Decode_GetStreamResponseMessageFast( message,
+                                                           messageSize,
+                                                           &fileId,
+                                                           &blockId,
+                                                           &blockSize,
+                                                           &pPayload,
+                                                           pPayloadSize );
+
+    if( result == true )
+    {
+        ( void ) memcpy( decodedPayload, pPayload, *pPayloadSize );
+    }
+
+    return result;
+}
+
+/* Decode the JSON stream response of the same block, the CBOR message size is not used. */
+static bool decodeJson( size_t messageSize,
+                        size_t * pPayloadSize )
+{
+    int32_t fileId = 0;
+    int32_t blockId = 0;
+    int32_t blockSize = 0;
+    uint8_t * pPayload = decodedPayload;
+
+    ( void ) messageSize;
+    *pPayloadSize = sizeof( decodedPayload );
+
+    return decodeStreamResponseJson_Mqtt( ( const uint8_t * ) jsonMessage,
+                                          jsonMessageSize,
+                                          &fileId,
+                                          &blockId,
+                                          &blockSize,
+                                          &pPayload,
+                                          pPayloadSize );
+}
+
+/* Encode the JSON stream response of a block in jsonMessage like the service does. */
+static bool createJsonStreamResponse( size_t payloadSize )
+{
+    bool result = false;
+    size_t encodedSize = 0;
+    int headerSize = snprintf( jsonMessage,
+                               sizeof( jsonMessage ),
+                               "{\"c\":\"rdy\",\"f\":0,\"i\":%d,\"l\":%lu,\"p\":\"",
+                               BENCHMARK_BLOCK_INDEX,
+                               ( unsigned long ) payloadSize );
+
+    if( ( headerSize > 0 ) &&
+        ( base64Encode( ( uint8_t * ) &jsonMessage[ headerSize ],
+                        sizeof( jsonMessage ) - ( size_t ) headerSize,
+                        &encodedSize,
+                        blockPayload,
+                        payloadSize ) == Base64Success ) &&
+        ( ( ( size_t ) headerSize + encodedSize + 2U ) <= sizeof( jsonMessage ) ) )
+    {
+        jsonMessageSize = ( size_t ) headerSize + encodedSize;
+        ( void ) memcpy( &jsonMessage[ jsonMessageSize ], "\"}", 2U );
+        jsonMessageSize += 2U;
+        result = true;
+    }
+
+    return result;
+}
+
+static const BenchmarkCase_t benchmarkCases[] =
+{
+    { "lookup",   decodeLookup },
+    { "one pass", decodeView   },
+    { "fast",     decodeFast   },
+    { "json",     decodeJson   }
+};
+
+/* Return the time per block in nanoseconds, or a negative value on failure. */
+static double timeDecoder( BenchmarkDecoder_t decode,
+                           size_t messageSize,
+                           size_t payloadSize,
+                           unsigned long iterations,
+                           double * pCycles )
+{
+    unsigned long i = 0;
+    size_t decodedSize = 0;
+    double start = 0.0;
+    double elapsed = -1.0;
+    uint64_t startCycles = 0;
+    uint64_t cycles = 0;
+    bool result = true;
+
+    ( void ) memset( decodedPayload, 0, sizeof( decodedPayload ) );
+
+    start = nowSeconds();
+    startCycles = nowCycles();
+
+    for( i = 0; ( i < iterations ) && ( result == true ); i++ )
+    {
+        result = decode( messageSize, &decodedSize );
+    }
+
+    cycles = nowCycles() - startCycles;
+
+    if( ( result == true ) &&
+        ( decodedSize == payloadSize ) &&
+        ( memcmp( decodedPayload, blockPayload, payloadSize ) == 0 ) )
+    {
+        elapsed = ( ( nowSeconds() - start ) * 1e9 ) / ( double ) iterations;
+        *pCycles = ( double ) cycles / ( double ) iterations;
+    }
+
+    return elapsed;
+}
+
+int main( int argc,
+          char ** argv )
+{
+    unsigned long iterations = 1000000UL;
+    size_t sizeIndex = 0;
+    size_t caseIndex = 0;
+    size_t messageSize = 0;
+    size_t i = 0;
+    double elapsedNs = 0.0;
+    double cycles = 0.0;
+    int option = 0;
+    int exitStatus = EXIT_SUCCESS;
+
+    while( ( option = getopt( argc, argv, "n:" ) ) != -1 )
+    {
+        switch( option )
+        {
+            case 'n':
+                iterations = strtoul( optarg, NULL, 10 );
+                break;
+
+            default:
+                ( void ) fprintf( stderr, "Usage: %s [-n iterations]\n", argv[ 0 ] );
+                exitStatus = EXIT_FAILURE;
+                break;
+        }
+    }
+
+    if( iterations == 0UL )
+    {
+        iterations = 1UL;
+    }
+
+    for( i = 0; i < sizeof( blockPayload ); i++ )
+    {
+        blockPayload[ i ] = ( uint8_t ) ( i % UINT8_MAX );
+    }
+
+    if( exitStatus == EXIT_SUCCESS )
+    {
+        ( void ) printf( "%-10s %-10s %-12s %-10s %s\n", "payload", "decoder", "ns/block", "MB/s", "cycles/block" );
+    }
+
+    for( sizeIndex = 0; ( sizeIndex < ( sizeof( payloadSizes ) / sizeof( payloadSizes[ 0 ] ) ) ) && ( exitStatus == EXIT_SUCCESS ); sizeIndex++ )
+    {
+        if( createOtaStreammingMessage( message,
+                                        sizeof( message ),
+                                        BENCHMARK_BLOCK_INDEX,
+                                        blockPayload,
+                                        payloadSizes[ sizeIndex ],
+                                        &messageSize ) != CborNoError )
+        {
+            ( void ) fprintf( stderr, "Failed to encode a stream response of %lu bytes.\n", ( unsigned long ) payloadSizes[ sizeIndex ] );
+            exitStatus = EXIT_FAILURE;
+        }
+        else if( createJsonStreamResponse( payloadSizes[ sizeIndex ] ) == false )
+        {
+            ( void ) fprintf( stderr, "Failed to encode a JSON stream response of %lu bytes.\n", ( unsigned long ) payloadSizes[ sizeIndex ] );
+            exitStatus = EXIT_FAILURE;
+        }
+        else
+        {
+            /* Both stream responses were encoded. */
+        }
+
+        for( caseIndex = 0; ( caseIndex < ( sizeof( benchmarkCases ) / sizeof( benchmarkCases[ 0 ] ) ) ) && ( exitStatus == EXIT_SUCCESS ); caseIndex++ )
+        {
+            elapsedNs = timeDecoder( benchmarkCases[ caseIndex ].decode, messageSize, payloadSizes[ sizeIndex ], iterations, &cycles );
+
+            if( elapsedNs < 0.0 )
+            {
+                ( void ) fprintf( stderr, "The %s decoder failed to decode a stream response of %lu bytes.\n",
+                                  benchmarkCases[ caseIndex ].pName,
+                                  ( unsigned long ) payloadSizes[ sizeIndex ] );
+                exitStatus = EXIT_FAILURE;
+            }
+            else if( BENCHMARK_HAS_CYCLE_COUNTER == 1 )
+            {
+                ( void ) printf( "%-10lu %-10s %-12.1f %-10.1f %.0f\n",
+                                 ( unsigned long ) payloadSizes[ sizeIndex ],
+                                 benchmarkCases[ caseIndex ].pName,
+                                 elapsedNs,
+                                 ( ( double ) payloadSizes[ sizeIndex ] * 1e3 ) / elapsedNs,
+                                 cycles );
+            }
+            else
+            {
+                ( void ) printf( "%-10lu %-10s %-12.1f %-10.1f -\n",
+                                 ( unsigned long ) payloadSizes[ sizeIndex ],
+                                 benchmarkCases[ caseIndex ].pName,
+                                 elapsedNs,
+                                 ( ( double ) payloadSizes[ sizeIndex ] * 1e3 ) / elapsedNs );
+            }
+        }
+    }
+
+    return exitStatus;
+}
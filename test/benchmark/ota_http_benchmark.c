@@ -0,0 +1,369 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_http_benchmark.c
+ * @brief Benchmark the POSIX HTTP range client against the loopback range server.
+ *
+ * The file is downloaded for every combination of file block size, blocks per range
+ * request and number of pipelined requests, and the throughput is reported in MB/s and
+ * range requests per second. Ranges lost to a connection reset are requested again.
+ *
+ * The body is written to a temporary image file, once through a user space buffer like an
+ * application passing it to the OTA agent, and once spliced straight into the file if the
+ * client is built with the file sink.
+ *
+ * Usage: ota_http_benchmark [-s fileSize] [-l latencyMs] [-b bytesPerSecond] [-r resetAfterRequests]
+ */
+
+/* Standard Includes.*/
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Posix includes. */
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "ota_http_posix.h"
+#include "ota_http_range_server.h"
+
+#define BENCHMARK_PROCESS_TIMEOUT_MS    10U
+#define BENCHMARK_STALL_TIMEOUT_S       5.0
+#define BENCHMARK_URL_SIZE              64U
+#define BYTES_PER_MB                    1048576.0
+
+static const uint32_t blockSizes[] = { 256U, 1024U, 4096U };
+static const uint32_t blocksPerRange[] = { 1U, 4U, 16U };
+static const uint32_t pipelineDepths[] = { 1U, 4U, OTA_HTTP_POSIX_MAX_PIPELINED_REQUESTS };
+
+#if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+    static const char * const bodyPaths[] = { "buffered", "splice" };
+#else
+    static const char * const bodyPaths[] = { "buffered" };
+#endif
+
+/* Image file the body is written to, and the buffer of the buffered path. */
+static int imageFile = -1;
+static uint8_t eventBuffer[ OTA_HTTP_POSIX_BUFFER_SIZE ];
+
+/* Download progress, shared with the body callback. */
+static uint32_t fileSize = 0;
+static uint32_t rangeSize = 0;
+static uint32_t numRanges = 0;
+static uint32_t * pRangeBytes = NULL;
+static uint8_t * pRangeInFlight = NULL;
+static uint32_t rangesComplete = 0;
+
+static double nowSeconds( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( double ) now.tv_sec + ( ( double ) now.tv_nsec / 1e9 );
+}
+
+static uint32_t rangeLength( uint32_t range )
+{
+    uint32_t length = rangeSize;
+
+    if( ( range + 1U ) == numRanges )
+    {
+        length = fileSize - ( range * rangeSize );
+    }
+
+    return length;
+}
+
+static void writtenCallback( uint32_t fileOffset,
+                             uint32_t dataLength )
+{
+    uint32_t range = fileOffset / rangeSize;
+
+    /* A response never spans two ranges. */
+    pRangeBytes[ range ] += dataLength;
+
+    if( pRangeBytes[ range ] == rangeLength( range ) )
+    {
+        pRangeInFlight[ range ] = 0U;
+        rangesComplete++;
+    }
+}
+
+static void bodyCallback( uint32_t fileOffset,
+                          const uint8_t * pData,
+                          uint32_t dataLength )
+{
+    /* Copy the body into an event buffer and write it to the file, like the OTA agent does.
+     * The chunks are never larger than the receive buffer of the client. */
+    ( void ) memcpy( eventBuffer, pData, dataLength );
+
+    if( pwrite( imageFile, eventBuffer, dataLength, ( off_t ) fileOffset ) == ( ssize_t ) dataLength )
+    {
+        writtenCallback( fileOffset, dataLength );
+    }
+}
+
+/* Count the bytes of the image file that differ from the file of the server. */
+static uint32_t verifyFile( void )
+{
+    uint32_t offset = 0;
+    uint32_t index = 0;
+    uint32_t corrupt = 0;
+    ssize_t readResult = 0;
+
+    for( offset = 0; offset < fileSize; offset += ( uint32_t ) sizeof( eventBuffer ) )
+    {
+        readResult = pread( imageFile, eventBuffer, sizeof( eventBuffer ), ( off_t ) offset );
+
+        for( index = 0; index < sizeof( eventBuffer ) && ( ( offset + index ) < fileSize ); index++ )
+        {
+            if( ( ( ssize_t ) index >= readResult ) || ( eventBuffer[ index ] != RANGE_SERVER_FILE_BYTE( offset + index ) ) )
+            {
+                corrupt++;
+            }
+        }
+    }
+
+    return corrupt;
+}
+
+/* Download the whole file and return the elapsed time, or a negative value on failure. */
+static double downloadFile( uint32_t depth )
+{
+    OtaHttpPosixStats_t stats;
+    uint32_t resets = 0;
+    uint32_t nextRange = 0;
+    uint32_t range = 0;
+    uint32_t progress = 0;
+    double startTime = nowSeconds();
+    double progressTime = startTime;
+    double elapsed = 0.0;
+
+    rangesComplete = 0;
+    ( void ) memset( pRangeBytes, 0, numRanges * sizeof( uint32_t ) );
+    ( void ) memset( pRangeInFlight, 0, numRanges );
+
+    while( ( rangesComplete < numRanges ) && ( elapsed >= 0.0 ) )
+    {
+        /* Keep the pipeline full with the next ranges that are not received. */
+        while( ( nextRange < numRanges ) && ( Posix_OtaHttpPendingRequests() < depth ) )
+        {
+            if( ( pRangeBytes[ nextRange ] < rangeLength( nextRange ) ) && ( pRangeInFlight[ nextRange ] == 0U ) )
+            {
+                if( Posix_OtaHttpRequest( nextRange * rangeSize, ( nextRange * rangeSize ) + rangeLength( nextRange ) - 1U ) == OtaHttpSuccess )
+                {
+                    pRangeInFlight[ nextRange ] = 1U;
+                }
+            }
+
+            nextRange++;
+        }
+
+        ( void ) Posix_OtaHttpProcess( BENCHMARK_PROCESS_TIMEOUT_MS );
+
+        /* A reset drops the pending requests, request the incomplete ranges again from scratch. */
+        Posix_OtaHttpGetStats( &stats );
+
+        if( stats.resets != resets )
+        {
+            resets = stats.resets;
+
+            for( range = 0; range < numRanges; range++ )
+            {
+                if( pRangeInFlight[ range ] != 0U )
+                {
+                    pRangeInFlight[ range ] = 0U;
+                    pRangeBytes[ range ] = 0U;
+                }
+            }
+        }
+
+        if( ( nextRange == numRanges ) && ( Posix_OtaHttpPendingRequests() == 0U ) && ( rangesComplete < numRanges ) )
+        {
+            nextRange = 0;
+        }
+
+        if( rangesComplete != progress )
+        {
+            progress = rangesComplete;
+            progressTime = nowSeconds();
+        }
+        else if( ( nowSeconds() - progressTime ) > BENCHMARK_STALL_TIMEOUT_S )
+        {
+            elapsed = -1.0;
+        }
+        else
+        {
+            elapsed = nowSeconds() - startTime;
+        }
+    }
+
+    if( elapsed >= 0.0 )
+    {
+        elapsed = nowSeconds() - startTime;
+    }
+
+    return elapsed;
+}
+
+int main( int argc,
+          char ** argv )
+{
+    RangeServerConfig_t config = { 0, 1048576U, 0U, 0U, 0U, 0U };
+    OtaHttpPosixStats_t stats;
+    char url[ BENCHMARK_URL_SIZE ];
+    uint16_t port = 0;
+    size_t blockIndex = 0;
+    size_t rangeIndex = 0;
+    size_t depthIndex = 0;
+    size_t pathIndex = 0;
+    char imagePath[] = "/tmp/ota_http_benchmark_XXXXXX";
+    double elapsed = 0.0;
+    int option = 0;
+    int exitStatus = EXIT_SUCCESS;
+
+    while( ( option = getopt( argc, argv, "s:l:b:r:" ) ) != -1 )
+    {
+        switch( option )
+        {
+            case 's':
+                config.fileSize = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'l':
+                config.latencyMs = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'b':
+                config.bytesPerSecond = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'r':
+                config.resetAfterRequests = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            default:
+                ( void ) fprintf( stderr, "Usage: %s [-s fileSize] [-l latencyMs] [-b bytesPerSecond] [-r resetAfterRequests]\n", argv[ 0 ] );
+                exitStatus = EXIT_FAILURE;
+                break;
+        }
+    }
+
+    if( exitStatus == EXIT_SUCCESS )
+    {
+        imageFile = mkstemp( imagePath );
+    }
+
+    if( ( imageFile >= 0 ) && ( config.fileSize > 0U ) && ( RangeServer_Start( &config, &port ) == true ) )
+    {
+        fileSize = config.fileSize;
+        ( void ) snprintf( url, sizeof( url ), "http://127.0.0.1:%u/ota.bin", ( unsigned int ) port );
+        Posix_OtaHttpSetBodyCallback( bodyCallback );
+
+        ( void ) printf( "file=%u bytes latency=%u ms bandwidth=%u B/s resetAfter=%u\n",
+                         ( unsigned int ) config.fileSize,
+                         ( unsigned int ) config.latencyMs,
+                         ( unsigned int ) config.bytesPerSecond,
+                         ( unsigned int ) config.resetAfterRequests );
+        ( void ) printf( "%9s %8s %14s %9s %10s %12s %12s %7s\n",
+                         "path", "block", "blocks/range", "pipeline", "MB/s", "requests/s", "connections", "resets" );
+
+        for( pathIndex = 0; pathIndex < ( sizeof( bodyPaths ) / sizeof( bodyPaths[ 0 ] ) ); pathIndex++ )
+        {
+            #if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+                ( void ) Posix_OtaHttpSetFileSink( ( pathIndex == 0U ) ? -1 : imageFile, writtenCallback );
+            #endif
+
+            for( blockIndex = 0; blockIndex < ( sizeof( blockSizes ) / sizeof( blockSizes[ 0 ] ) ); blockIndex++ )
+            {
+                for( rangeIndex = 0; rangeIndex < ( sizeof( blocksPerRange ) / sizeof( blocksPerRange[ 0 ] ) ); rangeIndex++ )
+                {
+                    rangeSize = blockSizes[ blockIndex ] * blocksPerRange[ rangeIndex ];
+                    numRanges = ( fileSize + rangeSize - 1U ) / rangeSize;
+                    pRangeBytes = malloc( numRanges * sizeof( uint32_t ) );
+                    pRangeInFlight = malloc( numRanges );
+
+                    for( depthIndex = 0; ( depthIndex < ( sizeof( pipelineDepths ) / sizeof( pipelineDepths[ 0 ] ) ) ) && ( pRangeBytes != NULL ) && ( pRangeInFlight != NULL ); depthIndex++ )
+                    {
+                        elapsed = -1.0;
+
+                        /* Start every download with an empty file. */
+                        if( ( ftruncate( imageFile, 0 ) == 0 ) && ( Posix_OtaHttpInit( url ) == OtaHttpSuccess ) )
+                        {
+                            elapsed = downloadFile( pipelineDepths[ depthIndex ] );
+                            Posix_OtaHttpGetStats( &stats );
+                            ( void ) Posix_OtaHttpDeinit();
+                        }
+
+                        if( ( elapsed < 0.0 ) || ( verifyFile() > 0U ) )
+                        {
+                            ( void ) printf( "%9s %8u %14u %9u %10s\n",
+                                             bodyPaths[ pathIndex ],
+                                             ( unsigned int ) blockSizes[ blockIndex ],
+                                             ( unsigned int ) blocksPerRange[ rangeIndex ],
+                                             ( unsigned int ) pipelineDepths[ depthIndex ],
+                                             "FAILED" );
+                            exitStatus = EXIT_FAILURE;
+                        }
+                        else
+                        {
+                            ( void ) printf( "%9s %8u %14u %9u %10.2f %12.0f %12u %7u\n",
+                                             bodyPaths[ pathIndex ],
+                                             ( unsigned int ) blockSizes[ blockIndex ],
+                                             ( unsigned int ) blocksPerRange[ rangeIndex ],
+                                             ( unsigned int ) pipelineDepths[ depthIndex ],
+                                             ( ( double ) fileSize / BYTES_PER_MB ) / elapsed,
+                                             ( double ) stats.requests / elapsed,
+                                             ( unsigned int ) stats.connections,
+                                             ( unsigned int ) stats.resets );
+                        }
+
+                        ( void ) fflush( stdout );
+                    }
+
+                    free( pRangeBytes );
+                    free( pRangeInFlight );
+                }
+            }
+        }
+
+        RangeServer_Stop();
+    }
+    else
+    {
+        exitStatus = EXIT_FAILURE;
+    }
+
+    if( imageFile >= 0 )
+    {
+        ( void ) close( imageFile );
+        ( void ) unlink( imagePath );
+    }
+
+    return exitStatus;
+}
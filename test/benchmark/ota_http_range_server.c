@@ -0,0 +1,459 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_http_range_server.c
+ * @brief Loopback HTTP/1.1 range server for testing and benchmarking the HTTP data plane.
+ *
+ * The server handles one persistent connection at a time and answers pipelined
+ * requests in order. It can delay every response by a latency after its request
+ * arrived, limit the bandwidth and reset the connection halfway through a response.
+ * Like a pre-signed url, a url can expire after a number of requests, a request for a
+ * different url starts over.
+ */
+
+/* Standard Includes.*/
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+/* Posix includes. */
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "ota_http_range_server.h"
+
+#define SERVER_POLL_INTERVAL_MS    100
+#define SERVER_BUFFER_SIZE         4096U
+#define SERVER_SEND_SLICE_SIZE     1024U
+#define SERVER_HEADER_END          "\r\n\r\n"
+#define SERVER_RANGE_HEADER        "\nRange: bytes="
+#define SERVER_MAX_URL_SIZE        256U
+#define SERVER_EXPIRED_BODY        "Request has expired"
+#define NANOSECONDS_PER_SECOND     1000000000ULL
+#define NANOSECONDS_PER_MS         1000000ULL
+
+static pthread_t serverThread;
+static pthread_mutex_t serverMutex = PTHREAD_MUTEX_INITIALIZER;
+static int listenSocket = -1;
+static volatile bool stopServer = false;
+static RangeServerConfig_t serverConfig;
+static RangeServerStats_t serverStats;
+
+/* Url of the last request and the number of requests for it. */
+static char pCurrentUrl[ SERVER_MAX_URL_SIZE ];
+static uint32_t urlRequests = 0;
+
+/* Count the request for its url and check if the url expired. */
+static bool isUrlExpired( const char * pRequest )
+{
+    const char * pUrl = strchr( pRequest, ' ' );
+    size_t urlLength = 0;
+
+    if( pUrl != NULL )
+    {
+        pUrl = &pUrl[ 1 ];
+        urlLength = strcspn( pUrl, " \r\n" );
+    }
+
+    if( urlLength >= sizeof( pCurrentUrl ) )
+    {
+        urlLength = sizeof( pCurrentUrl ) - 1U;
+    }
+
+    if( ( pUrl != NULL ) && ( ( strncmp( pCurrentUrl, pUrl, urlLength ) != 0 ) || ( pCurrentUrl[ urlLength ] != '\0' ) ) )
+    {
+        ( void ) memcpy( pCurrentUrl, pUrl, urlLength );
+        pCurrentUrl[ urlLength ] = '\0';
+        urlRequests = 0;
+    }
+
+    urlRequests++;
+
+    return( ( serverConfig.expireAfterRequests > 0U ) && ( urlRequests > serverConfig.expireAfterRequests ) );
+}
+
+static uint64_t nowNs( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( ( uint64_t ) now.tv_sec * NANOSECONDS_PER_SECOND ) + ( uint64_t ) now.tv_nsec;
+}
+
+static void sleepNs( uint64_t duration )
+{
+    struct timespec delay;
+
+    delay.tv_sec = ( time_t ) ( duration / NANOSECONDS_PER_SECOND );
+    delay.tv_nsec = ( long ) ( duration % NANOSECONDS_PER_SECOND );
+
+    while( ( nanosleep( &delay, &delay ) != 0 ) && ( errno == EINTR ) )
+    {
+    }
+}
+
+static bool sendAll( int clientSocket,
+                     const uint8_t * pData,
+                     size_t length )
+{
+    size_t bytesSent = 0;
+    ssize_t sendResult = 0;
+
+    while( ( bytesSent < length ) && ( sendResult >= 0 ) )
+    {
+        sendResult = send( clientSocket, &pData[ bytesSent ], length - bytesSent, MSG_NOSIGNAL );
+
+        if( sendResult > 0 )
+        {
+            bytesSent += ( size_t ) sendResult;
+        }
+        else if( ( sendResult < 0 ) && ( errno == EINTR ) )
+        {
+            sendResult = 0;
+        }
+        else
+        {
+            sendResult = -1;
+        }
+    }
+
+    return( bytesSent == length );
+}
+
+/* Send the file data from the offset, limited to the configured bandwidth. */
+static bool sendBody( int clientSocket,
+                      uint32_t offset,
+                      uint32_t length )
+{
+    uint8_t slice[ SERVER_SEND_SLICE_SIZE ];
+    uint64_t startTime = nowNs();
+    uint64_t dueTime = 0;
+    uint32_t bytesSent = 0;
+    uint32_t sliceLength = 0;
+    uint32_t index = 0;
+    bool sendOk = true;
+
+    while( ( bytesSent < length ) && ( sendOk == true ) )
+    {
+        sliceLength = length - bytesSent;
+
+        if( sliceLength > SERVER_SEND_SLICE_SIZE )
+        {
+            sliceLength = SERVER_SEND_SLICE_SIZE;
+        }
+
+        for( index = 0; index < sliceLength; index++ )
+        {
+            slice[ index ] = RANGE_SERVER_FILE_BYTE( offset + bytesSent + index );
+        }
+
+        sendOk = sendAll( clientSocket, slice, sliceLength );
+        bytesSent += sliceLength;
+
+        if( serverConfig.bytesPerSecond > 0U )
+        {
+            dueTime = startTime + ( ( uint64_t ) bytesSent * NANOSECONDS_PER_SECOND ) / serverConfig.bytesPerSecond;
+
+            if( dueTime > nowNs() )
+            {
+                sleepNs( dueTime - nowNs() );
+            }
+        }
+    }
+
+    return sendOk;
+}
+
+/* Answer one request. Returns false if the connection must be closed. */
+static bool handleRequest( int clientSocket,
+                           const char * pRequest,
+                           uint64_t arrivalTime )
+{
+    char headers[ 256 ];
+    const char * pRange = strstr( pRequest, SERVER_RANGE_HEADER );
+    unsigned long rangeStart = 0;
+    unsigned long rangeEnd = serverConfig.fileSize - 1U;
+    uint32_t requestNumber = 0;
+    uint64_t dueTime = 0;
+    int headersLength = 0;
+    bool keepOpen = true;
+    struct linger lingerOption;
+
+    ( void ) pthread_mutex_lock( &serverMutex );
+    serverStats.requests++;
+    requestNumber = serverStats.requests;
+    ( void ) pthread_mutex_unlock( &serverMutex );
+
+    /* Pipelined requests wait for the latency at the same time, like a network round trip. */
+    dueTime = arrivalTime + ( ( uint64_t ) serverConfig.latencyMs * NANOSECONDS_PER_MS );
+
+    if( dueTime > nowNs() )
+    {
+        sleepNs( dueTime - nowNs() );
+    }
+
+    if( pRange != NULL )
+    {
+        pRange = &pRange[ sizeof( SERVER_RANGE_HEADER ) - 1U ];
+        rangeStart = strtoul( pRange, NULL, 10 );
+        pRange = strchr( pRange, '-' );
+        rangeEnd = ( pRange != NULL ) ? strtoul( &pRange[ 1 ], NULL, 10 ) : 0UL;
+
+        if( rangeEnd >= serverConfig.fileSize )
+        {
+            rangeEnd = serverConfig.fileSize - 1U;
+        }
+    }
+
+    if( isUrlExpired( pRequest ) == true )
+    {
+        headersLength = snprintf( headers, sizeof( headers ),
+                                  "HTTP/1.1 403 Forbidden\r\n"
+                                  "Content-Length: %u\r\n"
+                                  "\r\n"
+                                  SERVER_EXPIRED_BODY,
+                                  ( unsigned int ) ( sizeof( SERVER_EXPIRED_BODY ) - 1U ) );
+        keepOpen = sendAll( clientSocket, ( const uint8_t * ) headers, ( size_t ) headersLength );
+
+        ( void ) pthread_mutex_lock( &serverMutex );
+        serverStats.expired++;
+        ( void ) pthread_mutex_unlock( &serverMutex );
+    }
+    else if( ( rangeStart > rangeEnd ) || ( rangeStart >= serverConfig.fileSize ) )
+    {
+        headersLength = snprintf( headers, sizeof( headers ),
+                                  "HTTP/1.1 416 Range Not Satisfiable\r\n"
+                                  "Content-Range: bytes */%u\r\n"
+                                  "Content-Length: 0\r\n"
+                                  "\r\n",
+                                  ( unsigned int ) serverConfig.fileSize );
+        keepOpen = sendAll( clientSocket, ( const uint8_t * ) headers, ( size_t ) headersLength );
+    }
+    else
+    {
+        headersLength = snprintf( headers, sizeof( headers ),
+                                  "HTTP/1.1 206 Partial Content\r\n"
+                                  "Content-Range: bytes %lu-%lu/%u\r\n"
+                                  "Content-Length: %lu\r\n"
+                                  "\r\n",
+                                  rangeStart,
+                                  rangeEnd,
+                                  ( unsigned int ) serverConfig.fileSize,
+                                  rangeEnd - rangeStart + 1UL );
+        keepOpen = sendAll( clientSocket, ( const uint8_t * ) headers, ( size_t ) headersLength );
+
+        if( ( serverConfig.resetAfterRequests > 0U ) && ( ( requestNumber % serverConfig.resetAfterRequests ) == 0U ) )
+        {
+            /* Send half of the body and abort the connection with a reset. */
+            ( void ) sendBody( clientSocket, ( uint32_t ) rangeStart, ( uint32_t ) ( rangeEnd - rangeStart + 1UL ) / 2U );
+
+            lingerOption.l_onoff = 1;
+            lingerOption.l_linger = 0;
+            ( void ) setsockopt( clientSocket, SOL_SOCKET, SO_LINGER, &lingerOption, sizeof( lingerOption ) );
+
+            ( void ) pthread_mutex_lock( &serverMutex );
+            serverStats.resets++;
+            ( void ) pthread_mutex_unlock( &serverMutex );
+
+            keepOpen = false;
+        }
+        else if( keepOpen == true )
+        {
+            keepOpen = sendBody( clientSocket, ( uint32_t ) rangeStart, ( uint32_t ) ( rangeEnd - rangeStart + 1UL ) );
+        }
+        else
+        {
+            /* The client is gone. */
+        }
+    }
+
+    return keepOpen;
+}
+
+/* Answer the requests on a connection until it is closed. */
+static void serveConnection( int clientSocket )
+{
+    char buffer[ SERVER_BUFFER_SIZE + 1U ];
+    size_t length = 0;
+    size_t requestLength = 0;
+    char * pHeaderEnd = NULL;
+    struct pollfd pollSocket;
+    ssize_t recvResult = 0;
+    uint64_t arrivalTime = 0;
+    bool keepOpen = true;
+    int noDelay = 1;
+
+    ( void ) setsockopt( clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof( noDelay ) );
+
+    pollSocket.fd = clientSocket;
+    pollSocket.events = POLLIN;
+
+    while( ( keepOpen == true ) && ( stopServer == false ) )
+    {
+        buffer[ length ] = '\0';
+        pHeaderEnd = strstr( buffer, SERVER_HEADER_END );
+
+        if( pHeaderEnd != NULL )
+        {
+            /* Answer a complete request. Pipelined requests stay in the buffer. */
+            requestLength = ( size_t ) ( pHeaderEnd - buffer ) + sizeof( SERVER_HEADER_END ) - 1U;
+            pHeaderEnd[ 1 ] = '\0';
+            keepOpen = handleRequest( clientSocket, buffer, arrivalTime );
+            length -= requestLength;
+            ( void ) memmove( buffer, &buffer[ requestLength ], length );
+        }
+        else if( length == SERVER_BUFFER_SIZE )
+        {
+            keepOpen = false;
+        }
+        else if( poll( &pollSocket, 1, SERVER_POLL_INTERVAL_MS ) > 0 )
+        {
+            recvResult = recv( clientSocket, &buffer[ length ], SERVER_BUFFER_SIZE - length, 0 );
+
+            if( recvResult > 0 )
+            {
+                arrivalTime = nowNs();
+                length += ( size_t ) recvResult;
+            }
+            else
+            {
+                keepOpen = false;
+            }
+        }
+        else
+        {
+            /* Check whether the server is stopped. */
+        }
+    }
+
+    ( void ) close( clientSocket );
+}
+
+static void * serverTask( void * pArgs )
+{
+    struct pollfd pollSocket;
+    int clientSocket = -1;
+
+    ( void ) pArgs;
+
+    pollSocket.fd = listenSocket;
+    pollSocket.events = POLLIN;
+
+    while( stopServer == false )
+    {
+        if( poll( &pollSocket, 1, SERVER_POLL_INTERVAL_MS ) > 0 )
+        {
+            clientSocket = accept( listenSocket, NULL, NULL );
+
+            if( clientSocket >= 0 )
+            {
+                ( void ) pthread_mutex_lock( &serverMutex );
+                serverStats.connections++;
+                ( void ) pthread_mutex_unlock( &serverMutex );
+
+                serveConnection( clientSocket );
+            }
+        }
+    }
+
+    return NULL;
+}
+
+bool RangeServer_Start( const RangeServerConfig_t * pConfig,
+                        uint16_t * pPort )
+{
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof( address );
+    int reuseAddress = 1;
+    bool started = false;
+
+    ( void ) memcpy( &serverConfig, pConfig, sizeof( serverConfig ) );
+    ( void ) memset( &serverStats, 0, sizeof( serverStats ) );
+    ( void ) memset( pCurrentUrl, 0, sizeof( pCurrentUrl ) );
+    urlRequests = 0;
+    stopServer = false;
+
+    ( void ) memset( &address, 0, sizeof( address ) );
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    address.sin_port = htons( pConfig->port );
+
+    listenSocket = socket( AF_INET, SOCK_STREAM, 0 );
+
+    if( listenSocket >= 0 )
+    {
+        ( void ) setsockopt( listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof( reuseAddress ) );
+
+        if( ( bind( listenSocket, ( struct sockaddr * ) &address, sizeof( address ) ) == 0 ) &&
+            ( listen( listenSocket, 4 ) == 0 ) &&
+            ( getsockname( listenSocket, ( struct sockaddr * ) &address, &addressLength ) == 0 ) &&
+            ( pthread_create( &serverThread, NULL, serverTask, NULL ) == 0 ) )
+        {
+            *pPort = ntohs( address.sin_port );
+            started = true;
+        }
+        else
+        {
+            ( void ) close( listenSocket );
+            listenSocket = -1;
+        }
+    }
+
+    if( started == false )
+    {
+        ( void ) fprintf( stderr, "Failed to start the range server: %s\n", strerror( errno ) );
+    }
+
+    return started;
+}
+
+void RangeServer_GetStats( RangeServerStats_t * pStats )
+{
+    ( void ) pthread_mutex_lock( &serverMutex );
+    ( void ) memcpy( pStats, &serverStats, sizeof( serverStats ) );
+    ( void ) pthread_mutex_unlock( &serverMutex );
+}
+
+void RangeServer_Stop( void )
+{
+    if( listenSocket >= 0 )
+    {
+        stopServer = true;
+        ( void ) pthread_join( serverThread, NULL );
+        ( void ) close( listenSocket );
+        listenSocket = -1;
+    }
+}
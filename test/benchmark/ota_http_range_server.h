@@ -0,0 +1,91 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_http_range_server.h
+ * @brief Loopback HTTP/1.1 range server for testing and benchmarking the HTTP data plane.
+ */
+
+#ifndef _OTA_HTTP_RANGE_SERVER_H_
+#define _OTA_HTTP_RANGE_SERVER_H_
+
+/* Standard library include. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Byte of the served file at an offset.
+ */
+#define RANGE_SERVER_FILE_BYTE( offset )    ( ( uint8_t ) ( ( offset ) % 251U ) )
+
+/**
+ * @brief Configuration of the range server.
+ */
+typedef struct RangeServerConfig
+{
+    uint16_t port;                /*!< Loopback port to listen on, 0 to pick a free port. */
+    uint32_t fileSize;            /*!< Size of the served file. */
+    uint32_t latencyMs;           /*!< Delay before each response. */
+    uint32_t bytesPerSecond;      /*!< Bandwidth limit of the responses, 0 for no limit. */
+    uint32_t resetAfterRequests;  /*!< Reset the connection halfway through every Nth response, 0 for no resets. */
+    uint32_t expireAfterRequests; /*!< Answer 403 Forbidden after N requests for the same url, 0 for urls that never expire. */
+} RangeServerConfig_t;
+
+/**
+ * @brief Statistics of the range server.
+ */
+typedef struct RangeServerStats
+{
+    uint32_t connections; /*!< Number of connections accepted. */
+    uint32_t requests;    /*!< Number of requests received. */
+    uint32_t resets;      /*!< Number of connections reset. */
+    uint32_t expired;     /*!< Number of requests rejected for an expired url. */
+} RangeServerStats_t;
+
+/**
+ * @brief Start the range server on a thread.
+ *
+ * @param[pConfig]      Configuration of the server.
+ *
+ * @param[pPort]        Pointer to store the port the server listens on.
+ *
+ * @return              true if the server was started, false otherwise.
+ */
+bool RangeServer_Start( const RangeServerConfig_t * pConfig,
+                        uint16_t * pPort );
+
+/**
+ * @brief Get the statistics of the range server.
+ *
+ * @param[pStats]       Pointer to store the statistics.
+ */
+void RangeServer_GetStats( RangeServerStats_t * pStats );
+
+/**
+ * @brief Stop the range server and wait for its thread.
+ */
+void RangeServer_Stop( void );
+
+#endif /* ifndef _OTA_HTTP_RANGE_SERVER_H_ */
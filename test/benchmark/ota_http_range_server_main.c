@@ -0,0 +1,121 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_http_range_server_main.c
+ * @brief Run the loopback range server until it is interrupted.
+ *
+ * Usage: ota_http_range_server [-p port] [-s fileSize] [-l latencyMs] [-b bytesPerSecond] [-r resetAfterRequests] [-e expireAfterRequests]
+ */
+
+/* Standard Includes.*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+
+/* Posix includes. */
+#include <unistd.h>
+
+#include "ota_http_range_server.h"
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void interruptHandler( int signalNumber )
+{
+    ( void ) signalNumber;
+    interrupted = 1;
+}
+
+int main( int argc,
+          char ** argv )
+{
+    RangeServerConfig_t config = { 0, 1048576U, 0U, 0U, 0U, 0U };
+    RangeServerStats_t stats;
+    uint16_t port = 0;
+    int option = 0;
+    int exitStatus = EXIT_SUCCESS;
+
+    while( ( option = getopt( argc, argv, "p:s:l:b:r:e:" ) ) != -1 )
+    {
+        switch( option )
+        {
+            case 'p':
+                config.port = ( uint16_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 's':
+                config.fileSize = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'l':
+                config.latencyMs = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'b':
+                config.bytesPerSecond = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'r':
+                config.resetAfterRequests = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'e':
+                config.expireAfterRequests = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            default:
+                ( void ) fprintf( stderr, "Usage: %s [-p port] [-s fileSize] [-l latencyMs] [-b bytesPerSecond] [-r resetAfterRequests] [-e expireAfterRequests]\n", argv[ 0 ] );
+                exitStatus = EXIT_FAILURE;
+                break;
+        }
+    }
+
+    if( ( exitStatus == EXIT_SUCCESS ) && ( RangeServer_Start( &config, &port ) == true ) )
+    {
+        ( void ) signal( SIGINT, interruptHandler );
+        ( void ) signal( SIGTERM, interruptHandler );
+        ( void ) printf( "Serving %u bytes on http://127.0.0.1:%u/\n", ( unsigned int ) config.fileSize, ( unsigned int ) port );
+        ( void ) fflush( stdout );
+
+        while( interrupted == 0 )
+        {
+            ( void ) pause();
+        }
+
+        RangeServer_Stop();
+        RangeServer_GetStats( &stats );
+        ( void ) printf( "connections=%u requests=%u resets=%u expired=%u\n",
+                         ( unsigned int ) stats.connections,
+                         ( unsigned int ) stats.requests,
+                         ( unsigned int ) stats.resets,
+                         ( unsigned int ) stats.expired );
+    }
+    else
+    {
+        exitStatus = EXIT_FAILURE;
+    }
+
+    return exitStatus;
+}
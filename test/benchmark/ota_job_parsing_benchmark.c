@@ -0,0 +1,299 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_job_parsing_benchmark.c
+ * @brief Benchmark the parser of the job documents.
+ *
+ * Job documents with one or more files are searched with one coreJSON search per model
+ * parameter, as the agent did before, tokenized in one pass, and parsed by the document
+ * model, which tokenizes the document and stores the parameters in the file context.
+ * The time per document is reported for each document.
+ *
+ * Usage: ota_job_parsing_benchmark [-n iterations]
+ */
+
+/* Standard Includes.*/
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Posix includes. */
+#include <unistd.h>
+
+/* For accessing the OTA private functions. */
+#include "ota.c"
+
+#define BENCHMARK_DOC_SIZE         8192U
+#define BENCHMARK_FILE_PATH_SIZE   64U
+#define BENCHMARK_STREAM_SIZE      64U
+
+/* A file of the file group. */
+#define BENCHMARK_FILE_JSON                                                                         \
+    "{\"filepath\":\"/device/images/demo%u.bin\",\"filesize\":180568,\"fileid\":%u,"                \
+    "\"certfile\":\"/device/certs/signer.crt\",\"attr\":0,\"fileType\":0,"                          \
+    "\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}"
+
+/* The job document up to the file group, and after it. */
+#define BENCHMARK_DOC_HEAD_JSON                                                                     \
+    "{\"clientToken\":\"0:demo-thing\",\"timestamp\":1602795143,\"execution\":{"                    \
+    "\"jobId\":\"AFR_OTA-demo-job\",\"status\":\"QUEUED\",\"statusDetails\":{\"updatedBy\":65536}," \
+    "\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1," \
+    "\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"MQTT\"],\"streamname\":\"AFR_OTA-demo-stream\",\"files\":["
+#define BENCHMARK_DOC_TAIL_JSON    "]}}}}"
+
+/* Firmware version. */
+const AppVersion32_t appFirmwareVersion =
+{
+    .u.x.major = 1,
+    .u.x.minor = 0,
+    .u.x.build = 0,
+};
+
+/* OTA code signing signature algorithm. */
+const char OTA_JsonFileSignatureKey[ OTA_FILE_SIG_KEY_STR_MAX_LENGTH ] = "sig-sha256-ecdsa";
+
+static const uint32_t numFiles[] = { 1U, 4U, 16U };
+
+static OtaInterfaces_t benchmarkInterfaces;
+static char document[ BENCHMARK_DOC_SIZE ];
+static uint8_t pFilePath[ BENCHMARK_FILE_PATH_SIZE ];
+static uint8_t pCertFilePath[ BENCHMARK_FILE_PATH_SIZE ];
+static uint8_t pStreamName[ BENCHMARK_STREAM_SIZE ];
+
+/* Parser of a job document. */
+typedef bool ( * BenchmarkParser_t )( const char * pJson,
+                                      uint32_t length );
+
+typedef struct BenchmarkCase
+{
+    const char * pName;
+    BenchmarkParser_t parse;
+} BenchmarkCase_t;
+
+static double nowSeconds( void )
+{
+    struct timespec now;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( double ) now.tv_sec + ( ( double ) now.tv_nsec / 1e9 );
+}
+
+/* Search the document once per model parameter, and in the file group for the ones not found. */
+static bool parseSearch( const char * pJson,
+                         uint32_t length )
+{
+    JsonDocModel_t docModel;
+    const char * pFileParams = NULL;
+    size_t fileParamsLength = 0;
+    const char * pValue = NULL;
+    size_t valueLength = 0;
+    uint16_t paramIndex = 0;
+    JSONStatus_t result = JSONSuccess;
+
+    ( void ) initDocModel( &docModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    result = JSON_Validate( pJson, length );
+
+    for( paramIndex = 0; ( paramIndex < OTA_NUM_JOB_PARAMS ) && ( result == JSONSuccess ); paramIndex++ )
+    {
+        const char * pKey = otaJobDocModelParamStructure[ paramIndex ].pSrcKey;
+
+        if( ( JSON_SearchConst( pJson, length, pKey, strlen( pKey ), &pValue, &valueLength, NULL ) == JSONSuccess ) ||
+            ( ( pFileParams != NULL ) &&
+              ( JSON_SearchConst( pFileParams, fileParamsLength, pKey, strlen( pKey ), &pValue, &valueLength, NULL ) == JSONSuccess ) ) )
+        {
+            docModel.paramsReceivedBitmap |= ( ( uint32_t ) 1U << paramIndex );
+
+            if( otaJobDocModelParamStructure[ paramIndex ].pDestOffset == OTA_STORE_NESTED_JSON )
+            {
+                pFileParams = &pValue[ 1 ];
+                fileParamsLength = valueLength - 2U;
+            }
+        }
+    }
+
+    return ( result == JSONSuccess ) &&
+           ( ( docModel.paramsReceivedBitmap & docModel.paramsRequiredBitmap ) == docModel.paramsRequiredBitmap );
+}
+
+/* Tokenize the document in one pass. */
+static bool parseTokenize( const char * pJson,
+                           uint32_t length )
+{
+    JsonDocModel_t docModel;
+    bool result = false;
+
+    ( void ) initDocModel( &docModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+
+    if( validateJSON( pJson, length ) == DocParseErrNone )
+    {
+        tokenizeJSONbyModel( pJson, length, &docModel );
+        result = ( docModel.paramsReceivedBitmap & docModel.paramsRequiredBitmap ) == docModel.paramsRequiredBitmap;
+    }
+
+    return result;
+}
+
+/* Parse the document by the model and store the parameters, like the agent does. */
+static bool parseModel( const char * pJson,
+                        uint32_t length )
+{
+    JsonDocModel_t docModel;
+
+    ( void ) initDocModel( &docModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+
+    return ( tokenizeJobDoc( pJson, length, &docModel ) == DocParseErrNone ) &&
+           ( extractJSONbyModel( &docModel ) == DocParseErrNone );
+}
+
+static const BenchmarkCase_t benchmarkCases[] =
+{
+    { "search",   parseSearch   },
+    { "tokenize", parseTokenize },
+    { "parse",    parseModel    }
+};
+
+/* Build a job document with a number of files, and return its length. */
+static uint32_t buildDocument( uint32_t files )
+{
+    size_t length = 0;
+    uint32_t i = 0;
+
+    length = ( size_t ) snprintf( document, sizeof( document ), BENCHMARK_DOC_HEAD_JSON );
+
+    for( i = 0; i < files; i++ )
+    {
+        length += ( size_t ) snprintf( &document[ length ], sizeof( document ) - length, "%s" BENCHMARK_FILE_JSON, ( i > 0U ) ? "," : "", i, i );
+    }
+
+    length += ( size_t ) snprintf( &document[ length ], sizeof( document ) - length, BENCHMARK_DOC_TAIL_JSON );
+
+    return ( uint32_t ) length;
+}
+
+/* Return the time per document in nanoseconds, or a negative value on failure. */
+static double timeParser( BenchmarkParser_t parse,
+                          uint32_t length,
+                          unsigned long iterations )
+{
+    unsigned long i = 0;
+    double start = 0.0;
+    double elapsed = -1.0;
+    bool result = true;
+
+    start = nowSeconds();
+
+    for( i = 0; ( i < iterations ) && ( result == true ); i++ )
+    {
+        result = parse( document, length );
+    }
+
+    if( result == true )
+    {
+        elapsed = ( ( nowSeconds() - start ) * 1e9 ) / ( double ) iterations;
+    }
+
+    return elapsed;
+}
+
+int main( int argc,
+          char ** argv )
+{
+    unsigned long iterations = 100000UL;
+    size_t docIndex = 0;
+    size_t caseIndex = 0;
+    uint32_t length = 0;
+    double elapsedNs = 0.0;
+    int option = 0;
+    int exitStatus = EXIT_SUCCESS;
+
+    while( ( option = getopt( argc, argv, "n:" ) ) != -1 )
+    {
+        switch( option )
+        {
+            case 'n':
+                iterations = strtoul( optarg, NULL, 10 );
+                break;
+
+            default:
+                ( void ) fprintf( stderr, "Usage: %s [-n iterations]\n", argv[ 0 ] );
+                exitStatus = EXIT_FAILURE;
+                break;
+        }
+    }
+
+    if( iterations == 0UL )
+    {
+        iterations = 1UL;
+    }
+
+    /* Store the parameters in buffers of the application, and the job name, protocols and
+     * signature in the buffers of the agent. */
+    benchmarkInterfaces.os.mem.malloc = malloc;
+    benchmarkInterfaces.os.mem.free = free;
+    otaAgent.pOtaInterface = &benchmarkInterfaces;
+    initializeLocalBuffers();
+    otaAgent.fileContext.pFilePath = pFilePath;
+    otaAgent.fileContext.filePathMaxSize = ( uint16_t ) sizeof( pFilePath );
+    otaAgent.fileContext.pCertFilepath = pCertFilePath;
+    otaAgent.fileContext.certFilePathMaxSize = ( uint16_t ) sizeof( pCertFilePath );
+    otaAgent.fileContext.pStreamName = pStreamName;
+    otaAgent.fileContext.streamNameMaxSize = ( uint16_t ) sizeof( pStreamName );
+
+    if( exitStatus == EXIT_SUCCESS )
+    {
+        ( void ) printf( "%-8s %-8s %-10s %s\n", "files", "bytes", "parser", "ns/doc" );
+    }
+
+    for( docIndex = 0; ( docIndex < ( sizeof( numFiles ) / sizeof( numFiles[ 0 ] ) ) ) && ( exitStatus == EXIT_SUCCESS ); docIndex++ )
+    {
+        length = buildDocument( numFiles[ docIndex ] );
+
+        for( caseIndex = 0; ( caseIndex < ( sizeof( benchmarkCases ) / sizeof( benchmarkCases[ 0 ] ) ) ) && ( exitStatus == EXIT_SUCCESS ); caseIndex++ )
+        {
+            elapsedNs = timeParser( benchmarkCases[ caseIndex ].parse, length, iterations );
+
+            if( elapsedNs < 0.0 )
+            {
+                ( void ) fprintf( stderr, "The %s parser failed to parse a job document with %lu files.\n",
+                                  benchmarkCases[ caseIndex ].pName,
+                                  ( unsigned long ) numFiles[ docIndex ] );
+                exitStatus = EXIT_FAILURE;
+            }
+            else
+            {
+                ( void ) printf( "%-8lu %-8lu %-10s %.1f\n",
+                                 ( unsigned long ) numFiles[ docIndex ],
+                                 ( unsigned long ) length,
+                                 benchmarkCases[ caseIndex ].pName,
+                                 elapsedNs );
+            }
+        }
+    }
+
+    return exitStatus;
+}
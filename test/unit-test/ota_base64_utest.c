@@ -30,6 +30,7 @@
  */
 
 #include <string.h>
+#include <stdbool.h>
 #include "unity.h"
 
 /* For accessing OTA private functions and error codes. */
@@ -144,6 +145,11 @@
 #define BASE64_INVALID_DATA_PADDING_AT_MIDDLE_ENCODED                 "Rk9P=QkFS"
 #define BASE64_INVALID_DATA_PADDING_AT_MIDDLE_ENCODED_LEN             ( sizeof( BASE64_INVALID_DATA_PADDING_AT_MIDDLE_ENCODED ) - 1U )
 
+#define BASE64_TEST_LONG_DATA_LEN                                     300U
+#define BASE64_TEST_LONG_DATA_ENCODED_LEN                             400U
+#define BASE64_TEST_LINE_LEN                                          64U
+#define BASE64_TEST_LONG_DATA_WITH_LINE_BREAKS_LEN                    ( BASE64_TEST_LONG_DATA_ENCODED_LEN + ( 2U * ( BASE64_TEST_LONG_DATA_ENCODED_LEN / BASE64_TEST_LINE_LEN ) ) )
+
 /* ============================   UNITY FIXTURES ============================ */
 
 void setUp( void )
@@ -156,6 +162,94 @@ void tearDown( void )
 
 /* ========================================================================== */
 
+/**
+ * @brief Encode BASE64_TEST_LONG_DATA_LEN bytes of data, with a CRLF line
+ *        break every BASE64_TEST_LINE_LEN symbols if lineBreaks is true.
+ */
+static size_t encodeLongData( uint8_t * pData,
+                              uint8_t * pEncoded,
+                              bool lineBreaks )
+{
+    uint8_t pEncodedData[ BASE64_TEST_LONG_DATA_ENCODED_LEN ];
+    size_t encodedLen = 0;
+    size_t outputLen = 0;
+    size_t i = 0;
+    int result = 0;
+
+    for( i = 0; i < BASE64_TEST_LONG_DATA_LEN; i++ )
+    {
+        pData[ i ] = ( uint8_t ) ( i * 7U );
+    }
+
+    result = base64Encode( pEncodedData,
+                           sizeof( pEncodedData ),
+                           &encodedLen,
+                           pData,
+                           BASE64_TEST_LONG_DATA_LEN );
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    TEST_ASSERT_EQUAL( BASE64_TEST_LONG_DATA_ENCODED_LEN, encodedLen );
+
+    for( i = 0; i < encodedLen; i++ )
+    {
+        pEncoded[ outputLen++ ] = pEncodedData[ i ];
+
+        if( ( lineBreaks == true ) && ( ( ( i + 1U ) % BASE64_TEST_LINE_LEN ) == 0U ) )
+        {
+            pEncoded[ outputLen++ ] = '\r';
+            pEncoded[ outputLen++ ] = '\n';
+        }
+    }
+
+    return outputLen;
+}
+
+/**
+ * @brief Decode Base64 encoded data in parts of partLen symbols with a
+ *        decoding context.
+ */
+static Base64Status_t decodeInParts( uint8_t * pDest,
+                                     size_t destLen,
+                                     size_t * pResultLen,
+                                     const uint8_t * pEncodedData,
+                                     size_t encodedLen,
+                                     size_t partLen )
+{
+    Base64DecodeContext_t context;
+    size_t offset = 0;
+    size_t currentPartLen = 0;
+    size_t outputLen = 0;
+    size_t resultLen = 0;
+    Base64Status_t result = Base64Success;
+
+    result = base64DecodeInit( &context );
+
+    while( ( result == Base64Success ) && ( offset < encodedLen ) )
+    {
+        currentPartLen = ( ( encodedLen - offset ) < partLen ) ? ( encodedLen - offset ) : partLen;
+        result = base64DecodeUpdate( &context,
+                                     &pDest[ outputLen ],
+                                     destLen - outputLen,
+                                     &resultLen,
+                                     &pEncodedData[ offset ],
+                                     currentPartLen );
+        outputLen += ( result == Base64Success ) ? resultLen : 0U;
+        offset += currentPartLen;
+    }
+
+    if( result == Base64Success )
+    {
+        result = base64DecodeFinal( &context,
+                                    &pDest[ outputLen ],
+                                    destLen - outputLen,
+                                    &resultLen );
+        *pResultLen = outputLen + resultLen;
+    }
+
+    return result;
+}
+
+/* ========================================================================== */
+
 /**
  * @brief Test that base64Decode is able to decode valid data with two padding
  *        symbols correctly.
@@ -659,4 +753,317 @@ void test_OTA_base64Decode_InvalidPaddingPlacement( void )
     TEST_ASSERT_EQUAL_INT( Base64InvalidSymbolOrdering, result );
 }
 
+/**
+ * @brief Test that base64Decode decodes long data with line breaks, where the
+ *        symbols are decoded four at a time between the line breaks.
+ */
+void test_OTA_base64Decode_ValidLongDataWithLineBreaks( void )
+{
+    uint8_t pData[ BASE64_TEST_LONG_DATA_LEN ];
+    uint8_t pEncoded[ BASE64_TEST_LONG_DATA_WITH_LINE_BREAKS_LEN ];
+    uint8_t pDecodedResultBuffer[ BASE64_TEST_LONG_DATA_LEN ] = { 0 };
+    size_t encodedLen = 0;
+    size_t resultLen = 0;
+    int result = 0;
+
+    encodedLen = encodeLongData( pData, pEncoded, false );
+
+    result = base64Decode( pDecodedResultBuffer,
+                           sizeof( pDecodedResultBuffer ),
+                           &resultLen,
+                           pEncoded,
+                           encodedLen );
+
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    TEST_ASSERT_EQUAL( BASE64_TEST_LONG_DATA_LEN, resultLen );
+    TEST_ASSERT_EQUAL_MEMORY( pData, pDecodedResultBuffer, resultLen );
+
+    encodedLen = encodeLongData( pData, pEncoded, true );
+    ( void ) memset( pDecodedResultBuffer, 0, sizeof( pDecodedResultBuffer ) );
+
+    result = base64Decode( pDecodedResultBuffer,
+                           sizeof( pDecodedResultBuffer ),
+                           &resultLen,
+                           pEncoded,
+                           encodedLen );
+
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    TEST_ASSERT_EQUAL( BASE64_TEST_LONG_DATA_LEN, resultLen );
+    TEST_ASSERT_EQUAL_MEMORY( pData, pDecodedResultBuffer, resultLen );
+}
+
+/**
+ * @brief Test that base64Decode reports the same errors for symbols after
+ *        groups of Base64 digits as for short data.
+ */
+void test_OTA_base64Decode_InvalidLongData( void )
+{
+    uint8_t pData[ BASE64_TEST_LONG_DATA_LEN ];
+    uint8_t pEncoded[ BASE64_TEST_LONG_DATA_WITH_LINE_BREAKS_LEN ];
+    uint8_t pDecodedResultBuffer[ BASE64_TEST_LONG_DATA_LEN ] = { 0 };
+    size_t encodedLen = 0;
+    size_t resultLen = 0;
+    int result = 0;
+
+    /* An invalid symbol in the middle of a group. */
+    encodedLen = encodeLongData( pData, pEncoded, false );
+    pEncoded[ 101 ] = '*';
+
+    result = base64Decode( pDecodedResultBuffer,
+                           sizeof( pDecodedResultBuffer ),
+                           &resultLen,
+                           pEncoded,
+                           encodedLen );
+    TEST_ASSERT_EQUAL_INT( Base64InvalidSymbol, result );
+
+    /* Base64 digits after a whitespace. */
+    encodedLen = encodeLongData( pData, pEncoded, false );
+    pEncoded[ 200 ] = ' ';
+
+    result = base64Decode( pDecodedResultBuffer,
+                           sizeof( pDecodedResultBuffer ),
+                           &resultLen,
+                           pEncoded,
+                           encodedLen );
+    TEST_ASSERT_EQUAL_INT( Base64InvalidSymbolOrdering, result );
+
+    /* Base64 digits after padding. */
+    encodedLen = encodeLongData( pData, pEncoded, true );
+    pEncoded[ 66 ] = '=';
+
+    result = base64Decode( pDecodedResultBuffer,
+                           sizeof( pDecodedResultBuffer ),
+                           &resultLen,
+                           pEncoded,
+                           encodedLen );
+    TEST_ASSERT_EQUAL_INT( Base64InvalidSymbolOrdering, result );
+
+    /* The buffer is one byte too small for the last group. */
+    encodedLen = encodeLongData( pData, pEncoded, true );
+
+    result = base64Decode( pDecodedResultBuffer,
+                           sizeof( pDecodedResultBuffer ) - 1U,
+                           &resultLen,
+                           pEncoded,
+                           encodedLen );
+    TEST_ASSERT_EQUAL_INT( Base64InvalidBufferSize, result );
+}
+
+/**
+ * @brief Test that data decoded in parts of any size, split inside groups, line
+ *        breaks and padding, matches the data decoded at once.
+ */
+void test_OTA_base64DecodeUpdate_ValidDataInParts( void )
+{
+    uint8_t pData[ BASE64_TEST_LONG_DATA_LEN ];
+    uint8_t pEncoded[ BASE64_TEST_LONG_DATA_WITH_LINE_BREAKS_LEN ];
+    uint8_t pDecodedResultBuffer[ BASE64_TEST_LONG_DATA_LEN ] = { 0 };
+    size_t encodedLen = 0;
+    size_t resultLen = 0;
+    size_t partLen = 0;
+    int result = 0;
+
+    encodedLen = encodeLongData( pData, pEncoded, true );
+
+    for( partLen = 1; partLen <= encodedLen; partLen++ )
+    {
+        resultLen = 0;
+        memset( pDecodedResultBuffer, '\0', sizeof( pDecodedResultBuffer ) );
+        result = decodeInParts( pDecodedResultBuffer,
+                                sizeof( pDecodedResultBuffer ),
+                                &resultLen,
+                                pEncoded,
+                                encodedLen,
+                                partLen );
+        TEST_ASSERT_EQUAL_INT( Base64Success, result );
+        TEST_ASSERT_EQUAL( BASE64_TEST_LONG_DATA_LEN, resultLen );
+        TEST_ASSERT_EQUAL_MEMORY( pData, pDecodedResultBuffer, BASE64_TEST_LONG_DATA_LEN );
+    }
+
+    /* The padding and the trailing whitespace are carried over to the next part. */
+    for( partLen = 1; partLen <= BASE64_VALID_DATA_PADDING_WHITESPACE_ENCODED_LEN; partLen++ )
+    {
+        resultLen = 0;
+        memset( pDecodedResultBuffer, '\0', sizeof( pDecodedResultBuffer ) );
+        result = decodeInParts( pDecodedResultBuffer,
+                                BASE64_VALID_DATA_PADDING_WHITESPACE_DECODED_LEN,
+                                &resultLen,
+                                BASE64_VALID_DATA_PADDING_WHITESPACE_ENCODED,
+                                BASE64_VALID_DATA_PADDING_WHITESPACE_ENCODED_LEN,
+                                partLen );
+        TEST_ASSERT_EQUAL_INT( Base64Success, result );
+        TEST_ASSERT_EQUAL( BASE64_VALID_DATA_PADDING_WHITESPACE_DECODED_LEN, resultLen );
+        TEST_ASSERT_EQUAL_MEMORY( BASE64_VALID_DATA_PADDING_WHITESPACE_DECODED,
+                                  pDecodedResultBuffer,
+                                  BASE64_VALID_DATA_PADDING_WHITESPACE_DECODED_LEN );
+    }
+}
+
+/**
+ * @brief Test that invalid data split into parts is reported by the part that
+ *        makes it invalid, or by base64DecodeFinal.
+ */
+void test_OTA_base64DecodeUpdate_InvalidDataInParts( void )
+{
+    Base64DecodeContext_t context;
+    uint8_t pDecodedResultBuffer[ BASE64_DEFAULT_TEST_DECODING_BUFFER_SIZE ] = { 0 };
+    size_t resultLen = 0;
+    int result = 0;
+
+    /* Base64 digits in the part after a whitespace. */
+    result = base64DecodeInit( &context );
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    result = base64DecodeUpdate( &context,
+                                 pDecodedResultBuffer,
+                                 sizeof( pDecodedResultBuffer ),
+                                 &resultLen,
+                                 ( const uint8_t * ) "Rk9P ",
+                                 5U );
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    TEST_ASSERT_EQUAL( 3U, resultLen );
+    result = base64DecodeUpdate( &context,
+                                 pDecodedResultBuffer,
+                                 sizeof( pDecodedResultBuffer ),
+                                 &resultLen,
+                                 ( const uint8_t * ) "QkFS",
+                                 4U );
+    TEST_ASSERT_EQUAL_INT( Base64InvalidSymbolOrdering, result );
+
+    /* Too many padding symbols over two parts. */
+    result = base64DecodeInit( &context );
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    result = base64DecodeUpdate( &context,
+                                 pDecodedResultBuffer,
+                                 sizeof( pDecodedResultBuffer ),
+                                 &resultLen,
+                                 ( const uint8_t * ) "Zg=",
+                                 3U );
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    TEST_ASSERT_EQUAL( 0U, resultLen );
+    result = base64DecodeUpdate( &context,
+                                 pDecodedResultBuffer,
+                                 sizeof( pDecodedResultBuffer ),
+                                 &resultLen,
+                                 ( const uint8_t * ) "==",
+                                 2U );
+    TEST_ASSERT_EQUAL_INT( Base64InvalidPaddingSymbol, result );
+
+    /* A single symbol left over for base64DecodeFinal. */
+    result = decodeInParts( pDecodedResultBuffer,
+                            sizeof( pDecodedResultBuffer ),
+                            &resultLen,
+                            ( const uint8_t * ) "Rk9PQ",
+                            5U,
+                            2U );
+    TEST_ASSERT_EQUAL_INT( Base64InvalidInputSize, result );
+
+    /* Fewer symbols than any encoded data. */
+    result = decodeInParts( pDecodedResultBuffer,
+                            sizeof( pDecodedResultBuffer ),
+                            &resultLen,
+                            BASE64_INVALID_DATA_IMPOSSIBLY_SMALL_ENCODED,
+                            BASE64_INVALID_DATA_IMPOSSIBLY_SMALL_ENCODED_LEN,
+                            1U );
+    TEST_ASSERT_EQUAL_INT( Base64InvalidInputSize, result );
+
+    /* The buffer of base64DecodeFinal is too small for the last group. */
+    result = decodeInParts( pDecodedResultBuffer,
+                            BASE64_VALID_DATA_ONE_PADDING_DECODED_LEN - 1U,
+                            &resultLen,
+                            BASE64_VALID_DATA_ONE_PADDING_ENCODED,
+                            BASE64_VALID_DATA_ONE_PADDING_ENCODED_LEN,
+                            3U );
+    TEST_ASSERT_EQUAL_INT( Base64InvalidBufferSize, result );
+
+    /* Null inputs. */
+    result = base64DecodeInit( NULL );
+    TEST_ASSERT_EQUAL_INT( Base64NullPointerInput, result );
+
+    result = base64DecodeUpdate( NULL,
+                                 pDecodedResultBuffer,
+                                 sizeof( pDecodedResultBuffer ),
+                                 &resultLen,
+                                 BASE64_VALID_DATA_ENCODED,
+                                 BASE64_VALID_DATA_ENCODED_LEN );
+    TEST_ASSERT_EQUAL_INT( Base64NullPointerInput, result );
+
+    result = base64DecodeInit( &context );
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    result = base64DecodeUpdate( &context,
+                                 pDecodedResultBuffer,
+                                 sizeof( pDecodedResultBuffer ),
+                                 NULL,
+                                 BASE64_VALID_DATA_ENCODED,
+                                 BASE64_VALID_DATA_ENCODED_LEN );
+    TEST_ASSERT_EQUAL_INT( Base64NullPointerInput, result );
+
+    result = base64DecodeFinal( &context,
+                                NULL,
+                                sizeof( pDecodedResultBuffer ),
+                                &resultLen );
+    TEST_ASSERT_EQUAL_INT( Base64NullPointerInput, result );
+}
+
+/**
+ * @brief Test that base64Encode encodes data with zero, one and two padding symbols.
+ */
+void test_OTA_base64Encode_ValidPadding( void )
+{
+    char pEncodedResultBuffer[ BASE64_DEFAULT_TEST_DECODING_BUFFER_SIZE ] = { 0 };
+    int result = 0;
+    size_t resultLen = 0;
+
+    result = base64Encode( pEncodedResultBuffer,
+                           BASE64_DEFAULT_TEST_DECODING_BUFFER_SIZE,
+                           &resultLen,
+                           BASE64_VALID_DATA_TWO_PADDING_DECODED,
+                           BASE64_VALID_DATA_TWO_PADDING_DECODED_LEN );
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    TEST_ASSERT_EQUAL( BASE64_VALID_DATA_TWO_PADDING_ENCODED_LEN, resultLen );
+    TEST_ASSERT_EQUAL_STRING_LEN( BASE64_VALID_DATA_TWO_PADDING_ENCODED, pEncodedResultBuffer, resultLen );
+
+    result = base64Encode( pEncodedResultBuffer,
+                           BASE64_DEFAULT_TEST_DECODING_BUFFER_SIZE,
+                           &resultLen,
+                           BASE64_VALID_DATA_ONE_PADDING_DECODED,
+                           BASE64_VALID_DATA_ONE_PADDING_DECODED_LEN );
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    TEST_ASSERT_EQUAL( BASE64_VALID_DATA_ONE_PADDING_ENCODED_LEN, resultLen );
+    TEST_ASSERT_EQUAL_STRING_LEN( BASE64_VALID_DATA_ONE_PADDING_ENCODED, pEncodedResultBuffer, resultLen );
+
+    result = base64Encode( pEncodedResultBuffer,
+                           BASE64_DEFAULT_TEST_DECODING_BUFFER_SIZE,
+                           &resultLen,
+                           BASE64_VALID_DATA_ZERO_PADDING_DECODED,
+                           BASE64_VALID_DATA_ZERO_PADDING_DECODED_LEN );
+    TEST_ASSERT_EQUAL_INT( Base64Success, result );
+    TEST_ASSERT_EQUAL( BASE64_VALID_DATA_ZERO_PADDING_ENCODED_LEN, resultLen );
+    TEST_ASSERT_EQUAL_STRING_LEN( BASE64_VALID_DATA_ZERO_PADDING_ENCODED, pEncodedResultBuffer, resultLen );
+}
+
+/**
+ * @brief Test that base64Encode fails for invalid parameters.
+ */
+void test_OTA_base64Encode_InvalidParameters( void )
+{
+    char pEncodedResultBuffer[ BASE64_DEFAULT_TEST_DECODING_BUFFER_SIZE ] = { 0 };
+    int result = 0;
+    size_t resultLen = 0;
+
+    result = base64Encode( NULL,
+                           BASE64_DEFAULT_TEST_DECODING_BUFFER_SIZE,
+                           &resultLen,
+                           BASE64_VALID_DATA_DECODED,
+                           BASE64_VALID_DATA_DECODED_LEN );
+    TEST_ASSERT_EQUAL_INT( Base64NullPointerInput, result );
+
+    /* The buffer is one symbol too small. */
+    result = base64Encode( pEncodedResultBuffer,
+                           BASE64_VALID_DATA_ENCODED_LEN - 1U,
+                           &resultLen,
+                           BASE64_VALID_DATA_DECODED,
+                           BASE64_VALID_DATA_DECODED_LEN );
+    TEST_ASSERT_EQUAL_INT( Base64InvalidBufferSize, result );
+}
+
 /* ========================================================================== */
@@ -25,6 +25,7 @@
 
 /* Standard includes. */
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 
 /* CBOR and OTA includes. */
@@ -42,6 +43,7 @@
 #define CBOR_TEST_MESSAGE_BUFFER_SIZE    ( OTA_FILE_BLOCK_SIZE * 2 )
 #define CBOR_TEST_BITMAP_VALUE           0xAAAAAAAA
 #define CBOR_TEST_BLOCKIDENTITY_VALUE    0
+#define CBOR_TEST_FUZZ_ITERATIONS        5000
 
 /* ========================================================================== */
 
@@ -84,6 +86,83 @@ void test_OTA_CborEncodeStreamRequest()
     }
 }
 
+void test_OTA_CborEncodeStreamRequestTemplate()
+{
+    uint8_t cborWork[ CBOR_TEST_MESSAGE_BUFFER_SIZE ];
+    OtaCborGetStreamRequest_t request = { 0 };
+    uint32_t bitmap = CBOR_TEST_BITMAP_VALUE;
+    uint32_t otherBitmap = 0x01020304;
+    uint32_t numBlocksRequest = otaconfigMAX_NUM_BLOCKS_REQUEST;
+    bool result = false;
+
+    /* The request of test_OTA_CborEncodeStreamRequest with the integers in 5 bytes,
+     * {"c": "ThisIsAClientToken", "f": 1, "l": 4096, "o": 0, "b": b"\xaa\xaa\xaa\xaa", "n": numBlocksRequest} */
+    uint8_t expectedData[] =
+    {
+        0xa6, 0x61, 0x63, 0x72, 0x54, 0x68, 0x69, 0x73, 0x49, 0x73, 0x41, 0x43, 0x6c, 0x69, 0x65,
+        0x6e, 0x74, 0x54, 0x6f, 0x6b, 0x65, 0x6e, 0x61, 0x66, 0x1a, 0x0,  0x0,  0x0,  0x1,  0x61,
+        0x6c, 0x1a, 0x0,  0x0,  0x10, 0x0,  0x61, 0x6f, 0x1a, 0x0,  0x0,  0x0,  0x0,  0x61, 0x62,
+        0x44, 0xaa, 0xaa, 0xaa, 0xaa, 0x61, 0x6e, 0x1a, 0x0,  0x0,  0x0,  numBlocksRequest
+    };
+
+    result = OTA_CBOR_Encode_GetStreamRequestTemplate(
+        cborWork,
+        sizeof( cborWork ),
+        &request,
+        CBOR_TEST_CLIENTTOKEN_VALUE,
+        1,
+        OTA_FILE_BLOCK_SIZE,
+        sizeof( bitmap ) );
+    TEST_ASSERT_TRUE( result );
+    TEST_ASSERT_EQUAL( sizeof( expectedData ), request.messageSize );
+
+    result = OTA_CBOR_Patch_GetStreamRequestMessage(
+        cborWork,
+        &request,
+        0,
+        ( uint8_t * ) &bitmap,
+        sizeof( bitmap ),
+        otaconfigMAX_NUM_BLOCKS_REQUEST );
+    TEST_ASSERT_TRUE( result );
+    TEST_ASSERT_EQUAL_MEMORY( expectedData, cborWork, sizeof( expectedData ) );
+
+    /* Only the bitmap, offset and number of blocks are written by the next requests. */
+    result = OTA_CBOR_Patch_GetStreamRequestMessage(
+        cborWork,
+        &request,
+        -2,
+        ( uint8_t * ) &otherBitmap,
+        sizeof( otherBitmap ),
+        0x12345678 );
+    TEST_ASSERT_TRUE( result );
+    TEST_ASSERT_EQUAL_MEMORY( expectedData, cborWork, request.blockOffsetIndex );
+    TEST_ASSERT_EQUAL_MEMORY( "\x3a\x00\x00\x00\x01", &cborWork[ request.blockOffsetIndex ], 5 );
+    TEST_ASSERT_EQUAL_MEMORY( &otherBitmap, &cborWork[ request.blockBitmapIndex ], sizeof( otherBitmap ) );
+    TEST_ASSERT_EQUAL_MEMORY( "\x1a\x12\x34\x56\x78", &cborWork[ request.numOfBlocksIndex ], 5 );
+
+    /* A bitmap of another size needs a new template. */
+    result = OTA_CBOR_Patch_GetStreamRequestMessage(
+        cborWork,
+        &request,
+        0,
+        ( uint8_t * ) &bitmap,
+        sizeof( bitmap ) - 1,
+        otaconfigMAX_NUM_BLOCKS_REQUEST );
+    TEST_ASSERT_FALSE( result );
+
+    /* The template must fit in the buffer. */
+    result = OTA_CBOR_Encode_GetStreamRequestTemplate(
+        cborWork,
+        sizeof( expectedData ) - 1,
+        &request,
+        CBOR_TEST_CLIENTTOKEN_VALUE,
+        1,
+        OTA_FILE_BLOCK_SIZE,
+        sizeof( bitmap ) );
+    TEST_ASSERT_FALSE( result );
+    TEST_ASSERT_EQUAL( 0, request.messageSize );
+}
+
 void test_OTA_CborDecodeStreamResponse()
 {
     uint8_t blockPayload[ OTA_FILE_BLOCK_SIZE ] = { 0 };
@@ -135,3 +214,392 @@ void test_OTA_CborDecodeStreamResponse()
         }
     }
 }
+
+void test_OTA_CborDecodeMultiBlockStreamResponse()
+{
+    uint8_t blockPayload[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t cborWork[ CBOR_TEST_MESSAGE_BUFFER_SIZE * 2 ] = { 0 };
+    int blockIndices[] = { 4, 5, 6 };
+    size_t blockSizes[] = { OTA_FILE_BLOCK_SIZE, OTA_FILE_BLOCK_SIZE, 100 };
+    size_t encodedSize = 0;
+    int fileId = -1;
+    int blockIndex = -1;
+    int blockSize = -1;
+    uint8_t decodedPayload[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t * pDecodedPayload = decodedPayload;
+    size_t payloadSize = 0;
+    size_t numBlocks = 0;
+    size_t blockNumber = 0;
+    bool result = false;
+    int i = 0;
+
+    for( i = 0; i < sizeof( blockPayload ); i++ )
+    {
+        blockPayload[ i ] = i % UINT8_MAX;
+    }
+
+    result = createOtaMultiBlockStreamingMessage(
+        cborWork,
+        sizeof( cborWork ),
+        blockIndices,
+        blockSizes,
+        3,
+        blockPayload,
+        &encodedSize );
+    TEST_ASSERT_EQUAL( CborNoError, result );
+
+    /* Every block of the message is decoded on its own into the same buffer. */
+    for( blockNumber = 0; blockNumber < 3; blockNumber++ )
+    {
+        memset( decodedPayload, 0, sizeof( decodedPayload ) );
+        payloadSize = sizeof( decodedPayload );
+
+        result = OTA_CBOR_Decode_GetStreamResponseMessageBlock(
+            cborWork,
+            encodedSize,
+            blockNumber,
+            &fileId,
+            &blockIndex,
+            &blockSize,
+            &pDecodedPayload,
+            &payloadSize,
+            &numBlocks );
+        TEST_ASSERT_TRUE( result );
+        TEST_ASSERT_EQUAL( 3, numBlocks );
+        TEST_ASSERT_EQUAL( CBOR_TEST_FILEIDENTITY_VALUE, fileId );
+        TEST_ASSERT_EQUAL( blockIndices[ blockNumber ], blockIndex );
+        TEST_ASSERT_EQUAL( blockSizes[ blockNumber ], blockSize );
+        TEST_ASSERT_EQUAL( blockSizes[ blockNumber ], payloadSize );
+
+        for( i = 0; i < payloadSize; i++ )
+        {
+            TEST_ASSERT_EQUAL( blockPayload[ i ], decodedPayload[ i ] );
+        }
+    }
+
+    /* There is no block after the last one. */
+    payloadSize = sizeof( decodedPayload );
+    result = OTA_CBOR_Decode_GetStreamResponseMessageBlock(
+        cborWork,
+        encodedSize,
+        3,
+        &fileId,
+        &blockIndex,
+        &blockSize,
+        &pDecodedPayload,
+        &payloadSize,
+        &numBlocks );
+    TEST_ASSERT_FALSE( result );
+}
+
+void test_OTA_CborDecodeStreamResponseAsMultiBlock()
+{
+    uint8_t blockPayload[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t cborWork[ CBOR_TEST_MESSAGE_BUFFER_SIZE ] = { 0 };
+    size_t encodedSize = 0;
+    int fileId = -1;
+    int blockIndex = -1;
+    int blockSize = -1;
+    uint8_t decodedPayload[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t * pDecodedPayload = decodedPayload;
+    size_t payloadSize = sizeof( decodedPayload );
+    size_t numBlocks = 0;
+    bool result = false;
+
+    result = createOtaStreammingMessage(
+        cborWork,
+        sizeof( cborWork ),
+        2,
+        blockPayload,
+        sizeof( blockPayload ),
+        &encodedSize );
+    TEST_ASSERT_EQUAL( CborNoError, result );
+
+    /* A response in the format of the service is a message of one block. */
+    result = OTA_CBOR_Decode_GetStreamResponseMessageBlock(
+        cborWork,
+        encodedSize,
+        0,
+        &fileId,
+        &blockIndex,
+        &blockSize,
+        &pDecodedPayload,
+        &payloadSize,
+        &numBlocks );
+    TEST_ASSERT_TRUE( result );
+    TEST_ASSERT_EQUAL( 1, numBlocks );
+    TEST_ASSERT_EQUAL( 2, blockIndex );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE, payloadSize );
+
+    payloadSize = sizeof( decodedPayload );
+    result = OTA_CBOR_Decode_GetStreamResponseMessageBlock(
+        cborWork,
+        encodedSize,
+        1,
+        &fileId,
+        &blockIndex,
+        &blockSize,
+        &pDecodedPayload,
+        &payloadSize,
+        &numBlocks );
+    TEST_ASSERT_FALSE( result );
+}
+
+void test_OTA_CborDecodeStreamResponseView()
+{
+    uint8_t blockPayload[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t cborWork[ CBOR_TEST_MESSAGE_BUFFER_SIZE ] = { 0 };
+    const int blockIndices[] = { 1, 2 };
+    const size_t blockSizes[] = { OTA_FILE_BLOCK_SIZE, OTA_FILE_BLOCK_SIZE / 2 };
+    size_t encodedSize = 0;
+    int fileId = -1;
+    int blockIndex = -1;
+    int blockSize = -1;
+    const uint8_t * pPayload = NULL;
+    size_t payloadSize = 0;
+    bool result = false;
+    int i = 0;
+
+    for( i = 0; i < sizeof( blockPayload ); i++ )
+    {
+        blockPayload[ i ] = i % UINT8_MAX;
+    }
+
+    result = createOtaStreammingMessage(
+        cborWork,
+        sizeof( cborWork ),
+        CBOR_TEST_BLOCKIDENTITY_VALUE,
+        blockPayload,
+        sizeof( blockPayload ),
+        &encodedSize );
+    TEST_ASSERT_EQUAL( CborNoError, result );
+
+    /* The payload is a view into the message. */
+    result = OTA_CBOR_Decode_GetStreamResponseMessageView(
+        cborWork,
+        encodedSize,
+        &fileId,
+        &blockIndex,
+        &blockSize,
+        &pPayload,
+        &payloadSize );
+    TEST_ASSERT_TRUE( result );
+    TEST_ASSERT_EQUAL( CBOR_TEST_FILEIDENTITY_VALUE, fileId );
+    TEST_ASSERT_EQUAL( CBOR_TEST_BLOCKIDENTITY_VALUE, blockIndex );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE, blockSize );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE, payloadSize );
+    TEST_ASSERT_TRUE( ( pPayload > cborWork ) && ( pPayload + payloadSize <= cborWork + encodedSize ) );
+    TEST_ASSERT_EQUAL_MEMORY( blockPayload, pPayload, payloadSize );
+
+    /* A message cut before its payload is rejected. */
+    result = OTA_CBOR_Decode_GetStreamResponseMessageView(
+        cborWork,
+        encodedSize - OTA_FILE_BLOCK_SIZE - 1,
+        &fileId,
+        &blockIndex,
+        &blockSize,
+        &pPayload,
+        &payloadSize );
+    TEST_ASSERT_FALSE( result );
+
+    /* A response with several blocks is left to the decoder that copies the blocks. */
+    result = createOtaMultiBlockStreamingMessage(
+        cborWork,
+        sizeof( cborWork ),
+        blockIndices,
+        blockSizes,
+        2,
+        blockPayload,
+        &encodedSize );
+    TEST_ASSERT_EQUAL( CborNoError, result );
+
+    result = OTA_CBOR_Decode_GetStreamResponseMessageView(
+        cborWork,
+        encodedSize,
+        &fileId,
+        &blockIndex,
+        &blockSize,
+        &pPayload,
+        &payloadSize );
+    TEST_ASSERT_FALSE( result );
+}
+
+void test_OTA_CborDecodeStreamResponseFast()
+{
+    uint8_t blockPayload[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t cborWork[ CBOR_TEST_MESSAGE_BUFFER_SIZE ] = { 0 };
+    size_t encodedSize = 0;
+    int fileId = -1;
+    int blockIndex = -1;
+    int blockSize = -1;
+    const uint8_t * pPayload = NULL;
+    size_t payloadSize = 0;
+    bool result = false;
+    int i = 0;
+
+    /* {"i": 2, "f": 0, "l": 1, "p": b"\x05"} has the keys in another order. */
+    uint8_t reorderedData[] =
+    {
+        0xa4, 0x61, 0x69, 0x02, 0x61, 0x66, 0x00, 0x61, 0x6c, 0x01, 0x61, 0x70, 0x41, 0x05
+    };
+
+    for( i = 0; i < sizeof( blockPayload ); i++ )
+    {
+        blockPayload[ i ] = i % UINT8_MAX;
+    }
+
+    result = createOtaStreammingMessageForFile(
+        cborWork,
+        sizeof( cborWork ),
+        -2,
+        70000,
+        blockPayload,
+        sizeof( blockPayload ),
+        &encodedSize );
+    TEST_ASSERT_EQUAL( CborNoError, result );
+
+    result = OTA_CBOR_Decode_GetStreamResponseMessageFast(
+        cborWork,
+        encodedSize,
+        &fileId,
+        &blockIndex,
+        &blockSize,
+        &pPayload,
+        &payloadSize );
+    TEST_ASSERT_TRUE( result );
+    TEST_ASSERT_EQUAL( -2, fileId );
+    TEST_ASSERT_EQUAL( 70000, blockIndex );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE, blockSize );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE, payloadSize );
+    TEST_ASSERT_EQUAL_PTR( cborWork + encodedSize - payloadSize, pPayload );
+    TEST_ASSERT_EQUAL_MEMORY( blockPayload, pPayload, payloadSize );
+
+    /* Any other layout is left to tinycbor. */
+    result = OTA_CBOR_Decode_GetStreamResponseMessageFast(
+        reorderedData,
+        sizeof( reorderedData ),
+        &fileId,
+        &blockIndex,
+        &blockSize,
+        &pPayload,
+        &payloadSize );
+    TEST_ASSERT_FALSE( result );
+
+    result = OTA_CBOR_Decode_GetStreamResponseMessageView(
+        reorderedData,
+        sizeof( reorderedData ),
+        &fileId,
+        &blockIndex,
+        &blockSize,
+        &pPayload,
+        &payloadSize );
+    TEST_ASSERT_TRUE( result );
+    TEST_ASSERT_EQUAL( 2, blockIndex );
+}
+
+void test_OTA_CborDecodeStreamResponseFastMatchesTinycbor()
+{
+    uint8_t blockPayload[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t cborWork[ CBOR_TEST_MESSAGE_BUFFER_SIZE ] = { 0 };
+    size_t encodedSize = 0;
+    size_t messageSize = 0;
+    int32_t fastFileId = 0, fileId = 0;
+    int32_t fastBlockIndex = 0, blockIndex = 0;
+    int32_t fastBlockSize = 0, blockSize = 0;
+    const uint8_t * pFastPayload = NULL;
+    const uint8_t * pPayload = NULL;
+    size_t fastPayloadSize = 0, payloadSize = 0;
+    bool fastResult = false;
+    bool result = false;
+    uint32_t seed = 1U;
+    uint32_t numMutations = 0;
+    int i = 0;
+    int j = 0;
+
+    for( i = 0; i < sizeof( blockPayload ); i++ )
+    {
+        blockPayload[ i ] = i % UINT8_MAX;
+    }
+
+    /* Decode random messages with random mutations with both decoders. */
+    for( i = 0; i < CBOR_TEST_FUZZ_ITERATIONS; i++ )
+    {
+        seed = ( seed * 1103515245U ) + 12345U;
+        result = createOtaStreammingMessageForFile(
+            cborWork,
+            sizeof( cborWork ),
+            ( int ) ( seed >> ( seed % 32U ) ),
+            ( int ) ( ( seed >> 8 ) % 100000U ),
+            blockPayload,
+            ( seed >> 4 ) % ( OTA_FILE_BLOCK_SIZE + 1U ),
+            &encodedSize );
+        TEST_ASSERT_EQUAL( CborNoError, result );
+
+        messageSize = encodedSize;
+        numMutations = ( seed >> 20 ) % 4U;
+
+        for( j = 0; j < numMutations; j++ )
+        {
+            seed = ( seed * 1103515245U ) + 12345U;
+
+            switch( ( seed >> 16 ) % 3U )
+            {
+                case 0:
+                    /* Change a byte, mostly of the heads and keys. */
+                    cborWork[ ( seed >> 4 ) % ( ( ( seed & 1U ) != 0U ) ? 24U : messageSize ) ] = ( uint8_t ) ( seed >> 24 );
+                    break;
+
+                case 1:
+                    /* Truncate the message. */
+                    messageSize = ( seed >> 4 ) % messageSize;
+                    break;
+
+                default:
+                    /* Append a byte. */
+                    cborWork[ messageSize ] = ( uint8_t ) ( seed >> 24 );
+                    messageSize++;
+                    break;
+            }
+
+            if( messageSize == 0 )
+            {
+                messageSize = 1;
+            }
+        }
+
+        fastResult = OTA_CBOR_Decode_GetStreamResponseMessageFast(
+            cborWork,
+            messageSize,
+            &fastFileId,
+            &fastBlockIndex,
+            &fastBlockSize,
+            &pFastPayload,
+            &fastPayloadSize );
+
+        result = OTA_CBOR_Decode_GetStreamResponseMessageView(
+            cborWork,
+            messageSize,
+            &fileId,
+            &blockIndex,
+            &blockSize,
+            &pPayload,
+            &payloadSize );
+
+        /* Every message the fast path accepts is decoded the same by tinycbor. */
+        if( fastResult == true )
+        {
+            TEST_ASSERT_TRUE( result );
+            TEST_ASSERT_EQUAL( fileId, fastFileId );
+            TEST_ASSERT_EQUAL( blockIndex, fastBlockIndex );
+            TEST_ASSERT_EQUAL( blockSize, fastBlockSize );
+            TEST_ASSERT_EQUAL_PTR( pPayload, pFastPayload );
+            TEST_ASSERT_EQUAL( payloadSize, fastPayloadSize );
+        }
+
+        /* Messages from the encoder are all in the layout of the service. */
+        if( numMutations == 0 )
+        {
+            TEST_ASSERT_TRUE( fastResult );
+        }
+    }
+}
@@ -32,10 +32,7 @@
 #define OTA_CONFIG_H_
 
 /* Enable both MQTT and HTTP in unit tests. */
-#define configENABLED_DATA_PROTOCOLS            ( OTA_DATA_OVER_MQTT | OTA_DATA_OVER_HTTP )
-
-/* Call status update for every block that we received so that we can hit some internal routines. */
-#define otaconfigOTA_UPDATE_STATUS_FREQUENCY    1
+#define configENABLED_DATA_PROTOCOLS            ( OTA_DATA_OVER_MQTT | OTA_DATA_OVER_HTTP | OTA_DATA_OVER_COAP )
 
 /* Lower request momentum so that retry fails faster. */
 #define otaconfigMAX_NUM_REQUEST_MOMENTUM       3
@@ -43,6 +40,37 @@
 /* Make number of blocks per mqtt request larger so we can hit some branch. */
 #define otaconfigMAX_NUM_BLOCKS_REQUEST         4
 
+/* Accept stream responses of two blocks so that the test file takes more than one response. */
+#define otaconfigMQTT_MAX_BLOCKS_PER_RESPONSE   2
+
+/* Request two blocks per HTTP range so that the test file takes more than one range. */
+#define otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST    2
+
+/* Keep two HTTP range requests in flight when the HTTP interface supports it. */
+#define otaconfigHTTP_MAX_PARALLEL_REQUESTS     2
+
+/* Allow file chunks a bit larger than the test chunks so that one chunk can complete a range. */
+#define otaconfigFILE_CHUNK_SIZE                1536U
+
+/* Use MQTT 5 topic aliases when the MQTT interface supports them. */
+#define otaconfigMQTT_TOPIC_ALIAS_GET_STREAM    1U
+#define otaconfigMQTT_TOPIC_ALIAS_JOB_STATUS    2U
+
+/* The features that are off by default are only enabled in ota_features_utest, so that
+ * ota_utest covers the default configuration. */
+#ifdef OTA_UTEST_OPTIONAL_FEATURES
+    /* Ingest blocks requested by other devices on a shared MQTT stream. */
+    #define otaconfigENABLE_PASSIVE_STREAM_LISTEN      1U
+
+    /* Download over MQTT and HTTP when the job offers both. */
+    #define otaconfigENABLE_HYBRID_DATA_TRANSFER       1U
+
+    /* Measure the other data protocols with one request each, so that the test file covers
+     * a protocol switch. */
+    #define otaconfigENABLE_DATA_PROTOCOL_PROBE        1U
+    #define otaconfigDATA_PROTOCOL_PROBE_NUM_BLOCKS    1
+#endif
+
 #define LOG_LEVEL_ERROR                         0
 #define LOG_LEVEL_WARN                          1
 #define LOG_LEVEL_INFO                          2
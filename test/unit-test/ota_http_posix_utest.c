@@ -0,0 +1,336 @@
+/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file ota_http_posix_utest.c
+ * @brief Unit tests for functions in ota_http_posix.c
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "unity.h"
+
+#include "ota_http_posix.h"
+#include "ota_http_range_server.h"
+
+/* Testing constants. */
+#define TEST_FILE_SIZE          10240U
+#define TEST_RANGE_SIZE         4096U
+#define TEST_NUM_RANGES         3U
+#define TEST_URL_SIZE           64U
+#define TEST_PROCESS_TIMEOUT    10U   /*!< Timeout in milliseconds. */
+#define TEST_MAX_PROCESS_LOOPS  500U
+
+/* Data passed to the body callback. */
+static uint8_t pReceivedFile[ TEST_FILE_SIZE ];
+static uint32_t bytesReceived = 0;
+static char pServerUrl[ TEST_URL_SIZE ];
+
+static void bodyCallback( uint32_t fileOffset,
+                          const uint8_t * pData,
+                          uint32_t dataLength )
+{
+    TEST_ASSERT_LESS_OR_EQUAL( TEST_FILE_SIZE, fileOffset + dataLength );
+
+    ( void ) memcpy( &pReceivedFile[ fileOffset ], pData, dataLength );
+    bytesReceived += dataLength;
+}
+
+#if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+
+/* Data passed to the written callback. */
+    static uint32_t bytesWritten = 0;
+
+    static void writtenCallback( uint32_t fileOffset,
+                                 uint32_t dataLength )
+    {
+        TEST_ASSERT_LESS_OR_EQUAL( TEST_FILE_SIZE, fileOffset + dataLength );
+
+        bytesWritten += dataLength;
+    }
+#endif
+
+static void startServer( uint32_t resetAfterRequests,
+                         uint32_t expireAfterRequests )
+{
+    RangeServerConfig_t config = { 0, TEST_FILE_SIZE, 0U, 0U, 0U, 0U };
+    uint16_t port = 0;
+
+    config.resetAfterRequests = resetAfterRequests;
+    config.expireAfterRequests = expireAfterRequests;
+    TEST_ASSERT_TRUE( RangeServer_Start( &config, &port ) );
+
+    ( void ) snprintf( pServerUrl, sizeof( pServerUrl ), "http://127.0.0.1:%u/ota.bin", ( unsigned int ) port );
+}
+
+static void processUntilNoPendingRequests( void )
+{
+    uint32_t loops = 0;
+
+    while( ( Posix_OtaHttpPendingRequests() > 0U ) && ( loops < TEST_MAX_PROCESS_LOOPS ) )
+    {
+        TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpProcess( TEST_PROCESS_TIMEOUT ) );
+        loops++;
+    }
+
+    TEST_ASSERT_EQUAL( 0, Posix_OtaHttpPendingRequests() );
+}
+
+static void checkReceivedRange( uint32_t rangeStart,
+                                uint32_t rangeEnd )
+{
+    uint32_t offset = 0;
+
+    for( offset = rangeStart; offset <= rangeEnd; offset++ )
+    {
+        TEST_ASSERT_EQUAL( RANGE_SERVER_FILE_BYTE( offset ), pReceivedFile[ offset ] );
+    }
+}
+
+/* ============================   UNITY FIXTURES ============================ */
+
+void setUp( void )
+{
+    ( void ) memset( pReceivedFile, 0, sizeof( pReceivedFile ) );
+    bytesReceived = 0;
+
+    Posix_OtaHttpSetBodyCallback( bodyCallback );
+}
+
+void tearDown( void )
+{
+    #if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+        ( void ) Posix_OtaHttpSetFileSink( -1, NULL );
+        bytesWritten = 0;
+    #endif
+
+    ( void ) Posix_OtaHttpDeinit();
+    RangeServer_Stop();
+}
+
+/* ========================================================================== */
+
+/**
+ * @brief Test that only valid plain http urls are accepted.
+ */
+void test_OTA_HttpPosix_InitInvalidUrl( void )
+{
+    char pHttpsUrl[] = "https://127.0.0.1/ota.bin";
+    char pNoHostUrl[] = "http:///ota.bin";
+    char pInvalidPortUrl[] = "http://127.0.0.1:1234567/ota.bin";
+
+    TEST_ASSERT_EQUAL( OtaHttpInitFailed, Posix_OtaHttpInit( NULL ) );
+    TEST_ASSERT_EQUAL( OtaHttpInitFailed, Posix_OtaHttpInit( pHttpsUrl ) );
+    TEST_ASSERT_EQUAL( OtaHttpInitFailed, Posix_OtaHttpInit( pNoHostUrl ) );
+    TEST_ASSERT_EQUAL( OtaHttpInitFailed, Posix_OtaHttpInit( pInvalidPortUrl ) );
+}
+
+/**
+ * @brief Test that pipelined range requests are answered in order on one connection.
+ */
+void test_OTA_HttpPosix_PipelinedRequests( void )
+{
+    OtaHttpPosixStats_t stats;
+    RangeServerStats_t serverStats;
+    uint32_t range = 0;
+
+    startServer( 0, 0 );
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpInit( pServerUrl ) );
+
+    for( range = 0; range < TEST_NUM_RANGES; range++ )
+    {
+        TEST_ASSERT_EQUAL( OtaHttpSuccess,
+                           Posix_OtaHttpRequest( range * TEST_RANGE_SIZE,
+                                                 ( range == ( TEST_NUM_RANGES - 1U ) ) ? ( TEST_FILE_SIZE - 1U ) : ( ( range + 1U ) * TEST_RANGE_SIZE - 1U ) ) );
+    }
+
+    TEST_ASSERT_EQUAL( TEST_NUM_RANGES, Posix_OtaHttpPendingRequests() );
+
+    processUntilNoPendingRequests();
+
+    TEST_ASSERT_EQUAL( TEST_FILE_SIZE, bytesReceived );
+    checkReceivedRange( 0, TEST_FILE_SIZE - 1U );
+
+    Posix_OtaHttpGetStats( &stats );
+    TEST_ASSERT_EQUAL( 1, stats.connections );
+    TEST_ASSERT_EQUAL( TEST_NUM_RANGES, stats.requests );
+    TEST_ASSERT_EQUAL( TEST_NUM_RANGES, stats.responses );
+    TEST_ASSERT_EQUAL( 0, stats.resets );
+
+    RangeServer_GetStats( &serverStats );
+    TEST_ASSERT_EQUAL( 1, serverStats.connections );
+}
+
+/**
+ * @brief Test that requests are rejected when the pipeline is full.
+ */
+void test_OTA_HttpPosix_PipelineFull( void )
+{
+    uint32_t request = 0;
+
+    startServer( 0, 0 );
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpInit( pServerUrl ) );
+
+    for( request = 0; request < OTA_HTTP_POSIX_MAX_PIPELINED_REQUESTS; request++ )
+    {
+        TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpRequest( 0, 0 ) );
+    }
+
+    TEST_ASSERT_EQUAL( OtaHttpRequestFailed, Posix_OtaHttpRequest( 0, 0 ) );
+
+    processUntilNoPendingRequests();
+    TEST_ASSERT_EQUAL( OTA_HTTP_POSIX_MAX_PIPELINED_REQUESTS, bytesReceived );
+}
+
+/**
+ * @brief Test that a connection reset drops the pending requests and the next request reconnects.
+ */
+void test_OTA_HttpPosix_ResetDropsPendingRequests( void )
+{
+    OtaHttpPosixStats_t stats;
+
+    /* The second response is reset halfway through its body. */
+    startServer( 2, 0 );
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpInit( pServerUrl ) );
+
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpRequest( 0, TEST_RANGE_SIZE - 1U ) );
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpRequest( TEST_RANGE_SIZE, TEST_FILE_SIZE - 1U ) );
+
+    processUntilNoPendingRequests();
+
+    Posix_OtaHttpGetStats( &stats );
+    TEST_ASSERT_EQUAL( 1, stats.resets );
+    TEST_ASSERT_EQUAL( 1, stats.responses );
+    TEST_ASSERT_LESS_THAN( TEST_FILE_SIZE, bytesReceived );
+    checkReceivedRange( 0, TEST_RANGE_SIZE - 1U );
+
+    /* Request the lost range again. */
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpRequest( TEST_RANGE_SIZE, TEST_FILE_SIZE - 1U ) );
+    processUntilNoPendingRequests();
+
+    checkReceivedRange( 0, TEST_FILE_SIZE - 1U );
+
+    Posix_OtaHttpGetStats( &stats );
+    TEST_ASSERT_EQUAL( 2, stats.connections );
+    TEST_ASSERT_EQUAL( 2, stats.responses );
+}
+
+/**
+ * @brief Test that the body of a failed range request is not passed to the callback.
+ */
+void test_OTA_HttpPosix_RangeNotSatisfiable( void )
+{
+    OtaHttpPosixStats_t stats;
+
+    startServer( 0, 0 );
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpInit( pServerUrl ) );
+
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpRequest( TEST_FILE_SIZE, TEST_FILE_SIZE + TEST_RANGE_SIZE ) );
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpRequest( 0, TEST_RANGE_SIZE - 1U ) );
+    processUntilNoPendingRequests();
+
+    /* The connection stays open and the next response is received. */
+    TEST_ASSERT_EQUAL( TEST_RANGE_SIZE, bytesReceived );
+    checkReceivedRange( 0, TEST_RANGE_SIZE - 1U );
+
+    Posix_OtaHttpGetStats( &stats );
+    TEST_ASSERT_EQUAL( 1, stats.connections );
+    TEST_ASSERT_EQUAL( 2, stats.responses );
+}
+
+/**
+ * @brief Test that a rejected url fails the next requests until the client is initialized again.
+ */
+void test_OTA_HttpPosix_UrlExpired( void )
+{
+    OtaHttpPosixStats_t stats;
+    char pFreshUrl[ TEST_URL_SIZE + 8U ];
+
+    startServer( 0, 1 );
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpInit( pServerUrl ) );
+
+    /* The second request for the url is forbidden, its body is not passed to the callback. */
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpRequest( 0, TEST_RANGE_SIZE - 1U ) );
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpRequest( TEST_RANGE_SIZE, TEST_FILE_SIZE - 1U ) );
+    processUntilNoPendingRequests();
+
+    TEST_ASSERT_EQUAL( TEST_RANGE_SIZE, bytesReceived );
+    TEST_ASSERT_EQUAL( OtaHttpUrlExpired, Posix_OtaHttpRequest( TEST_RANGE_SIZE, TEST_FILE_SIZE - 1U ) );
+
+    /* Continue with a fresh url. */
+    ( void ) snprintf( pFreshUrl, sizeof( pFreshUrl ), "%s?fresh", pServerUrl );
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpInit( pFreshUrl ) );
+    TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpRequest( TEST_RANGE_SIZE, TEST_FILE_SIZE - 1U ) );
+    processUntilNoPendingRequests();
+
+    checkReceivedRange( 0, TEST_FILE_SIZE - 1U );
+
+    Posix_OtaHttpGetStats( &stats );
+    TEST_ASSERT_EQUAL( 1, stats.responses );
+}
+
+#if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 )
+
+/**
+ * @brief Test that the body of pipelined responses is written to the file sink at its offset.
+ */
+    void test_OTA_HttpPosix_FileSink( void )
+    {
+        OtaHttpPosixStats_t stats;
+        FILE * pFile = tmpfile();
+        uint32_t range = 0;
+
+        TEST_ASSERT_NOT_NULL( pFile );
+        TEST_ASSERT_TRUE( Posix_OtaHttpSetFileSink( fileno( pFile ), writtenCallback ) );
+
+        startServer( 0, 0 );
+        TEST_ASSERT_EQUAL( OtaHttpSuccess, Posix_OtaHttpInit( pServerUrl ) );
+
+        /* Request the ranges out of order, so that the body is not written at the end of the file. */
+        for( range = TEST_NUM_RANGES; range > 0U; range-- )
+        {
+            TEST_ASSERT_EQUAL( OtaHttpSuccess,
+                               Posix_OtaHttpRequest( ( range - 1U ) * TEST_RANGE_SIZE,
+                                                     ( range == TEST_NUM_RANGES ) ? ( TEST_FILE_SIZE - 1U ) : ( range * TEST_RANGE_SIZE - 1U ) ) );
+        }
+
+        processUntilNoPendingRequests();
+
+        /* The body is only written to the file. */
+        TEST_ASSERT_EQUAL( 0, bytesReceived );
+        TEST_ASSERT_EQUAL( TEST_FILE_SIZE, bytesWritten );
+        TEST_ASSERT_EQUAL( TEST_FILE_SIZE, pread( fileno( pFile ), pReceivedFile, TEST_FILE_SIZE, 0 ) );
+        checkReceivedRange( 0, TEST_FILE_SIZE - 1U );
+
+        Posix_OtaHttpGetStats( &stats );
+        TEST_ASSERT_EQUAL( 1, stats.connections );
+        TEST_ASSERT_EQUAL( TEST_NUM_RANGES, stats.responses );
+        TEST_ASSERT_EQUAL( TEST_FILE_SIZE, stats.bytesReceived );
+
+        ( void ) fclose( pFile );
+    }
+
+#endif /* if ( OTA_HTTP_POSIX_ENABLE_FILE_SINK == 1 ) */
@@ -37,6 +37,7 @@
 #include "ota_private.h"
 #include "ota.c"
 #include "core_json.h"
+#include "utest_helpers.h"
 
 /* Testing Constants. */
 
@@ -59,6 +60,23 @@
 #define JOB_PARSING_INVALID_JSON_INVALID_BASE64KEY           "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob20\",\"status\":\"QUEUED\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"MQTT\"],\"streamname\":\"AFR_OTA-XYZ\",\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":180568,\"fileid\":0,\"certfile\":\"test.crt\",\"sig-sha256-ecdsa\":\"Rk9PQkFS===\"}] }}}}"
 #define JOB_PARSING_INVALID_JSON_INVALID_BASE64KEY_LENGTH    ( strlen( JOB_PARSING_INVALID_JSON_INVALID_BASE64KEY ) )
 
+/* Job document with the keys in another order, whitespace, brackets and quotes in strings and
+ * model keys in objects that are not on the key paths of the model. */
+#define JOB_PARSING_REORDERED_JSON                           "{ \"execution\" : {\"status\":{\"jobId\":\"nested\"},\"jobDocument\":{\"afr_ota\":{\"files\":[ {\"fileid\":2,\"filepath\":\"/test/\\\"demo}]\",\"filesize\":1024} ],\"streamname\":\"AFR_OTA-XYZ\",\"protocols\":[\"MQTT\"]}},\n\"jobId\":\"AFR_OTA-testjob21\"},\"statusDetails\":{\"fileid\":3},\"clientToken\":\"0:testclient\"}"
+#define JOB_PARSING_REORDERED_JSON_LENGTH                    ( strlen( JOB_PARSING_REORDERED_JSON ) )
+
+/* Job document with duplicate keys, a file parameter outside of the file group and two files. */
+#define JOB_PARSING_DUPLICATE_KEYS_JSON                      "{\"execution\":{\"jobId\":\"AFR_OTA-first\",\"jobId\":\"AFR_OTA-second\",\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"MQTT\"],\"files\":[{\"filesize\":100,\"fileid\":1},{\"filesize\":200,\"fileid\":2,\"attr\":7}]}}},\"execution\":{\"statusDetails\":{\"updatedBy\":5}},\"fileid\":9}"
+#define JOB_PARSING_DUPLICATE_KEYS_JSON_LENGTH               ( strlen( JOB_PARSING_DUPLICATE_KEYS_JSON ) )
+
+/* The valid job document sent again, after the job execution was updated. */
+#define JOB_PARSING_UPDATED_EXECUTION_JSON                   "{\"timestamp\":1602795200,\"execution\":{\"jobId\":\"AFR_OTA-testjob20\",\"status\":\"IN_PROGRESS\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795190,\"versionNumber\":2,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"MQTT\"],\"streamname\":\"AFR_OTA-XYZ\",\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":180568,\"fileid\":0,\"certfile\":\"test.crt\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
+#define JOB_PARSING_UPDATED_EXECUTION_JSON_LENGTH            ( strlen( JOB_PARSING_UPDATED_EXECUTION_JSON ) )
+
+/* The valid job document with a pre-signed url. */
+#define JOB_PARSING_FRESH_URL_JSON                           "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795300,\"execution\":{\"jobId\":\"AFR_OTA-testjob20\",\"status\":\"IN_PROGRESS\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795290,\"versionNumber\":3,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"MQTT\"],\"streamname\":\"AFR_OTA-XYZ\",\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":180568,\"fileid\":0,\"certfile\":\"test.crt\",\"update_data_url\":\"https://dummy-url.com/ota.bin?X-Amz-Signature=fresh\",\"auth_scheme\":\"aws.s3.presigned\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
+#define JOB_PARSING_FRESH_URL_JSON_LENGTH                    ( strlen( JOB_PARSING_FRESH_URL_JSON ) )
+
 /* Firmware version. */
 const AppVersion32_t appFirmwareVersion =
 {
@@ -77,6 +95,10 @@ static OtaInterfaces_t otaInterfaces;
 static OtaAppBuffer_t otaAppBuffer;
 static uint8_t pUserBuffer[ 300 ];
 
+/* Number of calls of the custom job callbacks. */
+static uint32_t customJobDocCallbackCount = 0;
+static uint32_t customJobCallbackCount = 0;
+
 /* ============================   UNITY FIXTURES ============================ */
 
 void setUp( void )
@@ -110,6 +132,26 @@ void tearDown( void )
 
 /* ========================================================================== */
 
+/**
+ * @brief Tokenize a job document and store the values of the model parameters, like
+ *        parseJobDoc does before it validates the job.
+ */
+static DocParseErr_t parseJobDocModel( const char * pJson,
+                                       uint32_t messageLength,
+                                       JsonDocModel_t * pDocModel )
+{
+    DocParseErr_t err = tokenizeJobDoc( pJson, messageLength, pDocModel );
+
+    if( err == DocParseErrNone )
+    {
+        err = extractJSONbyModel( pDocModel );
+    }
+
+    return err;
+}
+
+/* ========================================================================== */
+
 /**
  * @brief Test that parseJobDoc is able to generate a FileContext by processing a valid JSON document.
  */
@@ -123,7 +165,7 @@ void test_OTA_JobParsing_Valid_Parse_Job_Doc( void )
 }
 
 /**
- * @brief Test that parseJSONbyModel is able to process a valid JSON document correctly.
+ * @brief Test that parseJobDocModel is able to process a valid JSON document correctly.
  */
 void test_OTA_JobParsing_Valid_JSON( void )
 {
@@ -132,16 +174,17 @@ void test_OTA_JobParsing_Valid_JSON( void )
 
     err = initDocModel( &otaJobDocModel,
                         otaJobDocModelParamStructure,
+                        &otaJobDocKeyTable,
                         &otaAgent.fileContext,
                         sizeof( OtaFileContext_t ),
                         OTA_NUM_JOB_PARAMS );
-    err = parseJSONbyModel( JOB_PARSING_VALID_JSON, JOB_PARSING_VALID_JSON_LENGTH, &otaJobDocModel );
+    err = parseJobDocModel( JOB_PARSING_VALID_JSON, JOB_PARSING_VALID_JSON_LENGTH, &otaJobDocModel );
 
     TEST_ASSERT_EQUAL( DocParseErrNone, err );
 }
 
 /**
- * @brief Test that parseJSONbyModel is able to classify an invalid JSON document correctly.
+ * @brief Test that parseJobDocModel is able to classify an invalid JSON document correctly.
  */
 void test_OTA_JobParsing_Invalid_JSON( void )
 {
@@ -151,29 +194,482 @@ void test_OTA_JobParsing_Invalid_JSON( void )
 
     err = initDocModel( &otaJobDocModel,
                         otaJobDocModelParamStructure,
+                        &otaJobDocKeyTable,
                         &otaAgent.fileContext,
                         sizeof( OtaFileContext_t ),
                         OTA_NUM_JOB_PARAMS );
 
-    err = parseJSONbyModel( JOB_PARSING_MALFORMED_JSON, JOB_PARSING_MALFORMED_JSON_LENGTH, &otaJobDocModel );
+    err = parseJobDocModel( JOB_PARSING_MALFORMED_JSON, JOB_PARSING_MALFORMED_JSON_LENGTH, &otaJobDocModel );
     TEST_ASSERT_EQUAL( DocParseErr_InvalidJSONBuffer, err );
 
-    err = parseJSONbyModel( NULL, 0, &otaJobDocModel );
+    err = parseJobDocModel( NULL, 0, &otaJobDocModel );
     TEST_ASSERT_EQUAL( DocParseErrNullDocPointer, err );
 
     memcpy( &otaJobDocModelCopy, &otaJobDocModel, sizeof( JsonDocModel_t ) );
-    err = parseJSONbyModel( JOB_PARSING_INVALID_JSON_MISSING_JOBID, JOB_PARSING_INVALID_JSON_MISSING_JOBID_LENGTH, &otaJobDocModelCopy );
+    err = parseJobDocModel( JOB_PARSING_INVALID_JSON_MISSING_JOBID, JOB_PARSING_INVALID_JSON_MISSING_JOBID_LENGTH, &otaJobDocModelCopy );
     TEST_ASSERT_EQUAL( DocParseErrMalformedDoc, err );
 
     memcpy( &otaJobDocModelCopy, &otaJobDocModel, sizeof( JsonDocModel_t ) );
-    err = parseJSONbyModel( JOB_PARSING_INVALID_JSON_INVALID_BASE64KEY, JOB_PARSING_INVALID_JSON_INVALID_BASE64KEY_LENGTH, &otaJobDocModelCopy );
+    err = parseJobDocModel( JOB_PARSING_INVALID_JSON_INVALID_BASE64KEY, JOB_PARSING_INVALID_JSON_INVALID_BASE64KEY_LENGTH, &otaJobDocModelCopy );
     TEST_ASSERT_EQUAL( DocParseErrBase64Decode, err );
 
     memcpy( &otaJobDocModelCopy, &otaJobDocModel, sizeof( JsonDocModel_t ) );
-    err = parseJSONbyModel( JOB_PARSING_INVALID_JSON_INVALID_NUMERIC, JOB_PARSING_INVALID_JSON_INVALID_NUMERIC_LENGTH, &otaJobDocModelCopy );
+    err = parseJobDocModel( JOB_PARSING_INVALID_JSON_INVALID_NUMERIC, JOB_PARSING_INVALID_JSON_INVALID_NUMERIC_LENGTH, &otaJobDocModelCopy );
     TEST_ASSERT_EQUAL( DocParseErrInvalidNumChar, err );
 }
 
+/**
+ * @brief Test that parseJobDocModel finds the parameters on the key paths of the model
+ *        in any order, in one pass over the document.
+ */
+void test_OTA_JobParsing_Reordered_JSON( void )
+{
+    OtaJobParseErr_t err = OtaJobParseErrUnknown;
+    JsonDocModel_t otaJobDocModel;
+
+    err = initDocModel( &otaJobDocModel,
+                        otaJobDocModelParamStructure,
+                        &otaJobDocKeyTable,
+                        &otaAgent.fileContext,
+                        sizeof( OtaFileContext_t ),
+                        OTA_NUM_JOB_PARAMS );
+    err = parseJobDocModel( JOB_PARSING_REORDERED_JSON, JOB_PARSING_REORDERED_JSON_LENGTH, &otaJobDocModel );
+
+    TEST_ASSERT_EQUAL( DocParseErrNone, err );
+    TEST_ASSERT_EQUAL_STRING( "AFR_OTA-testjob21", ( const char * ) otaAgent.fileContext.pJobName );
+    TEST_ASSERT_EQUAL_STRING( "AFR_OTA-XYZ", ( const char * ) otaAgent.fileContext.pStreamName );
+    TEST_ASSERT_EQUAL_STRING( "/test/\\\"demo}]", ( const char * ) otaAgent.fileContext.pFilePath );
+    TEST_ASSERT_EQUAL( 2, otaAgent.fileContext.serverFileID );
+    TEST_ASSERT_EQUAL( 1024, otaAgent.fileContext.fileSize );
+
+    /* The value of an object is recorded with its braces. */
+    TEST_ASSERT_EQUAL( '{', otaJobDocModel.valueSpans[ 2 ].pValue[ 0 ] );
+    TEST_ASSERT_EQUAL( '}', otaJobDocModel.valueSpans[ 2 ].pValue[ otaJobDocModel.valueSpans[ 2 ].valueLength - 1U ] );
+}
+
+/**
+ * @brief Test that parseJobDocModel takes the first occurrence of a key path, prefers the
+ *        document over the file group and only searches the first file.
+ */
+void test_OTA_JobParsing_Duplicate_Keys_JSON( void )
+{
+    OtaJobParseErr_t err = OtaJobParseErrUnknown;
+    JsonDocModel_t otaJobDocModel;
+
+    err = initDocModel( &otaJobDocModel,
+                        otaJobDocModelParamStructure,
+                        &otaJobDocKeyTable,
+                        &otaAgent.fileContext,
+                        sizeof( OtaFileContext_t ),
+                        OTA_NUM_JOB_PARAMS );
+    err = parseJobDocModel( JOB_PARSING_DUPLICATE_KEYS_JSON, JOB_PARSING_DUPLICATE_KEYS_JSON_LENGTH, &otaJobDocModel );
+
+    TEST_ASSERT_EQUAL( DocParseErrNone, err );
+    TEST_ASSERT_EQUAL_STRING( "AFR_OTA-first", ( const char * ) otaAgent.fileContext.pJobName );
+    TEST_ASSERT_EQUAL( 100, otaAgent.fileContext.fileSize );
+    TEST_ASSERT_EQUAL( 9, otaAgent.fileContext.serverFileID );
+
+    /* The attributes of the second file and the status details of the second execution
+     * object are not searched. */
+    TEST_ASSERT_EQUAL( 0, otaJobDocModel.paramsReceivedBitmap & ( ( 1U << 19 ) | ( 1U << 6 ) ) );
+}
+
+/* Check that a generated key table holds every key path and key path prefix of a model in its
+ * own slot, and nothing else. This fails when the table was not generated again after the model
+ * changed. */
+static void verifyKeyTable( const JsonDocParam_t * pBodyDef,
+                            uint16_t numParams,
+                            const JsonKeyTable_t * pKeyTable )
+{
+    uint32_t matches[ OTA_JSON_MAX_KEY_PATHS ] = { 0 };
+    uint32_t children[ OTA_JSON_MAX_KEY_PATHS ] = { 0 };
+    const JsonKeyPath_t * pKeyPath = NULL;
+    const char * pSrcKey = NULL;
+    uint32_t hash = 0;
+    uint8_t slot = 0;
+    uint16_t paramIndex = 0;
+    uint16_t numSlotsUsed = 0;
+    size_t keyOffset = 0;
+    size_t i = 0;
+
+    TEST_ASSERT_EQUAL( 0, pKeyTable->dynamicParams >> numParams );
+
+    for( paramIndex = 0; paramIndex < numParams; paramIndex++ )
+    {
+        pSrcKey = pBodyDef[ paramIndex ].pSrcKey;
+        hash = OTA_FNV_OFFSET_BASIS;
+        keyOffset = 0;
+
+        if( ( pKeyTable->dynamicParams & ( ( uint32_t ) 1U << paramIndex ) ) != 0U )
+        {
+            /* A key only known at run time is not in the table, and is matched at the top level. */
+            TEST_ASSERT_NULL( strchr( pSrcKey, OTA_JSON_SEPARATOR[ 0 ] ) );
+        }
+        else
+        {
+            for( i = 0; i <= strlen( pSrcKey ); i++ )
+            {
+                if( ( pSrcKey[ i ] == '\0' ) || ( pSrcKey[ i ] == OTA_JSON_SEPARATOR[ 0 ] ) )
+                {
+                    slot = pKeyTable->slots[ OTA_JSON_KEY_SLOT( hash, pKeyTable->multiplier ) ];
+                    TEST_ASSERT_NOT_EQUAL( 0, slot );
+
+                    pKeyPath = &( pKeyTable->keyPaths[ slot - 1U ] );
+                    TEST_ASSERT_EQUAL( hash, pKeyPath->hash );
+                    TEST_ASSERT_EQUAL( keyOffset, pKeyPath->keyOffset );
+                    TEST_ASSERT_EQUAL( i - keyOffset, pKeyPath->keyLength );
+                    TEST_ASSERT_EQUAL_STRING_LEN( pSrcKey, pBodyDef[ pKeyPath->paramIndex ].pSrcKey, i );
+
+                    if( pSrcKey[ i ] == '\0' )
+                    {
+                        matches[ slot - 1U ] |= ( uint32_t ) 1U << paramIndex;
+                    }
+                    else
+                    {
+                        children[ slot - 1U ] |= ( uint32_t ) 1U << paramIndex;
+                        keyOffset = i + 1U;
+                    }
+                }
+
+                hash = hashJsonKey( hash, &pSrcKey[ i ], 1U );
+            }
+        }
+    }
+
+    /* Every key path of the table belongs to the parameters of the model that have it. */
+    for( i = 0; i < pKeyTable->numKeyPaths; i++ )
+    {
+        TEST_ASSERT_NOT_EQUAL( 0, matches[ i ] | children[ i ] );
+        TEST_ASSERT_EQUAL( matches[ i ], pKeyTable->keyPaths[ i ].matches );
+        TEST_ASSERT_EQUAL( children[ i ], pKeyTable->keyPaths[ i ].children );
+    }
+
+    for( i = 0; i < OTA_JSON_KEY_TABLE_SIZE; i++ )
+    {
+        numSlotsUsed += ( pKeyTable->slots[ i ] != 0U ) ? 1U : 0U;
+    }
+
+    TEST_ASSERT_EQUAL( pKeyTable->numKeyPaths, numSlotsUsed );
+}
+
+/**
+ * @brief Test that the generated key table of the job document model is up to date. Run
+ *        tools/json_key_table.py after changing the model.
+ */
+void test_OTA_JobParsing_Key_Table_Up_To_Date( void )
+{
+    verifyKeyTable( otaJobDocModelParamStructure, OTA_NUM_JOB_PARAMS, &otaJobDocKeyTable );
+
+    /* Only the file signature key, which the PAL defines, is not in the table. */
+    TEST_ASSERT_EQUAL( OTA_NUM_JOB_PARAMS - 1, otaJobDocKeyTable.numKeyPaths );
+
+    /* The generated parameter indices are the ones of the model. */
+    TEST_ASSERT_EQUAL( OTA_NUM_JOB_PARAMS, OTA_JOB_DOC_NUM_PARAMS );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_JOB_ID_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_JOB_ID ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_SELF_TEST_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_SELF_TEST ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_UPDATED_BY_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_UPDATED_BY ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_STREAM_NAME_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_STREAM_NAME ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_PROTOCOLS_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_PROTOCOLS ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_FILE_PATH_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_FILE_PATH ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_FILE_SIZE_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_FILE_SIZE ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_FILE_ID_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_FILE_ID ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_FILE_CERT_NAME_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_FILE_CERT_NAME ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_UPDATE_DATA_URL_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_UPDATE_DATA_URL ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_AUTH_SCHEME_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_AUTH_SCHEME ].pSrcKey );
+    TEST_ASSERT_EQUAL_PTR( OTA_JsonFileSignatureKey, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_FILE_SIGNATURE ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_FILE_ATTRIBUTE_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_FILE_ATTRIBUTE ].pSrcKey );
+    TEST_ASSERT_EQUAL_STRING( OTA_JSON_FILETYPE_KEY, otaJobDocModelParamStructure[ OTA_JOB_DOC_PARAM_FILETYPE ].pSrcKey );
+}
+
+/**
+ * @brief Test that the key paths of a document model are mapped to its parameters by its key
+ *        table, and that keys that are not in the model are not matched.
+ */
+void test_OTA_JobParsing_Custom_Model( void )
+{
+    OtaJobParseErr_t err = OtaJobParseErrUnknown;
+    JsonDocModel_t docModel;
+    const char * pJson = "{\"stat\":1,\"statusX\":{\"size\":2},\"status\":{\"code\":{\"size\":3},\"sizes\":4,\"size\":5},\"id\":6}";
+    static const JsonDocParam_t customModel[] =
+    {
+        { "status",           OTA_JOB_PARAM_REQUIRED, OTA_DONT_STORE_PARAM,                         OTA_DONT_STORE_PARAM, ModelParamTypeObject },
+        { "status.size",      OTA_JOB_PARAM_REQUIRED, U16_OFFSET( OtaFileContext_t, fileSize ),     OTA_DONT_STORE_PARAM, ModelParamTypeUInt32 },
+        { "status.code.size", OTA_JOB_PARAM_REQUIRED, U16_OFFSET( OtaFileContext_t, serverFileID ), OTA_DONT_STORE_PARAM, ModelParamTypeUInt32 },
+        { "id",               OTA_JOB_PARAM_OPTIONAL, U16_OFFSET( OtaFileContext_t, fileType ),     OTA_DONT_STORE_PARAM, ModelParamTypeUInt32 }
+    };
+
+    /* Generated with tools/json_key_table.py --name customModelKeyTable --keys status status.size status.code.size id */
+    static const JsonKeyTable_t customModelKeyTable =
+    {
+        0x9E3779B1U, /* Multiplier. */
+        0x00000000U, /* Parameters with a key only known at run time. */
+        5U,          /* Number of key paths. */
+        {
+            { 0xBA4B77EFU, 0x00000001U, 0x00000006U,  0U,  6U,  0U }, /* status */
+            { 0x68C10792U, 0x00000002U, 0x00000000U,  7U,  4U,  1U }, /* status.size */
+            { 0x549D434AU, 0x00000000U, 0x00000004U,  7U,  4U,  2U }, /* status.code */
+            { 0x10DCE805U, 0x00000004U, 0x00000000U, 12U,  4U,  2U }, /* status.code.size */
+            { 0x37386AE0U, 0x00000008U, 0x00000000U,  0U,  2U,  3U }  /* id */
+        },
+        {
+             4U,  0U,  0U,  5U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,
+             0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  2U,  0U,  0U,  0U,  0U,  0U,  0U,
+             0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,
+             1U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  0U,  3U,  0U,  0U
+        }
+    };
+
+    verifyKeyTable( customModel, sizeof( customModel ) / sizeof( customModel[ 0 ] ), &customModelKeyTable );
+
+    err = initDocModel( &docModel,
+                        customModel,
+                        &customModelKeyTable,
+                        &otaAgent.fileContext,
+                        sizeof( OtaFileContext_t ),
+                        sizeof( customModel ) / sizeof( customModel[ 0 ] ) );
+    TEST_ASSERT_EQUAL( DocParseErrNone, err );
+
+    /* "status.code" is only the prefix of a key path. */
+    TEST_ASSERT_EQUAL( 5, docModel.pKeyTable->numKeyPaths );
+
+    err = parseJobDocModel( pJson, strlen( pJson ), &docModel );
+    TEST_ASSERT_EQUAL( DocParseErrNone, err );
+    TEST_ASSERT_EQUAL( 5, otaAgent.fileContext.fileSize );
+    TEST_ASSERT_EQUAL( 3, otaAgent.fileContext.serverFileID );
+    TEST_ASSERT_EQUAL( 6, otaAgent.fileContext.fileType );
+
+    /* The job document model has its own table. */
+    err = initDocModel( &docModel,
+                        otaJobDocModelParamStructure,
+                        &otaJobDocKeyTable,
+                        &otaAgent.fileContext,
+                        sizeof( OtaFileContext_t ),
+                        OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrNone, err );
+    TEST_ASSERT_EQUAL_PTR( &otaJobDocKeyTable, docModel.pKeyTable );
+
+    err = parseJobDocModel( JOB_PARSING_REORDERED_JSON, JOB_PARSING_REORDERED_JSON_LENGTH, &docModel );
+    TEST_ASSERT_EQUAL( DocParseErrNone, err );
+    TEST_ASSERT_EQUAL_STRING( "AFR_OTA-testjob21", ( const char * ) otaAgent.fileContext.pJobName );
+}
+
+/**
+ * @brief Test that the fingerprint of a job document only changes with the fields that
+ *        identify the update.
+ */
+void test_OTA_JobParsing_Fingerprint( void )
+{
+    JsonDocModel_t otaJobDocModel;
+    uint32_t fingerprint = 0;
+    uint32_t otherFingerprint = 0;
+
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrNone, fingerprintJobDoc( JOB_PARSING_VALID_JSON, JOB_PARSING_VALID_JSON_LENGTH, &otaJobDocModel, &fingerprint ) );
+
+    /* The timestamps, the status and the version of the execution are left out. */
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrNone, fingerprintJobDoc( JOB_PARSING_UPDATED_EXECUTION_JSON, JOB_PARSING_UPDATED_EXECUTION_JSON_LENGTH, &otaJobDocModel, &otherFingerprint ) );
+    TEST_ASSERT_EQUAL( fingerprint, otherFingerprint );
+
+    /* So is the pre-signed url, which is refreshed while the file is transferred. */
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrNone, fingerprintJobDoc( JOB_PARSING_FRESH_URL_JSON, JOB_PARSING_FRESH_URL_JSON_LENGTH, &otaJobDocModel, &otherFingerprint ) );
+    TEST_ASSERT_EQUAL( fingerprint, otherFingerprint );
+
+    /* The job ID and the job document are not. */
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrNone, fingerprintJobDoc( JOB_PARSING_INVALID_JSON_MISSING_JOBID, JOB_PARSING_INVALID_JSON_MISSING_JOBID_LENGTH, &otaJobDocModel, &otherFingerprint ) );
+    TEST_ASSERT_NOT_EQUAL( fingerprint, otherFingerprint );
+
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrNone, fingerprintJobDoc( JOB_PARSING_INVALID_JSON_INVALID_NUMERIC, JOB_PARSING_INVALID_JSON_INVALID_NUMERIC_LENGTH, &otaJobDocModel, &otherFingerprint ) );
+    TEST_ASSERT_NOT_EQUAL( fingerprint, otherFingerprint );
+
+    /* Only a job document of the active job is identical. */
+    activeJobFingerprint = fingerprint;
+    ( void ) memset( otaAgent.pActiveJobName, 0, OTA_JOB_ID_MAX_SIZE );
+    TEST_ASSERT_FALSE( isActiveJobDoc( fingerprint ) );
+
+    ( void ) memcpy( otaAgent.pActiveJobName, "AFR_OTA-testjob20", strlen( "AFR_OTA-testjob20" ) );
+    TEST_ASSERT_TRUE( isActiveJobDoc( fingerprint ) );
+    TEST_ASSERT_FALSE( isActiveJobDoc( otherFingerprint ) );
+
+    ( void ) memset( otaAgent.pActiveJobName, 0, OTA_JOB_ID_MAX_SIZE );
+    activeJobFingerprint = 0;
+}
+
+/**
+ * @brief Test that a CBOR job document, with the signature as a raw byte string, is parsed
+ *        to the same file context as the JSON job document.
+ */
+void test_OTA_JobParsing_Cbor_Job_Doc( void )
+{
+    JsonDocModel_t otaJobDocModel;
+    Sig256_t signature;
+    uint8_t cborJobDoc[ 1024 ];
+    size_t cborJobDocSize = 0;
+
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrNone, parseJobDocModel( JOB_PARSING_VALID_JSON, JOB_PARSING_VALID_JSON_LENGTH, &otaJobDocModel ) );
+    ( void ) memcpy( &signature, otaAgent.fileContext.pSignature, sizeof( Sig256_t ) );
+
+    TEST_ASSERT_EQUAL( CborNoError, createOtaCborJobDocument( cborJobDoc, sizeof( cborJobDoc ), signature.data, signature.size, &cborJobDocSize ) );
+
+    /* Parse the CBOR job document to a cleared file context. */
+    ( void ) memset( otaAgent.fileContext.pJobName, 0, otaAgent.fileContext.jobNameMaxSize );
+    ( void ) memset( otaAgent.fileContext.pProtocols, 0, otaAgent.fileContext.protocolMaxSize );
+    ( void ) memset( otaAgent.fileContext.pSignature, 0, sizeof( Sig256_t ) );
+    ( void ) memset( otaAgent.fileContext.pFilePath, 0, otaAgent.fileContext.filePathMaxSize );
+    ( void ) memset( otaAgent.fileContext.pCertFilepath, 0, otaAgent.fileContext.certFilePathMaxSize );
+    ( void ) memset( otaAgent.fileContext.pStreamName, 0, otaAgent.fileContext.streamNameMaxSize );
+    otaAgent.fileContext.fileSize = 0;
+    otaAgent.fileContext.serverFileID = 1;
+
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrNone, parseJobDocModel( ( const char * ) cborJobDoc, ( uint32_t ) cborJobDocSize, &otaJobDocModel ) );
+    TEST_ASSERT_TRUE( otaJobDocModel.isCborDoc );
+
+    TEST_ASSERT_EQUAL_STRING( CBOR_TEST_JOB_ID_VALUE, ( const char * ) otaAgent.fileContext.pJobName );
+    TEST_ASSERT_EQUAL_STRING( "[\"" CBOR_TEST_PROTOCOLS_VALUE "\"]", ( const char * ) otaAgent.fileContext.pProtocols );
+    TEST_ASSERT_EQUAL_STRING( CBOR_TEST_STREAM_NAME_VALUE, ( const char * ) otaAgent.fileContext.pStreamName );
+    TEST_ASSERT_EQUAL_STRING( CBOR_TEST_FILE_PATH_VALUE, ( const char * ) otaAgent.fileContext.pFilePath );
+    TEST_ASSERT_EQUAL_STRING( CBOR_TEST_CERT_FILE_VALUE, ( const char * ) otaAgent.fileContext.pCertFilepath );
+    TEST_ASSERT_EQUAL( CBOR_TEST_FILE_SIZE_VALUE, otaAgent.fileContext.fileSize );
+    TEST_ASSERT_EQUAL( CBOR_TEST_FILEIDENTITY_VALUE, otaAgent.fileContext.serverFileID );
+    TEST_ASSERT_EQUAL( signature.size, otaAgent.fileContext.pSignature->size );
+    TEST_ASSERT_EQUAL_MEMORY( signature.data, otaAgent.fileContext.pSignature->data, signature.size );
+}
+
+/**
+ * @brief Test that malformed CBOR job documents and signatures too large for the file
+ *        context are rejected.
+ */
+void test_OTA_JobParsing_Invalid_Cbor_Job_Doc( void )
+{
+    JsonDocModel_t otaJobDocModel;
+    uint8_t signature[ kOTA_MaxSignatureSize + 44 ] = { 0 };
+    uint8_t cborJobDoc[ 1024 ];
+    size_t cborJobDocSize = 0;
+
+    TEST_ASSERT_EQUAL( CborNoError, createOtaCborJobDocument( cborJobDoc, sizeof( cborJobDoc ), signature, 64, &cborJobDocSize ) );
+
+    /* A truncated document. */
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrInvalidCborBuffer, parseJobDocModel( ( const char * ) cborJobDoc, ( uint32_t ) cborJobDocSize - 1U, &otaJobDocModel ) );
+
+    /* Data after the map of the document. */
+    cborJobDoc[ cborJobDocSize ] = 0U;
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrInvalidCborBuffer, parseJobDocModel( ( const char * ) cborJobDoc, ( uint32_t ) cborJobDocSize + 1U, &otaJobDocModel ) );
+
+    /* A signature larger than the signature buffer. */
+    TEST_ASSERT_EQUAL( CborNoError, createOtaCborJobDocument( cborJobDoc, sizeof( cborJobDoc ), signature, sizeof( signature ), &cborJobDocSize ) );
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrUserBufferInsuffcient, parseJobDocModel( ( const char * ) cborJobDoc, ( uint32_t ) cborJobDocSize, &otaJobDocModel ) );
+}
+
+/* PAL abort of the file context closed after a job document fails to parse. */
+static OtaPalStatus_t mockPalAbort( OtaFileContext_t * const pFileContext )
+{
+    ( void ) pFileContext;
+
+    return OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
+}
+
+/* Custom job callback that only counts the job documents. */
+static OtaJobParseErr_t customJobCallback( const char * pcJSON,
+                                           uint32_t ulMsgLen )
+{
+    ( void ) pcJSON;
+    ( void ) ulMsgLen;
+
+    customJobCallbackCount++;
+
+    return OtaJobParseErrNonConformingJobDoc;
+}
+
+/* Custom job callback that reads the values found in the job document. */
+static OtaJobParseErr_t customJobDocCallback( const char * pcJSON,
+                                              uint32_t ulMsgLen,
+                                              const OtaJobDocView_t * pDocView )
+{
+    const char * pValue = NULL;
+    size_t valueLength = 0;
+
+    TEST_ASSERT_EQUAL_PTR( JOB_PARSING_INVALID_JSON_MISSING_JOBID, pcJSON );
+    TEST_ASSERT_EQUAL( JOB_PARSING_INVALID_JSON_MISSING_JOBID_LENGTH, ulMsgLen );
+
+    TEST_ASSERT_TRUE( OTA_GetJobDocValue( pDocView, "execution.jobDocument.afr_ota.streamname", &pValue, &valueLength ) );
+    TEST_ASSERT_EQUAL( strlen( "AFR_OTA-XYZ" ), valueLength );
+    TEST_ASSERT_EQUAL_STRING_LEN( "AFR_OTA-XYZ", pValue, valueLength );
+
+    /* The job ID is missing from the document. */
+    TEST_ASSERT_FALSE( OTA_GetJobDocValue( pDocView, "execution.jobId", &pValue, &valueLength ) );
+
+    customJobDocCallbackCount++;
+
+    return OtaJobParseErrNonConformingJobDoc;
+}
+
+/**
+ * @brief Test that the values found in a job document are looked up by their key path and
+ *        passed to the custom job callback.
+ */
+void test_OTA_JobParsing_Custom_Callback_Values( void )
+{
+    JsonDocModel_t otaJobDocModel;
+    OtaJobDocView_t docView;
+    const char * pValue = NULL;
+    size_t valueLength = 0;
+    bool updateJob = false;
+    uint8_t signature[ 64 ] = { 0 };
+    uint8_t cborJobDoc[ 1024 ];
+    size_t cborJobDocSize = 0;
+
+    ( void ) initDocModel( &otaJobDocModel, otaJobDocModelParamStructure, &otaJobDocKeyTable, &otaAgent.fileContext, sizeof( OtaFileContext_t ), OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrNone, parseJobDocModel( JOB_PARSING_VALID_JSON, JOB_PARSING_VALID_JSON_LENGTH, &otaJobDocModel ) );
+    initJobDocView( &otaJobDocModel, &docView );
+
+    TEST_ASSERT_TRUE( OTA_GetJobDocValue( &docView, "execution.jobId", &pValue, &valueLength ) );
+    TEST_ASSERT_EQUAL_STRING_LEN( "AFR_OTA-testjob20", pValue, valueLength );
+
+    /* Values of the file parameters are the ones of the first file. */
+    TEST_ASSERT_TRUE( OTA_GetJobDocValue( &docView, "filesize", &pValue, &valueLength ) );
+    TEST_ASSERT_EQUAL_STRING_LEN( "180568", pValue, valueLength );
+
+    /* Objects are returned with their brackets. */
+    TEST_ASSERT_TRUE( OTA_GetJobDocValue( &docView, "execution.jobDocument", &pValue, &valueLength ) );
+    TEST_ASSERT_EQUAL( '{', pValue[ 0 ] );
+    TEST_ASSERT_EQUAL( '}', pValue[ valueLength - 1U ] );
+
+    /* Keys that are not parameters of the model have no value. */
+    TEST_ASSERT_FALSE( OTA_GetJobDocValue( &docView, "execution.jobDocument.afr_ota.files.filesize", &pValue, &valueLength ) );
+    TEST_ASSERT_FALSE( OTA_GetJobDocValue( &docView, "execution.status", &pValue, &valueLength ) );
+    TEST_ASSERT_FALSE( OTA_GetJobDocValue( &docView, "execution.jobI", &pValue, &valueLength ) );
+    TEST_ASSERT_FALSE( OTA_GetJobDocValue( NULL, "execution.jobId", &pValue, &valueLength ) );
+
+    /* A job document the model cannot parse is passed to the callback with its values. */
+    customJobDocCallbackCount = 0;
+    otaInterfaces.pal.abort = mockPalAbort;
+    ( void ) memset( otaAgent.fileContext.pJobName, 0, otaAgent.fileContext.jobNameMaxSize );
+    OTA_SetCustomJobDocCallback( customJobDocCallback );
+    TEST_ASSERT_NULL( parseJobDoc( JOB_PARSING_INVALID_JSON_MISSING_JOBID, JOB_PARSING_INVALID_JSON_MISSING_JOBID_LENGTH, &updateJob ) );
+    TEST_ASSERT_EQUAL( 1, customJobDocCallbackCount );
+
+    OTA_SetCustomJobDocCallback( NULL );
+
+    /* The custom job callback only gets JSON job documents. */
+    customJobCallbackCount = 0;
+    otaAgent.customJobCallback = customJobCallback;
+    TEST_ASSERT_EQUAL( CborNoError, createOtaCborJobDocument( cborJobDoc, sizeof( cborJobDoc ), signature, sizeof( signature ), &cborJobDocSize ) );
+    TEST_ASSERT_NULL( parseJobDoc( ( const char * ) cborJobDoc, ( uint32_t ) cborJobDocSize - 1U, &updateJob ) );
+    TEST_ASSERT_EQUAL( 0, customJobCallbackCount );
+    TEST_ASSERT_NULL( parseJobDoc( JOB_PARSING_INVALID_JSON_MISSING_JOBID, JOB_PARSING_INVALID_JSON_MISSING_JOBID_LENGTH, &updateJob ) );
+    TEST_ASSERT_EQUAL( 1, customJobCallbackCount );
+
+    otaAgent.customJobCallback = NULL;
+}
+
 /**
  * @brief Tests that initDocModel detects malformed document specifications.
  */
@@ -185,6 +681,7 @@ void test_OTA_jobParsing_invalidDocModel( void )
     /* Test for invalid json document model. */
     err = initDocModel( NULL,
                         otaJobDocModelParamStructure,
+                        &otaJobDocKeyTable,
                         &otaAgent.fileContext,
                         sizeof( OtaFileContext_t ),
                         OTA_NUM_JOB_PARAMS );
@@ -192,6 +689,16 @@ void test_OTA_jobParsing_invalidDocModel( void )
 
     /*Test for invalid job document parameters. */
     err = initDocModel( &otaJobDocModel,
+                        NULL,
+                        &otaJobDocKeyTable,
+                        &otaAgent.fileContext,
+                        sizeof( OtaFileContext_t ),
+                        OTA_NUM_JOB_PARAMS );
+    TEST_ASSERT_EQUAL( DocParseErrNullBodyPointer, err );
+
+    /* Test for a model without a key table. */
+    err = initDocModel( &otaJobDocModel,
+                        otaJobDocModelParamStructure,
                         NULL,
                         &otaAgent.fileContext,
                         sizeof( OtaFileContext_t ),
@@ -201,6 +708,7 @@ void test_OTA_jobParsing_invalidDocModel( void )
     /*Test when the document has more parameters than expected */
     err = initDocModel( &otaJobDocModel,
                         otaJobDocModelParamStructure,
+                        &otaJobDocKeyTable,
                         &otaAgent.fileContext,
                         sizeof( OtaFileContext_t ),
                         OTA_DOC_MODEL_MAX_PARAMS + 1 );
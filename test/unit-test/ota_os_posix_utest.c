@@ -164,6 +164,14 @@ void test_OTA_posix_SelfTestTimerCreateAndStop( void )
     timerCreateAndStop( OtaSelfTestTimer );
 }
 
+/**
+ * @brief Test timers are initialized, stopped and deleted successfully.
+ */
+void test_OTA_posix_ProgressTimerCreateAndStop( void )
+{
+    timerCreateAndStop( OtaProgressTimer );
+}
+
 /**
  * @brief Test invalid operations on timers.
  */
@@ -190,6 +198,18 @@ void test_OTA_posix_InvalidTimerOperations( void )
     TEST_ASSERT_NOT_EQUAL( OtaErrNone, result );
 }
 
+/**
+ * @brief Test that the monotonic time does not go backwards.
+ */
+void test_OTA_posix_GetTimeMs( void )
+{
+    uint32_t startMs = Posix_OtaGetTimeMs();
+
+    usleep( 10000 );
+
+    TEST_ASSERT_GREATER_OR_EQUAL( 10U, Posix_OtaGetTimeMs() - startMs );
+}
+
 /**
  * @brief Test memory allocation and free.
  */
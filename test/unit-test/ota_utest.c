@@ -29,6 +29,7 @@
  */
 
 /* Standard includes. */
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
@@ -45,6 +46,9 @@
 #include "ota_private.h"
 #include "ota_mqtt_private.h"
 #include "ota_http_private.h"
+#include "ota_coap_private.h"
+#include "ota_base64_private.h"
+#include "ota_interface_private.h"
 
 /* test includes. */
 #include "utest_helpers.h"
@@ -54,12 +58,24 @@
 #define OTA_TEST_FILE_NUM_BLOCKS         ( OTA_TEST_FILE_SIZE / OTA_FILE_BLOCK_SIZE + 1 )
 #define OTA_TEST_DUPLICATE_NUM_BLOCKS    3
 #define OTA_TEST_FILE_SIZE_STR           "10240"
+#define OTA_TEST_CHUNK_SIZE              1000
+#define OTA_TEST_HTTP_URL                "https://dummy-url.com/ota.bin"
+#define OTA_TEST_HTTP_FRESH_URL          "https://dummy-url.com/ota.bin?fresh"
+#define OTA_TEST_FILE_NUM_CHUNKS         ( OTA_TEST_FILE_SIZE / OTA_TEST_CHUNK_SIZE + 1 )
+#define OTA_TEST_COAP_BLOCK_SIZE         1024
+#define OTA_TEST_COAP_BLOCK_SZX          6
+#define OTA_TEST_FILE_NUM_COAP_BLOCKS    ( ( OTA_TEST_FILE_SIZE + OTA_TEST_COAP_BLOCK_SIZE - 1 ) / OTA_TEST_COAP_BLOCK_SIZE )
 #define JOB_DOC_A                        "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob20\",\"status\":\"QUEUED\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"MQTT\"],\"streamname\":\"AFR_OTA-XYZ\",\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":" OTA_TEST_FILE_SIZE_STR ",\"fileid\":0,\"certfile\":\"test.crt\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
 #define JOB_DOC_B                        "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob21\",\"status\":\"QUEUED\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"MQTT\"],\"streamname\":\"AFR_OTA-XYZ\",\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":" OTA_TEST_FILE_SIZE_STR ",\"fileid\":0,\"certfile\":\"test.crt\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
 #define JOB_DOC_SELF_TEST                "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob20\",\"status\":\"IN_PROGRESS\",\"statusDetails\":{\"self_test\":\"ready\",\"updatedBy\":\"0x1000000\"},\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"MQTT\"],\"streamname\":\"AFR_OTA-XYZ\",\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":" OTA_TEST_FILE_SIZE_STR ",\"fileid\":0,\"certfile\":\"test.crt\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
 #define JOB_DOC_SELF_TEST_DOWNGRADE      "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob20\",\"status\":\"IN_PROGRESS\",\"statusDetails\":{\"self_test\":\"ready\",\"updatedBy\":\"0x1000001\"},\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"MQTT\"],\"streamname\":\"AFR_OTA-XYZ\",\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":" OTA_TEST_FILE_SIZE_STR ",\"fileid\":0,\"certfile\":\"test.crt\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
-#define JOB_DOC_HTTP                     "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob22\",\"status\":\"QUEUED\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"HTTP\"],\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":" OTA_TEST_FILE_SIZE_STR ",\"fileid\":0,\"certfile\":\"test.crt\",\"update_data_url\":\"https://dummy-url.com/ota.bin\",\"auth_scheme\":\"aws.s3.presigned\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
+#define JOB_DOC_HTTP_WITH_URL( url )    "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob22\",\"status\":\"QUEUED\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"HTTP\"],\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":" OTA_TEST_FILE_SIZE_STR ",\"fileid\":0,\"certfile\":\"test.crt\",\"update_data_url\":\"" url "\",\"auth_scheme\":\"aws.s3.presigned\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
+#define JOB_DOC_HTTP                     JOB_DOC_HTTP_WITH_URL( OTA_TEST_HTTP_URL )
+#define JOB_DOC_HTTP_FRESH_URL           JOB_DOC_HTTP_WITH_URL( OTA_TEST_HTTP_FRESH_URL )
 #define JOB_DOC_ONE_BLOCK                "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob22\",\"status\":\"QUEUED\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"HTTP\"],\"files\":[{\"filepath\":\"/test/demo\",\"filesize\": \"1024\" ,\"fileid\":0,\"certfile\":\"test.crt\",\"update_data_url\":\"https://dummy-url.com/ota.bin\",\"auth_scheme\":\"aws.s3.presigned\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
+#define JOB_DOC_HYBRID                   "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob23\",\"status\":\"QUEUED\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"MQTT\",\"HTTP\"],\"streamname\":\"AFR_OTA-XYZ\",\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":" OTA_TEST_FILE_SIZE_STR ",\"fileid\":0,\"certfile\":\"test.crt\",\"update_data_url\":\"https://dummy-url.com/ota.bin\",\"auth_scheme\":\"aws.s3.presigned\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
+#define JOB_DOC_COAP                     "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob24\",\"status\":\"QUEUED\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"COAP\"],\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":" OTA_TEST_FILE_SIZE_STR ",\"fileid\":0,\"certfile\":\"test.crt\",\"update_data_url\":\"coap://dummy-coap.com/ota.bin\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
+#define JOB_DOC_HTTP_COAP                "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob25\",\"status\":\"QUEUED\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"HTTP\",\"COAP\"],\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":" OTA_TEST_FILE_SIZE_STR ",\"fileid\":0,\"certfile\":\"test.crt\",\"update_data_url\":\"coap://dummy-coap.com/ota.bin\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
 #define JOB_DOC_INVALID                  "not a json"
 #define JOB_DOC_INVALID_PROTOCOL         "{\"clientToken\":\"0:testclient\",\"timestamp\":1602795143,\"execution\":{\"jobId\":\"AFR_OTA-testjob20\",\"status\":\"QUEUED\",\"queuedAt\":1602795128,\"lastUpdatedAt\":1602795128,\"versionNumber\":1,\"executionNumber\":1,\"jobDocument\":{\"afr_ota\":{\"protocols\":[\"XYZ\"],\"streamname\":\"AFR_OTA-XYZ\",\"files\":[{\"filepath\":\"/test/demo\",\"filesize\":" OTA_TEST_FILE_SIZE_STR ",\"fileid\":0,\"certfile\":\"test.crt\",\"sig-sha256-ecdsa\":\"MEQCIF2QDvww1G/kpRGZ8FYvQrok1bSZvXjXefRk7sqNcyPTAiB4dvGt8fozIY5NC0vUDJ2MY42ZERYEcrbwA4n6q7vrBg==\"}] }}}}"
 
@@ -121,6 +137,47 @@ static bool eventIgnore;
 static FILE * pOtaFileHandle = NULL;
 static uint8_t pOtaFileBuffer[ OTA_TEST_FILE_SIZE ];
 
+/* Number of stream requests published and the last passive hold-off time. */
+static int streamRequestCount = 0;
+static uint32_t passiveHoldoffMs = 0;
+
+/* Number of progress updates published and the last one. */
+static int progressUpdateCount = 0;
+static char pLastProgressUpdate[ 128 ];
+
+/* Set while the progress timer is started and not stopped. */
+static bool progressTimerRunning = false;
+
+/* Topics bound to MQTT 5 topic aliases, and the topic bytes that would be sent for stream requests. */
+#define MQTT_TOPIC_ALIAS_MAX    4
+static char pAliasTopics[ MQTT_TOPIC_ALIAS_MAX + 1 ][ 256 ];
+static size_t streamRequestTopicBytes = 0;
+static size_t streamRequestTopicLen = 0;
+static char pStreamResponseTopic[ 256 ];
+
+/* Ranges of the HTTP requests. */
+static int httpRequestCount = 0;
+static uint32_t httpRangeStart = 0;
+static uint32_t httpRangeEnd = 0;
+
+/* The url passed to the last HTTP init, and a url that the HTTP server stand-in rejects. */
+static char pHttpInitUrl[ sizeof( OTA_TEST_HTTP_FRESH_URL ) ] = { 0 };
+static const char * pHttpExpiredUrl = NULL;
+
+/* Context ids and range starts of the HTTP requests with a context id. */
+static uint32_t pHttpRequestContextIds[ OTA_TEST_FILE_NUM_BLOCKS ];
+static uint32_t pHttpRequestRangeStarts[ OTA_TEST_FILE_NUM_BLOCKS ];
+
+/* Block2 transfers of the last CoAP request. */
+static int coapRequestCount = 0;
+static uint32_t coapBlockNumber = 0;
+static uint32_t coapNumBlocks = 0;
+static uint8_t coapBlockSzx = 0;
+
+/* Time of the mock monotonic clock, and the data protocol measured fastest that the PAL stored. */
+static uint32_t mockTimeMs = 0;
+static OtaDataProbeResult_t savedProbeResult = { 0 };
+
 /* 2 seconds default wait time for OTA state machine transition. */
 static const int otaDefaultWait = 2000;
 
@@ -267,16 +324,70 @@ static OtaOsStatus_t mockOSTimerInvokeCallback( OtaTimerId_t timerId,
 }
 
 
+static OtaOsStatus_t mockOSTimerStartRecordHoldoff( OtaTimerId_t timerId,
+                                                    const char * const pTimerName,
+                                                    const uint32_t timeout,
+                                                    OtaTimerCallback_t callback )
+{
+    if( ( timerId == OtaRequestTimer ) && ( timeout != otaconfigFILE_REQUEST_WAIT_MS ) )
+    {
+        passiveHoldoffMs = timeout;
+    }
+
+    return OtaOsSuccess;
+}
+
+static OtaOsStatus_t mockOSTimerExpireProgress( OtaTimerId_t timerId,
+                                                const char * const pTimerName,
+                                                const uint32_t timeout,
+                                                OtaTimerCallback_t callback )
+{
+    if( timerId == OtaProgressTimer )
+    {
+        callback( timerId );
+    }
+
+    return OtaOsSuccess;
+}
+
+static OtaOsStatus_t mockOSTimerStartRecordProgress( OtaTimerId_t timerId,
+                                                     const char * const pTimerName,
+                                                     const uint32_t timeout,
+                                                     OtaTimerCallback_t callback )
+{
+    if( timerId == OtaProgressTimer )
+    {
+        progressTimerRunning = true;
+    }
+
+    return OtaOsSuccess;
+}
+
 static OtaOsStatus_t stubOSTimerStop( OtaTimerId_t timerId )
 {
     return OtaOsSuccess;
 }
 
+static OtaOsStatus_t mockOSTimerStopRecordProgress( OtaTimerId_t timerId )
+{
+    if( timerId == OtaProgressTimer )
+    {
+        progressTimerRunning = false;
+    }
+
+    return OtaOsSuccess;
+}
+
 static OtaOsStatus_t stubOSTimerDelete( OtaTimerId_t timerId )
 {
     return OtaOsSuccess;
 }
 
+static uint32_t mockOSGetTimeMs( void )
+{
+    return mockTimeMs;
+}
+
 static OtaMqttStatus_t stubMqttSubscribe( const char * unused_1,
                                           uint16_t unused_2,
                                           uint8_t unused_3 )
@@ -293,6 +404,90 @@ static OtaMqttStatus_t stubMqttPublish( const char * const unused_1,
     return OtaMqttSuccess;
 }
 
+static bool isStreamRequestTopic( const char * pTopic,
+                                  uint16_t topicLen )
+{
+    return ( topicLen > strlen( "/get/cbor" ) ) &&
+           ( strncmp( pTopic + topicLen - strlen( "/get/cbor" ), "/get/cbor", strlen( "/get/cbor" ) ) == 0 );
+}
+
+static OtaMqttStatus_t mockMqttPublishCountStreamRequests( const char * const pTopic,
+                                                           uint16_t topicLen,
+                                                           const char * unused_1,
+                                                           uint32_t unused_2,
+                                                           uint8_t unused_3 )
+{
+    if( isStreamRequestTopic( pTopic, topicLen ) )
+    {
+        streamRequestCount++;
+    }
+
+    return OtaMqttSuccess;
+}
+
+/* Stands in for an MQTT 5 client and broker: the topic is only sent on the wire until its alias is
+ * bound, and is rebound when the alias is used with a different topic. */
+static OtaMqttStatus_t mockMqttPublishWithTopicAlias( const char * const pTopic,
+                                                      uint16_t topicLen,
+                                                      const char * unused_1,
+                                                      uint32_t unused_2,
+                                                      uint8_t unused_3,
+                                                      const OtaMqttPublishProperties_t * pProperties )
+{
+    size_t topicBytes = topicLen;
+
+    TEST_ASSERT_NOT_NULL( pProperties );
+    TEST_ASSERT_LESS_OR_EQUAL( MQTT_TOPIC_ALIAS_MAX, pProperties->topicAlias );
+    TEST_ASSERT_LESS_THAN( sizeof( pAliasTopics[ 0 ] ), topicLen );
+
+    if( pProperties->topicAlias != 0 )
+    {
+        if( ( strlen( pAliasTopics[ pProperties->topicAlias ] ) == topicLen ) &&
+            ( strncmp( pAliasTopics[ pProperties->topicAlias ], pTopic, topicLen ) == 0 ) )
+        {
+            topicBytes = 0;
+        }
+        else
+        {
+            memset( pAliasTopics[ pProperties->topicAlias ], 0, sizeof( pAliasTopics[ 0 ] ) );
+            memcpy( pAliasTopics[ pProperties->topicAlias ], pTopic, topicLen );
+        }
+    }
+
+    if( isStreamRequestTopic( pTopic, topicLen ) )
+    {
+        streamRequestCount++;
+        streamRequestTopicBytes += topicBytes;
+        streamRequestTopicLen = topicLen;
+
+        TEST_ASSERT_NOT_NULL( pProperties->pResponseTopic );
+        TEST_ASSERT_LESS_THAN( sizeof( pStreamResponseTopic ), pProperties->responseTopicLength );
+        memset( pStreamResponseTopic, 0, sizeof( pStreamResponseTopic ) );
+        memcpy( pStreamResponseTopic, pProperties->pResponseTopic, pProperties->responseTopicLength );
+    }
+
+    return OtaMqttSuccess;
+}
+
+static OtaMqttStatus_t mockMqttPublishRecordProgress( const char * const unused_1,
+                                                      uint16_t unused_2,
+                                                      const char * pMsg,
+                                                      uint32_t msgSize,
+                                                      uint8_t unused_3 )
+{
+    char pUpdate[ sizeof( pLastProgressUpdate ) ] = { 0 };
+
+    memcpy( pUpdate, pMsg, min( msgSize, sizeof( pUpdate ) - 1 ) );
+
+    if( strstr( pUpdate, "\"receive\":\"" ) != NULL )
+    {
+        memcpy( pLastProgressUpdate, pUpdate, sizeof( pUpdate ) );
+        progressUpdateCount++;
+    }
+
+    return OtaMqttSuccess;
+}
+
 static OtaMqttStatus_t mockMqttPublishAlwaysFail( const char * const unused_1,
                                                   uint16_t unused_2,
                                                   const char * unused_3,
@@ -325,6 +520,49 @@ static OtaHttpStatus_t stubHttpRequest( uint32_t rangeStart,
     return OtaHttpSuccess;
 }
 
+static OtaHttpStatus_t mockHttpRequestRecordRange( uint32_t rangeStart,
+                                                   uint32_t rangeEnd )
+{
+    httpRangeStart = rangeStart;
+    httpRangeEnd = rangeEnd;
+    httpRequestCount++;
+
+    return OtaHttpSuccess;
+}
+
+static OtaHttpStatus_t mockHttpRequestWithContextRecordRange( uint32_t contextId,
+                                                              uint32_t rangeStart,
+                                                              uint32_t rangeEnd )
+{
+    if( httpRequestCount < OTA_TEST_FILE_NUM_BLOCKS )
+    {
+        pHttpRequestContextIds[ httpRequestCount ] = contextId;
+        pHttpRequestRangeStarts[ httpRequestCount ] = rangeStart;
+    }
+
+    return mockHttpRequestRecordRange( rangeStart, rangeEnd );
+}
+
+static OtaHttpStatus_t mockHttpInitRecordUrl( char * url )
+{
+    strncpy( pHttpInitUrl, url, sizeof( pHttpInitUrl ) - 1 );
+
+    return OtaHttpSuccess;
+}
+
+static OtaHttpStatus_t mockHttpRequestExpiringUrl( uint32_t rangeStart,
+                                                   uint32_t rangeEnd )
+{
+    OtaHttpStatus_t status = OtaHttpUrlExpired;
+
+    if( ( pHttpExpiredUrl == NULL ) || ( strcmp( pHttpInitUrl, pHttpExpiredUrl ) != 0 ) )
+    {
+        status = mockHttpRequestRecordRange( rangeStart, rangeEnd );
+    }
+
+    return status;
+}
+
 static OtaHttpStatus_t mockHttpRequestAlwaysFail( uint32_t rangeStart,
                                                   uint32_t rangeEnd )
 {
@@ -336,6 +574,42 @@ static OtaHttpStatus_t stubHttpDeinit()
     return OtaHttpSuccess;
 }
 
+static OtaCoapStatus_t stubCoapInit( char * uri )
+{
+    return OtaCoapSuccess;
+}
+
+static OtaCoapStatus_t stubCoapRequest( uint32_t blockNumber,
+                                        uint32_t numBlocks,
+                                        uint8_t blockSizeExponent )
+{
+    return OtaCoapSuccess;
+}
+
+static OtaCoapStatus_t mockCoapRequestRecordBlocks( uint32_t blockNumber,
+                                                    uint32_t numBlocks,
+                                                    uint8_t blockSizeExponent )
+{
+    coapBlockNumber = blockNumber;
+    coapNumBlocks = numBlocks;
+    coapBlockSzx = blockSizeExponent;
+    coapRequestCount++;
+
+    return OtaCoapSuccess;
+}
+
+static OtaCoapStatus_t mockCoapRequestAlwaysFail( uint32_t blockNumber,
+                                                  uint32_t numBlocks,
+                                                  uint8_t blockSizeExponent )
+{
+    return OtaCoapRequestFailed;
+}
+
+static OtaCoapStatus_t stubCoapDeinit()
+{
+    return OtaCoapSuccess;
+}
+
 OtaPalStatus_t mockPalAbort( OtaFileContext_t * const pFileContext )
 {
     return OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
@@ -383,6 +657,14 @@ int16_t mockPalWriteBlock( OtaFileContext_t * const pFileContext,
     return blockSize;
 }
 
+int16_t mockPalWriteBlockAlwaysFail( OtaFileContext_t * const pFileContext,
+                                     uint32_t offset,
+                                     uint8_t * const pData,
+                                     uint32_t blockSize )
+{
+    return -1;
+}
+
 OtaPalStatus_t mockPalActivate( OtaFileContext_t * const pFileContext )
 {
     return OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
@@ -430,6 +712,20 @@ OtaPalImageState_t mockPalGetPlatformImageState( OtaFileContext_t * const pFileC
     return palImageState;
 }
 
+OtaPalStatus_t mockPalSaveProbeResult( const OtaDataProbeResult_t * pResult )
+{
+    savedProbeResult = *pResult;
+    return OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
+}
+
+OtaPalStatus_t mockPalLoadProbeResultCoap( OtaDataProbeResult_t * pResult )
+{
+    pResult->protocol = OTA_DATA_OVER_COAP;
+    pResult->bytesPerSecond = 1000;
+    pResult->latencyMs = 100;
+    return OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
+}
+
 OtaPalImageState_t mockPalGetPlatformImageStateAlwaysInvalid( OtaFileContext_t * const pFileContext )
 {
     ( void ) pFileContext;
@@ -463,6 +759,7 @@ static void otaInterfaceDefault()
     otaInterfaces.os.timer.start = stubOSTimerStart;
     otaInterfaces.os.timer.stop = stubOSTimerStop;
     otaInterfaces.os.timer.delete = stubOSTimerDelete;
+    otaInterfaces.os.timer.getTimeMs = NULL;
 
     otaInterfaces.os.mem.malloc = malloc;
     otaInterfaces.os.mem.free = free;
@@ -470,10 +767,17 @@ static void otaInterfaceDefault()
     otaInterfaces.mqtt.subscribe = stubMqttSubscribe;
     otaInterfaces.mqtt.publish = stubMqttPublish;
     otaInterfaces.mqtt.unsubscribe = stubMqttUnsubscribe;
+    otaInterfaces.mqtt.publishWithProperties = NULL;
 
     otaInterfaces.http.init = stubHttpInit;
     otaInterfaces.http.deinit = stubHttpDeinit;
     otaInterfaces.http.request = stubHttpRequest;
+    otaInterfaces.http.requestWithContext = NULL;
+    otaInterfaces.http.requestWithOffset = NULL;
+
+    otaInterfaces.coap.init = stubCoapInit;
+    otaInterfaces.coap.deinit = stubCoapDeinit;
+    otaInterfaces.coap.request = stubCoapRequest;
 
     otaInterfaces.pal.abort = mockPalAbort;
     otaInterfaces.pal.createFile = mockPalCreateFileForRx;
@@ -483,6 +787,8 @@ static void otaInterfaceDefault()
     otaInterfaces.pal.reset = mockPalResetDevice;
     otaInterfaces.pal.setPlatformImageState = mockPalSetPlatformImageState;
     otaInterfaces.pal.getPlatformImageState = mockPalGetPlatformImageState;
+    otaInterfaces.pal.saveProbeResult = NULL;
+    otaInterfaces.pal.loadProbeResult = NULL;
 }
 
 static void otaAppBufferDefault()
@@ -683,6 +989,26 @@ void tearDown()
 
     palImageState = OtaPalImageStateUnknown;
     resetCalled = false;
+    streamRequestCount = 0;
+    passiveHoldoffMs = 0;
+    progressUpdateCount = 0;
+    memset( pLastProgressUpdate, 0, sizeof( pLastProgressUpdate ) );
+    progressTimerRunning = false;
+    memset( pAliasTopics, 0, sizeof( pAliasTopics ) );
+    streamRequestTopicBytes = 0;
+    streamRequestTopicLen = 0;
+    memset( pStreamResponseTopic, 0, sizeof( pStreamResponseTopic ) );
+    httpRequestCount = 0;
+    httpRangeStart = 0;
+    httpRangeEnd = 0;
+    memset( pHttpInitUrl, 0, sizeof( pHttpInitUrl ) );
+    pHttpExpiredUrl = NULL;
+    coapRequestCount = 0;
+    coapBlockNumber = 0;
+    coapNumBlocks = 0;
+    coapBlockSzx = 0;
+    mockTimeMs = 0;
+    memset( &savedProbeResult, 0, sizeof( savedProbeResult ) );
     pOtaJobDoc = NULL;
     pOtaFileHandle = NULL;
     memset( pOtaFileBuffer, 0, OTA_TEST_FILE_SIZE );
@@ -1313,9 +1639,35 @@ void test_OTA_ReceiveFileBlockCompleteDynamicBufferMqtt()
     test_OTA_ReceiveFileBlockCompleteMqtt();
 }
 
-void test_OTA_ReceiveFileBlockCompleteHttp()
+/* Pass file data of the response to a HTTP request at the file offset to the OTA agent. The
+ * offset is only passed in front of the data for the requests with offset. */
+static void otaReceiveHttpBlock( OtaEventData_t * pEventBuffer,
+                                 uint32_t offset,
+                                 const uint8_t * pFileBlock,
+                                 uint32_t fileBlockSize )
 {
     OtaEventMsg_t otaEvent;
+    uint32_t offsetSize = 0;
+
+    if( otaInterfaces.http.requestWithOffset != NULL )
+    {
+        pEventBuffer->data[ 0 ] = ( uint8_t ) ( offset >> 24 );
+        pEventBuffer->data[ 1 ] = ( uint8_t ) ( offset >> 16 );
+        pEventBuffer->data[ 2 ] = ( uint8_t ) ( offset >> 8 );
+        pEventBuffer->data[ 3 ] = ( uint8_t ) offset;
+        offsetSize = OTA_HTTP_FILE_OFFSET_SIZE;
+    }
+
+    memcpy( &pEventBuffer->data[ offsetSize ], pFileBlock, fileBlockSize );
+    pEventBuffer->dataLength = offsetSize + fileBlockSize;
+
+    otaEvent.eventId = OtaAgentEventReceivedFileBlock;
+    otaEvent.pEventData = pEventBuffer;
+    OTA_SignalEvent( &otaEvent );
+}
+
+void test_OTA_ReceiveFileBlockCompleteHttp()
+{
     OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_BLOCKS ];
     uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
     int remainingBytes = OTA_TEST_FILE_SIZE;
@@ -1341,11 +1693,7 @@ void test_OTA_ReceiveFileBlockCompleteHttp()
     while( remainingBytes >= 0 )
     {
         fileBlockSize = min( remainingBytes, OTA_FILE_BLOCK_SIZE );
-        otaEvent.eventId = OtaAgentEventReceivedFileBlock;
-        otaEvent.pEventData = &eventBuffers[ idx ];
-        memcpy( otaEvent.pEventData->data, pFileBlock, fileBlockSize );
-        otaEvent.pEventData->dataLength = fileBlockSize;
-        OTA_SignalEvent( &otaEvent );
+        otaReceiveHttpBlock( &eventBuffers[ idx ], idx * OTA_FILE_BLOCK_SIZE, pFileBlock, fileBlockSize );
 
         idx++;
         remainingBytes -= OTA_FILE_BLOCK_SIZE;
@@ -1368,95 +1716,1289 @@ void test_OTA_ReceiveFileBlockCompleteDynamicBufferHttp()
     test_OTA_ReceiveFileBlockCompleteHttp();
 }
 
-static void invokeSelfTestHandler()
+void test_OTA_ReceiveFileBlockMultiBlockRangeHttp()
 {
-    pOtaJobDoc = JOB_DOC_SELF_TEST;
+    OtaEventMsg_t otaEvent;
+    OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_BLOCKS ];
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    int lastBlockSize = OTA_TEST_FILE_SIZE - ( OTA_TEST_FILE_NUM_BLOCKS - 1 ) * OTA_FILE_BLOCK_SIZE;
+    int idx = 0;
+
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaInterfaces.http.request = mockHttpRequestRecordRange;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    /* The first range covers several blocks. */
+    TEST_ASSERT_EQUAL( 1, httpRequestCount );
+    TEST_ASSERT_EQUAL( 0, httpRangeStart );
+    TEST_ASSERT_EQUAL( otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST * OTA_FILE_BLOCK_SIZE - 1, httpRangeEnd );
 
-    /* Set the event send interface to a mock function that allows events to be sent continuously.
-     * This is to complete the self test process. */
     otaInterfaces.os.event.send = mockOSEventSend;
 
-    otaGoToState( OtaAgentStateWaitingForJob );
-    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+    for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+    {
+        pFileBlock[ idx ] = idx % UINT8_MAX;
+    }
 
-    otaReceiveJobDocument();
-    otaWaitForState( OtaAgentStateCreatingFile );
-    otaWaitForState( OtaAgentStateWaitingForJob );
-}
+    /* Completing the range requests the next one, which ends with the file. */
+    for( idx = 0; idx < otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST; idx++ )
+    {
+        otaReceiveHttpBlock( &eventBuffers[ idx ], idx * OTA_FILE_BLOCK_SIZE, pFileBlock, OTA_FILE_BLOCK_SIZE );
+    }
 
-void test_OTA_SelfTestJob()
-{
-    invokeSelfTestHandler();
-    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
-    TEST_ASSERT_EQUAL( OtaImageStateAccepted, OTA_GetImageState() );
-}
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( 2, httpRequestCount );
+    TEST_ASSERT_EQUAL( otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST * OTA_FILE_BLOCK_SIZE, httpRangeStart );
+    TEST_ASSERT_EQUAL( OTA_TEST_FILE_SIZE - 1, httpRangeEnd );
 
-void test_OTA_SelfTestJobNonSelfTestPlatform()
-{
-    /* Let the PAL always says it's not in self test. */
-    otaInterfaces.pal.getPlatformImageState = mockPalGetPlatformImageStateAlwaysInvalid;
+    /* The range times out, only the missing blocks are requested again. */
+    otaEvent.eventId = OtaAgentEventRequestTimer;
+    otaEvent.pEventData = NULL;
+    OTA_SignalEvent( &otaEvent );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( 3, httpRequestCount );
+    TEST_ASSERT_EQUAL( otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST * OTA_FILE_BLOCK_SIZE, httpRangeStart );
+    TEST_ASSERT_EQUAL( OTA_TEST_FILE_SIZE - 1, httpRangeEnd );
 
-    invokeSelfTestHandler();
+    otaReceiveHttpBlock( &eventBuffers[ 2 ], 2 * OTA_FILE_BLOCK_SIZE, pFileBlock, lastBlockSize );
+
+    otaWaitForState( OtaAgentStateWaitingForJob );
     TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
-    TEST_ASSERT_EQUAL( OtaImageStateRejected, OTA_GetImageState() );
+
+    /* Check if received complete file. */
+    for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+    {
+        TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+    }
 }
 
-void test_OTA_NonSelfTestJobSelfTestPlatform()
+void test_OTA_ReceiveFileBlockLateDataHttp()
 {
-    /* Let the PAL always says it's in self test. */
-    otaInterfaces.pal.getPlatformImageState = mockPalGetPlatformImageStateAlwaysPendingCommit;
+    OtaEventMsg_t otaEvent = { 0 };
+    OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_BLOCKS ];
+    uint8_t pFileData[ OTA_TEST_FILE_SIZE ] = { 0 };
+    int lastBlockSize = OTA_TEST_FILE_SIZE - ( OTA_TEST_FILE_NUM_BLOCKS - 1 ) * OTA_FILE_BLOCK_SIZE;
+    int idx = 0;
 
-    otaGoToState( OtaAgentStateCreatingFile );
-    TEST_ASSERT_EQUAL( OtaAgentStateCreatingFile, OTA_GetState() );
-}
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaInterfaces.http.request = stubHttpRequest;
+    otaInterfaces.http.requestWithOffset = mockHttpRequestRecordRange;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+    TEST_ASSERT_EQUAL( 0, httpRangeStart );
 
-void test_OTA_SelfTestJobDowngrade()
-{
-    pOtaJobDoc = JOB_DOC_SELF_TEST_DOWNGRADE;
+    otaInterfaces.os.event.send = mockOSEventSend;
 
-    otaGoToState( OtaAgentStateWaitingForJob );
-    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+    /* Every block of the file has different data. */
+    for( idx = 0; idx < sizeof( pFileData ); idx++ )
+    {
+        pFileData[ idx ] = ( idx * 7 + idx / OTA_FILE_BLOCK_SIZE ) % UINT8_MAX;
+    }
 
-    otaReceiveJobDocument();
+    /* The first range stalls after its first block and is requested again from the missing block. */
+    otaReceiveHttpBlock( &eventBuffers[ 0 ], 0, pFileData, OTA_FILE_BLOCK_SIZE );
     otaWaitForEmptyEvent();
-    TEST_ASSERT_EQUAL( true, resetCalled );
-}
 
-void test_OTA_StartWithSelfTest()
-{
-    /* Directly set pal image state to pending commit, pretending we're in self test. */
-    palImageState = OtaPalImageStatePendingCommit;
+    otaEvent.eventId = OtaAgentEventRequestTimer;
+    OTA_SignalEvent( &otaEvent );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( 2, httpRequestCount );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE, httpRangeStart );
 
-    /* Let timer start to invoke callback directly. */
-    otaInterfaces.os.timer.start = mockOSTimerInvokeCallback;
+    /* The new response starts with the last block of the file, the late second block of the first
+     * response arrives in between. Each is stored at its own offset. */
+    otaReceiveHttpBlock( &eventBuffers[ 1 ], 2 * OTA_FILE_BLOCK_SIZE, &pFileData[ 2 * OTA_FILE_BLOCK_SIZE ], lastBlockSize );
+    otaReceiveHttpBlock( &eventBuffers[ 2 ], OTA_FILE_BLOCK_SIZE, &pFileData[ OTA_FILE_BLOCK_SIZE ], OTA_FILE_BLOCK_SIZE );
 
-    /* Start OTA agent. */
-    otaGoToState( OtaAgentStateWaitingForJob );
+    otaWaitForState( OtaAgentStateWaitingForJob );
     TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
-    TEST_ASSERT_EQUAL( true, resetCalled );
+
+    /* Check if received complete file. */
+    for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+    {
+        TEST_ASSERT_EQUAL( pFileData[ idx ], pOtaFileBuffer[ idx ] );
+    }
 }
 
-void test_OTA_ReceiveNewJobDocWhileInProgress()
+void test_OTA_ReceiveFileBlockMultiBlockBodyHttp()
 {
-    pOtaJobDoc = JOB_DOC_A;
+    OtaEventData_t eventBuffers[ 2 ];
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t pRangeBody[ otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST * OTA_FILE_BLOCK_SIZE ] = { 0 };
+    int lastBlockSize = OTA_TEST_FILE_SIZE - ( OTA_TEST_FILE_NUM_BLOCKS - 1 ) * OTA_FILE_BLOCK_SIZE;
+    int idx = 0;
 
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaInterfaces.http.request = mockHttpRequestRecordRange;
     otaGoToState( OtaAgentStateWaitingForFileBlock );
     TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+    TEST_ASSERT_EQUAL( 1, httpRequestCount );
 
-    /* Reset the event queue so that we can send the next event. */
-    mockOSEventReset( NULL );
-
-    /* Sending another job document should cause OTA agent to abort current update. */
-    pOtaJobDoc = JOB_DOC_B;
-    otaReceiveJobDocument();
-    otaWaitForState( OtaAgentStateRequestingJob );
-    TEST_ASSERT_EQUAL( OtaAgentStateRequestingJob, OTA_GetState() );
-}
+    otaInterfaces.os.event.send = mockOSEventSend;
 
-static void refreshWithJobDoc( const char * initJobDoc,
-                               const char * newJobDoc )
-{
-    OtaEventMsg_t otaEvent = { 0 };
+    for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+    {
+        pFileBlock[ idx ] = idx % UINT8_MAX;
+    }
+
+    /* The whole body of the first range is passed in one event, the agent splits it into blocks. */
+    for( idx = 0; idx < otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST; idx++ )
+    {
+        memcpy( &pRangeBody[ idx * OTA_FILE_BLOCK_SIZE ], pFileBlock, OTA_FILE_BLOCK_SIZE );
+    }
+
+    otaReceiveHttpBlock( &eventBuffers[ 0 ], 0, pRangeBody, sizeof( pRangeBody ) );
+    otaWaitForEmptyEvent();
+
+    /* Every block of the range is received, so the next range is requested. */
+    TEST_ASSERT_EQUAL( 2, httpRequestCount );
+    TEST_ASSERT_EQUAL( otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST * OTA_FILE_BLOCK_SIZE, httpRangeStart );
+    TEST_ASSERT_EQUAL( OTA_TEST_FILE_SIZE - 1, httpRangeEnd );
+
+    otaReceiveHttpBlock( &eventBuffers[ 1 ], otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST * OTA_FILE_BLOCK_SIZE, pFileBlock, lastBlockSize );
+
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+    /* Check if received complete file. */
+    for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+    {
+        TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+    }
+}
+
+void test_OTA_ReceiveFileBlockUrlExpiredHttp()
+{
+    OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_BLOCKS ];
+    OtaAgentStatistics_t statistics = { 0 };
+    OtaAgentStatistics_t refreshedStatistics = { 0 };
+    char pProgressUpdate[ sizeof( pLastProgressUpdate ) ] = { 0 };
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    int lastBlockSize = OTA_TEST_FILE_SIZE - ( OTA_TEST_FILE_NUM_BLOCKS - 1 ) * OTA_FILE_BLOCK_SIZE;
+    int idx = 0;
+
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaInterfaces.http.init = mockHttpInitRecordUrl;
+    otaInterfaces.http.request = mockHttpRequestExpiringUrl;
+    otaInterfaces.mqtt.publish = mockMqttPublishRecordProgress;
+    otaInterfaces.os.timer.start = mockOSTimerStartRecordProgress;
+    otaInterfaces.os.timer.stop = mockOSTimerStopRecordProgress;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+    TEST_ASSERT_EQUAL_STRING( OTA_TEST_HTTP_URL, pHttpInitUrl );
+    TEST_ASSERT_EQUAL( 1, httpRequestCount );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+    {
+        pFileBlock[ idx ] = idx % UINT8_MAX;
+    }
+
+    /* The url expires while the first range is received. */
+    pHttpExpiredUrl = OTA_TEST_HTTP_URL;
+
+    for( idx = 0; idx < otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST; idx++ )
+    {
+        otaReceiveHttpBlock( &eventBuffers[ idx ], idx * OTA_FILE_BLOCK_SIZE, pFileBlock, OTA_FILE_BLOCK_SIZE );
+    }
+
+    /* The rejected request makes the agent fetch the job document again. */
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+    TEST_ASSERT_EQUAL( 1, httpRequestCount );
+    TEST_ASSERT_EQUAL( OtaErrNone, OTA_GetStatistics( &statistics ) );
+    TEST_ASSERT_EQUAL( otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST, statistics.otaPacketsProcessed );
+    TEST_ASSERT_EQUAL( 1, progressUpdateCount );
+    memcpy( pProgressUpdate, pLastProgressUpdate, sizeof( pProgressUpdate ) );
+
+    /* No progress is reported while the url is refreshed, so the progress timer is stopped. */
+    TEST_ASSERT_FALSE( progressTimerRunning );
+
+    /* The job document of the same job has a fresh url, the download continues after the
+     * blocks received so far, with the statistics and the progress of the transfer. */
+    pOtaJobDoc = JOB_DOC_HTTP_FRESH_URL;
+    otaReceiveJobDocument();
+    otaWaitForState( OtaAgentStateWaitingForFileBlock );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+    TEST_ASSERT_EQUAL_STRING( OTA_TEST_HTTP_FRESH_URL, pHttpInitUrl );
+    TEST_ASSERT_EQUAL( 2, httpRequestCount );
+    TEST_ASSERT_EQUAL( otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST * OTA_FILE_BLOCK_SIZE, httpRangeStart );
+
+    TEST_ASSERT_EQUAL( OtaErrNone, OTA_GetStatistics( &refreshedStatistics ) );
+    TEST_ASSERT_EQUAL( statistics.otaPacketsReceived, refreshedStatistics.otaPacketsReceived );
+    TEST_ASSERT_EQUAL( statistics.otaPacketsQueued, refreshedStatistics.otaPacketsQueued );
+    TEST_ASSERT_EQUAL( statistics.otaPacketsProcessed, refreshedStatistics.otaPacketsProcessed );
+    TEST_ASSERT_EQUAL( statistics.otaPacketsDropped, refreshedStatistics.otaPacketsDropped );
+    TEST_ASSERT_EQUAL( 1, progressUpdateCount );
+    TEST_ASSERT_EQUAL_STRING( pProgressUpdate, pLastProgressUpdate );
+
+    otaReceiveHttpBlock( &eventBuffers[ 2 ], 2 * OTA_FILE_BLOCK_SIZE, pFileBlock, lastBlockSize );
+
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+    /* Check if received complete file. */
+    for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+    {
+        TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+    }
+}
+
+/* Pass a file block of the response to the HTTP request with the context id to the OTA agent. */
+static void otaReceiveHttpContextBlock( OtaEventData_t * pEventBuffer,
+                                        uint32_t contextId,
+                                        const uint8_t * pFileBlock,
+                                        uint32_t fileBlockSize )
+{
+    OtaEventMsg_t otaEvent;
+
+    pEventBuffer->data[ 0 ] = ( uint8_t ) ( contextId >> 24 );
+    pEventBuffer->data[ 1 ] = ( uint8_t ) ( contextId >> 16 );
+    pEventBuffer->data[ 2 ] = ( uint8_t ) ( contextId >> 8 );
+    pEventBuffer->data[ 3 ] = ( uint8_t ) contextId;
+    memcpy( &pEventBuffer->data[ OTA_HTTP_CONTEXT_ID_SIZE ], pFileBlock, fileBlockSize );
+    pEventBuffer->dataLength = OTA_HTTP_CONTEXT_ID_SIZE + fileBlockSize;
+
+    otaEvent.eventId = OtaAgentEventReceivedFileBlock;
+    otaEvent.pEventData = pEventBuffer;
+    OTA_SignalEvent( &otaEvent );
+}
+
+void test_OTA_ReceiveFileBlockParallelRangesHttp()
+{
+    OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_BLOCKS ];
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    int lastBlockSize = OTA_TEST_FILE_SIZE - ( OTA_TEST_FILE_NUM_BLOCKS - 1 ) * OTA_FILE_BLOCK_SIZE;
+    int idx = 0;
+
+    /* The local range server serves every request with a context id on its own connection. */
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaInterfaces.http.requestWithContext = mockHttpRequestWithContextRecordRange;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    /* Two ranges are in flight, the second one ends with the file. */
+    TEST_ASSERT_EQUAL( 2, httpRequestCount );
+    TEST_ASSERT_NOT_EQUAL( pHttpRequestContextIds[ 0 ], pHttpRequestContextIds[ 1 ] );
+    TEST_ASSERT_EQUAL( 0, pHttpRequestRangeStarts[ 0 ] );
+    TEST_ASSERT_EQUAL( otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST * OTA_FILE_BLOCK_SIZE, pHttpRequestRangeStarts[ 1 ] );
+    TEST_ASSERT_EQUAL( OTA_TEST_FILE_SIZE - 1, httpRangeEnd );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+    {
+        pFileBlock[ idx ] = idx % UINT8_MAX;
+    }
+
+    /* The second response completes before the first one. */
+    otaReceiveHttpContextBlock( &eventBuffers[ 0 ], pHttpRequestContextIds[ 1 ], pFileBlock, lastBlockSize );
+    otaReceiveHttpContextBlock( &eventBuffers[ 1 ], pHttpRequestContextIds[ 0 ], pFileBlock, OTA_FILE_BLOCK_SIZE );
+    otaReceiveHttpContextBlock( &eventBuffers[ 2 ], pHttpRequestContextIds[ 0 ], pFileBlock, OTA_FILE_BLOCK_SIZE );
+
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+    /* Check if received complete file. */
+    for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+    {
+        TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+    }
+
+    /* No range was requested again. */
+    TEST_ASSERT_EQUAL( 2, httpRequestCount );
+}
+
+void test_OTA_ReceiveFileBlockRequestGapsHttp()
+{
+    OtaEventMsg_t otaEvent = { 0 };
+    OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_BLOCKS + 1 ];
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t pStaleBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    int lastBlockSize = OTA_TEST_FILE_SIZE - ( OTA_TEST_FILE_NUM_BLOCKS - 1 ) * OTA_FILE_BLOCK_SIZE;
+    int idx = 0;
+
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaInterfaces.http.requestWithContext = mockHttpRequestWithContextRecordRange;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+    TEST_ASSERT_EQUAL( 2, httpRequestCount );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+    {
+        pFileBlock[ idx ] = idx % UINT8_MAX;
+    }
+
+    /* Receive the first and the last block, then the responses stall. */
+    otaReceiveHttpContextBlock( &eventBuffers[ 0 ], pHttpRequestContextIds[ 1 ], pFileBlock, lastBlockSize );
+    otaReceiveHttpContextBlock( &eventBuffers[ 1 ], pHttpRequestContextIds[ 0 ], pFileBlock, OTA_FILE_BLOCK_SIZE );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( 2, httpRequestCount );
+
+    /* Only the gap between the received blocks is requested again. */
+    otaEvent.eventId = OtaAgentEventRequestTimer;
+    OTA_SignalEvent( &otaEvent );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( 3, httpRequestCount );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE, httpRangeStart );
+    TEST_ASSERT_EQUAL( 2 * OTA_FILE_BLOCK_SIZE - 1, httpRangeEnd );
+
+    /* The new request reuses the context of the timed out one, under a new generation. */
+    TEST_ASSERT_NOT_EQUAL( pHttpRequestContextIds[ 0 ], pHttpRequestContextIds[ 2 ] );
+
+    /* A late block of the timed out request is ignored, it is not taken for the requested block. */
+    otaReceiveHttpContextBlock( &eventBuffers[ 2 ], pHttpRequestContextIds[ 0 ], pStaleBlock, OTA_FILE_BLOCK_SIZE );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+    TEST_ASSERT_EQUAL( 3, httpRequestCount );
+
+    otaReceiveHttpContextBlock( &eventBuffers[ 3 ], pHttpRequestContextIds[ 2 ], pFileBlock, OTA_FILE_BLOCK_SIZE );
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+    /* Check if received complete file. */
+    for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+    {
+        TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+    }
+}
+
+void test_OTA_ReceiveFileBlockUnknownContextHttp()
+{
+    OtaEventData_t eventBuffer;
+    OtaAgentStatistics_t statistics = { 0 };
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaInterfaces.http.requestWithContext = mockHttpRequestWithContextRecordRange;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    /* A block for a context id without a request in flight is ignored. */
+    otaReceiveHttpContextBlock( &eventBuffer, pHttpRequestContextIds[ 0 ] + otaconfigHTTP_MAX_PARALLEL_REQUESTS, pFileBlock, OTA_FILE_BLOCK_SIZE );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+    TEST_ASSERT_EQUAL( OtaErrNone, OTA_GetStatistics( &statistics ) );
+    TEST_ASSERT_EQUAL( 0, statistics.otaPacketsProcessed );
+}
+
+void test_OTA_ReceiveFileBlockCompleteHybrid()
+{
+    #if ( otaconfigENABLE_HYBRID_DATA_TRANSFER == 1U )
+        OtaEventMsg_t otaEvent;
+        OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_BLOCKS ];
+        uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+        uint8_t pStreamingMessage[ OTA_FILE_BLOCK_SIZE * 2 ] = { 0 };
+        size_t streamingMessageSize = 0;
+        int lastBlockSize = OTA_TEST_FILE_SIZE - ( OTA_TEST_FILE_NUM_BLOCKS - 1 ) * OTA_FILE_BLOCK_SIZE;
+        int idx = 0;
+
+        /* The job offers both protocols. MQTT is the primary data protocol so it downloads from the
+         * start of the file and HTTP from the end. */
+        pOtaJobDoc = JOB_DOC_HYBRID;
+        otaInterfaces.mqtt.publish = mockMqttPublishCountStreamRequests;
+        otaInterfaces.http.requestWithContext = mockHttpRequestWithContextRecordRange;
+        otaGoToState( OtaAgentStateWaitingForFileBlock );
+        TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+        /* Without any throughput observed yet, the blocks are split evenly and HTTP requests its
+         * blocks as one range. */
+        TEST_ASSERT_EQUAL( 1, streamRequestCount );
+        TEST_ASSERT_EQUAL( 1, httpRequestCount );
+        TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE, httpRangeStart );
+        TEST_ASSERT_EQUAL( OTA_TEST_FILE_SIZE - 1, httpRangeEnd );
+
+        otaInterfaces.os.event.send = mockOSEventSend;
+
+        for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+        {
+            pFileBlock[ idx ] = idx % UINT8_MAX;
+        }
+
+        /* The first block over MQTT. */
+        createOtaStreammingMessage(
+            pStreamingMessage,
+            sizeof( pStreamingMessage ),
+            0,
+            pFileBlock,
+            OTA_FILE_BLOCK_SIZE,
+            &streamingMessageSize );
+
+        otaEvent.eventId = OtaAgentEventReceivedFileBlock;
+        otaEvent.pEventData = &eventBuffers[ 0 ];
+        memcpy( otaEvent.pEventData->data, pStreamingMessage, streamingMessageSize );
+        otaEvent.pEventData->dataLength = streamingMessageSize;
+        OTA_SignalEvent( &otaEvent );
+
+        /* The other blocks over HTTP, told apart by the context id. */
+        otaReceiveHttpContextBlock( &eventBuffers[ 1 ], pHttpRequestContextIds[ 0 ], pFileBlock, OTA_FILE_BLOCK_SIZE );
+        otaReceiveHttpContextBlock( &eventBuffers[ 2 ], pHttpRequestContextIds[ 0 ], pFileBlock, lastBlockSize );
+
+        otaWaitForState( OtaAgentStateWaitingForJob );
+        TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+        /* Check if received complete file. */
+        for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+        {
+            TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+        }
+
+        /* Each protocol was only requested again once it delivered the blocks of its request. */
+        TEST_ASSERT_EQUAL( 1, streamRequestCount );
+        TEST_ASSERT_EQUAL( 1, httpRequestCount );
+    #else
+        TEST_IGNORE_MESSAGE( "Hybrid data transfer is disabled." );
+    #endif
+}
+
+void test_OTA_ReceiveFileBlockHybridSplitByThroughput()
+{
+    #if ( otaconfigENABLE_HYBRID_DATA_TRANSFER == 1U )
+        OtaEventMsg_t otaEvent = { 0 };
+        OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_BLOCKS ];
+        uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+        int lastBlockSize = OTA_TEST_FILE_SIZE - ( OTA_TEST_FILE_NUM_BLOCKS - 1 ) * OTA_FILE_BLOCK_SIZE;
+        int idx = 0;
+
+        pOtaJobDoc = JOB_DOC_HYBRID;
+        otaInterfaces.mqtt.publish = mockMqttPublishCountStreamRequests;
+        otaInterfaces.http.requestWithContext = mockHttpRequestWithContextRecordRange;
+        otaInterfaces.os.timer.getTimeMs = mockOSGetTimeMs;
+        otaGoToState( OtaAgentStateWaitingForFileBlock );
+        TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+        TEST_ASSERT_EQUAL( 1, streamRequestCount );
+        TEST_ASSERT_EQUAL( 1, httpRequestCount );
+
+        otaInterfaces.os.event.send = mockOSEventSend;
+
+        for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+        {
+            pFileBlock[ idx ] = idx % UINT8_MAX;
+        }
+
+        /* HTTP delivers its range quickly. */
+        mockTimeMs = 10;
+        otaReceiveHttpContextBlock( &eventBuffers[ 1 ], pHttpRequestContextIds[ 0 ], pFileBlock, OTA_FILE_BLOCK_SIZE );
+        otaReceiveHttpContextBlock( &eventBuffers[ 2 ], pHttpRequestContextIds[ 0 ], pFileBlock, lastBlockSize );
+        otaWaitForEmptyEvent();
+
+        /* The block left is in flight over MQTT, so HTTP is not requested again. */
+        TEST_ASSERT_EQUAL( 1, httpRequestCount );
+
+        /* MQTT did not deliver anything until the request timed out, so the block left goes to
+         * HTTP, which is faster. */
+        mockTimeMs = otaconfigFILE_REQUEST_WAIT_MS;
+        otaEvent.eventId = OtaAgentEventRequestTimer;
+        OTA_SignalEvent( &otaEvent );
+        otaWaitForEmptyEvent();
+
+        TEST_ASSERT_EQUAL( 1, streamRequestCount );
+        TEST_ASSERT_EQUAL( 2, httpRequestCount );
+        TEST_ASSERT_EQUAL( 0, httpRangeStart );
+        TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE - 1, httpRangeEnd );
+
+        otaReceiveHttpContextBlock( &eventBuffers[ 0 ], pHttpRequestContextIds[ 1 ], pFileBlock, OTA_FILE_BLOCK_SIZE );
+        otaWaitForState( OtaAgentStateWaitingForJob );
+        TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+        /* Check if received complete file. */
+        for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+        {
+            TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+        }
+    #else
+        TEST_IGNORE_MESSAGE( "Hybrid data transfer is disabled." );
+    #endif
+}
+
+/* Pass a chunk of file data at the file offset to the OTA agent. */
+static void otaReceiveFileChunk( OtaFileChunkEventData_t * pEventBuffer,
+                                 uint32_t offset,
+                                 const uint8_t * pFileBlock,
+                                 uint32_t chunkSize )
+{
+    OtaEventMsg_t otaEvent;
+    uint32_t idx = 0;
+
+    pEventBuffer->data[ 0 ] = ( uint8_t ) ( offset >> 24 );
+    pEventBuffer->data[ 1 ] = ( uint8_t ) ( offset >> 16 );
+    pEventBuffer->data[ 2 ] = ( uint8_t ) ( offset >> 8 );
+    pEventBuffer->data[ 3 ] = ( uint8_t ) offset;
+
+    for( idx = 0; idx < chunkSize; idx++ )
+    {
+        pEventBuffer->data[ OTA_FILE_CHUNK_OFFSET_SIZE + idx ] = pFileBlock[ ( offset + idx ) % OTA_FILE_BLOCK_SIZE ];
+    }
+
+    pEventBuffer->dataLength = OTA_FILE_CHUNK_OFFSET_SIZE + chunkSize;
+
+    otaEvent.eventId = OtaAgentEventReceivedFileChunk;
+    otaEvent.pEventData = ( OtaEventData_t * ) ( void * ) pEventBuffer;
+    OTA_SignalEvent( &otaEvent );
+}
+
+void test_OTA_ReceiveFileChunksHttp()
+{
+    /* The end of the first range splits one of the chunks in two. */
+    OtaFileChunkEventData_t eventBuffers[ OTA_TEST_FILE_NUM_CHUNKS + 1 ];
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint32_t rangeSize = otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST * OTA_FILE_BLOCK_SIZE;
+    uint32_t offset = 0;
+    int idx = 0;
+
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaInterfaces.http.request = mockHttpRequestRecordRange;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+    TEST_ASSERT_EQUAL( 1, httpRequestCount );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+    {
+        pFileBlock[ idx ] = idx % UINT8_MAX;
+    }
+
+    /* Receive the first range in chunks that are not aligned to the blocks, except for its
+     * last chunk. The next range is only requested once every block of the range is complete. */
+    idx = 0;
+
+    while( offset + OTA_TEST_CHUNK_SIZE < rangeSize )
+    {
+        otaReceiveFileChunk( &eventBuffers[ idx++ ], offset, pFileBlock, OTA_TEST_CHUNK_SIZE );
+        offset += OTA_TEST_CHUNK_SIZE;
+    }
+
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( 1, httpRequestCount );
+
+    otaReceiveFileChunk( &eventBuffers[ idx++ ], offset, pFileBlock, rangeSize - offset );
+    offset = rangeSize;
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( 2, httpRequestCount );
+    TEST_ASSERT_EQUAL( rangeSize, httpRangeStart );
+
+    /* Receive the rest of the file. */
+    while( offset < OTA_TEST_FILE_SIZE )
+    {
+        otaReceiveFileChunk( &eventBuffers[ idx++ ], offset, pFileBlock, min( OTA_TEST_CHUNK_SIZE, OTA_TEST_FILE_SIZE - offset ) );
+        offset += OTA_TEST_CHUNK_SIZE;
+    }
+
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+    /* Check if received complete file. */
+    for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+    {
+        TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+    }
+}
+
+void test_OTA_ReceiveFileChunkTooLarge()
+{
+    OtaFileChunkEventData_t eventBuffer = { 0 };
+    OtaEventMsg_t otaEvent = { 0 };
+    OtaAgentStatistics_t statistics = { 0 };
+
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    /* A chunk longer than its buffer is rejected instead of being read past the buffer. */
+    eventBuffer.dataLength = OTA_FILE_CHUNK_EVENT_SIZE + 1U;
+    otaEvent.eventId = OtaAgentEventReceivedFileChunk;
+    otaEvent.pEventData = ( OtaEventData_t * ) ( void * ) &eventBuffer;
+    OTA_SignalEvent( &otaEvent );
+    otaWaitForState( OtaAgentStateWaitingForJob );
+
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+    TEST_ASSERT_EQUAL( OtaErrNone, OTA_GetStatistics( &statistics ) );
+    TEST_ASSERT_EQUAL( 0, statistics.otaPacketsProcessed );
+}
+
+/* Write a chunk of file data to the file like a zero-copy data plane and pass its offset and
+ * length to the OTA agent. */
+static void otaReceiveWrittenFileChunk( OtaEventData_t * pEventBuffer,
+                                        uint32_t offset,
+                                        const uint8_t * pFileBlock,
+                                        uint32_t chunkSize )
+{
+    OtaEventMsg_t otaEvent;
+    uint32_t idx = 0;
+
+    for( idx = 0; idx < chunkSize; idx++ )
+    {
+        pOtaFileBuffer[ offset + idx ] = pFileBlock[ ( offset + idx ) % OTA_FILE_BLOCK_SIZE ];
+    }
+
+    pEventBuffer->data[ 0 ] = ( uint8_t ) ( offset >> 24 );
+    pEventBuffer->data[ 1 ] = ( uint8_t ) ( offset >> 16 );
+    pEventBuffer->data[ 2 ] = ( uint8_t ) ( offset >> 8 );
+    pEventBuffer->data[ 3 ] = ( uint8_t ) offset;
+    pEventBuffer->data[ 4 ] = ( uint8_t ) ( chunkSize >> 24 );
+    pEventBuffer->data[ 5 ] = ( uint8_t ) ( chunkSize >> 16 );
+    pEventBuffer->data[ 6 ] = ( uint8_t ) ( chunkSize >> 8 );
+    pEventBuffer->data[ 7 ] = ( uint8_t ) chunkSize;
+    pEventBuffer->dataLength = OTA_FILE_CHUNK_WRITTEN_SIZE;
+
+    otaEvent.eventId = OtaAgentEventFileChunkWritten;
+    otaEvent.pEventData = pEventBuffer;
+    OTA_SignalEvent( &otaEvent );
+}
+
+void test_OTA_ReceiveWrittenFileChunksHttp()
+{
+    OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_CHUNKS ];
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    OtaAgentStatistics_t statistics = { 0 };
+    uint32_t offset = 0;
+    int idx = 0;
+
+    /* The data is already in the file, so it must not be written by the PAL again. */
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaInterfaces.pal.writeBlock = mockPalWriteBlockAlwaysFail;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+    {
+        pFileBlock[ idx ] = idx % UINT8_MAX;
+    }
+
+    /* Chunks that are not aligned to the blocks complete the blocks once all their bytes are written. */
+    idx = 0;
+
+    while( offset < OTA_TEST_FILE_SIZE )
+    {
+        otaReceiveWrittenFileChunk( &eventBuffers[ idx++ ], offset, pFileBlock, min( OTA_TEST_CHUNK_SIZE, OTA_TEST_FILE_SIZE - offset ) );
+        offset += OTA_TEST_CHUNK_SIZE;
+    }
+
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+    /* Every chunk is accepted and the last one completes the file. */
+    TEST_ASSERT_EQUAL( OtaErrNone, OTA_GetStatistics( &statistics ) );
+    TEST_ASSERT_EQUAL( idx, statistics.otaPacketsProcessed );
+    TEST_ASSERT_EQUAL( 0, statistics.otaPacketsDropped );
+}
+
+void test_OTA_ReceiveWrittenFileChunkInvalidSize()
+{
+    OtaEventData_t eventBuffer;
+    OtaEventMsg_t otaEvent;
+
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    /* A written chunk event without the length rejects the update. */
+    ( void ) memset( eventBuffer.data, 0, OTA_FILE_CHUNK_OFFSET_SIZE );
+    eventBuffer.dataLength = OTA_FILE_CHUNK_OFFSET_SIZE;
+    otaEvent.eventId = OtaAgentEventFileChunkWritten;
+    otaEvent.pEventData = &eventBuffer;
+    OTA_SignalEvent( &otaEvent );
+
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+}
+
+void test_OTA_ReceiveFileChunkOutsideFile()
+{
+    OtaEventData_t eventBuffer;
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+
+    pOtaJobDoc = JOB_DOC_HTTP;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    /* A chunk that ends past the end of the file rejects the update. */
+    otaReceiveFileChunk( &eventBuffer, OTA_TEST_FILE_SIZE - 1, pFileBlock, 2 );
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+}
+
+/* CoAP server stand-in that answers the Block2 requests of the last CoAP request, each with a
+ * Block2 response whose payload is passed as a file chunk. Returns the number of events sent. */
+static uint32_t otaServeCoapBlocks( OtaEventData_t * pEventBuffers,
+                                    const uint8_t * pFileBlock )
+{
+    uint32_t blockSize = 1U << ( coapBlockSzx + 4U );
+    uint32_t option = 0;
+    uint32_t offset = 0;
+    uint32_t idx = 0;
+
+    for( idx = 0; idx < coapNumBlocks; idx++ )
+    {
+        option = ( ( coapBlockNumber + idx ) << 4U ) | coapBlockSzx;
+        offset = OTA_COAP_BLOCK2_OFFSET( option );
+
+        if( offset + blockSize < OTA_TEST_FILE_SIZE )
+        {
+            /* More blocks follow this one. */
+            option |= 1U << 3U;
+        }
+
+        TEST_ASSERT_EQUAL( coapBlockNumber + idx, OTA_COAP_BLOCK2_NUM( option ) );
+        TEST_ASSERT_LESS_THAN( OTA_TEST_FILE_SIZE, offset );
+        otaReceiveFileChunk( &pEventBuffers[ idx ], offset, pFileBlock,
+                             ( OTA_COAP_BLOCK2_MORE( option ) == 1U ) ? blockSize : OTA_TEST_FILE_SIZE - offset );
+    }
+
+    return coapNumBlocks;
+}
+
+void test_OTA_ReceiveFileBlockCompleteCoap()
+{
+    OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_COAP_BLOCKS ];
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint32_t blockIndex = 0;
+    uint32_t eventIndex = 0;
+    int idx = 0;
+
+    pOtaJobDoc = JOB_DOC_COAP;
+    otaInterfaces.coap.request = mockCoapRequestRecordBlocks;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+    {
+        pFileBlock[ idx ] = idx % UINT8_MAX;
+    }
+
+    /* Every file block is requested in Block2 transfers of the largest CoAP block size. The
+     * next file block is only requested once all CoAP blocks of the previous one are received. */
+    for( blockIndex = 0; blockIndex < OTA_TEST_FILE_NUM_BLOCKS; blockIndex++ )
+    {
+        TEST_ASSERT_EQUAL( blockIndex + 1, coapRequestCount );
+        TEST_ASSERT_EQUAL( blockIndex * OTA_FILE_BLOCK_SIZE / OTA_TEST_COAP_BLOCK_SIZE, coapBlockNumber );
+        TEST_ASSERT_EQUAL( OTA_TEST_COAP_BLOCK_SZX, coapBlockSzx );
+
+        if( blockIndex < OTA_TEST_FILE_NUM_BLOCKS - 1 )
+        {
+            TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE / OTA_TEST_COAP_BLOCK_SIZE, coapNumBlocks );
+        }
+        else
+        {
+            /* The last file block is shorter than a full block. */
+            TEST_ASSERT_EQUAL( OTA_TEST_FILE_NUM_COAP_BLOCKS - coapBlockNumber, coapNumBlocks );
+        }
+
+        eventIndex += otaServeCoapBlocks( &eventBuffers[ eventIndex ], pFileBlock );
+        otaWaitForEmptyEvent();
+    }
+
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+    TEST_ASSERT_EQUAL( OTA_TEST_FILE_NUM_BLOCKS, coapRequestCount );
+
+    /* Check if received complete file. */
+    for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+    {
+        TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+    }
+}
+
+void test_OTA_ReceiveFileBlockTimeoutCoap()
+{
+    OtaEventMsg_t otaEvent = { 0 };
+    OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_COAP_BLOCKS ];
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+
+    pOtaJobDoc = JOB_DOC_COAP;
+    otaInterfaces.coap.request = mockCoapRequestRecordBlocks;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+    TEST_ASSERT_EQUAL( 1, coapRequestCount );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    /* Only the first CoAP blocks of the first file block arrive, then the responses stall. */
+    otaReceiveFileChunk( &eventBuffers[ 0 ], 0, pFileBlock, OTA_TEST_COAP_BLOCK_SIZE );
+    otaReceiveFileChunk( &eventBuffers[ 1 ], OTA_TEST_COAP_BLOCK_SIZE, pFileBlock, OTA_TEST_COAP_BLOCK_SIZE );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( 1, coapRequestCount );
+
+    /* The incomplete file block is requested again from its first CoAP block. */
+    otaEvent.eventId = OtaAgentEventRequestTimer;
+    OTA_SignalEvent( &otaEvent );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( 2, coapRequestCount );
+    TEST_ASSERT_EQUAL( 0, coapBlockNumber );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE / OTA_TEST_COAP_BLOCK_SIZE, coapNumBlocks );
+
+    otaServeCoapBlocks( &eventBuffers[ 2 ], pFileBlock );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( 3, coapRequestCount );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE / OTA_TEST_COAP_BLOCK_SIZE, coapBlockNumber );
+}
+
+void test_OTA_RequestFileBlockCoapRetryFail()
+{
+    pOtaJobDoc = JOB_DOC_COAP;
+
+    otaGoToState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+    /* Let coap request fail so request file block will also fail. */
+    otaInterfaces.coap.request = mockCoapRequestAlwaysFail;
+
+    /* Let timer invoke callback directly. */
+    otaInterfaces.os.timer.start = mockOSTimerInvokeCallback;
+
+    /* Allow event to be sent continuously so that retries can work. */
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    otaReceiveJobDocument();
+    otaWaitForState( OtaAgentStateRequestingFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateRequestingFileBlock, OTA_GetState() );
+    otaWaitForState( OtaAgentStateStopped );
+    TEST_ASSERT_EQUAL( OtaAgentStateStopped, OTA_GetState() );
+}
+
+void test_OTA_ReceiveFileBlockRejectedCoap()
+{
+    OtaEventMsg_t otaEvent = { 0 };
+    OtaEventData_t eventBuffer;
+
+    pOtaJobDoc = JOB_DOC_COAP;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    /* The payload of Block2 responses is only accepted as file chunks. */
+    memset( eventBuffer.data, 0, OTA_TEST_COAP_BLOCK_SIZE );
+    eventBuffer.dataLength = OTA_TEST_COAP_BLOCK_SIZE;
+    otaEvent.eventId = OtaAgentEventReceivedFileBlock;
+    otaEvent.pEventData = &eventBuffer;
+    OTA_SignalEvent( &otaEvent );
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+}
+
+void test_OTA_ProbeSelectsFasterProtocol()
+{
+    #if ( otaconfigENABLE_DATA_PROTOCOL_PROBE == 1U )
+        OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_CHUNKS ];
+        uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+        uint32_t rangeSize = otaconfigHTTP_MAX_NUM_BLOCKS_REQUEST * OTA_FILE_BLOCK_SIZE;
+        uint32_t offset = 0;
+        int idx = 0;
+
+        pOtaJobDoc = JOB_DOC_HTTP_COAP;
+        otaInterfaces.os.timer.getTimeMs = mockOSGetTimeMs;
+        otaInterfaces.pal.saveProbeResult = mockPalSaveProbeResult;
+        otaInterfaces.http.request = mockHttpRequestRecordRange;
+        otaInterfaces.coap.request = mockCoapRequestRecordBlocks;
+
+        /* HTTP is measured first as the job does not offer the primary protocol. */
+        otaGoToState( OtaAgentStateWaitingForFileBlock );
+        TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+        TEST_ASSERT_EQUAL( 1, httpRequestCount );
+        TEST_ASSERT_EQUAL( 0, coapRequestCount );
+
+        otaInterfaces.os.event.send = mockOSEventSend;
+
+        for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+        {
+            pFileBlock[ idx ] = idx % UINT8_MAX;
+        }
+
+        /* The first range arrives over HTTP after 400 ms, then the rest of the file is
+         * requested over CoAP. */
+        mockTimeMs = 400;
+        idx = 0;
+
+        while( offset < rangeSize )
+        {
+            otaReceiveFileChunk( &eventBuffers[ idx++ ], offset, pFileBlock, min( OTA_TEST_CHUNK_SIZE, rangeSize - offset ) );
+            offset += OTA_TEST_CHUNK_SIZE;
+        }
+
+        otaWaitForEmptyEvent();
+        TEST_ASSERT_EQUAL( 1, httpRequestCount );
+        TEST_ASSERT_EQUAL( 1, coapRequestCount );
+        TEST_ASSERT_EQUAL( rangeSize / OTA_TEST_COAP_BLOCK_SIZE, coapBlockNumber );
+
+        /* The last block arrives over CoAP 100 ms later, CoAP is faster. */
+        mockTimeMs = 500;
+        otaServeCoapBlocks( &eventBuffers[ idx ], pFileBlock );
+
+        otaWaitForState( OtaAgentStateWaitingForJob );
+        TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+        TEST_ASSERT_EQUAL( OTA_DATA_OVER_COAP, savedProbeResult.protocol );
+        TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE * 1000 / 100, savedProbeResult.bytesPerSecond );
+        TEST_ASSERT_EQUAL( 100, savedProbeResult.latencyMs );
+
+        /* Check if received complete file. */
+        for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+        {
+            TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+        }
+    #else
+        TEST_IGNORE_MESSAGE( "Data protocol probing is disabled." );
+    #endif
+}
+
+void test_OTA_ProbeUsesStoredResult()
+{
+    #if ( otaconfigENABLE_DATA_PROTOCOL_PROBE == 1U )
+        pOtaJobDoc = JOB_DOC_HTTP_COAP;
+        otaInterfaces.os.timer.getTimeMs = mockOSGetTimeMs;
+        otaInterfaces.pal.loadProbeResult = mockPalLoadProbeResultCoap;
+        otaInterfaces.http.request = mockHttpRequestRecordRange;
+        otaInterfaces.coap.request = mockCoapRequestRecordBlocks;
+
+        /* The protocol measured fastest before the reboot is used without measuring again. */
+        otaGoToState( OtaAgentStateWaitingForFileBlock );
+        TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+        TEST_ASSERT_EQUAL( 0, httpRequestCount );
+        TEST_ASSERT_EQUAL( 1, coapRequestCount );
+        TEST_ASSERT_EQUAL( 0, coapBlockNumber );
+    #else
+        TEST_IGNORE_MESSAGE( "Data protocol probing is disabled." );
+    #endif
+}
+
+static void receiveFileBlocksRecordProgress()
+{
+    OtaEventMsg_t otaEvent;
+    OtaEventData_t eventBuffers[ OTA_TEST_FILE_NUM_BLOCKS ];
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t pStreamingMessage[ OTA_FILE_BLOCK_SIZE * 2 ] = { 0 };
+    size_t streamingMessageSize = 0;
+    int remainingBytes = OTA_TEST_FILE_SIZE;
+    int idx = 0;
+
+    pOtaJobDoc = JOB_DOC_A;
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.mqtt.publish = mockMqttPublishRecordProgress;
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    while( remainingBytes >= 0 )
+    {
+        createOtaStreammingMessage(
+            pStreamingMessage,
+            sizeof( pStreamingMessage ),
+            idx,
+            pFileBlock,
+            min( remainingBytes, OTA_FILE_BLOCK_SIZE ),
+            &streamingMessageSize );
+
+        otaEvent.eventId = OtaAgentEventReceivedFileBlock;
+        otaEvent.pEventData = &eventBuffers[ idx ];
+        memcpy( otaEvent.pEventData->data, pStreamingMessage, streamingMessageSize );
+        otaEvent.pEventData->dataLength = streamingMessageSize;
+        OTA_SignalEvent( &otaEvent );
+
+        /* The progress is reported by an event queued behind the block, let it be handled
+         * before the next block arrives. */
+        otaWaitForEmptyEvent();
+
+        idx++;
+        remainingBytes -= OTA_FILE_BLOCK_SIZE;
+    }
+
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+}
+
+void test_OTA_ReceiveFileBlockProgressRateLimited()
+{
+    char pExpected[ 32 ];
+
+    /* The progress timer never expires, so only the first block is reported. */
+    receiveFileBlocksRecordProgress();
+
+    snprintf( pExpected, sizeof( pExpected ), "\"receive\":\"1/%d\"}}", OTA_TEST_FILE_NUM_BLOCKS );
+    TEST_ASSERT_EQUAL( 1, progressUpdateCount );
+    TEST_ASSERT_NOT_NULL( strstr( pLastProgressUpdate, pExpected ) );
+}
+
+void test_OTA_ReceiveFileBlockProgressIntervalElapsed()
+{
+    char pExpected[ 32 ];
+
+    /* Every block past the minimum progress is reported once the interval elapses. The last
+     * block completes the file and is reported with the signature check result instead. */
+    otaInterfaces.os.timer.start = mockOSTimerExpireProgress;
+    receiveFileBlocksRecordProgress();
+
+    snprintf( pExpected, sizeof( pExpected ), "\"receive\":\"%d/%d\"}}", OTA_TEST_FILE_NUM_BLOCKS - 1, OTA_TEST_FILE_NUM_BLOCKS );
+    TEST_ASSERT_EQUAL( OTA_TEST_FILE_NUM_BLOCKS - 1, progressUpdateCount );
+    TEST_ASSERT_NOT_NULL( strstr( pLastProgressUpdate, pExpected ) );
+}
+
+void test_OTA_ReceiveFileBlockPassiveSharedStream()
+{
+    #if ( otaconfigENABLE_PASSIVE_STREAM_LISTEN == 1U )
+        OtaEventMsg_t otaEvent;
+        OtaEventData_t eventBuffers[ otaconfigMAX_NUM_BLOCKS_REQUEST + 2 * OTA_TEST_FILE_NUM_BLOCKS ];
+        uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+        uint8_t pStreamingMessage[ OTA_FILE_BLOCK_SIZE * 2 ] = { 0 };
+        size_t streamingMessageSize = 0;
+        int blockIdx = 0;
+        int eventIdx = 0;
+        int idx = 0;
+
+        pOtaJobDoc = JOB_DOC_A;
+        otaGoToState( OtaAgentStateWaitingForFileBlock );
+        TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+        /* From now on, only count the requests sent by this device. Every block below is sent in
+         * response to the requests of other devices subscribed to the same stream. */
+        otaInterfaces.mqtt.publish = mockMqttPublishCountStreamRequests;
+        otaInterfaces.os.timer.start = mockOSTimerStartRecordHoldoff;
+        otaInterfaces.os.event.send = mockOSEventSend;
+
+        for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+        {
+            pFileBlock[ idx ] = idx % UINT8_MAX;
+        }
+
+        /* Blocks of another file in the same stream are ignored without failing the update. They
+         * do not count as blocks of our own request, so its hold-off is not started. */
+        for( idx = 0; idx < otaconfigMAX_NUM_BLOCKS_REQUEST; idx++ )
+        {
+            createOtaStreammingMessageForFile(
+                pStreamingMessage,
+                sizeof( pStreamingMessage ),
+                CBOR_TEST_FILEIDENTITY_VALUE + 1,
+                idx,
+                pFileBlock,
+                OTA_FILE_BLOCK_SIZE,
+                &streamingMessageSize );
+
+            otaEvent.eventId = OtaAgentEventReceivedFileBlock;
+            otaEvent.pEventData = &eventBuffers[ eventIdx++ ];
+            memcpy( otaEvent.pEventData->data, pStreamingMessage, streamingMessageSize );
+            otaEvent.pEventData->dataLength = streamingMessageSize;
+            OTA_SignalEvent( &otaEvent );
+        }
+
+        otaWaitForEmptyEvent();
+        TEST_ASSERT_EQUAL( 0, passiveHoldoffMs );
+
+        /* Blocks of our file requested by other devices, all but the last one twice. The
+         * duplicates complete our own request, so our next request waits for the hold-off. */
+        for( idx = 0; idx < 2 * OTA_TEST_FILE_NUM_BLOCKS - 1; idx++ )
+        {
+            blockIdx = idx / 2;
+
+            createOtaStreammingMessage(
+                pStreamingMessage,
+                sizeof( pStreamingMessage ),
+                blockIdx,
+                pFileBlock,
+                min( OTA_TEST_FILE_SIZE - blockIdx * OTA_FILE_BLOCK_SIZE, OTA_FILE_BLOCK_SIZE ),
+                &streamingMessageSize );
+
+            otaEvent.eventId = OtaAgentEventReceivedFileBlock;
+            otaEvent.pEventData = &eventBuffers[ eventIdx++ ];
+            memcpy( otaEvent.pEventData->data, pStreamingMessage, streamingMessageSize );
+            otaEvent.pEventData->dataLength = streamingMessageSize;
+            OTA_SignalEvent( &otaEvent );
+        }
+
+        otaWaitForState( OtaAgentStateWaitingForJob );
+        TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+        /* The whole file was received from the shared stream without any further request. */
+        for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+        {
+            TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+        }
+
+        TEST_ASSERT_EQUAL( 0, streamRequestCount );
+
+        /* Our own request was deferred by the jittered hold-off. */
+        TEST_ASSERT_GREATER_OR_EQUAL( otaconfigPASSIVE_REQUEST_HOLDOFF_MS, passiveHoldoffMs );
+        TEST_ASSERT_LESS_OR_EQUAL( otaconfigPASSIVE_REQUEST_HOLDOFF_MS + otaconfigPASSIVE_REQUEST_JITTER_MS, passiveHoldoffMs );
+    #else
+        TEST_IGNORE_MESSAGE( "Passive stream listening is disabled." );
+    #endif
+}
+
+void test_OTA_RequestFileBlockMqttTopicAlias()
+{
+    OtaEventMsg_t otaEvent = { 0 };
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t pStreamingMessage[ OTA_FILE_BLOCK_SIZE * 2 ] = { 0 };
+    size_t streamingMessageSize = 0;
+    int idx = 0;
+
+    pOtaJobDoc = JOB_DOC_A;
+    otaInterfaces.mqtt.publishWithProperties = mockMqttPublishWithTopicAlias;
+
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    /* Retry the request until just before the momentum limit is reached. */
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    for( idx = 1; idx < otaconfigMAX_NUM_REQUEST_MOMENTUM; idx++ )
+    {
+        otaEvent.eventId = OtaAgentEventRequestFileBlock;
+        OTA_SignalEvent( &otaEvent );
+    }
+
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    /* Only the first request sends the topic, the following requests only send the alias. */
+    TEST_ASSERT_EQUAL( otaconfigMAX_NUM_REQUEST_MOMENTUM, streamRequestCount );
+    TEST_ASSERT_GREATER_THAN( 0, streamRequestTopicLen );
+    TEST_ASSERT_EQUAL( streamRequestTopicLen, streamRequestTopicBytes );
+
+    /* Stream replies are directed to the data topic. */
+    TEST_ASSERT_NOT_NULL( strstr( pStreamResponseTopic, "/streams/" ) );
+    TEST_ASSERT_EQUAL( strlen( pStreamResponseTopic ) - strlen( "/data/cbor" ),
+                       strstr( pStreamResponseTopic, "/data/cbor" ) - pStreamResponseTopic );
+
+    /* The first block is reported in a job status update. */
+    createOtaStreammingMessage( pStreamingMessage,
+                                sizeof( pStreamingMessage ),
+                                0,
+                                pFileBlock,
+                                OTA_FILE_BLOCK_SIZE,
+                                &streamingMessageSize );
+
+    otaEvent.eventId = OtaAgentEventReceivedFileBlock;
+    otaEvent.pEventData = &eventBuffer;
+    memcpy( otaEvent.pEventData->data, pStreamingMessage, streamingMessageSize );
+    otaEvent.pEventData->dataLength = streamingMessageSize;
+    OTA_SignalEvent( &otaEvent );
+    otaWaitForEmptyEvent();
+
+    /* The job status updates use their own alias. */
+    TEST_ASSERT_NOT_NULL( strstr( pAliasTopics[ otaconfigMQTT_TOPIC_ALIAS_JOB_STATUS ], "/update" ) );
+}
+
+static void invokeSelfTestHandler()
+{
+    pOtaJobDoc = JOB_DOC_SELF_TEST;
+
+    /* Set the event send interface to a mock function that allows events to be sent continuously.
+     * This is to complete the self test process. */
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    otaGoToState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+    otaReceiveJobDocument();
+    otaWaitForState( OtaAgentStateCreatingFile );
+    otaWaitForState( OtaAgentStateWaitingForJob );
+}
+
+void test_OTA_SelfTestJob()
+{
+    invokeSelfTestHandler();
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+    TEST_ASSERT_EQUAL( OtaImageStateAccepted, OTA_GetImageState() );
+}
+
+void test_OTA_SelfTestJobNonSelfTestPlatform()
+{
+    /* Let the PAL always says it's not in self test. */
+    otaInterfaces.pal.getPlatformImageState = mockPalGetPlatformImageStateAlwaysInvalid;
+
+    invokeSelfTestHandler();
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+    TEST_ASSERT_EQUAL( OtaImageStateRejected, OTA_GetImageState() );
+}
+
+void test_OTA_NonSelfTestJobSelfTestPlatform()
+{
+    /* Let the PAL always says it's in self test. */
+    otaInterfaces.pal.getPlatformImageState = mockPalGetPlatformImageStateAlwaysPendingCommit;
+
+    otaGoToState( OtaAgentStateCreatingFile );
+    TEST_ASSERT_EQUAL( OtaAgentStateCreatingFile, OTA_GetState() );
+}
+
+void test_OTA_SelfTestJobDowngrade()
+{
+    pOtaJobDoc = JOB_DOC_SELF_TEST_DOWNGRADE;
+
+    otaGoToState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+    otaReceiveJobDocument();
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( true, resetCalled );
+}
+
+void test_OTA_StartWithSelfTest()
+{
+    /* Directly set pal image state to pending commit, pretending we're in self test. */
+    palImageState = OtaPalImageStatePendingCommit;
+
+    /* Let timer start to invoke callback directly. */
+    otaInterfaces.os.timer.start = mockOSTimerInvokeCallback;
+
+    /* Start OTA agent. */
+    otaGoToState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+    TEST_ASSERT_EQUAL( true, resetCalled );
+}
+
+void test_OTA_ReceiveNewJobDocWhileInProgress()
+{
+    pOtaJobDoc = JOB_DOC_A;
+
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    /* Reset the event queue so that we can send the next event. */
+    mockOSEventReset( NULL );
+
+    /* Sending another job document should cause OTA agent to abort current update. */
+    pOtaJobDoc = JOB_DOC_B;
+    otaReceiveJobDocument();
+    otaWaitForState( OtaAgentStateRequestingJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateRequestingJob, OTA_GetState() );
+}
+
+void test_OTA_ReceiveSameJobDocWhileInProgress()
+{
+    pOtaJobDoc = JOB_DOC_A;
+
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    /* Reset the event queue so that we can send the next event. */
+    mockOSEventReset( NULL );
+
+    /* Sending the job document of the active job again should not abort the update. */
+    otaReceiveJobDocument();
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+}
+
+static void refreshWithJobDoc( const char * initJobDoc,
+                               const char * newJobDoc )
+{
+    OtaEventMsg_t otaEvent = { 0 };
 
     pOtaJobDoc = initJobDoc;
 
@@ -1497,6 +3039,36 @@ void test_OTA_RefreshWithSameJobDocHttpDynamicBuffer()
     refreshWithJobDoc( JOB_DOC_HTTP, JOB_DOC_HTTP );
 }
 
+void test_OTA_RefreshWithSameJobDocKeepsBlocks()
+{
+    OtaEventMsg_t otaEvent = { 0 };
+    OtaEventData_t blockBuffer;
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    OtaAgentStatistics_t statistics = { 0 };
+
+    pOtaJobDoc = JOB_DOC_HTTP;
+
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    otaReceiveHttpBlock( &blockBuffer, 0, pFileBlock, OTA_FILE_BLOCK_SIZE );
+    otaWaitForEmptyEvent();
+
+    otaEvent.eventId = OtaAgentEventRequestJobDocument;
+    OTA_SignalEvent( &otaEvent );
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+    /* The same job document continues the transfer instead of starting it over. */
+    otaReceiveJobDocument();
+    otaWaitForState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+    TEST_ASSERT_EQUAL( OtaErrNone, OTA_GetStatistics( &statistics ) );
+    TEST_ASSERT_EQUAL( 1, statistics.otaPacketsProcessed );
+}
+
 void test_OTA_UnexpectedEventReceiveJobDoc()
 {
     OtaEventMsg_t otaEvent = { 0 };
@@ -1539,6 +3111,86 @@ void test_OTA_UnexpectedEventOthers()
     TEST_ASSERT_EQUAL( OtaAgentStateSuspended, OTA_GetState() );
 }
 
+/* Send a stream response of the multi-block extension with the blocks of pBlockIndices. */
+static void otaReceiveMultiBlockResponse( OtaEventData_t * pEventBuffer,
+                                          const int * pBlockIndices,
+                                          const size_t * pBlockSizes,
+                                          size_t numBlocks,
+                                          uint8_t * pFileBlock )
+{
+    OtaEventMsg_t otaEvent = { 0 };
+    size_t streamingMessageSize = 0;
+
+    TEST_ASSERT_EQUAL( CborNoError, createOtaMultiBlockStreamingMessage( pEventBuffer->data,
+                                                                         sizeof( pEventBuffer->data ),
+                                                                         pBlockIndices,
+                                                                         pBlockSizes,
+                                                                         numBlocks,
+                                                                         pFileBlock,
+                                                                         &streamingMessageSize ) );
+
+    otaEvent.eventId = OtaAgentEventReceivedFileBlock;
+    otaEvent.pEventData = pEventBuffer;
+    otaEvent.pEventData->dataLength = streamingMessageSize;
+    OTA_SignalEvent( &otaEvent );
+}
+
+void test_OTA_ReceiveMultiBlockStreamResponse()
+{
+    OtaEventData_t eventBuffers[ 2 ];
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    int pFirstBlocks[] = { 0, 1 };
+    size_t pFirstSizes[] = { OTA_FILE_BLOCK_SIZE, OTA_FILE_BLOCK_SIZE };
+    int pLastBlocks[] = { 1, 2 };
+    size_t pLastSizes[] = { OTA_FILE_BLOCK_SIZE, OTA_TEST_FILE_SIZE - 2 * OTA_FILE_BLOCK_SIZE };
+    int idx = 0;
+
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+    {
+        pFileBlock[ idx ] = idx % UINT8_MAX;
+    }
+
+    /* Two blocks are ingested with one event. */
+    otaReceiveMultiBlockResponse( &eventBuffers[ 0 ], pFirstBlocks, pFirstSizes, 2, pFileBlock );
+    otaWaitForEmptyEvent();
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    /* A duplicate block in a response does not hold up the blocks after it. */
+    otaReceiveMultiBlockResponse( &eventBuffers[ 1 ], pLastBlocks, pLastSizes, 2, pFileBlock );
+
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+
+    /* Check if received complete file. */
+    for( idx = 0; idx < OTA_TEST_FILE_SIZE; ++idx )
+    {
+        TEST_ASSERT_EQUAL( pFileBlock[ idx % sizeof( pFileBlock ) ], pOtaFileBuffer[ idx ] );
+    }
+}
+
+void test_OTA_ReceiveMultiBlockStreamResponseTooManyBlocks()
+{
+    OtaEventData_t eventBuffer;
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    int pBlocks[] = { 0, 1, 2 };
+    size_t pSizes[] = { 16, 16, 16 };
+
+    otaGoToState( OtaAgentStateWaitingForFileBlock );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForFileBlock, OTA_GetState() );
+
+    otaInterfaces.os.event.send = mockOSEventSend;
+
+    /* A response with more blocks than otaconfigMQTT_MAX_BLOCKS_PER_RESPONSE is rejected. */
+    otaReceiveMultiBlockResponse( &eventBuffer, pBlocks, pSizes, 3, pFileBlock );
+    otaWaitForState( OtaAgentStateWaitingForJob );
+    TEST_ASSERT_EQUAL( OtaAgentStateWaitingForJob, OTA_GetState() );
+}
+
 void test_OTA_ReceiveFileBlockCompleteMqttSigCheckFail()
 {
     otaInterfaces.pal.closeFile = mockPalCloseFileSigCheckFail;
@@ -1628,7 +3280,13 @@ void test_OTA_Err_strerror( void )
     err = OtaErrActivateFailed;
     str = OTA_Err_strerror( err );
     TEST_ASSERT_EQUAL_STRING( "OtaErrActivateFailed", str );
-    err = OtaErrActivateFailed + 1;
+    err = OtaErrUrlExpired;
+    str = OTA_Err_strerror( err );
+    TEST_ASSERT_EQUAL_STRING( "OtaErrUrlExpired", str );
+    err = OtaErrStaleFileBlock;
+    str = OTA_Err_strerror( err );
+    TEST_ASSERT_EQUAL_STRING( "OtaErrStaleFileBlock", str );
+    err = OtaErrStaleFileBlock + 1;
     str = OTA_Err_strerror( err );
     TEST_ASSERT_EQUAL_STRING( "InvalidErrorCode", str );
 }
@@ -1780,6 +3438,183 @@ void test_OTA_JobParse_strerror( void )
     TEST_ASSERT_EQUAL_STRING( "InvalidErrorCode", str );
 }
 
+/**
+ * @brief Test that JSON stream requests are encoded with a Base64 bitmap.
+ */
+void test_OTA_EncodeStreamRequestJson( void )
+{
+    char pMessage[ OTA_REQUEST_MSG_MAX_SIZE ] = { 0 };
+    char pExpected[ OTA_REQUEST_MSG_MAX_SIZE ] = { 0 };
+    uint8_t pBitmap[] = { 0xff, 0x07 };
+    size_t messageSize = 0;
+
+    snprintf( pExpected, sizeof( pExpected ), "{\"c\":\"rdy\",\"f\":0,\"l\":%u,\"o\":0,\"n\":%d,\"b\":\"/wc=\"}",
+              OTA_FILE_BLOCK_SIZE, otaconfigMAX_NUM_BLOCKS_REQUEST );
+
+    TEST_ASSERT_TRUE( encodeStreamRequestJson_Mqtt( pMessage,
+                                                    sizeof( pMessage ),
+                                                    &messageSize,
+                                                    "rdy",
+                                                    0,
+                                                    OTA_FILE_BLOCK_SIZE,
+                                                    0,
+                                                    pBitmap,
+                                                    sizeof( pBitmap ),
+                                                    otaconfigMAX_NUM_BLOCKS_REQUEST ) );
+    TEST_ASSERT_EQUAL_STRING( pExpected, pMessage );
+    TEST_ASSERT_EQUAL( strlen( pExpected ), messageSize );
+
+    /* No room for the terminator. */
+    TEST_ASSERT_FALSE( encodeStreamRequestJson_Mqtt( pMessage,
+                                                     strlen( pExpected ),
+                                                     &messageSize,
+                                                     "rdy",
+                                                     0,
+                                                     OTA_FILE_BLOCK_SIZE,
+                                                     0,
+                                                     pBitmap,
+                                                     sizeof( pBitmap ),
+                                                     otaconfigMAX_NUM_BLOCKS_REQUEST ) );
+}
+
+/**
+ * @brief Test that the Base64 payload of JSON stream responses is decoded into the payload buffer.
+ */
+void test_OTA_DecodeStreamResponseJson( void )
+{
+    uint8_t pFileBlock[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t pDecoded[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    char pMessage[ OTA_FILE_BLOCK_SIZE * 2 ] = { 0 };
+    uint8_t * pPayload = pDecoded;
+    size_t payloadSize = sizeof( pDecoded );
+    size_t encodedSize = 0;
+    size_t messageSize = 0;
+    int32_t fileId = 0;
+    int32_t blockId = 0;
+    int32_t blockSize = 0;
+    int idx = 0;
+
+    for( idx = 0; idx < sizeof( pFileBlock ); idx++ )
+    {
+        pFileBlock[ idx ] = idx % UINT8_MAX;
+    }
+
+    messageSize = snprintf( pMessage, sizeof( pMessage ), "{\"c\":\"rdy\",\"f\":1,\"i\":2,\"l\":%u,\"p\":\"", OTA_FILE_BLOCK_SIZE );
+    TEST_ASSERT_EQUAL( Base64Success, base64Encode( ( uint8_t * ) &pMessage[ messageSize ],
+                                                    sizeof( pMessage ) - messageSize,
+                                                    &encodedSize,
+                                                    pFileBlock,
+                                                    sizeof( pFileBlock ) ) );
+    messageSize += encodedSize;
+    memcpy( &pMessage[ messageSize ], "\"}", 2 );
+    messageSize += 2;
+
+    TEST_ASSERT_TRUE( decodeStreamResponseJson_Mqtt( ( uint8_t * ) pMessage,
+                                                     messageSize,
+                                                     &fileId,
+                                                     &blockId,
+                                                     &blockSize,
+                                                     &pPayload,
+                                                     &payloadSize ) );
+    TEST_ASSERT_EQUAL( 1, fileId );
+    TEST_ASSERT_EQUAL( 2, blockId );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE, blockSize );
+    TEST_ASSERT_EQUAL( OTA_FILE_BLOCK_SIZE, payloadSize );
+    TEST_ASSERT_EQUAL_MEMORY( pFileBlock, pDecoded, OTA_FILE_BLOCK_SIZE );
+
+    /* The payload does not fit in the payload buffer. */
+    payloadSize = sizeof( pDecoded ) - 1;
+    TEST_ASSERT_FALSE( decodeStreamResponseJson_Mqtt( ( uint8_t * ) pMessage,
+                                                      messageSize,
+                                                      &fileId,
+                                                      &blockId,
+                                                      &blockSize,
+                                                      &pPayload,
+                                                      &payloadSize ) );
+
+    /* The payload is not valid Base64. */
+    payloadSize = sizeof( pDecoded );
+    pMessage[ messageSize - 3 ] = '!';
+    TEST_ASSERT_FALSE( decodeStreamResponseJson_Mqtt( ( uint8_t * ) pMessage,
+                                                      messageSize,
+                                                      &fileId,
+                                                      &blockId,
+                                                      &blockSize,
+                                                      &pPayload,
+                                                      &payloadSize ) );
+
+    /* A CBOR stream response is not a JSON stream response. */
+    payloadSize = sizeof( pDecoded );
+    createOtaStreammingMessage( ( uint8_t * ) pMessage,
+                                sizeof( pMessage ),
+                                0,
+                                pFileBlock,
+                                OTA_FILE_BLOCK_SIZE,
+                                &messageSize );
+    TEST_ASSERT_FALSE( decodeStreamResponseJson_Mqtt( ( uint8_t * ) pMessage,
+                                                      messageSize,
+                                                      &fileId,
+                                                      &blockId,
+                                                      &blockSize,
+                                                      &pPayload,
+                                                      &payloadSize ) );
+}
+
+void test_OTA_DecodeStreamResponseJsonLayout( void )
+{
+    /* The keys in any order, with whitespace, duplicate and unknown keys. */
+    const char * pValidMessage = " { \"i\" : 2 ,\"x\":{\"a\":[1,\"}\\u0041\"]},\"p\":\"AAEC\", \"l\":3,"
+                                 "\"f\":1,\"f\":-5,\"t\":true,\"n\":null,\"d\":-1.5e3 }\r\n";
+    const char * pInvalidMessages[] =
+    {
+        "{\"f\":1,\"i\":2,\"l\":3}",                          /* No payload. */
+        "{\"f\":-1,\"i\":2,\"l\":3,\"p\":\"AAEC\"}",          /* Negative file ID. */
+        "{\"f\":2147483648,\"i\":2,\"l\":3,\"p\":\"AAEC\"}",  /* File ID too large. */
+        "{\"f\":01,\"i\":2,\"l\":3,\"p\":\"AAEC\"}",          /* Leading zero. */
+        "{\"f\":1.5,\"i\":2,\"l\":3,\"p\":\"AAEC\"}",         /* Not an integer. */
+        "{\"f\":1,\"i\":2,\"l\":3,\"p\":4}",                  /* Payload is not a string. */
+        "{\"f\":1,\"i\":2,\"l\":3,\"p\":\"AAEC\"} x",         /* Trailing garbage. */
+        "{\"f\":1,\"i\":2,\"l\":3,\"p\":\"AAEC\"",            /* Object not closed. */
+        "{\"f\":1,\"i\":2,\"l\":3,\"p\":\"AAEC\",}",          /* Trailing comma. */
+        "{\"f\":1,\"i\":2,\"l\":3,\"x\":\"\\q\",\"p\":\"AAEC\"}", /* Invalid escape. */
+        "{\"f\":1,\"i\":2,\"l\":3,\"x\":[1,}],\"p\":\"AAEC\"}",  /* Invalid nested value. */
+        "{\"f\":1,\"i\":2,\"l\":3,\"x\":tru,\"p\":\"AAEC\"}",   /* Invalid literal. */
+    };
+    const uint8_t pExpected[] = { 0, 1, 2 };
+    uint8_t pDecoded[ 8 ] = { 0 };
+    uint8_t * pPayload = pDecoded;
+    size_t payloadSize = sizeof( pDecoded );
+    int32_t fileId = 0;
+    int32_t blockId = 0;
+    int32_t blockSize = 0;
+    int idx = 0;
+
+    TEST_ASSERT_TRUE( decodeStreamResponseJson_Mqtt( ( const uint8_t * ) pValidMessage,
+                                                     strlen( pValidMessage ),
+                                                     &fileId,
+                                                     &blockId,
+                                                     &blockSize,
+                                                     &pPayload,
+                                                     &payloadSize ) );
+    TEST_ASSERT_EQUAL( 1, fileId );
+    TEST_ASSERT_EQUAL( 2, blockId );
+    TEST_ASSERT_EQUAL( 3, blockSize );
+    TEST_ASSERT_EQUAL( sizeof( pExpected ), payloadSize );
+    TEST_ASSERT_EQUAL_MEMORY( pExpected, pDecoded, sizeof( pExpected ) );
+
+    for( idx = 0; idx < ( int ) ( sizeof( pInvalidMessages ) / sizeof( pInvalidMessages[ 0 ] ) ); idx++ )
+    {
+        payloadSize = sizeof( pDecoded );
+        TEST_ASSERT_FALSE( decodeStreamResponseJson_Mqtt( ( const uint8_t * ) pInvalidMessages[ idx ],
+                                                          strlen( pInvalidMessages[ idx ] ),
+                                                          &fileId,
+                                                          &blockId,
+                                                          &blockSize,
+                                                          &pPayload,
+                                                          &payloadSize ) );
+    }
+}
+
 /**
  * @brief Test OTA_MQTT_strerror returns correct strings.
  */
@@ -1825,7 +3660,35 @@ void test_OTA_HTTP_strerror( void )
     status = OtaHttpRequestFailed;
     str = OTA_HTTP_strerror( status );
     TEST_ASSERT_EQUAL_STRING( "OtaHttpRequestFailed", str );
-    status = OtaHttpRequestFailed + 1;
+    status = OtaHttpUrlExpired;
+    str = OTA_HTTP_strerror( status );
+    TEST_ASSERT_EQUAL_STRING( "OtaHttpUrlExpired", str );
+    status = OtaHttpUrlExpired + 1;
     str = OTA_HTTP_strerror( status );
     TEST_ASSERT_EQUAL_STRING( "InvalidErrorCode", str );
 }
+
+/**
+ * @brief Test OTA_COAP_strerror returns correct strings.
+ */
+void test_OTA_COAP_strerror( void )
+{
+    OtaCoapStatus_t status;
+    const char * str = NULL;
+
+    status = OtaCoapSuccess;
+    str = OTA_COAP_strerror( status );
+    TEST_ASSERT_EQUAL_STRING( "OtaCoapSuccess", str );
+    status = OtaCoapInitFailed;
+    str = OTA_COAP_strerror( status );
+    TEST_ASSERT_EQUAL_STRING( "OtaCoapInitFailed", str );
+    status = OtaCoapDeinitFailed;
+    str = OTA_COAP_strerror( status );
+    TEST_ASSERT_EQUAL_STRING( "OtaCoapDeinitFailed", str );
+    status = OtaCoapRequestFailed;
+    str = OTA_COAP_strerror( status );
+    TEST_ASSERT_EQUAL_STRING( "OtaCoapRequestFailed", str );
+    status = OtaCoapRequestFailed + 1;
+    str = OTA_COAP_strerror( status );
+    TEST_ASSERT_EQUAL_STRING( "InvalidErrorCode", str );
+}
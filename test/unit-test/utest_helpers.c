@@ -45,6 +45,23 @@ CborError createOtaStreammingMessage( uint8_t * pMessageBuffer,
                                       uint8_t * pBlockPayload,
                                       size_t blockPayloadSize,
                                       size_t * pEncodedSize )
+{
+    return createOtaStreammingMessageForFile( pMessageBuffer,
+                                              messageBufferSize,
+                                              CBOR_TEST_FILEIDENTITY_VALUE,
+                                              blockIndex,
+                                              pBlockPayload,
+                                              blockPayloadSize,
+                                              pEncodedSize );
+}
+
+CborError createOtaStreammingMessageForFile( uint8_t * pMessageBuffer,
+                                             size_t messageBufferSize,
+                                             int fileId,
+                                             int blockIndex,
+                                             uint8_t * pBlockPayload,
+                                             size_t blockPayloadSize,
+                                             size_t * pEncodedSize )
 {
     CborError cborResult = CborNoError;
     CborEncoder cborEncoder, cborMapEncoder;
@@ -72,7 +89,7 @@ CborError createOtaStreammingMessage( uint8_t * pMessageBuffer,
     {
         cborResult = cbor_encode_int(
             &cborMapEncoder,
-            CBOR_TEST_FILEIDENTITY_VALUE );
+            fileId );
     }
 
     /* Encode the block identity. */
@@ -139,3 +156,444 @@ CborError createOtaStreammingMessage( uint8_t * pMessageBuffer,
 
     return cborResult;
 }
+
+CborError createOtaMultiBlockStreamingMessage( uint8_t * pMessageBuffer,
+                                               size_t messageBufferSize,
+                                               const int * pBlockIndices,
+                                               const size_t * pBlockSizes,
+                                               size_t numBlocks,
+                                               uint8_t * pBlockPayload,
+                                               size_t * pEncodedSize )
+{
+    CborError cborResult = CborNoError;
+    CborEncoder cborEncoder, cborMapEncoder, cborArrayEncoder, cborBlockEncoder;
+    size_t i = 0;
+
+    /* Initialize the CBOR encoder. */
+    cbor_encoder_init(
+        &cborEncoder,
+        pMessageBuffer,
+        messageBufferSize,
+        0 );
+    cborResult = cbor_encoder_create_map(
+        &cborEncoder,
+        &cborMapEncoder,
+        2 );
+
+    /* Encode the file identity. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_text_stringz(
+            &cborMapEncoder,
+            OTA_CBOR_FILEID_KEY );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_int(
+            &cborMapEncoder,
+            CBOR_TEST_FILEIDENTITY_VALUE );
+    }
+
+    /* Encode the array of blocks, each with the first bytes of the payload. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_text_stringz(
+            &cborMapEncoder,
+            OTA_CBOR_BLOCKS_KEY );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_create_array(
+            &cborMapEncoder,
+            &cborArrayEncoder,
+            numBlocks );
+    }
+
+    for( i = 0; ( CborNoError == cborResult ) && ( i < numBlocks ); i++ )
+    {
+        cborResult = cbor_encoder_create_map(
+            &cborArrayEncoder,
+            &cborBlockEncoder,
+            3 );
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_encode_text_stringz(
+                &cborBlockEncoder,
+                OTA_CBOR_BLOCKID_KEY );
+        }
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_encode_int(
+                &cborBlockEncoder,
+                pBlockIndices[ i ] );
+        }
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_encode_text_stringz(
+                &cborBlockEncoder,
+                OTA_CBOR_BLOCKSIZE_KEY );
+        }
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_encode_int(
+                &cborBlockEncoder,
+                ( int64_t ) pBlockSizes[ i ] );
+        }
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_encode_text_stringz(
+                &cborBlockEncoder,
+                OTA_CBOR_BLOCKPAYLOAD_KEY );
+        }
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_encode_byte_string(
+                &cborBlockEncoder,
+                pBlockPayload,
+                pBlockSizes[ i ] );
+        }
+
+        if( CborNoError == cborResult )
+        {
+            cborResult = cbor_encoder_close_container_checked(
+                &cborArrayEncoder,
+                &cborBlockEncoder );
+        }
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_close_container_checked(
+            &cborMapEncoder,
+            &cborArrayEncoder );
+    }
+
+    /* Done with the encoder. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_close_container_checked(
+            &cborEncoder,
+            &cborMapEncoder );
+    }
+
+    /* Get the encoded size. */
+    if( ( CborNoError == cborResult ) && ( pEncodedSize != NULL ) )
+    {
+        *pEncodedSize = cbor_encoder_get_buffer_size(
+            &cborEncoder,
+            pMessageBuffer );
+    }
+
+    return cborResult;
+}
+
+static CborError encodeTextEntry( CborEncoder * pMapEncoder,
+                                  const char * pKey,
+                                  const char * pValue )
+{
+    CborError cborResult = CborNoError;
+
+    cborResult = cbor_encode_text_stringz(
+        pMapEncoder,
+        pKey );
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_text_stringz(
+            pMapEncoder,
+            pValue );
+    }
+
+    return cborResult;
+}
+
+static CborError encodeUintEntry( CborEncoder * pMapEncoder,
+                                  const char * pKey,
+                                  uint64_t value )
+{
+    CborError cborResult = CborNoError;
+
+    cborResult = cbor_encode_text_stringz(
+        pMapEncoder,
+        pKey );
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_uint(
+            pMapEncoder,
+            value );
+    }
+
+    return cborResult;
+}
+
+CborError createOtaCborJobDocument( uint8_t * pMessageBuffer,
+                                    size_t messageBufferSize,
+                                    const uint8_t * pSignature,
+                                    size_t signatureSize,
+                                    size_t * pEncodedSize )
+{
+    CborError cborResult = CborNoError;
+    CborEncoder cborEncoder, cborDocEncoder, cborExecutionEncoder, cborJobDocEncoder;
+    CborEncoder cborOtaEncoder, cborProtocolsEncoder, cborFilesEncoder, cborFileEncoder;
+
+    /* Initialize the CBOR encoder. */
+    cbor_encoder_init(
+        &cborEncoder,
+        pMessageBuffer,
+        messageBufferSize,
+        0 );
+    cborResult = cbor_encoder_create_map(
+        &cborEncoder,
+        &cborDocEncoder,
+        3 );
+
+    /* Encode the fields of the job execution message. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = encodeTextEntry(
+            &cborDocEncoder,
+            "clientToken",
+            "0:testclient" );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = encodeUintEntry(
+            &cborDocEncoder,
+            "timestamp",
+            1602795143U );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_text_stringz(
+            &cborDocEncoder,
+            "execution" );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_create_map(
+            &cborDocEncoder,
+            &cborExecutionEncoder,
+            3 );
+    }
+
+    /* Encode the job execution. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = encodeTextEntry(
+            &cborExecutionEncoder,
+            "jobId",
+            CBOR_TEST_JOB_ID_VALUE );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = encodeTextEntry(
+            &cborExecutionEncoder,
+            "status",
+            "QUEUED" );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_text_stringz(
+            &cborExecutionEncoder,
+            "jobDocument" );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_create_map(
+            &cborExecutionEncoder,
+            &cborJobDocEncoder,
+            1 );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_text_stringz(
+            &cborJobDocEncoder,
+            "afr_ota" );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_create_map(
+            &cborJobDocEncoder,
+            &cborOtaEncoder,
+            3 );
+    }
+
+    /* Encode the OTA job document. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_text_stringz(
+            &cborOtaEncoder,
+            "protocols" );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_create_array(
+            &cborOtaEncoder,
+            &cborProtocolsEncoder,
+            1 );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_text_stringz(
+            &cborProtocolsEncoder,
+            CBOR_TEST_PROTOCOLS_VALUE );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_close_container_checked(
+            &cborOtaEncoder,
+            &cborProtocolsEncoder );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = encodeTextEntry(
+            &cborOtaEncoder,
+            "streamname",
+            CBOR_TEST_STREAM_NAME_VALUE );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_text_stringz(
+            &cborOtaEncoder,
+            "files" );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_create_array(
+            &cborOtaEncoder,
+            &cborFilesEncoder,
+            1 );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_create_map(
+            &cborFilesEncoder,
+            &cborFileEncoder,
+            5 );
+    }
+
+    /* Encode the file, with the raw signature. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = encodeTextEntry(
+            &cborFileEncoder,
+            "filepath",
+            CBOR_TEST_FILE_PATH_VALUE );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = encodeUintEntry(
+            &cborFileEncoder,
+            "filesize",
+            CBOR_TEST_FILE_SIZE_VALUE );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = encodeUintEntry(
+            &cborFileEncoder,
+            "fileid",
+            CBOR_TEST_FILEIDENTITY_VALUE );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = encodeTextEntry(
+            &cborFileEncoder,
+            "certfile",
+            CBOR_TEST_CERT_FILE_VALUE );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_text_stringz(
+            &cborFileEncoder,
+            "sig-sha256-ecdsa" );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encode_byte_string(
+            &cborFileEncoder,
+            pSignature,
+            signatureSize );
+    }
+
+    /* Done with the encoders. */
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_close_container_checked(
+            &cborFilesEncoder,
+            &cborFileEncoder );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_close_container_checked(
+            &cborOtaEncoder,
+            &cborFilesEncoder );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_close_container_checked(
+            &cborJobDocEncoder,
+            &cborOtaEncoder );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_close_container_checked(
+            &cborExecutionEncoder,
+            &cborJobDocEncoder );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_close_container_checked(
+            &cborDocEncoder,
+            &cborExecutionEncoder );
+    }
+
+    if( CborNoError == cborResult )
+    {
+        cborResult = cbor_encoder_close_container_checked(
+            &cborEncoder,
+            &cborDocEncoder );
+    }
+
+    /* Get the encoded size. */
+    if( ( CborNoError == cborResult ) && ( pEncodedSize != NULL ) )
+    {
+        *pEncodedSize = cbor_encoder_get_buffer_size(
+            &cborEncoder,
+            pMessageBuffer );
+    }
+
+    return cborResult;
+}
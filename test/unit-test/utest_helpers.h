@@ -32,6 +32,14 @@
 #define CBOR_TEST_CLIENTTOKEN_VALUE                       "ThisIsAClientToken"
 #define CBOR_TEST_FILEIDENTITY_VALUE                      0
 
+/* Values of the CBOR job document, the ones of the JSON job document of the job parsing tests. */
+#define CBOR_TEST_JOB_ID_VALUE                            "AFR_OTA-testjob20"
+#define CBOR_TEST_PROTOCOLS_VALUE                         "MQTT"
+#define CBOR_TEST_STREAM_NAME_VALUE                       "AFR_OTA-XYZ"
+#define CBOR_TEST_FILE_PATH_VALUE                         "/test/demo"
+#define CBOR_TEST_FILE_SIZE_VALUE                         180568U
+#define CBOR_TEST_CERT_FILE_VALUE                         "test.crt"
+
 CborError createOtaStreammingMessage( uint8_t * pMessageBuffer,
                                       size_t messageBufferSize,
                                       int blockIndex,
@@ -39,4 +47,26 @@ CborError createOtaStreammingMessage( uint8_t * pMessageBuffer,
                                       size_t blockPayloadSize,
                                       size_t * pEncodedSize );
 
+CborError createOtaStreammingMessageForFile( uint8_t * pMessageBuffer,
+                                             size_t messageBufferSize,
+                                             int fileId,
+                                             int blockIndex,
+                                             uint8_t * pBlockPayload,
+                                             size_t blockPayloadSize,
+                                             size_t * pEncodedSize );
+
+CborError createOtaMultiBlockStreamingMessage( uint8_t * pMessageBuffer,
+                                               size_t messageBufferSize,
+                                               const int * pBlockIndices,
+                                               const size_t * pBlockSizes,
+                                               size_t numBlocks,
+                                               uint8_t * pBlockPayload,
+                                               size_t * pEncodedSize );
+
+CborError createOtaCborJobDocument( uint8_t * pMessageBuffer,
+                                    size_t messageBufferSize,
+                                    const uint8_t * pSignature,
+                                    size_t signatureSize,
+                                    size_t * pEncodedSize );
+
 #endif /* ifndef _UTEST_HELPERS_ */
@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+"""Generate the hash table of the key paths of the OTA job document model.
+
+The table maps every key path of otaJobDocModelParamStructure in source/ota.c, and
+every key path prefix, to its own slot, so that the agent finds a key path with one
+probe. The header also defines the index of every parameter of the model, named after
+its key macro, for the code that reads the values of given parameters. The build of test/CMakeLists.txt generates the table with --output, so that a
+change of the model is picked up by the build. The checked in table is used by the
+builds that do not run the script, run the script again after changing the model:
+
+    python3 tools/json_key_table.py
+
+With --check the script only verifies that source/include/ota_job_doc_key_table.h is
+up to date, the CI runs it. With --keys it prints the table of the given keys instead,
+for the models of the unit tests.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+PRIVATE_HEADER = os.path.join(ROOT, "source", "include", "ota_private.h")
+AGENT_SOURCE = os.path.join(ROOT, "source", "ota.c")
+TABLE_HEADER = os.path.join(ROOT, "source", "include", "ota_job_doc_key_table.h")
+
+MODEL_NAME = "otaJobDocModelParamStructure"
+TABLE_NAME = "otaJobDocKeyTable"
+
+FNV_OFFSET_BASIS = 2166136261
+FNV_PRIME = 16777619
+FIRST_MULTIPLIER = 2654435761
+MAX_MULTIPLIERS = 1 << 20
+SEPARATOR = "."
+
+LICENSE = """/*
+ * FreeRTOS OTA V2.0.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+"""
+
+
+def read_macros(path):
+    """Return the object-like macros of a header as lists of tokens."""
+    macros = {}
+    pattern = re.compile(r"^#define\s+(\w+)\s+(.*?)\s*(/\*.*)?$")
+
+    with open(path, encoding="utf-8") as header:
+        for line in header:
+            match = pattern.match(line.strip())
+
+            if match is not None:
+                macros[match.group(1)] = re.findall(r'"(?:[^"\\]|\\.)*"|\w+|\S', match.group(2))
+
+    return macros
+
+
+def expand_key(name, macros):
+    """Expand a macro made of string literals and other macros, None if it is not one."""
+    key = None
+
+    if name in macros:
+        key = ""
+
+        for token in macros[name]:
+            if token.startswith('"'):
+                key += token[1:-1]
+            else:
+                part = expand_key(token, macros)
+
+                if part is None:
+                    return None
+
+                key += part
+
+    return key
+
+
+def read_model(macros):
+    """Return the key macros of the job document model and their keys, None for a key only
+    known at run time."""
+    with open(AGENT_SOURCE, encoding="utf-8") as source:
+        text = source.read()
+
+    start = text.index(MODEL_NAME + "[")
+    body = text[text.index("{", start) + 1:text.index("};", start)]
+
+    return [(name, expand_key(name, macros)) for name in re.findall(r"\{\s*(\w+)\s*,", body)]
+
+
+def index_name(key_macro):
+    """Return the name of the index macro of a model parameter, from the name of its key macro:
+    OTA_JSON_JOB_ID_KEY gives OTA_JOB_DOC_PARAM_JOB_ID, OTA_JsonFileSignatureKey gives
+    OTA_JOB_DOC_PARAM_FILE_SIGNATURE."""
+    name = re.sub(r"^OTA_", "", key_macro)
+    name = re.sub(r"^(JSON_|Json)", "", name)
+    name = re.sub(r"(_KEY|Key)$", "", name)
+    name = re.sub(r"([a-z0-9])([A-Z])", r"\1_\2", name).upper()
+
+    return "OTA_JOB_DOC_PARAM_" + name
+
+
+def format_indices(names):
+    """Return the index macros of the parameters of the job document model."""
+    width = max(len(index_name(name)) for name in names) + 1
+    lines = ["/* Indices of the parameters in %s. */" % MODEL_NAME]
+
+    for param, name in enumerate(names):
+        lines.append("#define %s %uU" % (index_name(name).ljust(width), param))
+
+    lines.append("")
+    lines.append("/* Number of parameters of %s. */" % MODEL_NAME)
+    lines.append("#define %s %uU" % ("OTA_JOB_DOC_NUM_PARAMS".ljust(width), len(names)))
+
+    return "\n".join(lines) + "\n"
+
+
+def hash_key(hash_value, key):
+    """Continue the FNV-1a hash of a key path, like hashJsonKey in ota.c."""
+    for byte in key.encode("utf-8"):
+        hash_value ^= byte
+        hash_value = (hash_value * FNV_PRIME) & 0xFFFFFFFF
+
+    return hash_value
+
+
+def key_paths(keys):
+    """Return the key paths and key path prefixes of the model, like the agent matches them."""
+    paths = []
+    index = {}
+
+    for param, key in enumerate(keys):
+        if key is None:
+            continue
+
+        offset = 0
+
+        while True:
+            end = key.find(SEPARATOR, offset)
+            end = len(key) if end < 0 else end
+            path = key[:end]
+
+            if path not in index:
+                index[path] = len(paths)
+                paths.append({"path": path, "hash": hash_key(FNV_OFFSET_BASIS, path), "matches": 0,
+                              "children": 0, "offset": offset, "length": end - offset, "param": param})
+
+            entry = paths[index[path]]
+
+            if end == len(key):
+                entry["matches"] |= 1 << param
+                break
+
+            entry["children"] |= 1 << param
+            offset = end + 1
+
+    return paths
+
+
+def place_key_paths(paths, bits):
+    """Search a multiplier that maps every key path to its own slot."""
+    size = 1 << bits
+
+    for multiplier in range(FIRST_MULTIPLIER, FIRST_MULTIPLIER + 2 * MAX_MULTIPLIERS, 2):
+        multiplier &= 0xFFFFFFFF
+        slots = [0] * size
+
+        for number, entry in enumerate(paths):
+            slot = ((entry["hash"] * multiplier) & 0xFFFFFFFF) >> (32 - bits)
+
+            if slots[slot] != 0:
+                break
+
+            slots[slot] = number + 1
+        else:
+            return multiplier, slots
+
+    sys.exit("No multiplier maps the key paths to their own slots, raise OTA_JSON_KEY_TABLE_BITS.")
+
+
+def format_table(name, keys, bits):
+    """Return the C definition of the hash table of the keys."""
+    paths = key_paths(keys)
+
+    if len(paths) > (1 << bits) // 2:
+        sys.exit("The model has more than %u key paths." % ((1 << bits) // 2))
+
+    multiplier, slots = place_key_paths(paths, bits)
+    dynamic = 0
+
+    for param, key in enumerate(keys):
+        if key is None:
+            dynamic |= 1 << param
+
+    lines = ["static const JsonKeyTable_t %s =" % name, "{"]
+    lines.append("    %s /* Multiplier. */" % ("0x%08XU," % multiplier).ljust(12))
+    lines.append("    %s /* Parameters with a key only known at run time. */" % ("0x%08XU," % dynamic).ljust(12))
+    lines.append("    %s /* Number of key paths. */" % ("%uU," % len(paths)).ljust(12))
+    lines.append("    {")
+
+    for number, entry in enumerate(paths):
+        separator = "," if number < len(paths) - 1 else " "
+        lines.append("        { 0x%08XU, 0x%08XU, 0x%08XU, %2uU, %2uU, %2uU }%s /* %s */"
+                     % (entry["hash"], entry["matches"], entry["children"], entry["offset"],
+                        entry["length"], entry["param"], separator, entry["path"]))
+
+    lines.append("    },")
+    lines.append("    {")
+
+    for row in range(0, len(slots), 16):
+        values = ", ".join("%2uU" % slot for slot in slots[row:row + 16])
+        separator = "," if row + 16 < len(slots) else ""
+        lines.append("        %s%s" % (values, separator))
+
+    lines.append("    }")
+    lines.append("};")
+
+    return "\n".join(lines) + "\n"
+
+
+def format_header(model, bits):
+    """Return the header with the parameter indices and the hash table of the job document
+    model."""
+    names = [name for name, _ in model]
+    keys = [key for _, key in model]
+
+    return (LICENSE + """
+/**
+ * @file ota_job_doc_key_table.h
+ * @brief Parameter indices and hash table of the key paths of the OTA job document model.
+ *
+ * Generated by tools/json_key_table.py from otaJobDocModelParamStructure in ota.c.
+ * Do not edit, run the script again after changing the model.
+ *
+ * The table is defined static and only ota.c includes this header, so there is one
+ * copy of it.
+ */
+
+#ifndef OTA_JOB_DOC_KEY_TABLE_H
+#define OTA_JOB_DOC_KEY_TABLE_H
+
+""" + format_indices(names) + """
+/* *INDENT-OFF* */
+""" + format_table(TABLE_NAME, keys, bits) + """/* *INDENT-ON* */
+
+#endif /* ifndef OTA_JOB_DOC_KEY_TABLE_H */
+""")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--check", action="store_true",
+                        help="fail if the checked in table is not up to date")
+    parser.add_argument("--keys", nargs="+", metavar="KEY",
+                        help="print the table of these keys instead of the job document model")
+    parser.add_argument("--name", default="keyTable",
+                        help="name of the table printed for --keys")
+    parser.add_argument("--output", default=TABLE_HEADER, metavar="PATH",
+                        help="write the header to PATH instead of source/include")
+    args = parser.parse_args()
+
+    macros = read_macros(PRIVATE_HEADER)
+    bits = int(macros["OTA_JSON_KEY_TABLE_BITS"][0].rstrip("U"))
+    status = 0
+
+    if args.keys is not None:
+        sys.stdout.write(format_table(args.name, args.keys, bits))
+    else:
+        header = format_header(read_model(macros), bits)
+
+        if args.check:
+            with open(TABLE_HEADER, encoding="utf-8") as table:
+                if table.read() != header:
+                    sys.stderr.write("%s is stale, run tools/json_key_table.py.\n" % TABLE_HEADER)
+                    status = 1
+        else:
+            directory = os.path.dirname(os.path.abspath(args.output))
+
+            if not os.path.isdir(directory):
+                os.makedirs(directory)
+
+            with open(args.output, "w", encoding="utf-8") as table:
+                table.write(header)
+
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())